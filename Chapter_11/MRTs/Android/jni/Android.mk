@@ -10,8 +10,20 @@ LOCAL_MODULE    := MRTs
 LOCAL_CFLAGS    += -DANDROID
 
 
-LOCAL_SRC_FILES := $(COMMON_SRC_PATH)/esShader.c \
+LOCAL_SRC_FILES := $(COMMON_SRC_PATH)/esCamera.c \
+				   $(COMMON_SRC_PATH)/esCull.c \
+				   $(COMMON_SRC_PATH)/esGeometry.c \
+				   $(COMMON_SRC_PATH)/esHierarchy.c \
+				   $(COMMON_SRC_PATH)/esInstance.c \
+				   $(COMMON_SRC_PATH)/esMemory.c \
+				   $(COMMON_SRC_PATH)/esOptimize.c \
+				   $(COMMON_SRC_PATH)/esQuantize.c \
+				   $(COMMON_SRC_PATH)/esQuat.c \
+				   $(COMMON_SRC_PATH)/esShader.c \
 				   $(COMMON_SRC_PATH)/esShapes.c \
+				   $(COMMON_SRC_PATH)/esSimplify.c \
+				   $(COMMON_SRC_PATH)/esTangent.c \
+				   $(COMMON_SRC_PATH)/esThread.c \
 				   $(COMMON_SRC_PATH)/esTransform.c \
 				   $(COMMON_SRC_PATH)/esUtil.c \
 				   $(COMMON_SRC_PATH)/Android/esUtil_Android.c \
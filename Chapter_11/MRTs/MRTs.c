@@ -274,7 +274,7 @@ void ShutDown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
    //עⴰڴС400*400initFBOÿĿҲ400ʹöӦĹģʽ
    esCreateWindow ( esContext, "Multiple Render Targets", 400, 400, ES_WINDOW_RGB | ES_WINDOW_ALPHA );
 
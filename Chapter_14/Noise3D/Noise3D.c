@@ -493,18 +493,18 @@ void Shutdown ( ESContext *esContext )
 
    if ( userData->vertices != NULL )
    {
-      free ( userData->vertices );
+      esFree ( userData->vertices );
    }
 
    if ( userData->indices != NULL )
    {
-      free ( userData->indices );
+      esFree ( userData->indices );
    }
 
    if ( userData->texCoords != NULL );
 
    {
-      free ( userData->texCoords );
+      esFree ( userData->texCoords );
    }
 
    // Delete texture object
@@ -517,7 +517,7 @@ void Shutdown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
 
    esCreateWindow ( esContext, "Noise3D", 800, 600, ES_WINDOW_RGB | ES_WINDOW_DEPTH );
 
@@ -93,7 +93,7 @@ GLuint LoadTexture ( void *ioContext, char *fileName )
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
-   free ( buffer );
+   esFree ( buffer );
 
    return texId;
 }
@@ -295,7 +295,7 @@ void ShutDown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
 
    esCreateWindow ( esContext, "ParticleSystem", 640, 480, ES_WINDOW_RGB );
 
@@ -80,65 +80,41 @@ typedef struct
    ESMatrix  cubeMvpMatrix;
    ESMatrix  cubeMvpLightMatrix;
 
-   float eyePosition[3];//ӽλ
-   float lightPosition[3];//Դλ
+   // Model transforms of the ground and cube
+   ESHierarchy transforms;
+   int         groundNode;
+   int         cubeNode;
+
+   // Cameras for the scene and for the shadow map
+   ESCamera  eyeCamera;
+   ESCamera  lightCamera;
+
+   // Camera versions the MVP matrices were computed for
+   GLuint    mvpEyeVersion;
+   GLuint    mvpLightVersion;
 } UserData;
 
 ///
-// Initialize the MVP matrix
-// ʼMVP
-int InitMVP ( ESContext *esContext )
+// Build the model transforms of the ground and cube
+//
+int InitTransforms ( ESContext *esContext )
 {
-   ESMatrix perspective;
-   ESMatrix ortho;
-   ESMatrix modelview;
    ESMatrix model;
-   ESMatrix view;
-   float    aspect;
    UserData *userData = esContext->userData;
-   
-   // Compute the window aspect ratio
-   aspect = (GLfloat) esContext->width / (GLfloat) esContext->height;
-   
-   // Generate a perspective matrix with a 45 degree FOV for the scene rendering ͶӰ
-   esMatrixLoadIdentity ( &perspective );
-   esPerspective ( &perspective, 45.0f, aspect, 0.1f, 100.0f );
 
-   // Generate an orthographic projection matrix for the shadow map rendering ͶӰ
-   esMatrixLoadIdentity ( &ortho );
-   esOrtho ( &ortho, -10, 10, -10, 10, -30, 30 );
+   if ( !esHierarchyInit ( &userData->transforms, 2 ) )
+   {
+      return FALSE;
+   }
 
    // GROUND
-   // Generate a model view matrix to rotate/translate the ground
+   // Generate a model matrix to rotate/translate the ground
    esMatrixLoadIdentity ( &model );//λ
    // Center the ground
    esTranslate ( &model, -2.0f, -2.0f, 0.0f );//ƽ
    esScale ( &model, 10.0f, 10.0f, 10.0f );//
    esRotate ( &model, 90.0f, 1.0f, 0.0f, 0.0f );//ת
-
-   // create view matrix transformation from the eye position
-   esMatrixLookAt ( &view, 
-                    userData->eyePosition[0], userData->eyePosition[1], userData->eyePosition[2],
-                    0.0f, 0.0f, 0.0f,
-                    0.0f, 1.0f, 0.0f );
-   // MV = M * V
-   esMatrixMultiply ( &modelview, &model, &view );
-
-   // Compute the final ground MVP for the scene rendering by multiplying the 
-   // modelview and perspective matrices together  MVP = MV * P
-   esMatrixMultiply ( &userData->groundMvpMatrix, &modelview, &perspective );
-
-   // create view matrix transformation from the light position
-   esMatrixLookAt ( &view, 
-                    userData->lightPosition[0], userData->lightPosition[1], userData->lightPosition[2],
-                    0.0f, 0.0f, 0.0f,
-                    0.0f, 1.0f, 0.0f );
-
-   esMatrixMultiply ( &modelview, &model, &view );
-
-   // Compute the final ground MVP for the shadow map rendering by multiplying the 
-   // modelview and ortho matrices together
-   esMatrixMultiply ( &userData->groundMvpLightMatrix, &modelview, &ortho );
+   userData->groundNode = esHierarchyAddNode ( &userData->transforms, -1, &model );
 
    // CUBE
    // position the cube
@@ -146,30 +122,42 @@ int InitMVP ( ESContext *esContext )
    esTranslate ( &model, 5.0f, -0.4f, -3.0f );
    esScale ( &model, 1.0f, 2.5f, 1.0f );
    esRotate ( &model, -15.0f, 0.0f, 1.0f, 0.0f );
+   userData->cubeNode = esHierarchyAddNode ( &userData->transforms, -1, &model );
 
-   // create view matrix transformation from the eye position
-   esMatrixLookAt ( &view, 
-                    userData->eyePosition[0], userData->eyePosition[1], userData->eyePosition[2],
-                    0.0f, 0.0f, 0.0f,
-                    0.0f, 1.0f, 0.0f );
+   return TRUE;
+}
 
-   esMatrixMultiply ( &modelview, &model, &view );
-   
-   // Compute the final cube MVP for scene rendering by multiplying the 
-   // modelview and perspective matrices together
-   esMatrixMultiply ( &userData->cubeMvpMatrix, &modelview, &perspective );
+///
+// Initialize the MVP matrix
+// ʼMVP
+int InitMVP ( ESContext *esContext )
+{
+   ESMatrix *model;
+   ESMatrix *eyeViewProj;
+   ESMatrix *lightViewProj;
+   UserData *userData = esContext->userData;
 
-   // create view matrix transformation from the light position
-   esMatrixLookAt ( &view, 
-                    userData->lightPosition[0], userData->lightPosition[1], userData->lightPosition[2],
-                    0.0f, 0.0f, 0.0f,
-                    0.0f, 1.0f, 0.0f );
+   // View * projection of the eye (perspective) and of the light (orthographic),
+   // recomputed by the cameras only when they changed
+   eyeViewProj = ( ESMatrix * ) esCameraGetViewProjection ( &userData->eyeCamera );
+   lightViewProj = ( ESMatrix * ) esCameraGetViewProjection ( &userData->lightCamera );
 
-   esMatrixMultiply ( &modelview, &model, &view );
-   
-   // Compute the final cube MVP for shadow map rendering by multiplying the 
-   // modelview and ortho matrices together
-   esMatrixMultiply ( &userData->cubeMvpLightMatrix, &modelview, &ortho );
+   // GROUND
+   // Model matrix built once in InitTransforms
+   model = &userData->transforms.world[userData->groundNode];
+
+   // MVP = M * ( V * P ) for the scene and for the shadow map
+   esMatrixMultiply ( &userData->groundMvpMatrix, model, eyeViewProj );
+   esMatrixMultiply ( &userData->groundMvpLightMatrix, model, lightViewProj );
+
+   // CUBE
+   model = &userData->transforms.world[userData->cubeNode];
+
+   esMatrixMultiply ( &userData->cubeMvpMatrix, model, eyeViewProj );
+   esMatrixMultiply ( &userData->cubeMvpLightMatrix, model, lightViewProj );
+
+   userData->mvpEyeVersion = userData->eyeCamera.version;
+   userData->mvpLightVersion = userData->lightCamera.version;
 
    return TRUE;
 }
@@ -315,7 +303,7 @@ int Init ( ESContext *esContext )
 
    // Generate the vertex and index data for the ground
    userData->groundGridSize = 3;
-   userData->groundNumIndices = esGenSquareGrid( userData->groundGridSize, &positions, &indices );//Ķλú
+   userData->groundNumIndices = esGenSquareGrid( userData->groundGridSize, 0, &positions, &indices );//Ķλú
 
    // Index buffer object for the ground model
    glGenBuffers ( 1, &userData->groundIndicesIBO );
@@ -323,14 +311,14 @@ int Init ( ESContext *esContext )
    //GPUڴ  ϴ涥
    glBufferData ( GL_ELEMENT_ARRAY_BUFFER, userData->groundNumIndices * sizeof( GLuint ), indices, GL_STATIC_DRAW );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, 0 );
-   free( indices );
+   esFree( indices );
 
    // Position VBO for ground model
    glGenBuffers ( 1, &userData->groundPositionVBO );
    glBindBuffer ( GL_ARRAY_BUFFER, userData->groundPositionVBO );
    //GPUڴ  ϴ涥λ
    glBufferData ( GL_ARRAY_BUFFER, userData->groundGridSize * userData->groundGridSize * sizeof( GLfloat ) * 3,  positions, GL_STATIC_DRAW );
-   free( positions );
+   esFree( positions );
 
    // Generate the vertex and index date for the cube model  ģ͵Ķλú
    userData->cubeNumIndices = esGenCube ( 1.0f, &positions, NULL, NULL, &indices );
@@ -341,22 +329,38 @@ int Init ( ESContext *esContext )
    //GPUڴ ϴģ͵Ķ
    glBufferData ( GL_ELEMENT_ARRAY_BUFFER, sizeof( GLuint ) * userData->cubeNumIndices, indices, GL_STATIC_DRAW );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, 0 );
-   free( indices );
+   esFree( indices );
 
    // Position VBO for cube model
    glGenBuffers ( 1, &userData->cubePositionVBO );
    glBindBuffer ( GL_ARRAY_BUFFER, userData->cubePositionVBO );
    //GPUڴ ϴģ͵Ķλ
    glBufferData ( GL_ARRAY_BUFFER, 24 * sizeof( GLfloat ) * 3, positions, GL_STATIC_DRAW );
-   free( positions );
-
-   // setup transformation matrices
-   userData->eyePosition[0] = -5.0f;//۾λ
-   userData->eyePosition[1] = 3.0f;
-   userData->eyePosition[2] = 5.0f;
-   userData->lightPosition[0] = 10.0f;//Դλ
-   userData->lightPosition[1] = 5.0f;
-   userData->lightPosition[2] = 2.0f;
+   esFree( positions );
+
+   // setup the cameras: a perspective one at the eye position (its aspect ratio
+   // is set in Draw) and an orthographic one at the light position
+   esCameraInit ( &userData->eyeCamera );
+   esCameraLookAt ( &userData->eyeCamera,
+                    -5.0f, 3.0f, 5.0f,
+                    0.0f, 0.0f, 0.0f,
+                    0.0f, 1.0f, 0.0f );
+
+   esCameraInit ( &userData->lightCamera );
+   esCameraLookAt ( &userData->lightCamera,
+                    10.0f, 5.0f, 2.0f,
+                    0.0f, 0.0f, 0.0f,
+                    0.0f, 1.0f, 0.0f );
+   esCameraOrtho ( &userData->lightCamera, -10, 10, -10, 10, -30, 30 );
+
+   // Camera versions start at 1, so the first Draw computes the MVPs
+   userData->mvpEyeVersion = 0;
+   userData->mvpLightVersion = 0;
+
+   if ( !InitTransforms ( esContext ) )
+   {
+      return FALSE;
+   }
    
    // create depth texture  ʼΪfboattachment
    if ( !InitShadowMap( esContext ) )
@@ -427,9 +431,19 @@ void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
    GLint defaultFramebuffer = 0;
+   float aspect = ( GLfloat ) esContext->width / ( GLfloat ) esContext->height;
+
+   // Generate a perspective matrix with a 45 degree FOV for the scene rendering,
+   // a no-op unless the window was resized
+   esCameraPerspective ( &userData->eyeCamera, 45.0f, aspect, 0.1f, 100.0f );
 
-   // Initialize matrices
-   InitMVP ( esContext );
+   // Recompute the MVPs only when an object or a camera changed
+   if ( esHierarchyUpdate ( &userData->transforms ) > 0 ||
+         userData->eyeCamera.version != userData->mvpEyeVersion ||
+         userData->lightCamera.version != userData->mvpLightVersion )
+   {
+      InitMVP ( esContext );
+   }
    //ѯĬϵfbo
    glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &defaultFramebuffer );
 
@@ -500,11 +514,13 @@ void Shutdown ( ESContext *esContext )
    // Delete program object
    glDeleteProgram ( userData->sceneProgramObject );
    glDeleteProgram ( userData->shadowMapProgramObject );
+
+   esHierarchyFree ( &userData->transforms );
 }
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof( UserData ) );
+   esContext->userData = esMalloc ( sizeof( UserData ) );
 
    esCreateWindow ( esContext, "Shadow Rendering", 500, 500, ES_WINDOW_RGB | ES_WINDOW_DEPTH );
    
@@ -47,6 +47,8 @@ typedef struct
    // Uniform locations
    GLint  mvpLoc;
    GLint  lightDirectionLoc;
+   GLint  positionScaleLoc;
+   GLint  positionBiasLoc;
 
    // Sampler location
    GLint samplerLoc;
@@ -58,14 +60,21 @@ typedef struct
    GLuint positionVBO;
    GLuint indicesIBO;
 
+   // Quantized positions, their attribute format and dequantization
+   ESQuantizedVertices positions;
+
    // Number of indices
    int    numIndices;
 
+   // 16-bit index ranges, each drawn relative to its own first vertex
+   ESSubmesh *submeshes;
+   int    numSubmeshes;
+
    // dimension of grid
    int    gridSize;
 
-   // MVP matrix
-   ESMatrix  mvpMatrix;
+   // Camera, its view matrix places the terrain
+   ESCamera  camera;
 } UserData;
 
 ///
@@ -95,27 +104,20 @@ GLuint LoadTexture (  void *ioContext, char *fileName )
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 
-   free ( buffer );
+   esFree ( buffer );
 
    return texId;
 }
 
 ///
-// Initialize the MVP matrix
-// MVP
-int InitMVP ( ESContext *esContext )
+// Initialize the camera
+//
+void InitCamera ( ESContext *esContext )
 {
-   ESMatrix perspective;
    ESMatrix modelview;
-   float    aspect;
    UserData *userData = esContext->userData;
 
-   // Compute the window aspect ratio
-   aspect = ( GLfloat ) esContext->width / ( GLfloat ) esContext->height;
-
-   // Generate a perspective matrix with a 60 degree FOV ͶӰ
-   esMatrixLoadIdentity ( &perspective );
-   esPerspective ( &perspective, 60.0f, aspect, 0.1f, 20.0f );
+   esCameraInit ( &userData->camera );
 
    // Generate a model view matrix to rotate/translate the terrain
    esMatrixLoadIdentity ( &modelview );
@@ -124,11 +126,8 @@ int InitMVP ( ESContext *esContext )
    // Rotate
    esRotate ( &modelview, 45.0f, 1.0, 0.0, 0.0 );
 
-   // Compute the final MVP by multiplying the
-   // modelview and perspective matrices together  MVP = MV * P
-   esMatrixMultiply ( &userData->mvpMatrix, &modelview, &perspective );
-
-   return TRUE;
+   // The terrain has no model matrix of its own, so the model view is the camera's view
+   esCameraSetView ( &userData->camera, &modelview );
 }
 
 ///
@@ -138,26 +137,35 @@ int Init ( ESContext *esContext )
 {
    GLfloat *positions;
    GLuint *indices;
+   GLushort *indices16;
+   ESMeshLayout layout;
+   GLsizeiptr positionsSize = 0;
+   void *memory;
+   static const GLenum positionTypes[ES_MESH_MAX_ATTRIBS] = { GL_UNSIGNED_SHORT, GL_FLOAT, GL_FLOAT };
 
    UserData *userData = esContext->userData;
    const char vShaderStr[] =
       "#version 300 es                                      \n"
       "uniform mat4 u_mvpMatrix;                            \n"
+      "uniform vec2 u_positionScale;                        \n"
+      "uniform vec2 u_positionBias;                         \n"
       "uniform vec3 u_lightDirection;                       \n"//ƽйķ
       "layout(location = 0) in vec4 a_position;             \n"
       "uniform sampler2D s_texture;                         \n"//Ĳ
       "out vec4 v_color;                                    \n"
       "void main()                                          \n"
       "{                                                    \n"
+      "   vec2 position = a_position.xy * u_positionScale   \n"
+      "                   + u_positionBias;                 \n"
       "   // compute vertex normal from height map          \n"//Ӹ߶ͼ㷨
       "   float hxl = textureOffset( s_texture,             \n"
-      "                  a_position.xy, ivec2(-1,  0) ).w;  \n"
+      "                  position, ivec2(-1,  0) ).w;       \n"
       "   float hxr = textureOffset( s_texture,             \n"
-      "                  a_position.xy, ivec2( 1,  0) ).w;  \n"
+      "                  position, ivec2( 1,  0) ).w;       \n"
       "   float hyl = textureOffset( s_texture,             \n"
-      "                  a_position.xy, ivec2( 0, -1) ).w;  \n"
+      "                  position, ivec2( 0, -1) ).w;       \n"
       "   float hyr = textureOffset( s_texture,             \n"
-      "                  a_position.xy, ivec2( 0,  1) ).w;  \n"
+      "                  position, ivec2( 0,  1) ).w;       \n"
       "   vec3 u = normalize( vec3(0.05, 0.0, hxr-hxl) );   \n"
       "   vec3 v = normalize( vec3(0.0, 0.05, hyr-hyl) );   \n"
       "   vec3 normal = cross( u, v );                      \n"//ķ
@@ -167,8 +175,8 @@ int Init ( ESContext *esContext )
       "   v_color = vec4( vec3(diffuse), 1.0 );             \n"
       "                                                     \n"
       "   // get vertex position from height map            \n"
-      "   float h = texture ( s_texture, a_position.xy ).w; \n"
-      "   vec4 v_position = vec4 ( a_position.xy,           \n"//Ӹ߶ͼУȡĸ߶
+      "   float h = texture ( s_texture, position ).w;      \n"
+      "   vec4 v_position = vec4 ( position,                \n"//Ӹ߶ͼУȡĸ߶
       "                            h/2.5,                   \n"
       "                            a_position.w );          \n"
       "   gl_Position = u_mvpMatrix * v_position;           \n"//ת
@@ -190,6 +198,8 @@ int Init ( ESContext *esContext )
    // Get the uniform locations ͳһlocation
    userData->mvpLoc = glGetUniformLocation ( userData->programObject, "u_mvpMatrix" );
    userData->lightDirectionLoc = glGetUniformLocation ( userData->programObject, "u_lightDirection" );
+   userData->positionScaleLoc = glGetUniformLocation ( userData->programObject, "u_positionScale" );
+   userData->positionBiasLoc = glGetUniformLocation ( userData->programObject, "u_positionBias" );
    // Get the sampler location
    userData->samplerLoc = glGetUniformLocation ( userData->programObject, "s_texture" );
 
@@ -201,27 +211,86 @@ int Init ( ESContext *esContext )
       return FALSE;
    }
 
-   // Generate the position and indices of a square grid for the base terrain
+   // Generate the position and indices of a square grid for the base terrain,
+   // as triangle strips walked in bands that reuse the post-transform vertex cache.
+   // esBenchmark reports how this order compares with the default triangle list.
    userData->gridSize = 200;
-   userData->numIndices = esGenSquareGrid ( userData->gridSize, &positions, &indices );//ɶλú
+   userData->numIndices = esGenSquareGrid ( userData->gridSize, ES_SHAPE_TRIANGLE_STRIP | ES_SHAPE_OPTIMIZE_VERTEX_CACHE,
+                                            &positions, &indices );//ɶλú
+
+   // The 200x200 grid has 40000 vertices, which fit one 16-bit submesh: esSplitIndices16
+   // reserves 0xFFFF as the restart index, so a submesh holds at most 65535 vertices.
+   // Larger grids are split into several submeshes
+   userData->numSubmeshes = esSplitIndices16 ( &indices16, &userData->submeshes, GL_TRIANGLE_STRIP,
+                                               indices, userData->numIndices );
+   esFree ( indices );
+
+   if ( userData->numSubmeshes == 0 )
+   {
+      esFree ( positions );
+      return FALSE;
+   }
 
    // Index buffer for base terrain  ݵVBO
    glGenBuffers ( 1, &userData->indicesIBO );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO );
    //GPUڴ棬ϴ
-   glBufferData ( GL_ELEMENT_ARRAY_BUFFER, userData->numIndices * sizeof ( GLuint ), indices, GL_STATIC_DRAW );
+   glBufferData ( GL_ELEMENT_ARRAY_BUFFER,
+                  ( userData->submeshes[userData->numSubmeshes - 1].firstIndex +
+                    userData->submeshes[userData->numSubmeshes - 1].numIndices ) * sizeof ( GLushort ),
+                  indices16, GL_STATIC_DRAW );
    glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, 0 );//ָĬϵbuffer
-   free ( indices );
+   esFree ( indices16 );
 
    // Position VBO for base terrain  λݵVB0
    glGenBuffers ( 1, &userData->positionVBO );
    glBindBuffer ( GL_ARRAY_BUFFER, userData->positionVBO );
    //GPUڴ棬ϴ
-   glBufferData ( GL_ARRAY_BUFFER, userData->gridSize * userData->gridSize * sizeof ( GLfloat ) * 3, positions, GL_STATIC_DRAW );
-   free ( positions );
+   // Positions are normalized 16-bit over the grid bounds, 8 bytes a vertex instead
+   // of 12, encoded straight into the mapped buffer
+   esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT );
+   memory = NULL;
+
+   if ( esQuantizeVertices ( &userData->positions, &layout, positions, userData->gridSize * userData->gridSize,
+                             positionTypes, NULL, &positionsSize ) )
+   {
+      glBufferData ( GL_ARRAY_BUFFER, positionsSize, NULL, GL_STATIC_DRAW );
+      memory = glMapBufferRange ( GL_ARRAY_BUFFER, 0, positionsSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+   }
+
+   if ( memory == NULL || !esQuantizeVertices ( &userData->positions, &layout, positions,
+                                                userData->gridSize * userData->gridSize, positionTypes,
+                                                memory, &positionsSize ) )
+   {
+      if ( memory != NULL )
+      {
+         glUnmapBuffer ( GL_ARRAY_BUFFER );
+      }
+
+      glBindBuffer ( GL_ARRAY_BUFFER, 0 );
+      glDeleteBuffers ( 1, &userData->positionVBO );
+      glDeleteBuffers ( 1, &userData->indicesIBO );
+      esFree ( userData->submeshes );
+      userData->positionVBO = 0;
+      userData->indicesIBO = 0;
+      userData->submeshes = NULL;
+      esFree ( positions );
+      return FALSE;
+   }
+
+   glUnmapBuffer ( GL_ARRAY_BUFFER );
+   esFree ( positions );
+
+   esLogMessage ( "Terrain positions: %d -> %d bytes a vertex, max error %g\n", layout.stride,
+                  userData->positions.stride, userData->positions.maxError[ES_MESH_POSITION] );
+
+   InitCamera ( esContext );
 
    glClearColor ( 1.0f, 1.0f, 1.0f, 0.0f );//ɫ
 
+   // The grid strips are separated by the all-ones index, 0xFFFF for GLushort
+   glEnable ( GL_PRIMITIVE_RESTART_FIXED_INDEX );
+
    return TRUE;
 }
 
@@ -231,8 +300,12 @@ int Init ( ESContext *esContext )
 void Draw ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
+   float     aspect = ( GLfloat ) esContext->width / ( GLfloat ) esContext->height;
+   int       i;
 
-   InitMVP ( esContext );
+   // Generate a perspective matrix with a 60 degree FOV.  The camera only
+   // rebuilds it, and the MVP, when the aspect ratio changes.
+   esCameraPerspective ( &userData->camera, 60.0f, aspect, 0.1f, 20.0f );
 
    // Set the viewport
    glViewport ( 0, 0, esContext->width, esContext->height );
@@ -246,7 +319,6 @@ void Draw ( ESContext *esContext )
    // Load the vertex position ضλ
    glBindBuffer ( GL_ARRAY_BUFFER, userData->positionVBO );
    //ָλVB0еĸʽ͵ַƫ
-   glVertexAttribPointer ( POSITION_LOC, 3, GL_FLOAT, GL_FALSE, 3 * sizeof ( GLfloat ), ( const void * ) NULL );
    glEnableVertexAttribArray ( POSITION_LOC );//ʹܶ
 
    // Bind the index buffer 
@@ -259,12 +331,27 @@ void Draw ( ESContext *esContext )
    glUniform1i(userData->samplerLoc, 0); //ʹԪ0
 
    // Load the MVP matrix MVP
-   glUniformMatrix4fv ( userData->mvpLoc, 1, GL_FALSE, ( GLfloat * ) &userData->mvpMatrix.m[0][0] );
+   glUniformMatrix4fv ( userData->mvpLoc, 1, GL_FALSE, &esCameraGetViewProjection ( &userData->camera )->m[0][0] );
    // Load the light direction ù߷
    glUniform3f ( userData->lightDirectionLoc, 0.86f, 0.14f, 0.49f );
    //printf("   %d \n", userData->numIndices);// 237606
    // Draw the grid Ⱦ
-   glDrawElements ( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, ( const void * ) NULL );
+   // Dequantize the positions
+   glUniform2fv ( userData->positionScaleLoc, 1, userData->positions.scale[ES_MESH_POSITION] );
+   glUniform2fv ( userData->positionBiasLoc, 1, userData->positions.bias[ES_MESH_POSITION] );
+
+   for ( i = 0; i < userData->numSubmeshes; i++ )
+   {
+      const ESSubmesh *submesh = &userData->submeshes[i];
+      const ESVertexAttrib *position = &userData->positions.attribs[ES_MESH_POSITION];
+      GLsizei stride = userData->positions.stride;
+
+      // Indices are relative to the submesh's first vertex
+      glVertexAttribPointer ( POSITION_LOC, position->size, position->type, position->normalized, stride,
+                              ( const void * ) ( GLintptr ) ( position->offset + submesh->baseVertex * stride ) );
+      glDrawElements ( GL_TRIANGLE_STRIP, submesh->numIndices, GL_UNSIGNED_SHORT,
+                       ( const void * ) ( submesh->firstIndex * sizeof ( GLushort ) ) );
+   }
 }
 
 ///
@@ -276,6 +363,7 @@ void Shutdown ( ESContext *esContext )
 
    glDeleteBuffers ( 1, &userData->positionVBO );
    glDeleteBuffers ( 1, &userData->indicesIBO );
+   esFree ( userData->submeshes );
 
    // Delete program object
    glDeleteProgram ( userData->programObject );
@@ -284,7 +372,7 @@ void Shutdown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
 
    esCreateWindow ( esContext, "TerrainRendering", 640, 480, ES_WINDOW_RGB | ES_WINDOW_DEPTH );
 
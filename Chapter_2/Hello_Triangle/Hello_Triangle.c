@@ -220,7 +220,7 @@ void Shutdown ( ESContext *esContext )
 int esMain ( ESContext *esContext )
 {
     //为自定义的userData类型分配内存
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
    //通过egl创建窗口
    esCreateWindow ( esContext, "Hello Triangle", 320, 240, ES_WINDOW_RGB );
 
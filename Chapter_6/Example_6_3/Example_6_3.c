@@ -131,7 +131,7 @@ void Shutdown ( ESContext *esContext )
 int esMain ( ESContext *esContext )
 {
    // ԶĽṹڴ
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
    //ͨEGL
    esCreateWindow ( esContext, "Example 6-3", 320, 240, ES_WINDOW_RGB );
 
@@ -36,6 +36,7 @@
 // 7.2.3 ״ʵ  һεãȾʵ
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include "esUtil.h"
 
 #ifdef _WIN32
@@ -44,7 +45,12 @@
 #endif
 
 
+// Build with -DINSTANCING_STRESS_TEST to draw a million smaller cubes instead of 100
+#ifdef INSTANCING_STRESS_TEST
+#define NUM_INSTANCES   ( 1024 * 1024 )
+#else
 #define NUM_INSTANCES   100
+#endif
 #define POSITION_LOC    0
 #define COLOR_LOC       1
 #define MVP_LOC         2
@@ -54,17 +60,16 @@ typedef struct
    // Handle to a program object
    GLuint programObject;
 
+   // Unit cube from the geometry cache, scaled by the instance scale
+   const ESGeometry *cube;
+
    // VBOs
-   GLuint positionVBO;
    GLuint colorVBO;
    GLuint mvpVBO;
-   GLuint indicesIBO;
 
-   // Number of indices
-   int       numIndices;
-
-   // Rotation angle ÿʵתǶ
-   GLfloat   angle[NUM_INSTANCES];
+   // Per-instance position, orientation and scale.  The orientations are
+   // advanced each frame by a shared rotation step.
+   ESInstanceData instances;
 
 } UserData;
 
@@ -73,8 +78,7 @@ typedef struct
 //
 int Init ( ESContext *esContext )
 {
-   GLfloat *positions;
-   GLuint *indices;
+   ESGeometryDesc cubeDesc;
 
    UserData *userData = esContext->userData;
    const char vShaderStr[] =
@@ -102,31 +106,28 @@ int Init ( ESContext *esContext )
    // Load the shaders and get a linked program object
    userData->programObject = esLoadProgram ( vShaderStr, fShaderStr );
 
-   // Generate the vertex data
-   // ɶλvertices  indices
-   userData->numIndices = esGenCube ( 0.1f, &positions,
-                                      NULL, NULL, &indices );
-
-   // Index buffer object
-   // ʹûϴ
-   glGenBuffers ( 1, &userData->indicesIBO );
-   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO );
-   glBufferData ( GL_ELEMENT_ARRAY_BUFFER, sizeof ( GLuint ) * userData->numIndices, indices, GL_STATIC_DRAW );
-   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, 0 );
-   free ( indices );
-
-   // Position VBO for cube model
-   // ʹVB0ϴλ
-   glGenBuffers ( 1, &userData->positionVBO );
-   glBindBuffer ( GL_ARRAY_BUFFER, userData->positionVBO );
-   glBufferData ( GL_ARRAY_BUFFER, 24 * sizeof ( GLfloat ) * 3, positions, GL_STATIC_DRAW );
-   free ( positions );
+   // Share the unit cube with anything else drawing one; the size of the
+   // cubes goes into the instance scale instead of the vertices
+   memset ( &cubeDesc, 0, sizeof ( cubeDesc ) );
+   cubeDesc.shape = ES_GEOMETRY_CUBE;
+   cubeDesc.attribs = ES_MESH_POSITION_BIT;
+   userData->cube = esAcquireGeometry ( &cubeDesc );
+
+   if ( userData->cube == NULL )
+   {
+      return GL_FALSE;
+   }
 
    // Random color for each instance
    {
-      GLubyte colors[NUM_INSTANCES][4];//ÿʵɫRGBA
+      GLubyte ( *colors ) [4] = esMalloc ( NUM_INSTANCES * 4 );//ÿʵɫRGBA
       int instance;
 
+      if ( colors == NULL )
+      {
+         return GL_FALSE;
+      }
+
       srandom ( 0 );
 
       for ( instance = 0; instance < NUM_INSTANCES; instance++ )
@@ -140,17 +141,41 @@ int Init ( ESContext *esContext )
       glGenBuffers ( 1, &userData->colorVBO );
       glBindBuffer ( GL_ARRAY_BUFFER, userData->colorVBO );
       glBufferData ( GL_ARRAY_BUFFER, NUM_INSTANCES * 4, colors, GL_STATIC_DRAW );
+      esFree ( colors );
    }
 
    // Allocate storage to store MVP per instance
    {
+      ESInstanceData *instances = &userData->instances;
+      int numRows = ( int ) sqrtf ( NUM_INSTANCES );
+      int numColumns = numRows;
+      // Cubes 0.1 across, shrunk when there are more than 10 to a row so they do not overlap
+      GLfloat scale = numRows > 10 ? 1.0f / ( float ) numRows : 0.1f;
       int instance;
 
+      if ( !esInstanceDataInit ( instances, NUM_INSTANCES ) )
+      {
+         return GL_FALSE;
+      }
+
       // Random angle for each instance, compute the MVP later
       // ÿʵתǶȣupdateÿ֡½ǶȣӰmodel-viewӶӰʾ棩
       for ( instance = 0; instance < NUM_INSTANCES; instance++ )
       {
-         userData->angle[instance] = ( float ) ( random() % 32768 ) / 32767.0f * 360.0f;
+         GLfloat angle = ( float ) ( random() % 32768 ) / 32767.0f * 360.0f;
+         ESQuat  orientation;
+
+         // ʵڵУxyλƣ[-1.0, 1.0]֮
+         instances->positionX[instance] = ( ( float ) ( instance % numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
+         instances->positionY[instance] = ( ( float ) ( instance / numColumns ) / ( float ) numColumns ) * 2.0f - 1.0f;
+         instances->positionZ[instance] = -2.0f;
+         instances->scale[instance] = scale;
+
+         esQuatFromAxisAngle ( &orientation, angle, 1.0, 0.0, 1.0 );
+         instances->rotationX[instance] = orientation.x;
+         instances->rotationY[instance] = orientation.y;
+         instances->rotationZ[instance] = orientation.z;
+         instances->rotationW[instance] = orientation.w;
       }
       // ΪÿʵMVPGPUڴ
       glGenBuffers ( 1, &userData->mvpVBO );
@@ -173,9 +198,7 @@ void Update ( ESContext *esContext, float deltaTime )
    ESMatrix *matrixBuf;
    ESMatrix perspective;
    float    aspect;
-   int      instance = 0;
-   int      numRows;
-   int      numColumns;
+   ESQuat   step;
 
 
    // Compute the window aspect ratio
@@ -186,41 +209,20 @@ void Update ( ESContext *esContext, float deltaTime )
    esPerspective ( &perspective, 60.0f, aspect, 1.0f, 20.0f );
 
    // ѴmvpGPUڴ ӳ䵽Ӧó
+   // Every matrix is rewritten, so let the driver discard the old contents instead of waiting for the GPU
    glBindBuffer ( GL_ARRAY_BUFFER, userData->mvpVBO );
-   matrixBuf = ( ESMatrix * ) glMapBufferRange ( GL_ARRAY_BUFFER, 0, sizeof ( ESMatrix ) * NUM_INSTANCES, GL_MAP_WRITE_BIT );
+   matrixBuf = ( ESMatrix * ) glMapBufferRange ( GL_ARRAY_BUFFER, 0, sizeof ( ESMatrix ) * NUM_INSTANCES,
+                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
 
-   // Compute a per-instance MVP that translates and rotates each instance differnetly
-   numRows = ( int ) sqrtf ( NUM_INSTANCES );
-   numColumns = numRows;
+   // Every cube spins at 40 degrees per second about the same axis, so the
+   // trig is done once per frame instead of once per instance
+   esQuatFromAxisAngle ( &step, deltaTime * 40.0f, 1.0, 0.0, 1.0 );
 
-   for ( instance = 0; instance < NUM_INSTANCES; instance++ )
-   {
-      ESMatrix modelview;
-      // ʵڵУxyλƣ[-1.0, 1.0]֮
-      float translateX = ( ( float ) ( instance % numRows ) / ( float ) numRows ) * 2.0f - 1.0f;
-      float translateY = ( ( float ) ( instance / numColumns ) / ( float ) numColumns ) * 2.0f - 1.0f;
-
-      // Generate a model view matrix to rotate/translate the cube ʼΪλ
-      esMatrixLoadIdentity ( &modelview );
-
-      // Per-instance translation xyƽ
-      esTranslate ( &modelview, translateX, translateY, -2.0f );
-
-      // Compute a rotation angle based on time to rotate the cube deltaTimeתǶ
-      userData->angle[instance] += ( deltaTime * 40.0f );
-
-      if ( userData->angle[instance] >= 360.0f )
-      {
-         userData->angle[instance] -= 360.0f;
-      }
-
-      // Rotate the cube ת
-      esRotate ( &modelview, userData->angle[instance], 1.0, 0.0, 1.0 );
+   // Advance each orientation by the step and compute the final MVP for every
+   // instance in one pass, writing straight into the mapped buffer
+   // һʵMVP mvp = modevleiw * perspective
+   esInstanceComputeMVPs ( matrixBuf, &userData->instances, &step, &perspective );
 
-      // Compute the final MVP by multiplying the modevleiw and perspective matrices together
-      // һʵMVP mvp = modevleiw * perspective
-      esMatrixMultiply ( &matrixBuf[instance], &modelview, &perspective );
-   }
    // ȡӳ䣨ˢ
    glUnmapBuffer ( GL_ARRAY_BUFFER );
 }
@@ -243,9 +245,9 @@ void Draw ( ESContext *esContext )
 
    // Load the vertex position
    // ָλڻеƫ  ʹܶ
-   glBindBuffer ( GL_ARRAY_BUFFER, userData->positionVBO );
-   glVertexAttribPointer ( POSITION_LOC, 3, GL_FLOAT,
-                           GL_FALSE, 3 * sizeof ( GLfloat ), ( const void * ) NULL );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->cube->vertexBuffer );
+   glVertexAttribPointer ( POSITION_LOC, 3, GL_FLOAT, GL_FALSE, userData->cube->layout.stride,
+                           ( const void * ) ( GLintptr ) userData->cube->layout.offset[ES_MESH_POSITION] );
    glEnableVertexAttribArray ( POSITION_LOC );
 
    // Load the instance color buffer
@@ -280,10 +282,11 @@ void Draw ( ESContext *esContext )
    glVertexAttribDivisor ( MVP_LOC + 3, 1 );
 
    // Bind the index buffer  
-   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->indicesIBO );
+   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->cube->indexBuffer );
 
    // Draw the cubes
-   glDrawElementsInstanced ( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, ( const void * ) NULL, NUM_INSTANCES );
+   glDrawElementsInstanced ( userData->cube->mode, userData->cube->numIndices, userData->cube->indexType,
+                             ( const void * ) NULL, NUM_INSTANCES );
 }
 
 ///
@@ -293,10 +296,11 @@ void Shutdown ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
    // ɾbuffer
-   glDeleteBuffers ( 1, &userData->positionVBO );
    glDeleteBuffers ( 1, &userData->colorVBO );
    glDeleteBuffers ( 1, &userData->mvpVBO );
-   glDeleteBuffers ( 1, &userData->indicesIBO );
+   esReleaseGeometry ( userData->cube );
+
+   esInstanceDataFree ( &userData->instances );
 
    // Delete program object
    glDeleteProgram ( userData->programObject );
@@ -305,10 +309,15 @@ void Shutdown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
 
    esCreateWindow ( esContext, "Instancing", 640, 480, ES_WINDOW_RGB | ES_WINDOW_DEPTH );
 
+#ifdef INSTANCING_STRESS_TEST
+   // Spread the per-instance work over every processor
+   esSetThreadCount ( 0 );
+#endif
+
    if ( !Init ( esContext ) )
    {
       return GL_FALSE;
@@ -181,12 +181,12 @@ void Shutdown ( ESContext *esContext )
 
    if ( userData->vertices != NULL )
    {
-      free ( userData->vertices );
+      esFree ( userData->vertices );
    }
 
    if ( userData->indices != NULL )
    {
-      free ( userData->indices );
+      esFree ( userData->indices );
    }
 
    // Delete program object
@@ -196,7 +196,7 @@ void Shutdown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
 
    esCreateWindow ( esContext, "Simple_VertexShader", 320, 240, ES_WINDOW_RGB | ES_WINDOW_DEPTH );
 
@@ -76,7 +76,7 @@ GLboolean GenMipMap2D ( GLubyte *src, GLubyte **dst, int srcWidth, int srcHeight
       *dstHeight = 1;
    }
 
-   *dst = malloc ( sizeof ( GLubyte ) * texelSize * ( *dstWidth ) * ( *dstHeight ) );
+   *dst = esMalloc ( sizeof ( GLubyte ) * texelSize * ( *dstWidth ) * ( *dstHeight ) );
 
    if ( *dst == NULL )
    {
@@ -134,7 +134,7 @@ GLubyte *GenCheckImage ( int width, int height, int checkSize )
 {
    int x,
        y;
-   GLubyte *pixels = malloc ( width * height * 3 );
+   GLubyte *pixels = esMalloc ( width * height * 3 );
 
    if ( pixels == NULL )
    {
@@ -215,7 +215,7 @@ GLuint CreateMipMappedTexture2D( )
                      GL_UNSIGNED_BYTE, newImage );
 
       // Free the previous image
-      free ( prevImage );
+      esFree ( prevImage );
 
       // Set the previous image for the next iteration
       prevImage = newImage;
@@ -226,7 +226,7 @@ GLuint CreateMipMappedTexture2D( )
       height = newHeight;
    }
 
-   free ( newImage );
+   esFree ( newImage );
 
    // Set the filtering mode ùģʽ
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST );//ѡmipȡõ P170
@@ -355,7 +355,7 @@ void ShutDown ( ESContext *esContext )
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
 
    esCreateWindow ( esContext, "MipMap 2D", 320, 240, ES_WINDOW_RGB );
 
@@ -47,11 +47,9 @@ typedef struct
    // Texture handle
    GLuint textureId;
 
-   // Vertex data
-   int      numIndices;//
-   GLfloat *vertices;//λָ
-   GLfloat *normals;//㷨ָ
-   GLuint  *indices;//ָ
+   // Vertex data, interleaved vertices followed by the indices in one buffer
+   ESMesh   mesh;
+   GLuint   meshVBO;
    //ӵ
    GLint  mvpLoc;// Uniform locations
    GLfloat   angle;// Rotation angle
@@ -126,6 +124,9 @@ GLuint CreateSimpleTextureCubemap( )
 int Init ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
+   ESMeshLayout layout;
+   GLsizeiptr meshSize;
+   void *memory;
    char vShaderStr[] =
       "#version 300 es                            \n"
       "layout(location = 0) in vec4 a_position;   \n"
@@ -161,9 +162,23 @@ int Init ( ESContext *esContext )
    userData->textureId = CreateSimpleTextureCubemap ();
 
    // Generate the vertex data ĶϢ
-   //userData->numIndices = esGenSphere ( 20, 0.75f, &userData->vertices, &userData->normals, NULL, &userData->indices );
+   //userData->numIndices = esGenSphere ( 20, 0.75f, 0, &userData->vertices, &userData->normals, NULL, &userData->indices );
    // Լ޸ĵģ
-   userData->numIndices = esGenCube(1.0, &userData->vertices, &userData->normals, NULL, &userData->indices);
+   // Size the mesh, then generate it straight into the mapped buffer
+   esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT | ES_MESH_NORMAL_BIT );
+   esGenCubeMesh ( &userData->mesh, &layout, 1.0f, NULL, &meshSize );
+
+   glGenBuffers ( 1, &userData->meshVBO );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->meshVBO );
+   glBufferData ( GL_ARRAY_BUFFER, meshSize, NULL, GL_STATIC_DRAW );
+   memory = glMapBufferRange ( GL_ARRAY_BUFFER, 0, meshSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+
+   if ( memory == NULL || !esGenCubeMesh ( &userData->mesh, &layout, 1.0f, memory, &meshSize ) )
+   {
+      return FALSE;
+   }
+
+   glUnmapBuffer ( GL_ARRAY_BUFFER );
 
    glClearColor ( 1.0f, 1.0f, 1.0f, 0.0f );
    return TRUE;
@@ -227,12 +242,14 @@ void Draw ( ESContext *esContext )
    // Use the program object
    glUseProgram ( userData->programObject );
 
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->meshVBO );
+
    // Load the vertex position  ָλõݸʽݵַ
-   glVertexAttribPointer ( 0, 3, GL_FLOAT,
-                           GL_FALSE, 0, userData->vertices );
+   glVertexAttribPointer ( 0, 3, GL_FLOAT, GL_FALSE, userData->mesh.layout.stride,
+                           ( const void * ) ( GLintptr ) userData->mesh.layout.offset[ES_MESH_POSITION] );
    // Load the normal ָ㷨ߵݸʽݵַ
-   glVertexAttribPointer ( 1, 3, GL_FLOAT,
-                           GL_FALSE, 0, userData->normals );
+   glVertexAttribPointer ( 1, 3, GL_FLOAT, GL_FALSE, userData->mesh.layout.stride,
+                           ( const void * ) ( GLintptr ) userData->mesh.layout.offset[ES_MESH_NORMAL] );
    //ʹܶ
    glEnableVertexAttribArray ( 0 );
    glEnableVertexAttribArray ( 1 );
@@ -247,8 +264,10 @@ void Draw ( ESContext *esContext )
    // Set the sampler texture unit to 0
    glUniform1i ( userData->samplerLoc, 0 );//òʹԪ0
 
-   glDrawElements ( GL_TRIANGLES, userData->numIndices,
-                    GL_UNSIGNED_INT, userData->indices );
+   // The indices follow the vertices in the same buffer
+   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->meshVBO );
+   glDrawElements ( userData->mesh.mode, userData->mesh.numIndices,
+                    GL_UNSIGNED_INT, ( const void * ) userData->mesh.indexOffset );
 }
 
 ///
@@ -264,14 +283,13 @@ void ShutDown ( ESContext *esContext )
    // Delete program object
    glDeleteProgram ( userData->programObject );
 
-   free ( userData->vertices );
-   free ( userData->normals );
+   glDeleteBuffers ( 1, &userData->meshVBO );
 }
 
 
 int esMain ( ESContext *esContext )
 {
-   esContext->userData = malloc ( sizeof ( UserData ) );
+   esContext->userData = esMalloc ( sizeof ( UserData ) );
 
    esCreateWindow ( esContext, "Simple Texture Cubemap", 320, 240, ES_WINDOW_RGB );
 
@@ -0,0 +1,1005 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esBenchmark.c
+//
+//    CPU microbenchmarks for the Common math and geometry routines.  No
+//    EGL or GL context is needed.  Results are written as JSON to stdout,
+//    or to the file given with -o, after the vertex cache statistics of the
+//    esGenSquareGrid index orders.
+//
+//    Usage: esBenchmark [-o file.json] [-filter substring] [-quick] [-threads n]
+//
+//    -threads sets esSetThreadCount for the routines that split their work.
+//
+//    Configure with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_simd.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined ( _WIN32 )
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+///
+// Defines
+//
+
+/// Number of matrices the matrix benchmarks cycle through
+#define MATRIX_POOL     64
+
+/// Timed repetitions per benchmark, the median is reported
+#define REPETITIONS     5
+
+///
+//  Types
+//
+typedef struct
+{
+   const char *name;
+   int         param;
+   const char *itemName;
+
+   /// Run iterations operations, return the number of items produced by one
+   int ( *run ) ( int param, int iterations );
+} Benchmark;
+
+///
+//  Forward declarations
+//
+
+/// es::Mat4 checks and benchmarks, in esBenchmarkMat4.cpp
+int CheckMat4 ( void );
+int BenchMatrixChainC ( int param, int iterations );
+int BenchMat4Chain ( int param, int iterations );
+
+///
+//  Globals
+//
+
+/// Written by every benchmark so the work cannot be optimized away
+static volatile GLfloat sink;
+
+static ESMatrix pool[3][MATRIX_POOL];
+
+static long allocCount;
+static long allocBytes;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// CountAlloc(), CountRealloc(), CountFree()
+//
+//    Installed with esSetAllocator so the allocations made by the Common sources are counted
+//
+static void *ESCALLBACK CountAlloc ( void *userData, size_t size )
+{
+   ( void ) userData;
+
+   allocCount++;
+   allocBytes += ( long ) size;
+   return malloc ( size );
+}
+
+static void *ESCALLBACK CountRealloc ( void *userData, void *ptr, size_t size )
+{
+   ( void ) userData;
+
+   allocCount++;
+   allocBytes += ( long ) size;
+   return realloc ( ptr, size );
+}
+
+static void ESCALLBACK CountFree ( void *userData, void *ptr )
+{
+   ( void ) userData;
+
+   free ( ptr );
+}
+
+///
+// Now()
+//
+//    Monotonic time in nanoseconds
+//
+static double Now ( void )
+{
+#if defined ( _WIN32 )
+   LARGE_INTEGER freq, count;
+
+   QueryPerformanceFrequency ( &freq );
+   QueryPerformanceCounter ( &count );
+   return ( double ) count.QuadPart * 1.0e9 / ( double ) freq.QuadPart;
+#else
+   struct timespec ts;
+
+   clock_gettime ( CLOCK_MONOTONIC, &ts );
+   return ( double ) ts.tv_sec * 1.0e9 + ( double ) ts.tv_nsec;
+#endif
+}
+
+///
+// InitPool()
+//
+static void InitPool ( void )
+{
+   unsigned int seed = 1;
+   int          i, j, k;
+
+   for ( i = 0; i < 3; i++ )
+   {
+      for ( j = 0; j < MATRIX_POOL; j++ )
+      {
+         for ( k = 0; k < 16; k++ )
+         {
+            seed = seed * 1664525u + 1013904223u;
+            ( &pool[i][j].m[0][0] ) [k] = ( GLfloat ) ( seed >> 8 ) / ( GLfloat ) ( 1 << 24 ) - 0.5f;
+         }
+      }
+   }
+}
+
+static int BenchMatrixMultiply ( int param, int iterations )
+{
+   int i;
+
+   ( void ) param;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      int j = i & ( MATRIX_POOL - 1 );
+
+      esMatrixMultiply ( &pool[2][j], &pool[0][j], &pool[1][( j + 1 ) & ( MATRIX_POOL - 1 )] );
+   }
+
+   sink = pool[2][0].m[0][0];
+   return 1;
+}
+
+static int BenchMatrixMultiplyBatch ( int param, int iterations )
+{
+   int i;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      esMatrixMultiplyBatch ( &pool[2][0], &pool[0][0], &pool[1][i & ( MATRIX_POOL - 1 )], param );
+   }
+
+   sink = pool[2][0].m[0][0];
+   return param;
+}
+
+///
+// BuildHierarchy()
+//
+//    A tree of param nodes where node i is a child of node ( i - 1 ) / 4, with the
+//    local matrices taken from the pool.  Built on the first (warm-up) call.
+//
+static ESHierarchy *BuildHierarchy ( int param )
+{
+   static ESHierarchy hierarchy;
+   static int         count = 0;
+   int                i;
+
+   if ( count != param )
+   {
+      if ( count != 0 )
+      {
+         esHierarchyFree ( &hierarchy );
+      }
+
+      esHierarchyInit ( &hierarchy, param );
+
+      for ( i = 0; i < param; i++ )
+      {
+         esHierarchyAddNode ( &hierarchy, i > 0 ? ( i - 1 ) / 4 : -1, &pool[0][i & ( MATRIX_POOL - 1 )] );
+      }
+
+      count = param;
+   }
+
+   return &hierarchy;
+}
+
+static int BenchHierarchyUpdate ( int param, int iterations )
+{
+   ESHierarchy *hierarchy = BuildHierarchy ( param );
+   int          i;
+
+   // Moving the root recomputes every world matrix, one depth level per batch
+   for ( i = 0; i < iterations; i++ )
+   {
+      esHierarchySetLocal ( hierarchy, 0, &pool[1][i & ( MATRIX_POOL - 1 )] );
+      esHierarchyUpdate ( hierarchy );
+   }
+
+   sink = hierarchy->world[param - 1].m[0][0];
+   return param;
+}
+
+static int BenchHierarchyPerNode ( int param, int iterations )
+{
+   ESHierarchy *hierarchy = BuildHierarchy ( param );
+   int          i, j;
+
+   // The same update as one esMatrixMultiply call per node in index order,
+   // which is what esHierarchyUpdate did before it batched each level
+   for ( i = 0; i < iterations; i++ )
+   {
+      hierarchy->local[0] = pool[1][i & ( MATRIX_POOL - 1 )];
+      hierarchy->dirty[0] = 1;
+      memset ( hierarchy->changed, 0, param );
+
+      for ( j = 0; j < param; j++ )
+      {
+         int p = hierarchy->parent[j];
+
+         if ( !hierarchy->dirty[j] && ( p < 0 || !hierarchy->changed[p] ) )
+         {
+            continue;
+         }
+
+         if ( p < 0 )
+         {
+            hierarchy->world[j] = hierarchy->local[j];
+         }
+         else
+         {
+            esMatrixMultiply ( &hierarchy->world[j], &hierarchy->local[j], &hierarchy->world[p] );
+         }
+
+         hierarchy->dirty[j] = 0;
+         hierarchy->changed[j] = 1;
+      }
+   }
+
+   sink = hierarchy->world[param - 1].m[0][0];
+   return param;
+}
+
+static int BenchRotate ( int param, int iterations )
+{
+   int i;
+
+   ( void ) param;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      ESMatrix *m = &pool[2][i & ( MATRIX_POOL - 1 )];
+
+      *m = pool[0][i & ( MATRIX_POOL - 1 )];
+      esRotate ( m, ( GLfloat ) ( i & 255 ), 1.0f, 0.0f, 1.0f );
+   }
+
+   sink = pool[2][0].m[0][0];
+   return 1;
+}
+
+static int BenchLookAt ( int param, int iterations )
+{
+   int i;
+
+   ( void ) param;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      GLfloat t = ( GLfloat ) ( i & 255 );
+
+      esMatrixLookAt ( &pool[2][i & ( MATRIX_POOL - 1 )],
+                       -5.0f + t * 0.01f, 3.0f, 5.0f,
+                       0.0f, 0.0f, 0.0f,
+                       0.0f, 1.0f, 0.0f );
+   }
+
+   sink = pool[2][0].m[0][0];
+   return 1;
+}
+
+static int BenchPerspective ( int param, int iterations )
+{
+   int i;
+
+   ( void ) param;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      ESMatrix *m = &pool[2][i & ( MATRIX_POOL - 1 )];
+
+      esMatrixLoadIdentity ( m );
+      esPerspective ( m, 45.0f + ( GLfloat ) ( i & 15 ), 4.0f / 3.0f, 0.1f, 100.0f );
+   }
+
+   sink = pool[2][0].m[0][0];
+   return 1;
+}
+
+static int BenchGenSphere ( int param, int iterations )
+{
+   int i;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      GLfloat *vertices, *normals, *texCoords;
+      GLuint  *indices;
+
+      esGenSphere ( param, 1.0f, 0, &vertices, &normals, &texCoords, &indices );
+      sink = vertices[0];
+
+      esFree ( vertices );
+      esFree ( normals );
+      esFree ( texCoords );
+      esFree ( indices );
+   }
+
+   return ( param / 2 + 1 ) * ( param + 1 );
+}
+
+static int BenchGenCube ( int param, int iterations )
+{
+   int i;
+
+   ( void ) param;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      GLfloat *vertices, *normals, *texCoords;
+      GLuint  *indices;
+
+      esGenCube ( 1.0f, &vertices, &normals, &texCoords, &indices );
+      sink = vertices[0];
+
+      esFree ( vertices );
+      esFree ( normals );
+      esFree ( texCoords );
+      esFree ( indices );
+   }
+
+   return 24;
+}
+
+static int BenchGenSquareGrid ( int param, int iterations )
+{
+   int i;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      GLfloat *vertices;
+      GLuint  *indices;
+
+      esGenSquareGrid ( param, 0, &vertices, &indices );
+      sink = vertices[0];
+
+      esFree ( vertices );
+      esFree ( indices );
+   }
+
+   return param * param;
+}
+
+static int BenchGenIcosphereMesh ( int param, int iterations )
+{
+   ESMeshLayout layout;
+   ESMesh       mesh;
+   int          numVertices = 0;
+   int          i;
+
+   esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT | ES_MESH_NORMAL_BIT | ES_MESH_TEXCOORD_BIT );
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      // The whole level of detail chain in one allocation
+      esGenIcosphereMesh ( &mesh, &layout, param, 1.0f, ES_MESH_MAX_LODS, NULL, NULL );
+      sink = mesh.lods[mesh.numLods - 1].radius;
+      numVertices = mesh.numVertices;
+
+      esMeshFree ( &mesh );
+   }
+
+   return numVertices;
+}
+
+static int BenchTransformPoints ( int param, int iterations )
+{
+   // The grid is built on the first (warm-up) call so only the transform is timed
+   static GLfloat *vertices = NULL;
+   static GLfloat *out = NULL;
+   static int      size = 0;
+   int             count = param * param;
+   int             i;
+
+   if ( size != param )
+   {
+      esFree ( vertices );
+      free ( out );
+      esGenSquareGrid ( param, 0, &vertices, NULL );
+      out = malloc ( count * 3 * sizeof ( GLfloat ) );
+      size = param;
+   }
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      esTransformPoints ( &pool[0][i & ( MATRIX_POOL - 1 )], vertices, 0, out, 0, count );
+   }
+
+   sink = out[0];
+   return count;
+}
+
+static int BenchInstanceMVPs ( int param, int iterations )
+{
+   // Instances are set up on the first (warm-up) call so only the MVP pass is timed
+   static ESInstanceData instances;
+   static ESMatrix      *out = NULL;
+   ESQuat                step = { 0.0f, 0.00615f, 0.0f, 0.99998f };
+   int                   i;
+
+   if ( instances.count != param )
+   {
+      esInstanceDataFree ( &instances );
+      free ( out );
+      esInstanceDataInit ( &instances, param );
+      out = malloc ( param * sizeof ( ESMatrix ) );
+
+      for ( i = 0; i < param; i++ )
+      {
+         instances.positionX[i] = ( GLfloat ) ( i % 256 );
+         instances.positionY[i] = ( GLfloat ) ( i / 256 );
+      }
+   }
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      esInstanceComputeMVPs ( out, &instances, &step, &pool[1][i & ( MATRIX_POOL - 1 )] );
+   }
+
+   sink = out[0].m[3][0];
+   return param;
+}
+
+static int BenchOptimizeVertexCache ( int param, int iterations )
+{
+   // The row-order grid indices are generated on the first (warm-up) call
+   static GLuint *source = NULL;
+   static GLuint *indices = NULL;
+   static int     numIndices = 0;
+   static int     size = 0;
+   int            i;
+
+   if ( size != param )
+   {
+      esFree ( source );
+      free ( indices );
+      numIndices = esGenSquareGrid ( param, 0, NULL, &source );
+      indices = malloc ( numIndices * sizeof ( GLuint ) );
+      size = param;
+   }
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      memcpy ( indices, source, numIndices * sizeof ( GLuint ) );
+      esOptimizeVertexCache ( indices, numIndices, param * param, 0 );
+   }
+
+   sink = ( GLfloat ) indices[0];
+   return numIndices / 3;
+}
+
+static int BenchQuantizeVertices ( int param, int iterations )
+{
+   // The float sphere and the output block are allocated on the first (warm-up) call
+   static ESMesh  mesh;
+   static void   *quantized = NULL;
+   static GLsizeiptr quantizedSize = 0;
+   static int     slices = 0;
+   ESMeshLayout   layout;
+   ESQuantizedVertices result;
+   GLsizeiptr     size;
+   int            i;
+
+   if ( slices != param )
+   {
+      esMeshFree ( &mesh );
+      free ( quantized );
+      esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT | ES_MESH_NORMAL_BIT | ES_MESH_TEXCOORD_BIT );
+      esGenSphereMesh ( &mesh, &layout, param, 1.0f, 0, NULL, NULL );
+      esQuantizeVertices ( &result, &mesh.layout, mesh.vertices, mesh.numVertices, NULL, NULL, &quantizedSize );
+      quantized = malloc ( quantizedSize );
+      slices = param;
+   }
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      size = quantizedSize;
+      esQuantizeVertices ( &result, &mesh.layout, mesh.vertices, mesh.numVertices, NULL, quantized, &size );
+   }
+
+   sink = result.maxError[ES_MESH_POSITION];
+   return mesh.numVertices;
+}
+
+static int BenchSimplifyMesh ( int param, int iterations )
+{
+   // The sphere and the output are allocated on the first (warm-up) call
+   static ESMesh  mesh;
+   static GLuint *result = NULL;
+   static int     slices = 0;
+   ESSimplifyParams params;
+   ESMeshLayout   layout;
+   int            i;
+
+   if ( slices != param )
+   {
+      esMeshFree ( &mesh );
+      free ( result );
+      esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT | ES_MESH_NORMAL_BIT );
+      esGenSphereMesh ( &mesh, &layout, param, 1.0f, 0, NULL, NULL );
+      result = malloc ( sizeof ( GLuint ) * mesh.numIndices );
+      slices = param;
+   }
+
+   // Down to a tenth of the triangles
+   memset ( &params, 0, sizeof ( params ) );
+   params.targetTriangles = mesh.numIndices / 30;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      sink = ( GLfloat ) esSimplifyMesh ( result, mesh.indices, mesh.numIndices, &mesh.layout,
+                                          mesh.vertices, mesh.numVertices, &params, NULL );
+   }
+
+   return mesh.numIndices / 3;
+}
+
+static int BenchWeldVertices ( int param, int iterations )
+{
+   // The sphere and the remap table are allocated on the first (warm-up) call
+   static ESMesh  mesh;
+   static GLuint *remap = NULL;
+   static int     slices = 0;
+   ESMeshLayout   layout;
+   int            i;
+
+   if ( slices != param )
+   {
+      esMeshFree ( &mesh );
+      free ( remap );
+      esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT | ES_MESH_NORMAL_BIT | ES_MESH_TEXCOORD_BIT );
+      esGenSphereMesh ( &mesh, &layout, param, 1.0f, 0, NULL, NULL );
+      remap = malloc ( sizeof ( GLuint ) * mesh.numVertices );
+      slices = param;
+   }
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      sink = ( GLfloat ) esWeldVertices ( remap, &mesh.layout, mesh.vertices, mesh.numVertices, 0.0f );
+   }
+
+   return mesh.numVertices;
+}
+
+static int BenchGenTangents ( int param, int iterations )
+{
+   // The sphere and the QTangents are allocated on the first (warm-up) call
+   static ESMesh        mesh;
+   static ESQuatPacked *qtangents = NULL;
+   static int           slices = 0;
+   ESMeshLayout         layout;
+   int                  i;
+
+   if ( slices != param )
+   {
+      esMeshFree ( &mesh );
+      free ( qtangents );
+      esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT | ES_MESH_NORMAL_BIT | ES_MESH_TEXCOORD_BIT );
+      esGenSphereMesh ( &mesh, &layout, param, 1.0f, 0, NULL, NULL );
+      qtangents = malloc ( sizeof ( ESQuatPacked ) * mesh.numVertices );
+      slices = param;
+   }
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      esGenMeshTangents ( qtangents, 0, &mesh );
+      sink = ( GLfloat ) qtangents[i % mesh.numVertices].w;
+   }
+
+   return mesh.numVertices;
+}
+
+static int BenchBuildMeshlets ( int param, int iterations )
+{
+   // The sphere is generated on the first (warm-up) call
+   static ESMesh  mesh;
+   static int     slices = 0;
+   ESMeshLayout   layout;
+   ESMeshlets     meshlets;
+   int            i;
+
+   if ( slices != param )
+   {
+      esMeshFree ( &mesh );
+      esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT | ES_MESH_NORMAL_BIT );
+      esGenSphereMesh ( &mesh, &layout, param, 1.0f, 0, NULL, NULL );
+      slices = param;
+   }
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      esBuildMeshlets ( &meshlets, mesh.indices, mesh.numIndices, mesh.vertices, mesh.layout.stride,
+                        mesh.numVertices, 64, 126 );
+      sink = ( GLfloat ) meshlets.numMeshlets;
+      esMeshletsFree ( &meshlets );
+   }
+
+   return mesh.numIndices / 3;
+}
+
+static int BenchCullSpheres ( int param, int iterations )
+{
+   // Spheres on a grid around the origin, built on the first (warm-up) call.  The
+   // temporary visibility mask comes from the frame arena, reset as after a frame.
+   static GLfloat *spheres = NULL;
+   static GLuint  *visible = NULL;
+   static int      count = 0;
+   ESMatrix        view, projection, mvp;
+   ESFrustum       frustum;
+   int             i;
+
+   if ( count != param )
+   {
+      free ( spheres );
+      free ( visible );
+      spheres = malloc ( sizeof ( GLfloat ) * 4 * param );
+      visible = malloc ( sizeof ( GLuint ) * param );
+
+      for ( i = 0; i < param; i++ )
+      {
+         spheres[i] = ( GLfloat ) ( i % 64 ) - 32.0f;
+         spheres[param + i] = 0.0f;
+         spheres[2 * param + i] = ( GLfloat ) ( i / 64 ) - 32.0f;
+         spheres[3 * param + i] = 0.5f;
+      }
+
+      count = param;
+   }
+
+   esMatrixLoadIdentity ( &view );
+   esMatrixLookAt ( &view, 0.0f, 2.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f );
+   esMatrixLoadIdentity ( &projection );
+   esPerspective ( &projection, 60.0f, 1.0f, 0.1f, 100.0f );
+   esMatrixMultiply ( &mvp, &view, &projection );
+   esFrustumFromMatrix ( &frustum, &mvp );
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      sink = ( GLfloat ) esCullSpheres ( &frustum, spheres, spheres + param, spheres + 2 * param,
+                                         spheres + 3 * param, param, NULL, visible );
+      esFrameReset ();
+   }
+
+   return param;
+}
+
+static int BenchCullMeshlets ( int param, int iterations )
+{
+   // The meshlets and the range list are built on the first (warm-up) call
+   static ESMeshlets  meshlets;
+   static ESDrawRange *ranges = NULL;
+   static int         slices = 0;
+   ESMatrix           view, projection, mvp;
+   ESFrustum          frustum;
+   GLfloat            eye[3] = { 0.0f, 1.0f, 3.0f };
+   int                i;
+
+   if ( slices != param )
+   {
+      ESMeshLayout layout;
+      ESMesh       mesh;
+
+      esMeshletsFree ( &meshlets );
+      free ( ranges );
+      esMeshLayoutInit ( &layout, ES_MESH_POSITION_BIT );
+      esGenSphereMesh ( &mesh, &layout, param, 1.0f, 0, NULL, NULL );
+      esBuildMeshlets ( &meshlets, mesh.indices, mesh.numIndices, mesh.vertices, mesh.layout.stride,
+                        mesh.numVertices, 64, 126 );
+      ranges = malloc ( sizeof ( ESDrawRange ) * meshlets.numMeshlets );
+      esMeshFree ( &mesh );
+      slices = param;
+   }
+
+   esMatrixLoadIdentity ( &view );
+   esMatrixLookAt ( &view, eye[0], eye[1], eye[2], 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f );
+   esMatrixLoadIdentity ( &projection );
+   esPerspective ( &projection, 60.0f, 1.0f, 0.1f, 100.0f );
+   esMatrixMultiply ( &mvp, &view, &projection );
+   esFrustumFromMatrix ( &frustum, &mvp );
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      sink = ( GLfloat ) esCullMeshlets ( &meshlets, &frustum, eye, ranges );
+   }
+
+   return meshlets.numMeshlets;
+}
+
+static const Benchmark benchmarks[] =
+{
+   { "esMatrixMultiply",      0,    "matrices", BenchMatrixMultiply },
+   { "esMatrixMultiplyBatch", 64,   "matrices", BenchMatrixMultiplyBatch },
+   { "esMatrixMultiply A*B*C", 4096, "matrices", BenchMatrixChainC },
+   { "es::Mat4 A*B*C",        4096, "matrices", BenchMat4Chain },
+   { "esHierarchyUpdate",     4096, "nodes",    BenchHierarchyUpdate },
+   { "esHierarchyUpdate",     65536, "nodes",   BenchHierarchyUpdate },
+   { "hierarchy per-node",    4096, "nodes",    BenchHierarchyPerNode },
+   { "hierarchy per-node",    65536, "nodes",   BenchHierarchyPerNode },
+   { "esRotate",              0,    "matrices", BenchRotate },
+   { "esMatrixLookAt",        0,    "matrices", BenchLookAt },
+   { "esPerspective",         0,    "matrices", BenchPerspective },
+   { "esGenSphere",           20,   "vertices", BenchGenSphere },
+   { "esGenSphere",           64,   "vertices", BenchGenSphere },
+   { "esGenSphere",           256,  "vertices", BenchGenSphere },
+   { "esGenCube",             0,    "vertices", BenchGenCube },
+   { "esGenSquareGrid",       64,   "vertices", BenchGenSquareGrid },
+   { "esGenSquareGrid",       200,  "vertices", BenchGenSquareGrid },
+   { "esGenSquareGrid",       512,  "vertices", BenchGenSquareGrid },
+   { "esGenIcosphereMesh",    6,    "vertices", BenchGenIcosphereMesh },
+   { "esTransformPoints",     200,  "vertices", BenchTransformPoints },
+   { "esInstanceComputeMVPs", 65536, "instances", BenchInstanceMVPs },
+   { "esOptimizeVertexCache", 200,  "triangles", BenchOptimizeVertexCache },
+   { "esQuantizeVertices",    256,  "vertices", BenchQuantizeVertices },
+   { "esSimplifyMesh",        256,  "triangles", BenchSimplifyMesh },
+   { "esWeldVertices",        1024, "vertices", BenchWeldVertices },
+   { "esGenTangents",         1024, "vertices", BenchGenTangents },
+   { "esBuildMeshlets",       256,  "triangles", BenchBuildMeshlets },
+   { "esCullSpheres",         4096, "spheres", BenchCullSpheres },
+   { "esCullMeshlets",        1024, "meshlets", BenchCullMeshlets }
+};
+
+///
+// CompareDouble()
+//
+static int CompareDouble ( const void *a, const void *b )
+{
+   double x = * ( const double * ) a;
+   double y = * ( const double * ) b;
+
+   return x < y ? -1 : x > y ? 1 : 0;
+}
+
+///
+// RunBenchmark()
+//
+//    Pick an iteration count that runs for at least minTime nanoseconds,
+//    then time REPETITIONS runs of it and write one JSON object
+//
+static void RunBenchmark ( FILE *out, const Benchmark *bench, double minTime, int first )
+{
+   double times[REPETITIONS];
+   double median, nsPerOp;
+   int    iterations = 1;
+   int    items = 0;
+   int    i;
+   long   allocs, bytes;
+
+   // Warm up and calibrate
+   for ( ;; )
+   {
+      double start = Now ();
+
+      items = bench->run ( bench->param, iterations );
+
+      if ( Now () - start >= minTime || iterations >= ( 1 << 28 ) )
+      {
+         break;
+      }
+
+      iterations *= 2;
+   }
+
+   allocCount = 0;
+   allocBytes = 0;
+
+   for ( i = 0; i < REPETITIONS; i++ )
+   {
+      double start = Now ();
+
+      bench->run ( bench->param, iterations );
+      times[i] = Now () - start;
+   }
+
+   allocs = allocCount;
+   bytes = allocBytes;
+
+   qsort ( times, REPETITIONS, sizeof ( double ), CompareDouble );
+   median = times[REPETITIONS / 2];
+   nsPerOp = median / iterations;
+
+   fprintf ( out, "%s    {\"name\": \"%s\", \"param\": %d, \"iterations\": %d, "
+             "\"ns_per_op\": %.2f, \"ns_per_op_min\": %.2f, \"ops_per_sec\": %.1f, "
+             "\"%s_per_op\": %d, \"%s_per_sec\": %.1f, ",
+             first ? "" : ",\n", bench->name, bench->param, iterations,
+             nsPerOp, times[0] / iterations, 1.0e9 / nsPerOp,
+             bench->itemName, items, bench->itemName, items * 1.0e9 / nsPerOp );
+
+   fprintf ( out, "\"allocs_per_op\": %.2f, \"alloc_bytes_per_op\": %.1f}",
+             ( double ) allocs / ( ( double ) iterations * REPETITIONS ),
+             ( double ) bytes / ( ( double ) iterations * REPETITIONS ) );
+}
+
+///
+// WriteVertexCacheStats()
+//
+//    Post-transform cache behaviour of the index orders esGenSquareGrid can
+//    produce for a 200 x 200 grid, the one TerrainRendering draws as strips
+//
+static void WriteVertexCacheStats ( FILE *out )
+{
+   static const struct
+   {
+      const char *name;
+      GLuint      flags;
+   } orders[] =
+   {
+      { "triangles", 0 },
+      { "triangles, cache bands", ES_SHAPE_OPTIMIZE_VERTEX_CACHE },
+      { "strip", ES_SHAPE_TRIANGLE_STRIP },
+      { "strip, cache bands", ES_SHAPE_TRIANGLE_STRIP | ES_SHAPE_OPTIMIZE_VERTEX_CACHE }
+   };
+   const int gridSize = 200;
+   int       i;
+
+   fprintf ( out, "  \"vertex_cache\": [\n" );
+
+   for ( i = 0; i < ( int ) ( sizeof ( orders ) / sizeof ( orders[0] ) ); i++ )
+   {
+      ESVertexCacheStats stats;
+      GLuint *indices;
+      int     numIndices = esGenSquareGrid ( gridSize, orders[i].flags, NULL, &indices );
+
+      esAnalyzeVertexCache ( &stats, ( orders[i].flags & ES_SHAPE_TRIANGLE_STRIP ) ? GL_TRIANGLE_STRIP : GL_TRIANGLES,
+                             indices, numIndices, gridSize * gridSize, 0 );
+      esFree ( indices );
+
+      fprintf ( out, "    {\"name\": \"esGenSquareGrid\", \"param\": %d, \"order\": \"%s\", \"indices\": %d, "
+                "\"acmr\": %.3f, \"atvr\": %.3f}%s\n",
+                gridSize, orders[i].name, numIndices, stats.acmr, stats.atvr,
+                i + 1 < ( int ) ( sizeof ( orders ) / sizeof ( orders[0] ) ) ? "," : "" );
+   }
+
+   fprintf ( out, "  ],\n" );
+}
+
+///
+// SimdName()
+//
+static const char *SimdName ( void )
+{
+#if defined ( ES_SIMD_AVX )
+   return "avx";
+#elif defined ( ES_SIMD_SSE )
+   return "sse";
+#elif defined ( ES_SIMD_NEON )
+   return "neon";
+#else
+   return "scalar";
+#endif
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESAllocator countingAllocator = { CountAlloc, CountRealloc, CountFree, NULL };
+   const char *outName = NULL;
+   const char *filter = NULL;
+   double      minTime = 50.0e6;
+   FILE       *out = stdout;
+   int         first = 1;
+   int         mat4Mismatches;
+   int         i;
+
+   for ( i = 1; i < argc; i++ )
+   {
+      if ( strcmp ( argv[i], "-o" ) == 0 && i + 1 < argc )
+      {
+         outName = argv[++i];
+      }
+      else if ( strcmp ( argv[i], "-filter" ) == 0 && i + 1 < argc )
+      {
+         filter = argv[++i];
+      }
+      else if ( strcmp ( argv[i], "-quick" ) == 0 )
+      {
+         minTime = 2.0e6;
+      }
+      else if ( strcmp ( argv[i], "-threads" ) == 0 && i + 1 < argc )
+      {
+         esSetThreadCount ( atoi ( argv[++i] ) );
+      }
+      else
+      {
+         fprintf ( stderr, "Usage: %s [-o file.json] [-filter substring] [-quick] [-threads n]\n", argv[0] );
+         return 1;
+      }
+   }
+
+   if ( outName != NULL && ( out = fopen ( outName, "w" ) ) == NULL )
+   {
+      fprintf ( stderr, "Cannot open %s\n", outName );
+      return 1;
+   }
+
+   esSetAllocator ( &countingAllocator );
+   InitPool ();
+   mat4Mismatches = CheckMat4 ();
+
+   fprintf ( out, "{\n  \"suite\": \"esUtil\",\n  \"simd\": \"%s\",\n  \"threads\": %d,\n"
+             "  \"mat4_bit_identical\": %s,\n",
+             SimdName (), esGetThreadCount (), mat4Mismatches == 0 ? "true" : "false" );
+   WriteVertexCacheStats ( out );
+   fprintf ( out, "  \"results\": [\n" );
+
+   for ( i = 0; i < ( int ) ( sizeof ( benchmarks ) / sizeof ( benchmarks[0] ) ); i++ )
+   {
+      if ( filter != NULL && strstr ( benchmarks[i].name, filter ) == NULL )
+      {
+         continue;
+      }
+
+      RunBenchmark ( out, &benchmarks[i], minTime, first );
+      first = 0;
+   }
+
+   fprintf ( out, "\n  ]\n}\n" );
+
+   if ( out != stdout )
+   {
+      fclose ( out );
+   }
+
+   if ( mat4Mismatches != 0 )
+   {
+      fprintf ( stderr, "es::Mat4 differs from esMatrixMultiply in %d products\n", mat4Mismatches );
+      return 1;
+   }
+
+   return 0;
+}
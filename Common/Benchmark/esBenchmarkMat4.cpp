@@ -0,0 +1,206 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esBenchmarkMat4.cpp
+//
+//    C++ half of esBenchmark.  Builds esMath.hpp as C++14, checks its
+//    products against esMatrixMultiply bit for bit and times an A * B * C
+//    chain both ways.
+//
+
+///
+//  Includes
+//
+#include "esMath.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+///
+// Defines
+//
+
+/// Largest chain benchmark parameter
+#define CHAIN_MAX   4096
+
+///
+//  Globals
+//
+
+/// Written by every benchmark so the work cannot be optimized away
+static volatile GLfloat sink;
+
+/// Operands and results of the chain benchmarks, allocated on first use
+static ESMatrix *chainA = NULL;
+static ESMatrix *chainB = NULL;
+static ESMatrix *chainC = NULL;
+static ESMatrix *chainOut = NULL;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FillRandom()
+//
+//    Values in [-0.5, 0.5) from a fixed LCG, so runs are repeatable
+//
+static void FillRandom ( ESMatrix *matrices, int count, unsigned int seed )
+{
+   for ( int i = 0; i < count; i++ )
+   {
+      for ( int k = 0; k < 16; k++ )
+      {
+         seed = seed * 1664525u + 1013904223u;
+         ( &matrices[i].m[0][0] ) [k] = ( GLfloat ) ( seed >> 8 ) / ( GLfloat ) ( 1 << 24 ) - 0.5f;
+      }
+   }
+}
+
+///
+// InitChain()
+//
+static bool InitChain ()
+{
+   if ( chainA != NULL )
+   {
+      return true;
+   }
+
+   chainA = static_cast < ESMatrix * > ( malloc ( 4 * CHAIN_MAX * sizeof ( ESMatrix ) ) );
+
+   if ( chainA == NULL )
+   {
+      return false;
+   }
+
+   chainB = chainA + CHAIN_MAX;
+   chainC = chainB + CHAIN_MAX;
+   chainOut = chainC + CHAIN_MAX;
+   FillRandom ( chainA, 3 * CHAIN_MAX, 12345u );
+   return true;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// CheckMat4()
+//
+//    Number of es::Mat4 results that differ in any bit from esMatrixMultiply
+//
+extern "C" int CheckMat4 ( void )
+{
+   ESMatrix src[3 * 64];
+   int      mismatches = 0;
+
+   FillRandom ( src, 3 * 64, 777u );
+
+   for ( int i = 0; i < 64; i++ )
+   {
+      const ESMatrix &a = src[i], &b = src[64 + i], &c = src[128 + i];
+      ESMatrix ab, expect;
+
+      // A * B * C against ( A * B ) * C
+      esMatrixMultiply ( &ab, const_cast < ESMatrix * > ( &a ), const_cast < ESMatrix * > ( &b ) );
+      esMatrixMultiply ( &expect, &ab, const_cast < ESMatrix * > ( &c ) );
+
+      es::Mat4 chain = es::Mat4::from ( a ) * es::Mat4::from ( b ) * es::Mat4::from ( c );
+
+      mismatches += memcmp ( chain.es (), &expect, sizeof ( ESMatrix ) ) != 0;
+
+      // a = b * a, where the result aliases an operand
+      es::Mat4 alias = es::Mat4::from ( a );
+
+      esMatrixMultiply ( &expect, const_cast < ESMatrix * > ( &b ), const_cast < ESMatrix * > ( &a ) );
+      alias = es::Mat4::from ( b ) * alias;
+
+      mismatches += memcmp ( alias.es (), &expect, sizeof ( ESMatrix ) ) != 0;
+   }
+
+   return mismatches;
+}
+
+///
+// BenchMatrixChainC()
+//
+//    out[k] = a[k] * b[k] * c[k] with two esMatrixMultiply calls
+//
+extern "C" int BenchMatrixChainC ( int param, int iterations )
+{
+   if ( !InitChain () || param > CHAIN_MAX )
+   {
+      return 0;
+   }
+
+   for ( int i = 0; i < iterations; i++ )
+   {
+      for ( int k = 0; k < param; k++ )
+      {
+         ESMatrix ab;
+
+         esMatrixMultiply ( &ab, &chainA[k], &chainB[k] );
+         esMatrixMultiply ( &chainOut[k], &ab, &chainC[k] );
+      }
+   }
+
+   sink = chainOut[0].m[0][0];
+   return param;
+}
+
+///
+// BenchMat4Chain()
+//
+//    The same chain as an es::Mat4 expression, evaluated row by row
+//
+extern "C" int BenchMat4Chain ( int param, int iterations )
+{
+   if ( !InitChain () || param > CHAIN_MAX )
+   {
+      return 0;
+   }
+
+   for ( int i = 0; i < iterations; i++ )
+   {
+      for ( int k = 0; k < param; k++ )
+      {
+         es::Mat4::from ( chainOut[k] ) = es::Mat4::from ( chainA[k] ) * es::Mat4::from ( chainB[k] ) *
+                                          es::Mat4::from ( chainC[k] );
+      }
+   }
+
+   sink = chainOut[0].m[0][0];
+   return param;
+}
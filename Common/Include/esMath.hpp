@@ -0,0 +1,540 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esMath.hpp
+//
+//    Header-only C++ wrapper over the ESMatrix routines.  es::Mat4 has the
+//    same layout as ESMatrix and uses the same row-vector convention, so
+//    a * b here is esMatrixMultiply ( result, a, b ) and an es::Mat4 can be
+//    handed to the C functions and to glUniformMatrix4fv unchanged.
+//
+//    Products are expression templates: a chain such as model * view * proj
+//    is evaluated one row at a time when it is assigned, pushing each row
+//    of the leftmost matrix through the others, so no intermediate matrix
+//    is stored.  Do not keep an expression in an auto variable; it refers
+//    to its operands.
+//
+//    The factory functions (identity, translation, scaling, frustum, ortho
+//    and perspective) are constexpr and fold to constants when their
+//    arguments are.  Requires C++14.
+//
+
+#ifndef ESMATH_HPP
+#define ESMATH_HPP
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_simd.h"
+#include <string.h>
+
+namespace es
+{
+
+///
+//  Types
+//
+
+/// Four floats, used as a row vector: v * m transforms v by m
+struct Vec4
+{
+   GLfloat   v[4];
+
+   Vec4 () = default;
+   constexpr Vec4 ( GLfloat x, GLfloat y, GLfloat z, GLfloat w ) : v { x, y, z, w } {}
+
+   constexpr GLfloat operator[] ( int i ) const
+   {
+      return v[i];
+   }
+
+   GLfloat &operator[] ( int i )
+   {
+      return v[i];
+   }
+};
+
+inline constexpr Vec4 operator+ ( const Vec4 &a, const Vec4 &b )
+{
+   return Vec4 ( a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] );
+}
+
+inline constexpr Vec4 operator- ( const Vec4 &a, const Vec4 &b )
+{
+   return Vec4 ( a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] );
+}
+
+inline constexpr Vec4 operator* ( const Vec4 &a, GLfloat s )
+{
+   return Vec4 ( a.v[0] * s, a.v[1] * s, a.v[2] * s, a.v[3] * s );
+}
+
+inline constexpr GLfloat dot ( const Vec4 &a, const Vec4 &b )
+{
+   return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3];
+}
+
+namespace detail
+{
+
+constexpr GLfloat PI = 3.1415926535897932384626433832795f;
+
+/// An expression is evaluated in blocks of BLOCK_ROWS consecutive rows; a
+/// VecBlock holds the single row vector of v * m
+#if defined ( ES_SIMD_AVX )
+typedef __m256 Block;
+typedef __m256 VecBlock;
+const int BLOCK_ROWS = 2;
+
+inline Block LoadBlock ( const GLfloat *p )
+{
+   return _mm256_loadu_ps ( p );
+}
+
+inline void StoreBlock ( GLfloat *p, Block b )
+{
+   _mm256_storeu_ps ( p, b );
+}
+
+/// A single row vector, duplicated into both halves
+inline Block LoadVec ( const GLfloat *p )
+{
+   return _mm256_broadcast_ps ( ( const __m128 * ) p );
+}
+
+inline void StoreVec ( GLfloat *p, Block b )
+{
+   _mm_storeu_ps ( p, _mm256_castps256_ps128 ( b ) );
+}
+
+///
+// MulBlock()
+//
+//    Two row vectors times a matrix, same term order as esMatrixMultiply
+//
+inline Block MulBlock ( Block v, const GLfloat m[4][4] )
+{
+   Block r = _mm256_mul_ps ( _mm256_shuffle_ps ( v, v, 0x00 ), _mm256_broadcast_ps ( ( const __m128 * ) m[0] ) );
+
+   r = _mm256_add_ps ( r, _mm256_mul_ps ( _mm256_shuffle_ps ( v, v, 0x55 ), _mm256_broadcast_ps ( ( const __m128 * ) m[1] ) ) );
+   r = _mm256_add_ps ( r, _mm256_mul_ps ( _mm256_shuffle_ps ( v, v, 0xAA ), _mm256_broadcast_ps ( ( const __m128 * ) m[2] ) ) );
+   r = _mm256_add_ps ( r, _mm256_mul_ps ( _mm256_shuffle_ps ( v, v, 0xFF ), _mm256_broadcast_ps ( ( const __m128 * ) m[3] ) ) );
+
+   return r;
+}
+#elif defined ( ES_SIMD )
+typedef esVec4 Block;
+typedef esVec4 VecBlock;
+const int BLOCK_ROWS = 1;
+
+inline Block LoadBlock ( const GLfloat *p )
+{
+   return esVec4Load ( p );
+}
+
+inline void StoreBlock ( GLfloat *p, Block b )
+{
+   esVec4Store ( p, b );
+}
+
+inline Block LoadVec ( const GLfloat *p )
+{
+   return esVec4Load ( p );
+}
+
+inline void StoreVec ( GLfloat *p, Block b )
+{
+   esVec4Store ( p, b );
+}
+
+///
+// MulBlock()
+//
+//    Row vector times matrix, same term order as esMatrixMultiply
+//
+inline Block MulBlock ( Block v, const GLfloat m[4][4] )
+{
+   Block r = esVec4Mul ( esVec4SplatLane ( v, 0 ), esVec4Load ( m[0] ) );
+
+   r = esVec4MulAdd ( r, esVec4SplatLane ( v, 1 ), esVec4Load ( m[1] ) );
+   r = esVec4MulAdd ( r, esVec4SplatLane ( v, 2 ), esVec4Load ( m[2] ) );
+   r = esVec4MulAdd ( r, esVec4SplatLane ( v, 3 ), esVec4Load ( m[3] ) );
+
+   return r;
+}
+#else
+/// Without SIMD the whole matrix is one block, so a product runs the same
+/// loop as esMatrixMultiply and the compiler vectorizes it the same way
+struct Block
+{
+   GLfloat   m[4][4];
+};
+
+typedef Vec4 VecBlock;
+const int BLOCK_ROWS = 4;
+
+inline Block LoadBlock ( const GLfloat *p )
+{
+   Block b;
+
+   memcpy ( b.m, p, sizeof ( b.m ) );
+   return b;
+}
+
+inline void StoreBlock ( GLfloat *p, const Block &b )
+{
+   memcpy ( p, b.m, sizeof ( b.m ) );
+}
+
+inline VecBlock LoadVec ( const GLfloat *p )
+{
+   return Vec4 ( p[0], p[1], p[2], p[3] );
+}
+
+inline void StoreVec ( GLfloat *p, const VecBlock &v )
+{
+   p[0] = v.v[0];
+   p[1] = v.v[1];
+   p[2] = v.v[2];
+   p[3] = v.v[3];
+}
+
+///
+// MulBlock()
+//
+//    Row vector times matrix, same term order as esMatrixMultiply
+//
+inline VecBlock MulBlock ( const VecBlock &v, const GLfloat m[4][4] )
+{
+   Vec4 r;
+
+   for ( int j = 0; j < 4; j++ )
+   {
+      r.v[j] = ( v.v[0] * m[0][j] ) + ( v.v[1] * m[1][j] ) + ( v.v[2] * m[2][j] ) + ( v.v[3] * m[3][j] );
+   }
+
+   return r;
+}
+
+inline Block MulBlock ( const Block &a, const GLfloat m[4][4] )
+{
+   Block r;
+
+   for ( int i = 0; i < 4; i++ )
+   {
+      r.m[i][0] = ( a.m[i][0] * m[0][0] ) + ( a.m[i][1] * m[1][0] ) + ( a.m[i][2] * m[2][0] ) + ( a.m[i][3] * m[3][0] );
+      r.m[i][1] = ( a.m[i][0] * m[0][1] ) + ( a.m[i][1] * m[1][1] ) + ( a.m[i][2] * m[2][1] ) + ( a.m[i][3] * m[3][1] );
+      r.m[i][2] = ( a.m[i][0] * m[0][2] ) + ( a.m[i][1] * m[1][2] ) + ( a.m[i][2] * m[2][2] ) + ( a.m[i][3] * m[3][2] );
+      r.m[i][3] = ( a.m[i][0] * m[0][3] ) + ( a.m[i][1] * m[1][3] ) + ( a.m[i][2] * m[2][3] ) + ( a.m[i][3] * m[3][3] );
+   }
+
+   return r;
+}
+#endif
+
+const int NUM_BLOCKS = 4 / BLOCK_ROWS;
+
+///
+// Tan()
+//
+//    tan ( x ) for |x| < pi / 2, usable in constant expressions
+//
+inline constexpr GLfloat Tan ( GLfloat angle )
+{
+   double x = angle;
+   double x2 = x * x;
+   double sinTerm = x, sinSum = x;
+   double cosTerm = 1.0, cosSum = 1.0;
+
+   for ( int n = 1; n < 16; n++ )
+   {
+      sinTerm *= -x2 / ( ( 2.0 * n ) * ( 2.0 * n + 1.0 ) );
+      cosTerm *= -x2 / ( ( 2.0 * n - 1.0 ) * ( 2.0 * n ) );
+      sinSum += sinTerm;
+      cosSum += cosTerm;
+   }
+
+   return ( GLfloat ) ( sinSum / cosSum );
+}
+
+} // namespace detail
+
+template < class L, class R > class MatProduct;
+
+/// Base of every matrix expression: provides rows ( i ), block i of the value's
+/// rows, and mulRows ( v ), the row vectors in a Block or VecBlock v multiplied
+/// by the value
+template < class E >
+struct MatExpr
+{
+   const E &self () const
+   {
+      return static_cast < const E & > ( *this );
+   }
+};
+
+/// Operands are held by reference, except nested products which are small and
+/// usually temporaries
+template < class T >
+struct MatOperand
+{
+   typedef const T &Type;
+};
+
+template < class L, class R >
+struct MatOperand < MatProduct < L, R > >
+{
+   typedef MatProduct < L, R > Type;
+};
+
+/// Lazy product lhs * rhs
+template < class L, class R >
+class MatProduct : public MatExpr < MatProduct < L, R > >
+{
+public:
+   MatProduct ( const L &l, const R &r ) : lhs ( l ), rhs ( r ) {}
+
+   detail::Block rows ( int i ) const
+   {
+      return rhs.mulRows ( lhs.rows ( i ) );
+   }
+
+   template < class B >
+   B mulRows ( const B &v ) const
+   {
+      return rhs.mulRows ( lhs.mulRows ( v ) );
+   }
+
+private:
+   typename MatOperand < L >::Type lhs;
+   typename MatOperand < R >::Type rhs;
+};
+
+/// 4x4 matrix, layout-compatible with ESMatrix
+struct Mat4 : public MatExpr < Mat4 >
+{
+   GLfloat   m[4][4];
+
+   Mat4 () = default;
+
+   constexpr Mat4 ( GLfloat m00, GLfloat m01, GLfloat m02, GLfloat m03,
+                    GLfloat m10, GLfloat m11, GLfloat m12, GLfloat m13,
+                    GLfloat m20, GLfloat m21, GLfloat m22, GLfloat m23,
+                    GLfloat m30, GLfloat m31, GLfloat m32, GLfloat m33 )
+      : m { { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } }
+   {
+   }
+
+   Mat4 ( const ESMatrix &src )
+   {
+      *this = from ( src );
+   }
+
+   /// Evaluate an expression straight into the new matrix
+   template < class E >
+   Mat4 ( const MatExpr < E > &expr )
+   {
+      const E &e = expr.self ();
+
+      for ( int i = 0; i < detail::NUM_BLOCKS; i++ )
+      {
+         detail::StoreBlock ( m[i * detail::BLOCK_ROWS], e.rows ( i ) );
+      }
+   }
+
+   /// Evaluate an expression that may refer to this matrix, e.g. a = b * a
+   template < class E >
+   Mat4 &operator= ( const MatExpr < E > &expr )
+   {
+      const E      &e = expr.self ();
+      detail::Block blocks[detail::NUM_BLOCKS];
+      int           i;
+
+      for ( i = 0; i < detail::NUM_BLOCKS; i++ )
+      {
+         blocks[i] = e.rows ( i );
+      }
+
+      for ( i = 0; i < detail::NUM_BLOCKS; i++ )
+      {
+         detail::StoreBlock ( m[i * detail::BLOCK_ROWS], blocks[i] );
+      }
+
+      return *this;
+   }
+
+   Mat4 &operator= ( const Mat4 & ) = default;
+
+   template < class E >
+   Mat4 &operator*= ( const MatExpr < E > &expr )
+   {
+      return *this = MatProduct < Mat4, E > ( *this, expr.self () );
+   }
+
+   detail::Block rows ( int i ) const
+   {
+      return detail::LoadBlock ( m[i * detail::BLOCK_ROWS] );
+   }
+
+   template < class B >
+   B mulRows ( const B &v ) const
+   {
+      return detail::MulBlock ( v, m );
+   }
+
+   /// For glUniformMatrix4fv ( loc, 1, GL_FALSE, a.data () )
+   const GLfloat *data () const
+   {
+      return &m[0][0];
+   }
+
+   ESMatrix *es ()
+   {
+      return reinterpret_cast < ESMatrix * > ( this );
+   }
+
+   const ESMatrix *es () const
+   {
+      return reinterpret_cast < const ESMatrix * > ( this );
+   }
+
+   /// View an ESMatrix as an es::Mat4 without copying
+   static Mat4 &from ( ESMatrix &src )
+   {
+      return reinterpret_cast < Mat4 & > ( src );
+   }
+
+   static const Mat4 &from ( const ESMatrix &src )
+   {
+      return reinterpret_cast < const Mat4 & > ( src );
+   }
+};
+
+static_assert ( sizeof ( Mat4 ) == sizeof ( ESMatrix ), "es::Mat4 must match the ESMatrix layout" );
+
+template < class L, class R >
+inline MatProduct < L, R > operator* ( const MatExpr < L > &lhs, const MatExpr < R > &rhs )
+{
+   return MatProduct < L, R > ( lhs.self (), rhs.self () );
+}
+
+/// Row vector times matrix expression
+template < class E >
+inline Vec4 operator* ( const Vec4 &v, const MatExpr < E > &expr )
+{
+   Vec4 result;
+
+   detail::StoreVec ( result.v, expr.self ().mulRows ( detail::LoadVec ( v.v ) ) );
+
+   return result;
+}
+
+///
+//  Factories, matching the C functions applied to an identity matrix
+//
+
+inline constexpr Mat4 identity ()
+{
+   return Mat4 ( 1.0f, 0.0f, 0.0f, 0.0f,
+                 0.0f, 1.0f, 0.0f, 0.0f,
+                 0.0f, 0.0f, 1.0f, 0.0f,
+                 0.0f, 0.0f, 0.0f, 1.0f );
+}
+
+/// Same as esTranslate
+inline constexpr Mat4 translation ( GLfloat tx, GLfloat ty, GLfloat tz )
+{
+   return Mat4 ( 1.0f, 0.0f, 0.0f, 0.0f,
+                 0.0f, 1.0f, 0.0f, 0.0f,
+                 0.0f, 0.0f, 1.0f, 0.0f,
+                 tx,   ty,   tz,   1.0f );
+}
+
+/// Same as esScale
+inline constexpr Mat4 scaling ( GLfloat sx, GLfloat sy, GLfloat sz )
+{
+   return Mat4 ( sx,   0.0f, 0.0f, 0.0f,
+                 0.0f, sy,   0.0f, 0.0f,
+                 0.0f, 0.0f, sz,   0.0f,
+                 0.0f, 0.0f, 0.0f, 1.0f );
+}
+
+/// Same as esFrustum, identity for invalid parameters
+inline constexpr Mat4 frustum ( GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat nearZ, GLfloat farZ )
+{
+   GLfloat deltaX = right - left;
+   GLfloat deltaY = top - bottom;
+   GLfloat deltaZ = farZ - nearZ;
+
+   if ( ( nearZ <= 0.0f ) || ( farZ <= 0.0f ) ||
+         ( deltaX <= 0.0f ) || ( deltaY <= 0.0f ) || ( deltaZ <= 0.0f ) )
+   {
+      return identity ();
+   }
+
+   return Mat4 ( 2.0f * nearZ / deltaX, 0.0f, 0.0f, 0.0f,
+                 0.0f, 2.0f * nearZ / deltaY, 0.0f, 0.0f,
+                 ( right + left ) / deltaX, ( top + bottom ) / deltaY, - ( nearZ + farZ ) / deltaZ, -1.0f,
+                 0.0f, 0.0f, -2.0f * nearZ * farZ / deltaZ, 0.0f );
+}
+
+/// Same as esPerspective, identity for invalid parameters.  The tangent is computed
+/// with a series so it can be folded; it may differ from tanf in the last bit.
+inline constexpr Mat4 perspective ( GLfloat fovy, GLfloat aspect, GLfloat nearZ, GLfloat farZ )
+{
+   GLfloat frustumH = detail::Tan ( fovy / 360.0f * detail::PI ) * nearZ;
+   GLfloat frustumW = frustumH * aspect;
+
+   return frustum ( -frustumW, frustumW, -frustumH, frustumH, nearZ, farZ );
+}
+
+/// Same as esOrtho, identity for invalid parameters
+inline constexpr Mat4 ortho ( GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat nearZ, GLfloat farZ )
+{
+   GLfloat deltaX = right - left;
+   GLfloat deltaY = top - bottom;
+   GLfloat deltaZ = farZ - nearZ;
+
+   if ( ( deltaX == 0.0f ) || ( deltaY == 0.0f ) || ( deltaZ == 0.0f ) )
+   {
+      return identity ();
+   }
+
+   return Mat4 ( 2.0f / deltaX, 0.0f, 0.0f, 0.0f,
+                 0.0f, 2.0f / deltaY, 0.0f, 0.0f,
+                 0.0f, 0.0f, -2.0f / deltaZ, 0.0f,
+                 - ( right + left ) / deltaX, - ( top + bottom ) / deltaY, - ( nearZ + farZ ) / deltaZ, 1.0f );
+}
+
+} // namespace es
+
+#endif // ESMATH_HPP
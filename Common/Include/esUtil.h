@@ -79,6 +79,65 @@ extern "C" {
 /// esCreateWindow flat - multi-sample buffer
 #define ES_WINDOW_MULTISAMPLE   8
 
+/// esGenSphere and esGenSquareGrid flag - emit the indices in
+/// bands that reuse the post-transform vertex cache
+#define ES_SHAPE_OPTIMIZE_VERTEX_CACHE   1
+/// esGenSphere and esGenSquareGrid flag - emit the indices as GL_TRIANGLE_STRIP,
+/// one strip per row separated by ES_PRIMITIVE_RESTART_INDEX.  Draw them with
+/// glEnable ( GL_PRIMITIVE_RESTART_FIXED_INDEX ).
+#define ES_SHAPE_TRIANGLE_STRIP          2
+/// esGenSphere flag - leave out the zero-area triangles of the esGenSphere poles, so each
+/// slice ends in one triangle whose tip has its own texture s.  Only applies to GL_TRIANGLES.
+#define ES_SHAPE_NO_DEGENERATES          4
+
+/// Strip separator for GLuint indices with GL_PRIMITIVE_RESTART_FIXED_INDEX
+#define ES_PRIMITIVE_RESTART_INDEX   0xFFFFFFFFu
+
+/// Post-transform vertex cache size assumed when a function is given 0
+#define ES_VERTEX_CACHE_SIZE   16
+
+/// Vertex attributes of an ESMeshLayout: float3 position, float3 normal, float2 texCoord
+#define ES_MESH_POSITION      0
+#define ES_MESH_NORMAL        1
+#define ES_MESH_TEXCOORD      2
+#define ES_MESH_MAX_ATTRIBS   3
+
+/// esMeshLayoutInit attribute bits
+#define ES_MESH_POSITION_BIT  ( 1 << ES_MESH_POSITION )
+#define ES_MESH_NORMAL_BIT    ( 1 << ES_MESH_NORMAL )
+#define ES_MESH_TEXCOORD_BIT  ( 1 << ES_MESH_TEXCOORD )
+
+/// Most levels of detail an ESMesh can hold
+#define ES_MESH_MAX_LODS      8
+
+/// esSimplifyMesh flag: keep the vertices on open borders where they are
+#define ES_SIMPLIFY_LOCK_BORDER   1
+
+/// ESGeometryDesc shapes, generated at unit size: radius 1, a cube of side 1 or
+/// the 0..1 square of esGenSquareGrid.  Scale them with the model matrix.
+#define ES_GEOMETRY_SPHERE      0
+#define ES_GEOMETRY_CUBE        1
+#define ES_GEOMETRY_GRID        2
+#define ES_GEOMETRY_CYLINDER    3
+#define ES_GEOMETRY_CONE        4
+#define ES_GEOMETRY_TORUS       5
+#define ES_GEOMETRY_CAPSULE     6
+#define ES_GEOMETRY_ICOSPHERE   7
+
+/// GLSL ES 3.00 decode of an esGenTangents QTangent, to paste into a vertex shader ahead of
+/// main.  Feed the attribute as glVertexAttribPointer ( loc, 4, GL_SHORT, GL_TRUE, ... ) and
+/// transform the results by the normal matrix, as for a plain normal.
+#define ES_QTANGENT_GLSL                                                                              \
+   "void esDecodeQTangent ( vec4 qtangent, out vec3 normal, out vec3 tangent, out vec3 bitangent )\n" \
+   "{\n"                                                                                              \
+   "   vec4 q = normalize ( qtangent );\n"                                                            \
+   "   normal = vec3 ( 2.0 * ( q.x * q.z - q.y * q.w ), 2.0 * ( q.y * q.z + q.x * q.w ),\n"           \
+   "                   1.0 - 2.0 * ( q.x * q.x + q.y * q.y ) );\n"                                    \
+   "   tangent = vec3 ( 1.0 - 2.0 * ( q.y * q.y + q.z * q.z ), 2.0 * ( q.x * q.y - q.z * q.w ),\n"    \
+   "                    2.0 * ( q.x * q.z + q.y * q.w ) );\n"                                         \
+   "   bitangent = cross ( normal, tangent ) * ( qtangent.w < 0.0 ? -1.0 : 1.0 );\n"                  \
+   "}\n"
+
 
 ///
 // Types
@@ -95,6 +154,356 @@ typedef struct
    GLfloat   m[4][4];
 } ESMatrix;
 
+/// ESMatrix with 16-byte alignment so the SIMD paths can use aligned loads and stores.
+/// The layout is identical to ESMatrix; a pointer to one may be cast to the other.
+#if defined ( _MSC_VER )
+typedef __declspec ( align ( 16 ) ) struct
+{
+   GLfloat   m[4][4];
+} ESMatrixA;
+#else
+typedef struct __attribute__ ( ( aligned ( 16 ) ) )
+{
+   GLfloat   m[4][4];
+} ESMatrixA;
+#endif
+
+/// Affine transform: an ESMatrix whose last column is (0, 0, 0, 1), stored without
+/// that column and transposed, so m[i] is row i of the matrix as GL/GLSL sees it
+/// (m[i][3] is the translation).  Upload with glUniformMatrix4x3fv ( loc, 1, GL_TRUE, &a.m[0][0] )
+/// or convert with esAffineToMatrix.  The esAffine* functions use the same
+/// composition order as their ESMatrix counterparts.
+typedef struct
+{
+   GLfloat   m[3][4];
+} ESAffine;
+
+/// Index of each plane in ESFrustum::planes
+enum
+{
+   ES_FRUSTUM_LEFT,
+   ES_FRUSTUM_RIGHT,
+   ES_FRUSTUM_BOTTOM,
+   ES_FRUSTUM_TOP,
+   ES_FRUSTUM_NEAR,
+   ES_FRUSTUM_FAR
+};
+
+/// View frustum as six normalized planes (a, b, c, d) pointing inwards:
+/// a point is inside a plane when a*x + b*y + c*z + d >= 0
+typedef struct
+{
+   GLfloat   planes[6][4];
+} ESFrustum;
+
+/// Unit quaternion rotation (x, y, z) * sin ( angle / 2 ), cos ( angle / 2 )
+typedef struct
+{
+   GLfloat   x, y, z, w;
+} ESQuat;
+
+/// ESQuat packed as four snorm16 values, 8 bytes.  Use as a per-instance attribute with
+/// glVertexAttribPointer ( loc, 4, GL_SHORT, GL_TRUE, ... ) and renormalize in the shader.
+typedef struct
+{
+   GLshort   x, y, z, w;
+} ESQuatPacked;
+
+/// Rigid transform (rotation followed by translation) as a unit dual quaternion
+typedef struct
+{
+   ESQuat    real;
+   ESQuat    dual;
+} ESDualQuat;
+
+/// Transform hierarchy.  Nodes are stored as parallel arrays in the order they were
+/// added, and a parent is always added before its children.  world[i] is
+/// local[i] * world[parent[i]] as of the last esHierarchyUpdate; changed[i] is
+/// nonzero when that update recomputed world[i].  Treat all fields as read-only.
+typedef struct
+{
+   int        count;
+   int        capacity;
+   int       *parent;
+   ESMatrix  *local;
+   ESMatrix  *world;
+   GLubyte   *dirty;
+   GLubyte   *changed;
+
+   /// Number of ancestors of each node, and the largest of them
+   int       *depth;
+   int        maxDepth;
+
+   /// Node indices sorted by depth, then index, and where each depth level starts
+   /// in that list.  Rebuilt by esHierarchyUpdate when levelCount != count.
+   int       *levelOrder;
+   int       *levelStart;
+   int        levelCount;
+
+   /// Scratch for esHierarchyUpdate: the nodes of one level it recomputes
+   int       *order;
+
+   /// Lowest node index with a dirty local matrix, count if none
+   int        firstDirty;
+   /// Lowest node index whose changed flag is set, count if none
+   int        firstChanged;
+} ESHierarchy;
+
+/// Camera with view and projection parameters.  Set it up with esCameraLookAt or
+/// esCameraSetView and esCameraPerspective or esCameraOrtho, and read the matrices
+/// with the esCameraGet* functions, which compute them only after a change.
+/// version is incremented whenever a setter changes anything (it starts at 1), so
+/// work that depends on the camera can be skipped while the version is unchanged.
+typedef struct
+{
+   GLfloat    eye[3];
+   GLfloat    target[3];
+   GLfloat    up[3];
+   GLboolean  explicitView;
+
+   GLboolean  ortho;
+   GLfloat    fovy;
+   GLfloat    aspect;
+   GLfloat    left, right, bottom, top;
+   GLfloat    nearZ, farZ;
+
+   ESMatrix   view;
+   ESMatrix   projection;
+   ESMatrix   viewProjection;
+   ESMatrix   inverseViewProjection;
+   ESFrustum  frustum;
+   GLuint     valid;
+
+   GLuint     version;
+} ESCamera;
+
+/// Per-instance transforms stored as structure-of-arrays, for esInstanceComputeMVPs.
+/// Each instance is scaled, rotated by a unit quaternion and then translated.  To start
+/// from Euler or axis-angle data, convert it once with esQuatFromAxisAngle.
+typedef struct
+{
+   int        count;
+   GLfloat   *positionX;
+   GLfloat   *positionY;
+   GLfloat   *positionZ;
+   GLfloat   *rotationX;
+   GLfloat   *rotationY;
+   GLfloat   *rotationZ;
+   GLfloat   *rotationW;
+   /// Uniform scale per instance, may be NULL for no scaling
+   GLfloat   *scale;
+} ESInstanceData;
+
+/// Post-transform vertex cache statistics, from esAnalyzeVertexCache
+typedef struct
+{
+   /// Average cache miss ratio: vertices transformed per triangle, from 0.5 (ideal) to 3
+   GLfloat   acmr;
+   /// Average transform to vertex ratio: vertices transformed per vertex used, 1 is ideal
+   GLfloat   atvr;
+   /// Number of vertices transformed
+   int       transformed;
+} ESVertexCacheStats;
+
+/// Range of a 16-bit index buffer from esSplitIndices16.  Indices are relative to
+/// baseVertex: point the vertex attributes at that vertex before drawing the range.
+typedef struct
+{
+   /// Offset of the first index in the GLushort array
+   int   firstIndex;
+   int   numIndices;
+   /// Vertex that index 0 refers to
+   int   baseVertex;
+   /// Vertices baseVertex .. baseVertex + numVertices - 1 may be referenced
+   int   numVertices;
+} ESSubmesh;
+
+/// Interleaved vertex layout for the esGen*Mesh functions
+typedef struct
+{
+   /// Bytes from one vertex to the next, a multiple of 4
+   GLsizei   stride;
+   /// Byte offset of each ES_MESH_* attribute in a vertex, a multiple of 4, or -1 to leave it out
+   GLint     offset[ES_MESH_MAX_ATTRIBS];
+} ESMeshLayout;
+
+/// One level of detail of an ESMesh, drawn with glDrawElements over its index range.
+/// Indices are absolute, so every level shares the mesh's vertex attribute setup.
+typedef struct
+{
+   int       firstIndex;
+   int       numIndices;
+   /// The level uses vertices firstVertex .. firstVertex + numVertices - 1
+   int       firstVertex;
+   int       numVertices;
+   /// Bounding sphere of the level
+   GLfloat   center[3];
+   GLfloat   radius;
+} ESMeshLod;
+
+/// Shape generated into one block of memory: numVertices interleaved vertices followed
+/// by numIndices GLuint indices.  The block can be uploaded with a single glBufferData
+/// and the buffer bound both as GL_ARRAY_BUFFER and, at indexOffset, GL_ELEMENT_ARRAY_BUFFER.
+typedef struct
+{
+   ESMeshLayout layout;
+   /// GL_TRIANGLES, or GL_TRIANGLE_STRIP when generated with ES_SHAPE_TRIANGLE_STRIP
+   GLenum       mode;
+   int          numVertices;
+   int          numIndices;
+   /// Start of the block, NULL if the mesh was only sized
+   GLvoid      *vertices;
+   GLuint      *indices;
+   /// Byte offset of the indices from the start of the block
+   GLsizeiptr   indexOffset;
+   /// Size of the block in bytes
+   GLsizeiptr   size;
+   /// TRUE if the block was allocated and must be released with esMeshFree
+   GLboolean    allocated;
+   /// Levels of detail, each coarser than the one before; a single level
+   /// covers the whole mesh unless a chain was generated
+   int          numLods;
+   ESMeshLod    lods[ES_MESH_MAX_LODS];
+} ESMesh;
+
+/// glVertexAttribPointer parameters of one attribute of an ESQuantizedVertices
+typedef struct
+{
+   GLint       size;
+   GLenum      type;
+   GLboolean   normalized;
+   /// Byte offset in a vertex, -1 if the attribute is not stored
+   GLint       offset;
+} ESVertexAttrib;
+
+/// Vertices re-encoded by esQuantizeVertices.  Dequantize each attribute in the
+/// vertex shader with value * scale + bias, per component.
+typedef struct
+{
+   ESVertexAttrib attribs[ES_MESH_MAX_ATTRIBS];
+   GLsizei      stride;
+   int          numVertices;
+   GLfloat      scale[ES_MESH_MAX_ATTRIBS][3];
+   GLfloat      bias[ES_MESH_MAX_ATTRIBS][3];
+   /// Largest and root mean square component error of the decoded values against the source
+   GLfloat      maxError[ES_MESH_MAX_ATTRIBS];
+   GLfloat      rmsError[ES_MESH_MAX_ATTRIBS];
+   /// The encoded vertices, NULL if they were only sized
+   GLvoid      *vertices;
+   GLsizeiptr   size;
+   /// TRUE if the vertices were allocated and must be released with esQuantizedVerticesFree
+   GLboolean    allocated;
+} ESQuantizedVertices;
+
+/// How far esSimplifyMesh may go; it stops at whichever limit is reached first
+typedef struct
+{
+   /// Triangles to simplify down to, 0 to go by targetError alone
+   int          targetTriangles;
+   /// Largest error a collapse may add, 0 for no limit.  The error combines the position
+   /// distance with the attribute differences scaled by attribWeights, so it is only a
+   /// distance in position units when every weight is 0
+   GLfloat      targetError;
+   /// Position units per unit of normal and texture coordinate difference, indexed
+   /// by ES_MESH_*; 0 leaves the attribute out of the error
+   GLfloat      attribWeights[ES_MESH_MAX_ATTRIBS];
+   /// Bitfield of ES_SIMPLIFY_* values
+   GLbitfield   flags;
+} ESSimplifyParams;
+
+/// Triangle list split into meshlets by esBuildMeshlets.  The per-meshlet data is kept
+/// as structure-of-arrays for esCullMeshlets.
+typedef struct
+{
+   int          numMeshlets;
+   /// The source triangles reordered so each meshlet's are contiguous
+   GLuint      *indices;
+   int          numIndices;
+   /// Index range and smallest and largest vertex of each meshlet
+   GLint       *firstIndex;
+   GLsizei     *count;
+   GLuint      *minVertex;
+   GLuint      *maxVertex;
+   /// Bounding sphere of each meshlet
+   GLfloat     *centerX;
+   GLfloat     *centerY;
+   GLfloat     *centerZ;
+   GLfloat     *radius;
+   /// Cone holding every triangle normal of a meshlet: its axis and the sine of its half
+   /// angle, 1 if the meshlet can be seen from any side
+   GLfloat     *coneX;
+   GLfloat     *coneY;
+   GLfloat     *coneZ;
+   GLfloat     *coneCutoff;
+   /// Scratch visibility bits for esCullMeshlets
+   GLuint      *visibleMask;
+} ESMeshlets;
+
+/// Range of indices to draw with glDrawRangeElements ( mode, start, end, count, type,
+/// firstIndex * index size ), from esCullMeshlets
+typedef struct
+{
+   GLint        firstIndex;
+   GLsizei      count;
+   GLuint       start;
+   GLuint       end;
+} ESDrawRange;
+
+/// Parameters of a shape in the geometry cache, see esAcquireGeometry.  Fields a
+/// shape does not use are ignored, so they do not split the cache.
+typedef struct
+{
+   /// ES_GEOMETRY_* value
+   GLenum       shape;
+   /// ES_MESH_*_BIT attributes, packed as by esMeshLayoutInit
+   GLbitfield   attribs;
+   /// Slices, the grid size or the icosphere subdivisions; unused by the cube
+   int          tessellation;
+   /// Rings around the tube of a torus
+   int          numRings;
+   /// Height over radius of a cylinder, cone or capsule, tube radius over radius of a torus
+   GLfloat      aspect;
+   /// Levels of detail of a cylinder, cone, torus, capsule or icosphere
+   int          numLods;
+   /// ES_SHAPE_* flags of a sphere or grid
+   GLuint       flags;
+} ESGeometryDesc;
+
+/// Shape shared through the geometry cache.  Bind vertexBuffer with layout for the
+/// attributes and indexBuffer as GL_ELEMENT_ARRAY_BUFFER, then draw a level with
+/// glDrawElements ( mode, lods[k].numIndices, indexType, lods[k].firstIndex * indexSize ).
+typedef struct
+{
+   GLuint       vertexBuffer;
+   GLuint       indexBuffer;
+   ESMeshLayout layout;
+   /// GL_TRIANGLES, or GL_TRIANGLE_STRIP for a sphere or grid with ES_SHAPE_TRIANGLE_STRIP
+   GLenum       mode;
+   /// GL_UNSIGNED_SHORT if the vertices can be addressed with 16 bits, else GL_UNSIGNED_INT.
+   /// Strips are separated by the largest value of the type.
+   GLenum       indexType;
+   GLsizei      indexSize;
+   int          numVertices;
+   int          numIndices;
+   /// Levels of detail, with bounds at unit size
+   int          numLods;
+   ESMeshLod    lods[ES_MESH_MAX_LODS];
+} ESGeometry;
+
+/// Memory functions used by Common, see esSetAllocator
+typedef struct
+{
+   /// Return size bytes aligned for any type, or NULL
+   void * ( ESCALLBACK *allocFunc ) ( void *userData, size_t size );
+   /// Resize a block keeping its contents, ptr may be NULL.  On failure return NULL
+   /// and leave the block as it was.
+   void * ( ESCALLBACK *reallocFunc ) ( void *userData, void *ptr, size_t size );
+   /// Release a block, ptr may be NULL
+   void ( ESCALLBACK *freeFunc ) ( void *userData, void *ptr );
+   /// Passed to every call
+   void *userData;
+} ESAllocator;
+
 typedef struct ESContext ESContext;
 
 struct ESContext
@@ -190,6 +599,54 @@ void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
 //
 void ESUTIL_API esLogMessage ( const char *formatStr, ... );
 
+//
+/// \brief Route every allocation made by Common through an allocator.  Memory that Common
+///        returns, such as esGen* arrays, esLoadTGA images and the application's userData,
+///        is released with esFree.  Set it before anything is allocated; the functions may
+///        be called from worker threads.
+/// \param allocator Functions to use, copied; NULL restores malloc, realloc and free
+//
+void ESUTIL_API esSetAllocator ( const ESAllocator *allocator );
+
+//
+/// \brief Allocate memory with the esSetAllocator allocator
+/// \return The block, NULL if memory ran out
+//
+void *ESUTIL_API esMalloc ( size_t size );
+
+//
+/// \brief Allocate count * size zeroed bytes with the esSetAllocator allocator
+/// \return The block, NULL if memory ran out or the size overflows
+//
+void *ESUTIL_API esCalloc ( size_t count, size_t size );
+
+//
+/// \brief Resize a block from esMalloc, esCalloc or esRealloc, or allocate one if ptr is NULL
+/// \return The block, NULL if memory ran out, in which case ptr is left as it was
+//
+void *ESUTIL_API esRealloc ( void *ptr, size_t size );
+
+//
+/// \brief Release memory allocated by Common or esMalloc, esCalloc and esRealloc
+/// \param ptr Block to release, may be NULL
+//
+void ESUTIL_API esFree ( void *ptr );
+
+//
+/// \brief Allocate transient memory that lives until the next esFrameReset.  The framework
+///        resets after presenting each frame, so once the arena has grown to a frame's needs
+///        this is a pointer bump with no heap call.  Use it on the thread running the frame loop.
+/// \param size Bytes wanted
+/// \return A 16-byte aligned block, NULL if memory ran out
+//
+void *ESUTIL_API esFrameAlloc ( size_t size );
+
+//
+/// \brief Release everything from esFrameAlloc at once.  Called by the framework after
+///        eglSwapBuffers; an application with its own loop calls it once per frame.
+//
+void ESUTIL_API esFrameReset ( void );
+
 //
 ///
 /// \brief Load a shader, check for compile errors, print error messages to output log
@@ -212,16 +669,18 @@ GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragSha
 
 //
 /// \brief Generates geometry for a sphere.  Allocates memory for the vertex data and stores
-///        the results in the arrays.  Generate index list for a TRIANGLE_STRIP
+///        the results in the arrays.  Generate index list as TRIANGLES, or as a TRIANGLE_STRIP
+///        with primitive restart if flags has ES_SHAPE_TRIANGLE_STRIP.
 /// \param numSlices The number of slices in the sphere
+/// \param flags Bitfield of ES_SHAPE_* values, 0 for the original layout
 /// \param vertices If not NULL, will contain array of float3 positions
 /// \param normals If not NULL, will contain array of float3 normals
 /// \param texCoords If not NULL, will contain array of float2 texCoords
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \param indices If not NULL, will contain the array of indices
 /// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLE_STRIP
+///         if it is not NULL ) as GL_TRIANGLES or GL_TRIANGLE_STRIP, 0 if memory ran out
 //
-int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GLfloat **normals,
+int ESUTIL_API esGenSphere ( int numSlices, float radius, GLuint flags, GLfloat **vertices, GLfloat **normals,
                              GLfloat **texCoords, GLuint **indices );
 
 //
@@ -231,23 +690,420 @@ int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GL
 /// \param vertices If not NULL, will contain array of float3 positions
 /// \param normals If not NULL, will contain array of float3 normals
 /// \param texCoords If not NULL, will contain array of float2 texCoords
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \param indices If not NULL, will contain the array of indices for the triangle list
 /// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLES
+///         if it is not NULL ) as GL_TRIANGLES
 //
 int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
                            GLfloat **texCoords, GLuint **indices );
 
 //
 /// \brief Generates a square grid consisting of triangles.  Allocates memory for the vertex data and stores
-///        the results in the arrays.  Generate index list as TRIANGLES.
+///        the results in the arrays.  Generate index list as TRIANGLES, or as a TRIANGLE_STRIP
+///        with primitive restart if flags has ES_SHAPE_TRIANGLE_STRIP.
 /// \param size create a grid of size by size (number of triangles = (size-1)*(size-1)*2)
+/// \param flags Bitfield of ES_SHAPE_OPTIMIZE_VERTEX_CACHE and ES_SHAPE_TRIANGLE_STRIP, or 0
 /// \param vertices If not NULL, will contain array of float3 positions
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \param indices If not NULL, will contain the array of indices
 /// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLES
+///         if it is not NULL ) as GL_TRIANGLES or GL_TRIANGLE_STRIP
+//
+int ESUTIL_API esGenSquareGrid ( int size, GLuint flags, GLfloat **vertices, GLuint **indices );
+
+//
+/// \brief Fill in a tightly packed layout holding the given attributes in ES_MESH_* order
+/// \param layout Returns the layout
+/// \param attribs Bitfield of ES_MESH_*_BIT values
+//
+void ESUTIL_API esMeshLayoutInit ( ESMeshLayout *layout, GLbitfield attribs );
+
+//
+/// \brief Generate esGenSphere geometry as an ESMesh.  The memory and memorySize arguments
+///        are shared by all the esGen*Mesh functions:
+///        - memorySize NULL: the mesh is allocated and must be released with esMeshFree
+///        - memory NULL: the mesh is only sized, *memorySize returns the bytes it needs
+///        - otherwise the mesh is written to memory, such as a buffer mapped with
+///          glMapBufferRange, if *memorySize is large enough
+/// \param mesh Returns the mesh, its counts and size are set even if nothing is written
+/// \param layout Vertex layout, texture coordinates as for esGenSphere
+/// \param flags Bitfield of ES_SHAPE_* values, as for esGenSphere
+/// \param memory Where to write the mesh, or NULL
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenSphereMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, float radius,
+                                       GLuint flags, void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Generate esGenCube geometry as an ESMesh, always as GL_TRIANGLES
+/// \param mesh Returns the mesh
+/// \param layout Vertex layout
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenCubeMesh ( ESMesh *mesh, const ESMeshLayout *layout, float scale,
+                                     void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Generate esGenSquareGrid geometry as an ESMesh.  Normals are ( 0, 0, -1 ), the side
+///        the triangles face, and texture coordinates repeat the position x and y.
+/// \param mesh Returns the mesh
+/// \param layout Vertex layout
+/// \param flags Bitfield of ES_SHAPE_* values, as for esGenSquareGrid
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenSquareGridMesh ( ESMesh *mesh, const ESMeshLayout *layout, int size, GLuint flags,
+                                           void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Generate a capped cylinder along the y axis, centered on the origin, as GL_TRIANGLES.
+///        Each further level of detail halves numSlices, down to 3.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSlices Slices around the axis of the finest level, at least 3
+/// \param radius Radius of the cylinder
+/// \param height Height of the cylinder
+/// \param numLods Levels of detail wanted, at most ES_MESH_MAX_LODS; fewer are generated
+///        when the tessellation runs out
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenCylinderMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, float radius,
+                                         float height, int numLods, void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Generate a cone along the y axis, apex up and centered on the origin, with a capped
+///        base, as GL_TRIANGLES.  Each further level of detail halves numSlices, down to 3.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSlices Slices around the axis of the finest level, at least 3
+/// \param radius Radius of the base
+/// \param height Height from the base to the apex
+/// \param numLods Levels of detail wanted, see esGenCylinderMesh
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
 //
-int ESUTIL_API esGenSquareGrid ( int size, GLfloat **vertices, GLuint **indices );
+GLboolean ESUTIL_API esGenConeMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, float radius,
+                                     float height, int numLods, void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Generate a torus around the y axis as GL_TRIANGLES.  Each further level of detail
+///        halves numSlices and numRings, down to 3.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSlices Slices around the y axis of the finest level, at least 3
+/// \param numRings Segments around the tube of the finest level, at least 3
+/// \param radius Distance from the center to the middle of the tube
+/// \param tubeRadius Radius of the tube
+/// \param numLods Levels of detail wanted, see esGenCylinderMesh
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenTorusMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, int numRings,
+                                      float radius, float tubeRadius, int numLods,
+                                      void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Generate a capsule, a cylinder with hemispherical ends, along the y axis and centered
+///        on the origin, as GL_TRIANGLES.  Each hemisphere has numSlices / 4 rings.  Each further
+///        level of detail halves numSlices, down to 4.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSlices Slices around the axis of the finest level, at least 4
+/// \param radius Radius of the cylinder and the hemispheres
+/// \param height Height of the cylinder between the hemisphere centers
+/// \param numLods Levels of detail wanted, see esGenCylinderMesh
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenCapsuleMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, float radius,
+                                        float height, int numLods, void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Generate an icosphere, an icosahedron whose faces are split into 4^numSubdivisions
+///        triangles projected onto the sphere, as GL_TRIANGLES.  Each further level of detail
+///        has one subdivision less, down to the icosahedron.  Faces do not share vertices, so
+///        texture s can run a little past 0 or 1 on faces crossing the seam at +z, for GL_REPEAT.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSubdivisions Subdivisions of the finest level, 0 to 8
+/// \param radius Radius of the sphere
+/// \param numLods Levels of detail wanted, see esGenCylinderMesh
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenIcosphereMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSubdivisions,
+                                          float radius, int numLods, void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Pick the level of detail to draw at a distance.  Every level has edges about twice
+///        as long as the one before, so doubling the distance keeps them the same size on screen:
+///        level 0 is used closer than lodDistance and level k from lodDistance * 2^(k-1).
+/// \param mesh Mesh with one or more levels of detail
+/// \param distance Distance from the eye to the center of the mesh
+/// \param lodDistance Distance up to which the finest level is drawn
+/// \return Index into mesh->lods
+//
+int ESUTIL_API esMeshSelectLod ( const ESMesh *mesh, GLfloat distance, GLfloat lodDistance );
+
+//
+/// \brief Release a mesh allocated by an esGen*Mesh function.  Meshes written to caller
+///        memory are only cleared.
+//
+void ESUTIL_API esMeshFree ( ESMesh *mesh );
+
+//
+/// \brief Re-encode float vertices with smaller attribute types.  GL_SHORT and GL_UNSIGNED_SHORT
+///        are normalized over the bounds of each component, GL_INT_2_10_10_10_REV (positions and
+///        normals only) stores values in [-1, 1] as they are and GL_HALF_FLOAT and GL_FLOAT need
+///        no dequantization.  Each attribute is padded to a multiple of 4 bytes.
+/// \param result Returns the encoded vertices, their glVertexAttribPointer parameters,
+///        dequantization constants and errors
+/// \param layout Layout of the float source, as in an ESMesh
+/// \param vertices Source vertices
+/// \param numVertices Number of vertices
+/// \param types Type of each ES_MESH_* attribute, NULL for GL_SHORT positions,
+///        GL_INT_2_10_10_10_REV normals and GL_UNSIGNED_SHORT texture coordinates
+/// \param memory Where to write the vertices, or NULL, as for esGenSphereMesh
+/// \param memorySize Size of memory in bytes, or NULL to allocate; returns the size needed
+/// \return FALSE if a type is not supported for its attribute, memory is too small
+///         or could not be allocated
+//
+GLboolean ESUTIL_API esQuantizeVertices ( ESQuantizedVertices *result, const ESMeshLayout *layout,
+                                          const GLvoid *vertices, int numVertices, const GLenum *types,
+                                          void *memory, GLsizeiptr *memorySize );
+
+//
+/// \brief Release vertices allocated by esQuantizeVertices.  Vertices written to caller
+///        memory are only cleared.
+//
+void ESUTIL_API esQuantizedVerticesFree ( ESQuantizedVertices *vertices );
+
+//
+/// \brief Get a shape from the process-wide geometry cache, generating and uploading it to
+///        buffer objects the first time it is asked for.  Later requests with the same
+///        parameters, including the flags of a sphere or grid, add a reference to
+///        the existing buffers.  Must be called with the GL context current.
+/// \param desc Shape parameters
+/// \return The shared shape, NULL if a parameter is invalid or memory ran out
+//
+const ESGeometry * ESUTIL_API esAcquireGeometry ( const ESGeometryDesc *desc );
+
+//
+/// \brief Drop a reference from esAcquireGeometry, deleting the buffers with the last one
+/// \param geometry Shape to release, may be NULL
+//
+void ESUTIL_API esReleaseGeometry ( const ESGeometry *geometry );
+
+//
+/// \brief Simulate a FIFO post-transform vertex cache over an index buffer
+/// \param stats Returns the ACMR, ATVR and number of vertices transformed
+/// \param mode GL_TRIANGLES, or GL_TRIANGLE_STRIP with ES_PRIMITIVE_RESTART_INDEX separators
+/// \param indices Index buffer
+/// \param numIndices Number of indices
+/// \param numVertices One more than the largest index
+/// \param cacheSize Cache entries, 0 for ES_VERTEX_CACHE_SIZE
+//
+void ESUTIL_API esAnalyzeVertexCache ( ESVertexCacheStats *stats, GLenum mode, const GLuint *indices,
+                                       int numIndices, int numVertices, int cacheSize );
+
+//
+/// \brief Reorder the triangles of a triangle list in place for the post-transform vertex
+///        cache, using Tipsify.  Works on any indexed mesh; each triangle keeps its winding.
+/// \param indices Triangle list
+/// \param numIndices Number of indices
+/// \param numVertices One more than the largest index
+/// \param cacheSize Cache entries to optimize for, 0 for ES_VERTEX_CACHE_SIZE
+/// \return GL_FALSE if memory could not be allocated, leaving indices unchanged
+//
+GLboolean ESUTIL_API esOptimizeVertexCache ( GLuint *indices, int numIndices, int numVertices, int cacheSize );
+
+//
+/// \brief Reorder clusters of a cache-optimized triangle list so that outward-facing
+///        clusters are drawn first, reducing overdraw.  Run after esOptimizeVertexCache.
+/// \param indices Triangle list
+/// \param numIndices Number of indices
+/// \param positions float3 position of each vertex
+/// \param positionStride Bytes between consecutive positions, 0 for tightly packed float3
+/// \param numVertices One more than the largest index
+/// \param cacheSize Cache entries, 0 for ES_VERTEX_CACHE_SIZE
+/// \param threshold Allowed ACMR increase, e.g. 1.05 for at most 5%; larger values make
+///        smaller clusters that can be sorted more finely
+/// \return GL_FALSE if memory could not be allocated, leaving indices unchanged
+//
+GLboolean ESUTIL_API esOptimizeOverdraw ( GLuint *indices, int numIndices, const GLfloat *positions,
+                                          int positionStride, int numVertices, int cacheSize,
+                                          float threshold );
+
+//
+/// \brief Convert 32-bit indices, e.g. from the esGen* functions, to 16-bit indices. Meshes
+///        whose primitives span more than 65535 vertices are split, in order, into submeshes
+///        that each reference a range of at most 65535 vertices.  Grids and spheres are split
+///        between rows.  Strip restarts become 0xFFFF.
+/// \param indices16 Returns the 16-bit indices of all submeshes, free with esFree()
+/// \param submeshes Returns the index range and base vertex of each submesh, free with esFree()
+/// \param mode GL_TRIANGLES, or GL_TRIANGLE_STRIP with ES_PRIMITIVE_RESTART_INDEX separators
+/// \param indices Source indices
+/// \param numIndices Number of source indices
+/// \return The number of submeshes, 1 if all vertices fit; 0 if a single primitive spans
+///         too many vertices or memory could not be allocated
+//
+int ESUTIL_API esSplitIndices16 ( GLushort **indices16, ESSubmesh **submeshes, GLenum mode,
+                                  const GLuint *indices, int numIndices );
+
+//
+/// \brief Find vertices with the same attributes.  Every vertex maps to the first vertex it
+///        welds to, and the vertices kept are numbered in order, so remap[v] <= v and the
+///        vertices can be compacted in place.  Vertices are hashed on worker threads.
+/// \param remap Returns the new index of each vertex
+/// \param layout Layout of the vertices; every stored attribute is compared
+/// \param vertices Interleaved float vertices
+/// \param numVertices Number of vertices
+/// \param epsilon 0 to weld equal vertices (-0 equals +0), otherwise the largest difference
+///        in any component that still welds.  Each vertex welds to the first one in range,
+///        so chains of close vertices are not merged into one.
+/// \return The number of vertices kept, 0 if memory ran out
+//
+int ESUTIL_API esWeldVertices ( GLuint *remap, const ESMeshLayout *layout, const GLvoid *vertices,
+                                int numVertices, GLfloat epsilon );
+
+//
+/// \brief Remove, in place, the triangles of a GL_TRIANGLES list that repeat an index, such as
+///        those left by esWeldVertices, and the repeats of a triangle with the same winding.
+///        The triangles kept stay in order with their first corner unchanged.
+/// \param indices Triangle list
+/// \param numIndices Number of indices
+/// \return The number of indices kept, -1 if memory ran out
+//
+int ESUTIL_API esRemoveDegenerateTriangles ( GLuint *indices, int numIndices );
+
+//
+/// \brief Weld the vertices of a GL_TRIANGLES mesh with esWeldVertices, drop the triangles
+///        that become degenerate or repeated, and pack vertices and indices in place.  Each
+///        level of detail is cleaned on its own and keeps its bounds.  An allocated mesh is
+///        shrunk to its new size.
+/// \param mesh Mesh to clean
+/// \param epsilon Weld distance, see esWeldVertices
+/// \return FALSE for a strip mesh, a mesh that was only sized, or if memory ran out
+//
+GLboolean ESUTIL_API esCleanMesh ( ESMesh *mesh, GLfloat epsilon );
+
+//
+/// \brief Compute a tangent frame for the vertices of a GL_TRIANGLES list and pack each, with
+///        its normal, as a QTangent: the rotation taking x, y and z to the tangent (+s),
+///        normal x tangent and the normal, with the sign of w set for a mirrored mapping.
+///        That is 8 bytes in place of 28 for float normal, tangent and handedness.  Triangle
+///        tangents are weighted by area and orthogonalized against each vertex's normal.
+///        Triangles are processed on worker threads.  Decode with esQTangentUnpack, or in a
+///        vertex shader built as "#version 300 es\n" ES_QTANGENT_GLSL "...":
+///
+///           in vec4 a_qtangent;
+///           ...
+///           esDecodeQTangent ( a_qtangent, normal, tangent, bitangent );
+///
+/// \param result Returns the QTangent of each vertex the indices use; others are not written
+/// \param stride Bytes from one result to the next, 0 if they are tightly packed.  Use the
+///        stride of an interleaved vertex buffer to write into it.
+/// \param layout Layout of the vertices, which need positions, normals and texture coordinates
+/// \param vertices Interleaved float vertices
+/// \param numVertices Number of vertices
+/// \param indices Triangle list
+/// \param numIndices Number of indices
+/// \return FALSE if an attribute is missing, numIndices is not a multiple of 3 or memory ran out
+//
+GLboolean ESUTIL_API esGenTangents ( ESQuatPacked *result, GLsizei stride, const ESMeshLayout *layout,
+                                     const GLvoid *vertices, int numVertices, const GLuint *indices,
+                                     int numIndices );
+
+//
+/// \brief Run esGenTangents over every level of detail of a GL_TRIANGLES mesh, so vertices
+///        shared between levels take their frame from the finest level using them
+/// \param result Returns numVertices QTangents
+/// \param stride Bytes from one result to the next, 0 if they are tightly packed
+/// \param mesh Mesh with positions, normals and texture coordinates
+/// \return FALSE for a strip mesh, a mesh that was only sized, a missing attribute or if
+///         memory ran out
+//
+GLboolean ESUTIL_API esGenMeshTangents ( ESQuatPacked *result, GLsizei stride, const ESMesh *mesh );
+
+//
+/// \brief Decode a QTangent on the CPU, as ES_QTANGENT_GLSL does
+/// \param src Packed frame from esGenTangents
+/// \param normal Returns the unit normal
+/// \param tangent Returns the unit tangent
+/// \param bitangent Returns the unit bitangent, normal x tangent negated for a mirrored mapping
+//
+void ESUTIL_API esQTangentUnpack ( const ESQuatPacked *src, GLfloat normal[3], GLfloat tangent[3],
+                                   GLfloat bitangent[3] );
+
+//
+/// \brief Split a triangle list into meshlets of at most maxVertices vertices and maxTriangles
+///        triangles for esCullMeshlets.  Meshlets grow over neighbouring triangles that add the
+///        fewest vertices and keep their normals close, so their bounds and normal cones stay tight.
+///        64 vertices and 126 triangles suit most meshes.
+/// \param meshlets Returns the meshlets, release with esMeshletsFree
+/// \param indices Triangle list
+/// \param numIndices Number of indices
+/// \param positions float3 position of each vertex
+/// \param positionStride Bytes between consecutive positions, 0 for tightly packed float3
+/// \param numVertices One more than the largest index
+/// \param maxVertices Most vertices per meshlet, at least 3
+/// \param maxTriangles Most triangles per meshlet
+/// \return GL_FALSE if there are no triangles, a limit is too small or memory could not be allocated
+//
+GLboolean ESUTIL_API esBuildMeshlets ( ESMeshlets *meshlets, const GLuint *indices, int numIndices,
+                                       const GLfloat *positions, int positionStride, int numVertices,
+                                       int maxVertices, int maxTriangles );
+
+//
+/// \brief Release meshlets built by esBuildMeshlets
+//
+void ESUTIL_API esMeshletsFree ( ESMeshlets *meshlets );
+
+//
+/// \brief Simplify a triangle list by collapsing edges in order of quadric error.  Vertices
+///        are only moved onto others, so the result indexes the same vertex buffer.  Vertices
+///        sharing a position with different attributes, such as texture seams, are kept, and
+///        border vertices only slide along the border.  Quadrics and collapse costs are
+///        computed on esSetThreadCount threads.
+/// \param result Returns the simplified triangle list, room for numIndices indices; may be indices
+/// \param indices Triangle list
+/// \param numIndices Number of indices
+/// \param layout Vertex layout, a position is required
+/// \param vertices Vertex data
+/// \param numVertices Number of vertices
+/// \param params Limits, attribute weights and flags
+/// \param error If not NULL, returns the largest error of a collapse made, measured like
+///        params->targetError: position distance combined with the weighted attribute terms
+/// \return The number of indices written, 0 if there is no position, every triangle is
+///         degenerate or memory ran out
+//
+int ESUTIL_API esSimplifyMesh ( GLuint *result, const GLuint *indices, int numIndices, const ESMeshLayout *layout,
+                                const GLvoid *vertices, int numVertices, const ESSimplifyParams *params,
+                                GLfloat *error );
+
+//
+/// \brief Build a level of detail chain for a GL_TRIANGLES mesh with esSimplifyMesh.  Each level
+///        is simplified from the one before to ratio times its triangles, and the chain ends early
+///        once params->targetError or locked vertices stop it.  All levels share one copy of
+///        the vertices and the bound of the first level of mesh.
+/// \param result Returns the mesh, allocated, release with esMeshFree
+/// \param mesh Source mesh; its first level becomes level 0
+/// \param numLods Levels wanted, at most ES_MESH_MAX_LODS
+/// \param ratio Fraction of the triangles of each level kept in the next, such as 0.5
+/// \param params Error limit, attribute weights and flags; targetTriangles is set per level
+/// \return FALSE if mesh is not an indexed triangle list or memory ran out
+//
+GLboolean ESUTIL_API esGenMeshLods ( ESMesh *result, const ESMesh *mesh, int numLods, GLfloat ratio,
+                                     const ESSimplifyParams *params );
 
 //
 /// \brief Loads a 8-bit, 24-bit or 32-bit TGA image from a file
@@ -255,7 +1111,7 @@ int ESUTIL_API esGenSquareGrid ( int size, GLfloat **vertices, GLuint **indices
 /// \param fileName Name of the file on disk
 /// \param width Width of loaded image in pixels
 /// \param height Height of loaded image in pixels
-///  \return Pointer to loaded image.  NULL on failure.
+///  \return Pointer to loaded image, release with esFree.  NULL on failure.
 //
 char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width, int *height );
 
@@ -312,11 +1168,114 @@ void ESUTIL_API esOrtho ( ESMatrix *result, float left, float right, float botto
 
 //
 /// \brief Perform the following operation - result matrix = srcA matrix * srcB matrix
-/// \param result Returns multiplied matrix
+///        Uses SSE/AVX or NEON when available (see esUtil_simd.h).  The vector paths
+///        accumulate in the same order as the scalar path and never fuse multiply-adds,
+///        so results are bit-identical to the scalar code; if the compiler contracts the
+///        scalar code into FMAs the two differ by at most 2 ULP per element.
+/// \param result Returns multiplied matrix, may be the same as srcA or srcB
 /// \param srcA, srcB Input matrices to be multiplied
 //
 void ESUTIL_API esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB );
 
+//
+/// \brief Same as esMatrixMultiply for 16-byte aligned matrices
+/// \param result Returns multiplied matrix, may be the same as srcA or srcB
+/// \param srcA, srcB Input matrices to be multiplied
+//
+void ESUTIL_API esMatrixMultiplyAligned ( ESMatrixA *result, const ESMatrixA *srcA, const ESMatrixA *srcB );
+
+//
+/// \brief Multiply an array of matrices by a shared matrix: out[i] = a[i] * sharedB
+///        Large batches are split across the threads set with esSetThreadCount.
+/// \param out Returns n matrices; may be the same array as a, or a mapped buffer
+/// \param a Array of n matrices
+/// \param sharedB Matrix applied to every element, must not point into out
+/// \param n Number of matrices
+//
+void ESUTIL_API esMatrixMultiplyBatch ( ESMatrix *out, const ESMatrix *a, const ESMatrix *sharedB, int n );
+
+//
+/// \brief Pre-multiply an array of matrices by a shared matrix: out[i] = sharedA * b[i]
+/// \param out Returns n matrices; may be the same array as b, or a mapped buffer
+/// \param sharedA Matrix applied to every element, must not point into out
+/// \param b Array of n matrices
+/// \param n Number of matrices
+//
+void ESUTIL_API esMatrixMultiplyBatchLeft ( ESMatrix *out, const ESMatrix *sharedA, const ESMatrix *b, int n );
+
+//
+/// \brief Multiply two arrays of matrices element by element: out[i] = a[i] * b[i]
+/// \param out Returns n matrices; may be the same array as a or b
+/// \param a, b Arrays of n matrices
+/// \param n Number of matrices
+//
+void ESUTIL_API esMatrixMultiplyBatchPairwise ( ESMatrix *out, const ESMatrix *a, const ESMatrix *b, int n );
+
+//
+/// \brief Multiply selected matrices by matrices picked through an index array:
+///        out[i] = a[i] * b[bIndex[i]] for each i in index.  Used by esHierarchyUpdate
+///        to compute one depth level of world matrices at a time.
+/// \param out Returns the selected matrices; may be the same array as a.  It may also be
+///        b as long as no selected element is the b matrix of another selected element.
+/// \param a, b Arrays of matrices
+/// \param index n distinct element indices
+/// \param bIndex For each element, the index of its matrix in b
+/// \param n Number of selected elements
+//
+void ESUTIL_API esMatrixMultiplyBatchGather ( ESMatrix *out, const ESMatrix *a, const ESMatrix *b,
+                                              const int *index, const int *bIndex, int n );
+
+//
+/// \brief Transform an array of points by a matrix: out = ( x, y, z, 1 ) * matrix, keeping x, y, z.
+///        Points are float3 at the start of each element, as produced by the esGen* functions.
+///        Large arrays are split across the threads set with esSetThreadCount.
+/// \param matrix Transform to apply
+/// \param in Input points
+/// \param inStride Bytes between consecutive input points, 0 for tightly packed float3
+/// \param out Returns the transformed points; may be the same array as in if the strides match.
+///        Only the first three floats of each element are written.
+/// \param outStride Bytes between consecutive output points, 0 for tightly packed float3
+/// \param count Number of points
+//
+void ESUTIL_API esTransformPoints ( const ESMatrix *matrix, const GLfloat *in, int inStride, GLfloat *out, int outStride, int count );
+
+//
+/// \brief Transform an array of directions by a matrix, ignoring its translation:
+///        out = ( x, y, z, 0 ) * matrix.  Arguments as for esTransformPoints.  For normals,
+///        pass a matrix whose upper 3x3 is the normal matrix.
+//
+void ESUTIL_API esTransformVectors ( const ESMatrix *matrix, const GLfloat *in, int inStride, GLfloat *out, int outStride, int count );
+
+//
+/// \brief Project an array of points: ( x, y, z, 1 ) * matrix divided by w, e.g. to normalized
+///        device coordinates with a model-view-projection matrix.  Arguments as for esTransformPoints.
+//
+void ESUTIL_API esProjectPoints ( const ESMatrix *matrix, const GLfloat *in, int inStride, GLfloat *out, int outStride, int count );
+
+//
+/// \brief esTransformPoints for points stored as separate x, y, z arrays, e.g. bounding sphere centers
+/// \param matrix Transform to apply
+/// \param inX, inY, inZ Input coordinates
+/// \param outX, outY, outZ Return the transformed coordinates, may be the same arrays as the inputs
+/// \param count Number of points
+//
+void ESUTIL_API esTransformPointsSoA ( const ESMatrix *matrix,
+                                       const GLfloat *inX, const GLfloat *inY, const GLfloat *inZ,
+                                       GLfloat *outX, GLfloat *outY, GLfloat *outZ, int count );
+
+//
+/// \brief Set the number of threads used by the batch functions in Common.  Worker threads
+///        are started when a batch first needs them and are kept for later batches.
+/// \param numThreads Number of threads including the calling thread; 1 (the default)
+///        keeps all work on the calling thread, 0 uses one thread per processor
+//
+void ESUTIL_API esSetThreadCount ( int numThreads );
+
+//
+/// \brief Return the number of threads used by the batch functions in Common
+//
+int ESUTIL_API esGetThreadCount ( void );
+
 //
 //// \brief Return an identity matrix
 //// \param result Returns identity matrix
@@ -336,6 +1295,444 @@ esMatrixLookAt ( ESMatrix *result,
                  float lookAtX, float lookAtY, float lookAtZ,
                  float upX,     float upY,     float upZ );
 
+//
+/// \brief Invert a general 4x4 matrix (SSE block inverse when available)
+/// \param result Returns the inverse, may be the same as src
+/// \param src Matrix to invert
+/// \return GL_FALSE if src is singular (result is left unchanged), GL_TRUE otherwise
+//
+GLboolean ESUTIL_API esMatrixInverse ( ESMatrix *result, const ESMatrix *src );
+
+//
+/// \brief Invert a matrix whose last column is (0, 0, 0, 1), such as a model view matrix
+///        built with esTranslate/esRotate/esScale/esMatrixLookAt.  Cheaper than esMatrixInverse.
+/// \param result Returns the inverse, may be the same as src
+/// \param src Affine matrix to invert
+/// \return GL_FALSE if src is singular (result is left unchanged), GL_TRUE otherwise
+//
+GLboolean ESUTIL_API esMatrixInverseAffine ( ESMatrix *result, const ESMatrix *src );
+
+//
+/// \brief Return the determinant of a matrix
+/// \param src Input matrix
+//
+GLfloat ESUTIL_API esMatrixDeterminant ( const ESMatrix *src );
+
+//
+/// \brief Compute the normal matrix (inverse-transpose of the upper 3x3) of a model view matrix
+///        so it can be computed once per object instead of per vertex.
+///        Upload with glUniformMatrix3fv ( loc, 1, GL_FALSE, &result[0][0] ).
+/// \param result Returns the 3x3 normal matrix
+/// \param src Model view matrix
+/// \return GL_FALSE if the upper 3x3 is singular (result is left unchanged), GL_TRUE otherwise
+//
+GLboolean ESUTIL_API esMatrixInverseTranspose3x3 ( GLfloat result[3][3], const ESMatrix *src );
+
+//
+/// \brief Extract the normalized frustum planes of a projection or model-view-projection matrix,
+///        e.g. one built with esPerspective/esOrtho.  The planes are in the space that mvp
+///        transforms from (world space for a view-projection matrix).
+/// \param frustum Returns the six planes
+/// \param mvp Matrix to extract the planes from
+//
+void ESUTIL_API esFrustumFromMatrix ( ESFrustum *frustum, const ESMatrix *mvp );
+
+//
+/// \brief Test an array of bounding spheres against a frustum.  Spheres are passed as
+///        structure-of-arrays; large counts are split across the threads set with esSetThreadCount.
+/// \param frustum Frustum to test against
+/// \param centerX, centerY, centerZ, radius Arrays of count sphere centers and radii
+/// \param count Number of spheres
+/// \param visibleMask If not NULL, receives (count + 31) / 32 words; bit (i % 32) of word (i / 32)
+///        is set when sphere i is at least partially inside.  If NULL a temporary mask is taken
+///        from esFrameAlloc.
+/// \param visibleIndices If not NULL, receives the indices of the visible spheres in increasing order
+///        (room for count entries is needed)
+/// \return The number of visible spheres
+//
+int ESUTIL_API esCullSpheres ( const ESFrustum *frustum,
+                               const GLfloat *centerX, const GLfloat *centerY, const GLfloat *centerZ,
+                               const GLfloat *radius, int count,
+                               GLuint *visibleMask, GLuint *visibleIndices );
+
+//
+/// \brief Test an array of axis-aligned boxes against a frustum.  See esCullSpheres.
+/// \param frustum Frustum to test against
+/// \param minX, minY, minZ, maxX, maxY, maxZ Arrays of count box extents
+/// \param count Number of boxes
+/// \param visibleMask If not NULL, receives (count + 31) / 32 visibility words
+/// \param visibleIndices If not NULL, receives the indices of the visible boxes in increasing order
+/// \return The number of visible boxes
+//
+int ESUTIL_API esCullAABBs ( const ESFrustum *frustum,
+                             const GLfloat *minX, const GLfloat *minY, const GLfloat *minZ,
+                             const GLfloat *maxX, const GLfloat *maxY, const GLfloat *maxZ, int count,
+                             GLuint *visibleMask, GLuint *visibleIndices );
+
+//
+/// \brief Cull meshlets outside a frustum or facing away from the eye, and merge the meshlets
+///        left that follow each other in the index buffer into draw ranges.  Works in the space
+///        of the mesh: build the frustum from its model-view-projection matrix and pass the eye
+///        in model space.  Uses meshlets->visibleMask, so one ESMeshlets is culled on one thread
+///        at a time.
+/// \param meshlets Meshlets from esBuildMeshlets
+/// \param frustum Frustum to test against
+/// \param eye Eye position
+/// \param ranges Receives the draw ranges, room for numMeshlets entries is needed
+/// \return The number of draw ranges
+//
+int ESUTIL_API esCullMeshlets ( ESMeshlets *meshlets, const ESFrustum *frustum, const GLfloat eye[3],
+                                ESDrawRange *ranges );
+
+//
+/// \brief Return an identity affine transform
+/// \param result Returns identity transform
+//
+void ESUTIL_API esAffineLoadIdentity ( ESAffine *result );
+
+//
+/// \brief Convert a matrix to an affine transform, dropping its last column
+/// \param result Returns the affine transform
+/// \param src Matrix to convert; assumed to have (0, 0, 0, 1) as its last column
+//
+void ESUTIL_API esAffineFromMatrix ( ESAffine *result, const ESMatrix *src );
+
+//
+/// \brief Expand an affine transform to a full matrix
+/// \param result Returns the matrix
+/// \param src Affine transform to expand
+//
+void ESUTIL_API esAffineToMatrix ( ESMatrix *result, const ESAffine *src );
+
+//
+/// \brief Perform the following operation - result = srcA * srcB (same order as esMatrixMultiply)
+///        Costs 36 multiplies instead of the 64 of esMatrixMultiply.
+/// \param result Returns the composed transform, may be the same as srcA or srcB
+/// \param srcA, srcB Input transforms
+//
+void ESUTIL_API esAffineMultiply ( ESAffine *result, const ESAffine *srcA, const ESAffine *srcB );
+
+//
+/// \brief Perform the following operation - result = srcA * srcB with a full matrix srcB,
+///        typically a projection.  Costs 48 multiplies instead of 64.
+/// \param result Returns the matrix, may be the same as srcB
+/// \param srcA Affine transform (e.g. a model view transform)
+/// \param srcB Full matrix (e.g. a projection matrix)
+//
+void ESUTIL_API esAffineMultiplyMatrix ( ESMatrix *result, const ESAffine *srcA, const ESMatrix *srcB );
+
+//
+/// \brief Affine version of esTranslate
+/// \param result Specifies the input transform.  Translated transform is returned in result.
+/// \param tx, ty, tz Translation along the x, y and z axes respectively
+//
+void ESUTIL_API esAffineTranslate ( ESAffine *result, GLfloat tx, GLfloat ty, GLfloat tz );
+
+//
+/// \brief Affine version of esScale
+/// \param result Specifies the input transform.  Scaled transform is returned in result.
+/// \param sx, sy, sz Scale factors along the x, y and z axes respectively
+//
+void ESUTIL_API esAffineScale ( ESAffine *result, GLfloat sx, GLfloat sy, GLfloat sz );
+
+//
+/// \brief Affine version of esRotate
+/// \param result Specifies the input transform.  Rotated transform is returned in result.
+/// \param angle Specifies the angle of rotation, in degrees.
+/// \param x, y, z Specify the x, y and z coordinates of a vector, respectively
+//
+void ESUTIL_API esAffineRotate ( ESAffine *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
+
+//
+/// \brief Invert an affine transform
+/// \param result Returns the inverse, may be the same as src
+/// \param src Transform to invert
+/// \return GL_FALSE if src is singular (result is left unchanged), GL_TRUE otherwise
+//
+GLboolean ESUTIL_API esAffineInvert ( ESAffine *result, const ESAffine *src );
+
+//
+/// \brief Apply an affine transform to a point (translation included)
+/// \param src Transform to apply
+/// \param in Input point
+/// \param out Returns the transformed point, may be the same as in
+//
+void ESUTIL_API esAffineTransformPoint ( const ESAffine *src, const GLfloat in[3], GLfloat out[3] );
+
+//
+/// \brief Apply an affine transform to a direction (translation ignored)
+/// \param src Transform to apply
+/// \param in Input vector
+/// \param out Returns the transformed vector, may be the same as in
+//
+void ESUTIL_API esAffineTransformVector ( const ESAffine *src, const GLfloat in[3], GLfloat out[3] );
+
+//
+/// \brief Return an identity quaternion
+/// \param result Returns the identity rotation
+//
+void ESUTIL_API esQuatLoadIdentity ( ESQuat *result );
+
+//
+/// \brief Build a quaternion from an axis and angle.  Converted with esQuatToMatrix it gives
+///        the same rotation as esRotate applied to an identity matrix.
+/// \param result Returns the rotation
+/// \param angle Specifies the angle of rotation, in degrees.
+/// \param x, y, z Specify the x, y and z coordinates of the axis, need not be normalized
+//
+void ESUTIL_API esQuatFromAxisAngle ( ESQuat *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z );
+
+//
+/// \brief Multiply two rotations, in the same order as esMatrixMultiply: the matrix of
+///        result is the matrix of srcA multiplied by the matrix of srcB.
+/// \param result Returns the product, may be the same as srcA or srcB
+/// \param srcA, srcB Input rotations
+//
+void ESUTIL_API esQuatMultiply ( ESQuat *result, const ESQuat *srcA, const ESQuat *srcB );
+
+//
+/// \brief Return the conjugate, which is the inverse of a unit quaternion
+/// \param result Returns the conjugate, may be the same as src
+/// \param src Input quaternion
+//
+void ESUTIL_API esQuatConjugate ( ESQuat *result, const ESQuat *src );
+
+//
+/// \brief Scale a quaternion to unit length.  Call every so often on accumulated rotations.
+/// \param result Returns the unit quaternion (identity if src is zero), may be the same as src
+/// \param src Input quaternion
+//
+void ESUTIL_API esQuatNormalize ( ESQuat *result, const ESQuat *src );
+
+//
+/// \brief Normalized linear interpolation along the shorter arc.  Cheaper than esQuatSlerp
+///        but not constant speed.
+/// \param result Returns the interpolated rotation, may be the same as srcA or srcB
+/// \param srcA, srcB Rotations at t = 0 and t = 1
+/// \param t Interpolation factor in [0, 1]
+//
+void ESUTIL_API esQuatNlerp ( ESQuat *result, const ESQuat *srcA, const ESQuat *srcB, GLfloat t );
+
+//
+/// \brief Spherical linear interpolation along the shorter arc
+/// \param result Returns the interpolated rotation, may be the same as srcA or srcB
+/// \param srcA, srcB Unit rotations at t = 0 and t = 1
+/// \param t Interpolation factor in [0, 1]
+//
+void ESUTIL_API esQuatSlerp ( ESQuat *result, const ESQuat *srcA, const ESQuat *srcB, GLfloat t );
+
+//
+/// \brief Convert a unit quaternion to a rotation matrix
+/// \param result Returns the matrix
+/// \param src Input rotation
+//
+void ESUTIL_API esQuatToMatrix ( ESMatrix *result, const ESQuat *src );
+
+//
+/// \brief Convert a unit quaternion to an affine transform with no translation
+/// \param result Returns the transform
+/// \param src Input rotation
+//
+void ESUTIL_API esQuatToAffine ( ESAffine *result, const ESQuat *src );
+
+//
+/// \brief Rotate a direction, giving the same result as esAffineTransformVector on esQuatToAffine ( src )
+/// \param src Unit rotation
+/// \param in Input vector
+/// \param out Returns the rotated vector, may be the same as in
+//
+void ESUTIL_API esQuatTransformVector ( const ESQuat *src, const GLfloat in[3], GLfloat out[3] );
+
+//
+/// \brief Quantize a unit quaternion to snorm16
+/// \param result Returns the packed rotation
+/// \param src Input rotation
+//
+void ESUTIL_API esQuatPack ( ESQuatPacked *result, const ESQuat *src );
+
+//
+/// \brief Decode a packed quaternion and renormalize it
+/// \param result Returns the rotation
+/// \param src Packed rotation
+//
+void ESUTIL_API esQuatUnpack ( ESQuat *result, const ESQuatPacked *src );
+
+//
+/// \brief Build a dual quaternion that rotates then translates, the same transform as
+///        esQuatToMatrix ( rotation ) with (tx, ty, tz) stored in its last row.
+/// \param result Returns the transform
+/// \param rotation Unit rotation
+/// \param tx, ty, tz Translation
+//
+void ESUTIL_API esDualQuatFromRotationTranslation ( ESDualQuat *result, const ESQuat *rotation, GLfloat tx, GLfloat ty, GLfloat tz );
+
+//
+/// \brief Multiply two rigid transforms, in the same order as esMatrixMultiply
+/// \param result Returns the product, may be the same as srcA or srcB
+/// \param srcA, srcB Input transforms
+//
+void ESUTIL_API esDualQuatMultiply ( ESDualQuat *result, const ESDualQuat *srcA, const ESDualQuat *srcB );
+
+//
+/// \brief Convert a unit dual quaternion to an affine transform
+/// \param result Returns the transform
+/// \param src Input transform
+//
+void ESUTIL_API esDualQuatToAffine ( ESAffine *result, const ESDualQuat *src );
+
+//
+/// \brief Convert a unit dual quaternion to a matrix
+/// \param result Returns the matrix
+/// \param src Input transform
+//
+void ESUTIL_API esDualQuatToMatrix ( ESMatrix *result, const ESDualQuat *src );
+
+//
+/// \brief Initialize an empty transform hierarchy
+/// \param hierarchy Hierarchy to initialize
+/// \param capacity Number of nodes to allocate room for, grows as needed
+/// \return GL_FALSE if the allocation failed
+//
+GLboolean ESUTIL_API esHierarchyInit ( ESHierarchy *hierarchy, int capacity );
+
+//
+/// \brief Free the memory held by a transform hierarchy
+/// \param hierarchy Hierarchy to free
+//
+void ESUTIL_API esHierarchyFree ( ESHierarchy *hierarchy );
+
+//
+/// \brief Add a node to a transform hierarchy
+/// \param hierarchy Hierarchy to add to
+/// \param parent Index of an existing node, or -1 for a root
+/// \param local Transform relative to the parent, NULL for identity
+/// \return Index of the new node, or -1 if parent is invalid or the allocation failed
+//
+int ESUTIL_API esHierarchyAddNode ( ESHierarchy *hierarchy, int parent, const ESMatrix *local );
+
+//
+/// \brief Replace the local transform of a node.  Its world matrix and those of its
+///        descendants are recomputed by the next esHierarchyUpdate.
+/// \param hierarchy Hierarchy holding the node
+/// \param node Index of the node
+/// \param local New transform relative to the parent
+//
+void ESUTIL_API esHierarchySetLocal ( ESHierarchy *hierarchy, int node, const ESMatrix *local );
+
+//
+/// \brief Recompute the world matrices of changed nodes and their descendants.  Returns
+///        immediately when nothing changed since the last call.
+/// \param hierarchy Hierarchy to update
+/// \return The number of world matrices recomputed
+//
+int ESUTIL_API esHierarchyUpdate ( ESHierarchy *hierarchy );
+
+//
+/// \brief Initialize a camera at the origin looking down -z, with a 60 degree perspective
+///        projection, aspect ratio 1 and depth range [1, 100]
+/// \param camera Camera to initialize
+//
+void ESUTIL_API esCameraInit ( ESCamera *camera );
+
+//
+/// \brief Place a camera, as esMatrixLookAt.  Does nothing if the values are unchanged.
+/// \param camera Camera to update
+/// \param posX, posY, posZ           eye position
+/// \param lookAtX, lookAtY, lookAtZ  look at vector
+/// \param upX, upY, upZ              up vector
+//
+void ESUTIL_API esCameraLookAt ( ESCamera *camera,
+                                 GLfloat posX,    GLfloat posY,    GLfloat posZ,
+                                 GLfloat lookAtX, GLfloat lookAtY, GLfloat lookAtZ,
+                                 GLfloat upX,     GLfloat upY,     GLfloat upZ );
+
+//
+/// \brief Use an explicit view matrix instead of eye/target/up.  Does nothing if it is unchanged.
+/// \param camera Camera to update
+/// \param view New view matrix
+//
+void ESUTIL_API esCameraSetView ( ESCamera *camera, const ESMatrix *view );
+
+//
+/// \brief Use a perspective projection, as esPerspective.  Does nothing if the values are
+///        unchanged, so it can be called every frame with the current aspect ratio.
+/// \param camera Camera to update
+/// \param fovy Field of view y angle in degrees
+/// \param aspect Aspect ratio of screen
+/// \param nearZ Near plane distance
+/// \param farZ Far plane distance
+//
+void ESUTIL_API esCameraPerspective ( ESCamera *camera, GLfloat fovy, GLfloat aspect, GLfloat nearZ, GLfloat farZ );
+
+//
+/// \brief Use an orthographic projection, as esOrtho.  Does nothing if the values are unchanged.
+/// \param camera Camera to update
+/// \param left, right Coordinates for the left and right vertical clipping planes
+/// \param bottom, top Coordinates for the bottom and top horizontal clipping planes
+/// \param nearZ, farZ Distances to the near and far depth clipping planes
+//
+void ESUTIL_API esCameraOrtho ( ESCamera *camera, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat nearZ, GLfloat farZ );
+
+//
+/// \brief Return the view matrix
+/// \param camera Camera to query
+//
+const ESMatrix *ESUTIL_API esCameraGetView ( ESCamera *camera );
+
+//
+/// \brief Return the projection matrix
+/// \param camera Camera to query
+//
+const ESMatrix *ESUTIL_API esCameraGetProjection ( ESCamera *camera );
+
+//
+/// \brief Return view * projection; model * viewProjection is the MVP of an object
+/// \param camera Camera to query
+//
+const ESMatrix *ESUTIL_API esCameraGetViewProjection ( ESCamera *camera );
+
+//
+/// \brief Return the inverse of the view-projection matrix, e.g. to unproject screen points
+/// \param camera Camera to query
+//
+const ESMatrix *ESUTIL_API esCameraGetInverseViewProjection ( ESCamera *camera );
+
+//
+/// \brief Return the world-space frustum planes, for esCullSpheres/esCullAABBs
+/// \param camera Camera to query
+//
+const ESFrustum *ESUTIL_API esCameraGetFrustum ( ESCamera *camera );
+
+//
+/// \brief Allocate the arrays of an ESInstanceData in a single block.  Instances start at
+///        the origin with no rotation and a scale of 1.
+/// \param data Structure to initialize
+/// \param count Number of instances
+/// \return GL_FALSE if count is not positive or the allocation failed
+//
+GLboolean ESUTIL_API esInstanceDataInit ( ESInstanceData *data, int count );
+
+//
+/// \brief Free the arrays allocated by esInstanceDataInit
+/// \param data Structure to free
+//
+void ESUTIL_API esInstanceDataFree ( ESInstanceData *data );
+
+//
+/// \brief Compute the model-view-projection matrix of every instance in one pass:
+///        scale * rotation * translation * viewProjection.  Four instances are processed
+///        at a time with SIMD and large counts are split across the threads set with
+///        esSetThreadCount.  Each result is written once, front to back, so result may
+///        point into a buffer mapped with glMapBufferRange.
+/// \param result Returns data->count matrices
+/// \param data Instance transforms
+/// \param step If not NULL, each rotation is first advanced to normalize ( rotation * step )
+///        and written back to data
+/// \param viewProjection View and projection applied to every instance
+//
+void ESUTIL_API esInstanceComputeMVPs ( ESMatrix *result, ESInstanceData *data, const ESQuat *step,
+                                        const ESMatrix *viewProjection );
+
 #ifdef __cplusplus
 }
 #endif
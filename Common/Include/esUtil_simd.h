@@ -0,0 +1,193 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esUtil_simd.h
+//
+//   Internal helpers used by the Common math routines to select a SIMD
+//   implementation at build time.  Exactly one of ES_SIMD_SSE or ES_SIMD_NEON
+//   is defined when vector kernels are available (ES_SIMD_AVX may be defined
+//   in addition to ES_SIMD_SSE).  Define ES_NO_SIMD to force the scalar paths.
+//
+//   The esVec4 macros never contract a multiply and an add into a fused
+//   multiply-add, so a vector kernel that evaluates its terms in the same
+//   order as the scalar code produces the same bits.
+
+#ifndef ESUTIL_SIMD_H
+#define ESUTIL_SIMD_H
+
+///
+//  Includes
+//
+#if !defined ( ES_NO_SIMD )
+#if defined ( __SSE__ ) || defined ( _M_X64 ) || defined ( _M_AMD64 ) || ( defined ( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define ES_SIMD_SSE     1
+#include <xmmintrin.h>
+#if defined ( __AVX__ )
+#define ES_SIMD_AVX     1
+#include <immintrin.h>
+#endif
+#elif defined ( __ARM_NEON ) || defined ( __ARM_NEON__ )
+#define ES_SIMD_NEON    1
+#include <arm_neon.h>
+#include <math.h>
+#endif
+#endif
+
+#if defined ( ES_SIMD_SSE ) || defined ( ES_SIMD_NEON )
+#define ES_SIMD         1
+#endif
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+
+///
+//  Macros
+//
+#if defined ( ES_SIMD_SSE )
+
+typedef __m128 esVec4;
+
+#define esVec4Load( p )              _mm_loadu_ps ( p )
+#define esVec4LoadAligned( p )       _mm_load_ps ( p )
+#define esVec4Store( p, v )          _mm_storeu_ps ( p, v )
+#define esVec4StoreAligned( p, v )   _mm_store_ps ( p, v )
+#define esVec4Splat( f )             _mm_set1_ps ( f )
+/// Broadcast lane i (a constant 0-3) of v
+#define esVec4SplatLane( v, i )      _mm_shuffle_ps ( v, v, _MM_SHUFFLE ( i, i, i, i ) )
+#define esVec4Zero()                 _mm_setzero_ps ()
+#define esVec4Add( a, b )            _mm_add_ps ( a, b )
+#define esVec4Sub( a, b )            _mm_sub_ps ( a, b )
+#define esVec4Mul( a, b )            _mm_mul_ps ( a, b )
+/// Correctly rounded, like the scalar / and sqrtf
+#define esVec4Div( a, b )            _mm_div_ps ( a, b )
+#define esVec4Sqrt( a )              _mm_sqrt_ps ( a )
+#define esVec4Min( a, b )            _mm_min_ps ( a, b )
+#define esVec4Max( a, b )            _mm_max_ps ( a, b )
+/// a + b * c, evaluated as two separately rounded operations
+#define esVec4MulAdd( a, b, c )      _mm_add_ps ( a, _mm_mul_ps ( b, c ) )
+/// Lane-wise a >= b as an all-ones / all-zeros mask
+#define esVec4CmpGE( a, b )          _mm_cmpge_ps ( a, b )
+#define esVec4And( a, b )            _mm_and_ps ( a, b )
+/// Sign bits of the four lanes packed into bits 0-3 of an int
+#define esVec4MoveMask( v )          _mm_movemask_ps ( v )
+/// Transpose the 4x4 matrix whose rows are r0..r3, in place
+#define esVec4Transpose( r0, r1, r2, r3 )   _MM_TRANSPOSE4_PS ( r0, r1, r2, r3 )
+
+#elif defined ( ES_SIMD_NEON )
+
+typedef float32x4_t esVec4;
+
+#define esVec4Load( p )              vld1q_f32 ( p )
+#define esVec4LoadAligned( p )       vld1q_f32 ( p )
+#define esVec4Store( p, v )          vst1q_f32 ( p, v )
+#define esVec4StoreAligned( p, v )   vst1q_f32 ( p, v )
+#define esVec4Splat( f )             vdupq_n_f32 ( f )
+/// Broadcast lane i (a constant 0-3) of v
+#define esVec4SplatLane( v, i )      vdupq_n_f32 ( vgetq_lane_f32 ( v, i ) )
+#define esVec4Zero()                 vdupq_n_f32 ( 0.0f )
+#define esVec4Add( a, b )            vaddq_f32 ( a, b )
+#define esVec4Sub( a, b )            vsubq_f32 ( a, b )
+#define esVec4Mul( a, b )            vmulq_f32 ( a, b )
+#if defined ( __aarch64__ )
+#define esVec4Div( a, b )            vdivq_f32 ( a, b )
+#define esVec4Sqrt( a )              vsqrtq_f32 ( a )
+#else
+// 32-bit NEON only has estimates, go through the scalar unit to keep the results exact
+#define esVec4Div( a, b )            esVec4DivNEON ( a, b )
+#define esVec4Sqrt( a )              esVec4SqrtNEON ( a )
+#endif
+#define esVec4Min( a, b )            vminq_f32 ( a, b )
+#define esVec4Max( a, b )            vmaxq_f32 ( a, b )
+/// a + b * c, evaluated as two separately rounded operations (not vfmaq_f32)
+#define esVec4MulAdd( a, b, c )      vaddq_f32 ( a, vmulq_f32 ( b, c ) )
+/// Lane-wise a >= b as an all-ones / all-zeros mask
+#define esVec4CmpGE( a, b )          vreinterpretq_f32_u32 ( vcgeq_f32 ( a, b ) )
+#define esVec4And( a, b )            vreinterpretq_f32_u32 ( vandq_u32 ( vreinterpretq_u32_f32 ( a ), \
+                                                                     vreinterpretq_u32_f32 ( b ) ) )
+/// Sign bits of the four lanes packed into bits 0-3 of an int
+#define esVec4MoveMask( v )          esVec4MoveMaskNEON ( v )
+#define esVec4Transpose( r0, r1, r2, r3 )                                                   \
+   do                                                                                      \
+   {                                                                                       \
+      float32x4x2_t t01 = vtrnq_f32 ( r0, r1 );                                            \
+      float32x4x2_t t23 = vtrnq_f32 ( r2, r3 );                                            \
+      r0 = vcombine_f32 ( vget_low_f32 ( t01.val[0] ), vget_low_f32 ( t23.val[0] ) );      \
+      r1 = vcombine_f32 ( vget_low_f32 ( t01.val[1] ), vget_low_f32 ( t23.val[1] ) );      \
+      r2 = vcombine_f32 ( vget_high_f32 ( t01.val[0] ), vget_high_f32 ( t23.val[0] ) );    \
+      r3 = vcombine_f32 ( vget_high_f32 ( t01.val[1] ), vget_high_f32 ( t23.val[1] ) );    \
+   } while ( 0 )
+
+static __inline int esVec4MoveMaskNEON ( float32x4_t v )
+{
+   uint32x4_t bits = vshrq_n_u32 ( vreinterpretq_u32_f32 ( v ), 31 );
+
+   return ( int ) ( vgetq_lane_u32 ( bits, 0 ) | ( vgetq_lane_u32 ( bits, 1 ) << 1 ) |
+                    ( vgetq_lane_u32 ( bits, 2 ) << 2 ) | ( vgetq_lane_u32 ( bits, 3 ) << 3 ) );
+}
+
+
+#if !defined ( __aarch64__ )
+static __inline float32x4_t esVec4DivNEON ( float32x4_t a, float32x4_t b )
+{
+   float fa[4], fb[4];
+
+   vst1q_f32 ( fa, a );
+   vst1q_f32 ( fb, b );
+   fa[0] /= fb[0];
+   fa[1] /= fb[1];
+   fa[2] /= fb[2];
+   fa[3] /= fb[3];
+   return vld1q_f32 ( fa );
+}
+
+static __inline float32x4_t esVec4SqrtNEON ( float32x4_t a )
+{
+   float fa[4];
+
+   vst1q_f32 ( fa, a );
+   fa[0] = sqrtf ( fa[0] );
+   fa[1] = sqrtf ( fa[1] );
+   fa[2] = sqrtf ( fa[2] );
+   fa[3] = sqrtf ( fa[3] );
+   return vld1q_f32 ( fa );
+}
+#endif
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESUTIL_SIMD_H
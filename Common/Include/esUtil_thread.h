@@ -0,0 +1,84 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// esUtil_thread.h
+//
+//   Internal interface for splitting a loop over worker threads.  The number of
+//   threads is controlled by esSetThreadCount() in esUtil.h.
+
+#ifndef ESUTIL_THREAD_H
+#define ESUTIL_THREAD_H
+
+///
+//  Includes
+//
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+
+///
+//  Macros
+//
+
+/// Upper bound on the number of threads esParallelFor will use
+#define ES_MAX_THREADS    64
+
+///
+// Types
+//
+
+/// Processes the items [begin, end) of a parallel loop
+typedef void ( *ESParallelFunc ) ( void *context, int begin, int end );
+
+///
+//  Public Functions
+//
+
+///
+//  esParallelFor()
+//
+//      Calls func over [0, count) split into contiguous ranges, one per thread.
+//      Ranges are never smaller than minPerThread items; if only one range results
+//      (or esSetThreadCount is 1) func is called once on the calling thread.
+//      Returns after every range has been processed.  A call made while another
+//      is running, from inside a range or from a second thread, runs on the
+//      calling thread.
+//
+void esParallelFor ( int count, int minPerThread, ESParallelFunc func, void *context );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESUTIL_THREAD_H
@@ -100,7 +100,7 @@ static void HandleCommand ( struct android_app *pApp, int32_t cmd )
 
          if ( esContext->userData != NULL )
          {
-            free ( esContext->userData );
+            esFree ( esContext->userData );
          }
 
          memset ( esContext, 0, sizeof ( ESContext ) );
@@ -190,6 +190,7 @@ void android_main ( struct android_app *pApp )
       {
          esContext.drawFunc ( &esContext );
          eglSwapBuffers ( esContext.eglDisplay, esContext.eglSurface );
+         esFrameReset ();
       }
    }
 }
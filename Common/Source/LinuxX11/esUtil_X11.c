@@ -177,6 +177,9 @@ void WinLoop ( ESContext *esContext )
             esContext->drawFunc(esContext);
 
         eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);        
+
+        // Everything from esFrameAlloc was for the frame just presented
+        esFrameReset();
     }
 }
 
@@ -207,7 +210,7 @@ int main ( int argc, char *argv[] )
 	   esContext.shutdownFunc ( &esContext );
 
    if ( esContext.userData != NULL )
-	   free ( esContext.userData );
+	   esFree ( esContext.userData );
 
    return 0;
 }
@@ -74,6 +74,7 @@ LRESULT WINAPI ESWindowProc ( HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam
          {
             esContext->drawFunc ( esContext );
             eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+            esFrameReset ();
          }
 
          if ( esContext )
@@ -258,7 +259,7 @@ int main ( int argc, char *argv[] )
 
    if ( esContext.userData != NULL )
    {
-      free ( esContext.userData );
+      esFree ( esContext.userData );
    }
 
    return 0;
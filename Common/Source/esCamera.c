@@ -0,0 +1,279 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESCamera.c
+//
+//    Camera holding view and projection parameters, with lazily computed
+//    view, projection, view-projection, inverse and frustum.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <string.h>
+
+///
+// Defines
+//
+
+/// Bits of ESCamera::valid
+#define CAMERA_VALID_VIEW             0x01
+#define CAMERA_VALID_PROJECTION       0x02
+#define CAMERA_VALID_VIEW_PROJECTION  0x04
+#define CAMERA_VALID_INVERSE          0x08
+#define CAMERA_VALID_FRUSTUM          0x10
+
+/// Everything derived from both the view and the projection
+#define CAMERA_VALID_DERIVED          ( CAMERA_VALID_VIEW_PROJECTION | CAMERA_VALID_INVERSE | CAMERA_VALID_FRUSTUM )
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Invalidate()
+//
+//    Drop the cached results in bits and bump the version
+//
+static void Invalidate ( ESCamera *camera, GLuint bits )
+{
+   camera->valid &= ~( bits | CAMERA_VALID_DERIVED );
+   camera->version++;
+}
+
+///
+// Differs()
+//
+static int Differs ( const GLfloat *a, const GLfloat *b, int count )
+{
+   int i;
+
+   for ( i = 0; i < count; i++ )
+   {
+      if ( a[i] != b[i] )
+      {
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+void ESUTIL_API
+esCameraInit ( ESCamera *camera )
+{
+   memset ( camera, 0, sizeof ( ESCamera ) );
+
+   camera->target[2] = -1.0f;
+   camera->up[1] = 1.0f;
+
+   camera->fovy = 60.0f;
+   camera->aspect = 1.0f;
+   camera->nearZ = 1.0f;
+   camera->farZ = 100.0f;
+
+   camera->version = 1;
+}
+
+void ESUTIL_API
+esCameraLookAt ( ESCamera *camera,
+                 GLfloat posX,    GLfloat posY,    GLfloat posZ,
+                 GLfloat lookAtX, GLfloat lookAtY, GLfloat lookAtZ,
+                 GLfloat upX,     GLfloat upY,     GLfloat upZ )
+{
+   GLfloat params[9];
+
+   params[0] = posX;
+   params[1] = posY;
+   params[2] = posZ;
+   params[3] = lookAtX;
+   params[4] = lookAtY;
+   params[5] = lookAtZ;
+   params[6] = upX;
+   params[7] = upY;
+   params[8] = upZ;
+
+   if ( !camera->explicitView &&
+         !Differs ( camera->eye, params, 3 ) && !Differs ( camera->target, params + 3, 3 ) && !Differs ( camera->up, params + 6, 3 ) )
+   {
+      return;
+   }
+
+   memcpy ( camera->eye, params, sizeof ( camera->eye ) );
+   memcpy ( camera->target, params + 3, sizeof ( camera->target ) );
+   memcpy ( camera->up, params + 6, sizeof ( camera->up ) );
+   camera->explicitView = GL_FALSE;
+
+   Invalidate ( camera, CAMERA_VALID_VIEW );
+}
+
+void ESUTIL_API
+esCameraSetView ( ESCamera *camera, const ESMatrix *view )
+{
+   if ( camera->explicitView && !Differs ( &camera->view.m[0][0], &view->m[0][0], 16 ) )
+   {
+      return;
+   }
+
+   Invalidate ( camera, CAMERA_VALID_VIEW );
+
+   camera->view = *view;
+   camera->explicitView = GL_TRUE;
+   camera->valid |= CAMERA_VALID_VIEW;
+}
+
+void ESUTIL_API
+esCameraPerspective ( ESCamera *camera, GLfloat fovy, GLfloat aspect, GLfloat nearZ, GLfloat farZ )
+{
+   if ( !camera->ortho && camera->fovy == fovy && camera->aspect == aspect &&
+         camera->nearZ == nearZ && camera->farZ == farZ )
+   {
+      return;
+   }
+
+   camera->ortho = GL_FALSE;
+   camera->fovy = fovy;
+   camera->aspect = aspect;
+   camera->nearZ = nearZ;
+   camera->farZ = farZ;
+
+   Invalidate ( camera, CAMERA_VALID_PROJECTION );
+}
+
+void ESUTIL_API
+esCameraOrtho ( ESCamera *camera, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat nearZ, GLfloat farZ )
+{
+   if ( camera->ortho && camera->left == left && camera->right == right &&
+         camera->bottom == bottom && camera->top == top &&
+         camera->nearZ == nearZ && camera->farZ == farZ )
+   {
+      return;
+   }
+
+   camera->ortho = GL_TRUE;
+   camera->left = left;
+   camera->right = right;
+   camera->bottom = bottom;
+   camera->top = top;
+   camera->nearZ = nearZ;
+   camera->farZ = farZ;
+
+   Invalidate ( camera, CAMERA_VALID_PROJECTION );
+}
+
+const ESMatrix *ESUTIL_API
+esCameraGetView ( ESCamera *camera )
+{
+   if ( ! ( camera->valid & CAMERA_VALID_VIEW ) )
+   {
+      esMatrixLookAt ( &camera->view,
+                       camera->eye[0], camera->eye[1], camera->eye[2],
+                       camera->target[0], camera->target[1], camera->target[2],
+                       camera->up[0], camera->up[1], camera->up[2] );
+      camera->valid |= CAMERA_VALID_VIEW;
+   }
+
+   return &camera->view;
+}
+
+const ESMatrix *ESUTIL_API
+esCameraGetProjection ( ESCamera *camera )
+{
+   if ( ! ( camera->valid & CAMERA_VALID_PROJECTION ) )
+   {
+      esMatrixLoadIdentity ( &camera->projection );
+
+      if ( camera->ortho )
+      {
+         esOrtho ( &camera->projection, camera->left, camera->right, camera->bottom, camera->top,
+                   camera->nearZ, camera->farZ );
+      }
+      else
+      {
+         esPerspective ( &camera->projection, camera->fovy, camera->aspect, camera->nearZ, camera->farZ );
+      }
+
+      camera->valid |= CAMERA_VALID_PROJECTION;
+   }
+
+   return &camera->projection;
+}
+
+const ESMatrix *ESUTIL_API
+esCameraGetViewProjection ( ESCamera *camera )
+{
+   if ( ! ( camera->valid & CAMERA_VALID_VIEW_PROJECTION ) )
+   {
+      esCameraGetView ( camera );
+      esCameraGetProjection ( camera );
+      esMatrixMultiply ( &camera->viewProjection, &camera->view, &camera->projection );
+      camera->valid |= CAMERA_VALID_VIEW_PROJECTION;
+   }
+
+   return &camera->viewProjection;
+}
+
+const ESMatrix *ESUTIL_API
+esCameraGetInverseViewProjection ( ESCamera *camera )
+{
+   if ( ! ( camera->valid & CAMERA_VALID_INVERSE ) )
+   {
+      if ( !esMatrixInverse ( &camera->inverseViewProjection, esCameraGetViewProjection ( camera ) ) )
+      {
+         esMatrixLoadIdentity ( &camera->inverseViewProjection );
+      }
+
+      camera->valid |= CAMERA_VALID_INVERSE;
+   }
+
+   return &camera->inverseViewProjection;
+}
+
+const ESFrustum *ESUTIL_API
+esCameraGetFrustum ( ESCamera *camera )
+{
+   if ( ! ( camera->valid & CAMERA_VALID_FRUSTUM ) )
+   {
+      esFrustumFromMatrix ( &camera->frustum, esCameraGetViewProjection ( camera ) );
+      camera->valid |= CAMERA_VALID_FRUSTUM;
+   }
+
+   return &camera->frustum;
+}
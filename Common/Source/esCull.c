@@ -0,0 +1,488 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESCull.c
+//
+//    Frustum plane extraction and batched visibility tests for bounding
+//    spheres and axis-aligned boxes stored as structure-of-arrays, and for
+//    meshlets, whose spheres also carry a backface normal cone.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_simd.h"
+#include "esUtil_thread.h"
+#include <math.h>
+#include <string.h>
+
+///
+// Defines
+//
+
+/// Smallest number of 32-object mask words handed to a worker thread
+#define CULL_MIN_WORDS_PER_THREAD   1024
+
+///
+//  Types
+//
+typedef struct
+{
+   const ESFrustum *frustum;
+
+   // Spheres: x, y, z, radius.  Boxes: min x/y/z, max x/y/z.
+   const GLfloat   *bounds[6];
+   int              isBox;
+
+   // Normal cone axis x, y, z and cutoff of each sphere, NULL if not tested
+   const GLfloat   *cones[4];
+   GLfloat          eye[3];
+   int              count;
+   GLuint          *mask;
+} CullJob;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// SphereVisible()
+//
+static int SphereVisible ( const ESFrustum *frustum, GLfloat x, GLfloat y, GLfloat z, GLfloat r )
+{
+   int p;
+
+   for ( p = 0; p < 6; p++ )
+   {
+      const GLfloat *plane = frustum->planes[p];
+
+      if ( plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < -r )
+      {
+         return 0;
+      }
+   }
+
+   return 1;
+}
+
+///
+// ConeVisible()
+//
+//    A meshlet is backfacing when every direction from the eye into its
+//    sphere is less than 90 degrees from every normal in its cone.  Taking
+//    the worst point of the sphere for both the distance and the angle:
+//    dot ( center - eye, axis ) >= cutoff * ( | center - eye | + radius ) + radius
+//
+static int ConeVisible ( const CullJob *job, int i )
+{
+   GLfloat dx = job->bounds[0][i] - job->eye[0];
+   GLfloat dy = job->bounds[1][i] - job->eye[1];
+   GLfloat dz = job->bounds[2][i] - job->eye[2];
+   GLfloat length = sqrtf ( dx * dx + dy * dy + dz * dz );
+   GLfloat d = dx * job->cones[0][i] + dy * job->cones[1][i] + dz * job->cones[2][i];
+
+   return job->cones[3][i] * ( length + job->bounds[3][i] ) + job->bounds[3][i] >= d;
+}
+
+///
+// BoxVisible()
+//
+//    Tests the corner furthest along each plane normal (the "positive vertex")
+//
+static int BoxVisible ( const ESFrustum *frustum, const GLfloat *const *bounds, int i )
+{
+   int p;
+
+   for ( p = 0; p < 6; p++ )
+   {
+      const GLfloat *plane = frustum->planes[p];
+      GLfloat x = plane[0] >= 0.0f ? bounds[3][i] : bounds[0][i];
+      GLfloat y = plane[1] >= 0.0f ? bounds[4][i] : bounds[1][i];
+      GLfloat z = plane[2] >= 0.0f ? bounds[5][i] : bounds[2][i];
+
+      if ( plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f )
+      {
+         return 0;
+      }
+   }
+
+   return 1;
+}
+
+///
+// CullWord()
+//
+//    Visibility bits for objects [first, first + num), num <= 32.  planes
+//    holds the splatted plane coefficients when SIMD is available.
+//
+static GLuint CullWord ( const CullJob *job, const void *planes, int first, int num )
+{
+   const ESFrustum *frustum = job->frustum;
+   const GLfloat   *const *bounds = job->bounds;
+   GLuint bits = 0;
+   int    i = 0;
+
+#if defined ( ES_SIMD )
+   const esVec4 ( *pv ) [4] = ( const esVec4 ( * ) [4] ) planes;
+   esVec4 zero = esVec4Zero ();
+   int    p;
+
+   if ( job->isBox )
+   {
+      // Positive-vertex arrays per plane, chosen once for the whole word
+      const GLfloat *px[6], *py[6], *pz[6];
+
+      for ( p = 0; p < 6; p++ )
+      {
+         px[p] = bounds[frustum->planes[p][0] >= 0.0f ? 3 : 0] + first;
+         py[p] = bounds[frustum->planes[p][1] >= 0.0f ? 4 : 1] + first;
+         pz[p] = bounds[frustum->planes[p][2] >= 0.0f ? 5 : 2] + first;
+      }
+
+      for ( ; i + 4 <= num; i += 4 )
+      {
+         esVec4 visible = esVec4CmpGE ( zero, zero );
+
+         for ( p = 0; p < 6; p++ )
+         {
+            esVec4 d = esVec4MulAdd ( pv[p][3], pv[p][0], esVec4Load ( px[p] + i ) );
+            d = esVec4MulAdd ( d, pv[p][1], esVec4Load ( py[p] + i ) );
+            d = esVec4MulAdd ( d, pv[p][2], esVec4Load ( pz[p] + i ) );
+            visible = esVec4And ( visible, esVec4CmpGE ( d, zero ) );
+         }
+
+         bits |= ( GLuint ) esVec4MoveMask ( visible ) << i;
+      }
+   }
+   else
+   {
+      for ( ; i + 4 <= num; i += 4 )
+      {
+         esVec4 x = esVec4Load ( bounds[0] + first + i );
+         esVec4 y = esVec4Load ( bounds[1] + first + i );
+         esVec4 z = esVec4Load ( bounds[2] + first + i );
+         esVec4 negR = esVec4Sub ( zero, esVec4Load ( bounds[3] + first + i ) );
+         esVec4 visible = esVec4CmpGE ( zero, zero );
+
+         for ( p = 0; p < 6; p++ )
+         {
+            esVec4 d = esVec4MulAdd ( pv[p][3], pv[p][0], x );
+            d = esVec4MulAdd ( d, pv[p][1], y );
+            d = esVec4MulAdd ( d, pv[p][2], z );
+            visible = esVec4And ( visible, esVec4CmpGE ( d, negR ) );
+         }
+
+         if ( job->cones[0] != NULL )
+         {
+            // Same test as ConeVisible()
+            esVec4 dx = esVec4Sub ( x, esVec4Splat ( job->eye[0] ) );
+            esVec4 dy = esVec4Sub ( y, esVec4Splat ( job->eye[1] ) );
+            esVec4 dz = esVec4Sub ( z, esVec4Splat ( job->eye[2] ) );
+            esVec4 length = esVec4Sqrt ( esVec4MulAdd ( esVec4MulAdd ( esVec4Mul ( dx, dx ), dy, dy ), dz, dz ) );
+            esVec4 d = esVec4MulAdd ( esVec4MulAdd ( esVec4Mul ( dx, esVec4Load ( job->cones[0] + first + i ) ),
+                                                     dy, esVec4Load ( job->cones[1] + first + i ) ),
+                                      dz, esVec4Load ( job->cones[2] + first + i ) );
+            esVec4 r = esVec4Load ( bounds[3] + first + i );
+            esVec4 limit = esVec4MulAdd ( r, esVec4Load ( job->cones[3] + first + i ), esVec4Add ( length, r ) );
+
+            visible = esVec4And ( visible, esVec4CmpGE ( limit, d ) );
+         }
+
+         bits |= ( GLuint ) esVec4MoveMask ( visible ) << i;
+      }
+   }
+#else
+   ( void ) planes;
+#endif
+
+   for ( ; i < num; i++ )
+   {
+      int idx = first + i;
+      int visible;
+
+      if ( job->isBox )
+      {
+         visible = BoxVisible ( frustum, bounds, idx );
+      }
+      else
+      {
+         visible = SphereVisible ( frustum, bounds[0][idx], bounds[1][idx], bounds[2][idx], bounds[3][idx] ) &&
+                   ( job->cones[0] == NULL || ConeVisible ( job, idx ) );
+      }
+
+      if ( visible )
+      {
+         bits |= 1u << i;
+      }
+   }
+
+   return bits;
+}
+
+///
+// CullRange()
+//
+//    esParallelFor callback, processes mask words [begin, end)
+//
+static void CullRange ( void *context, int begin, int end )
+{
+   CullJob *job = ( CullJob * ) context;
+   int      w;
+#if defined ( ES_SIMD )
+   esVec4   planes[6][4];
+   int      p, i;
+
+   for ( p = 0; p < 6; p++ )
+   {
+      for ( i = 0; i < 4; i++ )
+      {
+         planes[p][i] = esVec4Splat ( job->frustum->planes[p][i] );
+      }
+   }
+#else
+   void    *planes = NULL;
+#endif
+
+   for ( w = begin; w < end; w++ )
+   {
+      int first = w * 32;
+      int num = job->count - first < 32 ? job->count - first : 32;
+
+      job->mask[w] = CullWord ( job, planes, first, num );
+   }
+}
+
+///
+// RunCull()
+//
+//    Builds the visibility mask (in visibleMask, or a temporary one) and
+//    optionally the compacted index list
+//
+static int RunCull ( CullJob *job, GLuint *visibleMask, GLuint *visibleIndices )
+{
+   int numWords = ( job->count + 31 ) / 32;
+   int numVisible = 0;
+   int w;
+
+   if ( job->count <= 0 )
+   {
+      return 0;
+   }
+
+   // A temporary mask only lives for this call, so it comes from the frame arena
+   job->mask = visibleMask != NULL ? visibleMask : esFrameAlloc ( sizeof ( GLuint ) * numWords );
+
+   if ( job->mask == NULL )
+   {
+      return 0;
+   }
+
+   esParallelFor ( numWords, CULL_MIN_WORDS_PER_THREAD, CullRange, job );
+
+   for ( w = 0; w < numWords; w++ )
+   {
+      GLuint bits = job->mask[w];
+
+      GLuint bit;
+
+      for ( bit = 0; bits != 0; bit++, bits >>= 1 )
+      {
+         if ( bits & 1u )
+         {
+            if ( visibleIndices != NULL )
+            {
+               visibleIndices[numVisible] = ( GLuint ) w * 32 + bit;
+            }
+
+            numVisible++;
+         }
+      }
+   }
+
+   return numVisible;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esFrustumFromMatrix()
+//
+//      Gribb/Hartmann plane extraction.  With the row-vector convention used by
+//      ESMatrix, clip = p * mvp, so the clip-space rows are the matrix columns.
+//
+void ESUTIL_API esFrustumFromMatrix ( ESFrustum *frustum, const ESMatrix *mvp )
+{
+   int p;
+
+   for ( p = 0; p < 6; p++ )
+   {
+      int     axis = p / 2;
+      GLfloat sign = ( p & 1 ) ? -1.0f : 1.0f;
+      GLfloat *plane = frustum->planes[p];
+      GLfloat length;
+      int     i;
+
+      // left/right = w +/- x, bottom/top = w +/- y, near/far = w +/- z
+      for ( i = 0; i < 4; i++ )
+      {
+         plane[i] = mvp->m[i][3] + sign * mvp->m[i][axis];
+      }
+
+      length = sqrtf ( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+
+      if ( length > 0.0f )
+      {
+         plane[0] /= length;
+         plane[1] /= length;
+         plane[2] /= length;
+         plane[3] /= length;
+      }
+   }
+}
+
+///
+//  esCullSpheres()
+//
+int ESUTIL_API esCullSpheres ( const ESFrustum *frustum,
+                               const GLfloat *centerX, const GLfloat *centerY, const GLfloat *centerZ,
+                               const GLfloat *radius, int count,
+                               GLuint *visibleMask, GLuint *visibleIndices )
+{
+   CullJob job;
+
+   memset ( &job, 0, sizeof ( job ) );
+   job.frustum = frustum;
+   job.bounds[0] = centerX;
+   job.bounds[1] = centerY;
+   job.bounds[2] = centerZ;
+   job.bounds[3] = radius;
+   job.isBox = 0;
+   job.count = count;
+
+   return RunCull ( &job, visibleMask, visibleIndices );
+}
+
+///
+//  esCullAABBs()
+//
+int ESUTIL_API esCullAABBs ( const ESFrustum *frustum,
+                             const GLfloat *minX, const GLfloat *minY, const GLfloat *minZ,
+                             const GLfloat *maxX, const GLfloat *maxY, const GLfloat *maxZ, int count,
+                             GLuint *visibleMask, GLuint *visibleIndices )
+{
+   CullJob job;
+
+   memset ( &job, 0, sizeof ( job ) );
+   job.frustum = frustum;
+   job.bounds[0] = minX;
+   job.bounds[1] = minY;
+   job.bounds[2] = minZ;
+   job.bounds[3] = maxX;
+   job.bounds[4] = maxY;
+   job.bounds[5] = maxZ;
+   job.isBox = 1;
+   job.count = count;
+
+   return RunCull ( &job, visibleMask, visibleIndices );
+}
+
+///
+//  esCullMeshlets()
+//
+int ESUTIL_API esCullMeshlets ( ESMeshlets *meshlets, const ESFrustum *frustum, const GLfloat eye[3],
+                                ESDrawRange *ranges )
+{
+   CullJob job;
+   int     numRanges = 0;
+   int     last = -2;
+   int     w;
+
+   memset ( &job, 0, sizeof ( job ) );
+   job.frustum = frustum;
+   job.bounds[0] = meshlets->centerX;
+   job.bounds[1] = meshlets->centerY;
+   job.bounds[2] = meshlets->centerZ;
+   job.bounds[3] = meshlets->radius;
+   job.cones[0] = meshlets->coneX;
+   job.cones[1] = meshlets->coneY;
+   job.cones[2] = meshlets->coneZ;
+   job.cones[3] = meshlets->coneCutoff;
+   job.eye[0] = eye[0];
+   job.eye[1] = eye[1];
+   job.eye[2] = eye[2];
+   job.count = meshlets->numMeshlets;
+
+   RunCull ( &job, meshlets->visibleMask, NULL );
+
+   for ( w = 0; w < ( meshlets->numMeshlets + 31 ) / 32; w++ )
+   {
+      GLuint bits = meshlets->visibleMask[w];
+      int    i;
+
+      for ( i = w * 32; bits != 0; i++, bits >>= 1 )
+      {
+         if ( ( bits & 1u ) == 0 )
+         {
+            continue;
+         }
+
+         // Meshlets are contiguous in the index buffer, so neighbours merge
+         if ( i == last + 1 )
+         {
+            ESDrawRange *range = &ranges[numRanges - 1];
+
+            range->count += meshlets->count[i];
+            range->start = meshlets->minVertex[i] < range->start ? meshlets->minVertex[i] : range->start;
+            range->end = meshlets->maxVertex[i] > range->end ? meshlets->maxVertex[i] : range->end;
+         }
+         else
+         {
+            ESDrawRange *range = &ranges[numRanges++];
+
+            range->firstIndex = meshlets->firstIndex[i];
+            range->count = meshlets->count[i];
+            range->start = meshlets->minVertex[i];
+            range->end = meshlets->maxVertex[i];
+         }
+
+         last = i;
+      }
+   }
+
+   return numRanges;
+}
@@ -0,0 +1,394 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESGeometry.c
+//
+//    Process-wide cache of the generated shapes, uploaded once to buffer
+//    objects and shared by reference count.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+// Defines
+//
+
+/// Buckets allocated for the first entry; the table doubles when it holds more
+/// entries than buckets
+#define GEOMETRY_MIN_BUCKETS   16
+
+/// Attributes a shape can be generated with
+#define GEOMETRY_ATTRIBS   ( ES_MESH_POSITION_BIT | ES_MESH_NORMAL_BIT | ES_MESH_TEXCOORD_BIT )
+
+///
+//  Types
+//
+
+/// Cache key: the parameters a shape uses, every other field zero
+typedef struct
+{
+   ESGeometryDesc desc;
+} GeometryKey;
+
+typedef struct GeometryEntry
+{
+   /// First, so the pointer handed out is the entry
+   ESGeometry            geometry;
+   GeometryKey           key;
+   GLuint                hash;
+   int                   refCount;
+   struct GeometryEntry *next;
+} GeometryEntry;
+
+///
+//  Globals
+//
+static GeometryEntry **buckets = NULL;
+static int numBuckets = 0;
+static int numEntries = 0;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// MakeKey()
+//
+//    Copy the parameters the shape uses into a zeroed key, so requests that only
+//    differ in ignored fields compare equal byte for byte.
+//
+static GLboolean MakeKey ( GeometryKey *key, const ESGeometryDesc *desc )
+{
+   memset ( key, 0, sizeof ( GeometryKey ) );
+
+   key->desc.shape = desc->shape;
+   key->desc.attribs = desc->attribs & GEOMETRY_ATTRIBS;
+
+   switch ( desc->shape )
+   {
+      case ES_GEOMETRY_SPHERE:
+      case ES_GEOMETRY_GRID:
+         if ( desc->tessellation < ( desc->shape == ES_GEOMETRY_SPHERE ? 3 : 2 ) )
+         {
+            return GL_FALSE;
+         }
+
+         key->desc.tessellation = desc->tessellation;
+         // The grid has no poles to leave out
+         key->desc.flags = desc->shape == ES_GEOMETRY_GRID ? desc->flags & ~ES_SHAPE_NO_DEGENERATES : desc->flags;
+         break;
+
+      case ES_GEOMETRY_CUBE:
+         break;
+
+      case ES_GEOMETRY_TORUS:
+         key->desc.numRings = desc->numRings;
+
+      // Fall through
+      case ES_GEOMETRY_CYLINDER:
+      case ES_GEOMETRY_CONE:
+      case ES_GEOMETRY_CAPSULE:
+         key->desc.aspect = desc->aspect;
+
+      // Fall through
+      case ES_GEOMETRY_ICOSPHERE:
+         key->desc.tessellation = desc->tessellation;
+         key->desc.numLods = desc->numLods;
+         break;
+
+      default:
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// HashKey()
+//
+//    FNV-1a over the bytes of the key
+//
+static GLuint HashKey ( const GeometryKey *key )
+{
+   const GLubyte *bytes = ( const GLubyte * ) key;
+   GLuint hash = 2166136261u;
+   size_t i;
+
+   for ( i = 0; i < sizeof ( GeometryKey ); i++ )
+   {
+      hash = ( hash ^ bytes[i] ) * 16777619u;
+   }
+
+   return hash;
+}
+
+///
+// GenMesh()
+//
+//    Generate the shape of a key at unit size into an allocated mesh
+//
+static GLboolean GenMesh ( ESMesh *mesh, const GeometryKey *key )
+{
+   const ESGeometryDesc *desc = &key->desc;
+   ESMeshLayout layout;
+
+   esMeshLayoutInit ( &layout, desc->attribs );
+
+   switch ( desc->shape )
+   {
+      case ES_GEOMETRY_SPHERE:
+         return esGenSphereMesh ( mesh, &layout, desc->tessellation, 1.0f, desc->flags, NULL, NULL );
+
+      case ES_GEOMETRY_CUBE:
+         return esGenCubeMesh ( mesh, &layout, 1.0f, NULL, NULL );
+
+      case ES_GEOMETRY_GRID:
+         return esGenSquareGridMesh ( mesh, &layout, desc->tessellation, desc->flags, NULL, NULL );
+
+      case ES_GEOMETRY_CYLINDER:
+         return esGenCylinderMesh ( mesh, &layout, desc->tessellation, 1.0f, desc->aspect,
+                                    desc->numLods, NULL, NULL );
+
+      case ES_GEOMETRY_CONE:
+         return esGenConeMesh ( mesh, &layout, desc->tessellation, 1.0f, desc->aspect,
+                                desc->numLods, NULL, NULL );
+
+      case ES_GEOMETRY_TORUS:
+         return esGenTorusMesh ( mesh, &layout, desc->tessellation, desc->numRings, 1.0f, desc->aspect,
+                                 desc->numLods, NULL, NULL );
+
+      case ES_GEOMETRY_CAPSULE:
+         return esGenCapsuleMesh ( mesh, &layout, desc->tessellation, 1.0f, desc->aspect,
+                                   desc->numLods, NULL, NULL );
+
+      case ES_GEOMETRY_ICOSPHERE:
+         return esGenIcosphereMesh ( mesh, &layout, desc->tessellation, 1.0f, desc->numLods, NULL, NULL );
+   }
+
+   return GL_FALSE;
+}
+
+///
+// Upload()
+//
+//    Copy a mesh into new vertex and index buffers, with 16-bit indices when they
+//    fit.  The buffers are filled through GL_COPY_WRITE_BUFFER so the element
+//    array binding of a bound vertex array object is left alone.
+//
+static void Upload ( ESGeometry *geometry, ESMesh *mesh )
+{
+   GLuint buffers[2];
+
+   geometry->layout = mesh->layout;
+   geometry->mode = mesh->mode;
+   geometry->numVertices = mesh->numVertices;
+   geometry->numIndices = mesh->numIndices;
+   geometry->numLods = mesh->numLods;
+   memcpy ( geometry->lods, mesh->lods, sizeof ( ESMeshLod ) * mesh->numLods );
+
+   // 0xFFFF is kept free for the restart index
+   if ( mesh->numVertices <= 0xFFFF )
+   {
+      GLushort *indices16 = ( GLushort * ) mesh->indices;
+      int i;
+
+      // Narrow in place; each index is read before its slot can be overwritten.
+      // ES_PRIMITIVE_RESTART_INDEX truncates to 0xFFFF.
+      for ( i = 0; i < mesh->numIndices; i++ )
+      {
+         indices16[i] = ( GLushort ) mesh->indices[i];
+      }
+
+      geometry->indexType = GL_UNSIGNED_SHORT;
+      geometry->indexSize = sizeof ( GLushort );
+   }
+   else
+   {
+      geometry->indexType = GL_UNSIGNED_INT;
+      geometry->indexSize = sizeof ( GLuint );
+   }
+
+   glGenBuffers ( 2, buffers );
+   geometry->vertexBuffer = buffers[0];
+   geometry->indexBuffer = buffers[1];
+
+   glBindBuffer ( GL_COPY_WRITE_BUFFER, geometry->vertexBuffer );
+   glBufferData ( GL_COPY_WRITE_BUFFER, ( GLsizeiptr ) mesh->numVertices * mesh->layout.stride,
+                  mesh->vertices, GL_STATIC_DRAW );
+   glBindBuffer ( GL_COPY_WRITE_BUFFER, geometry->indexBuffer );
+   glBufferData ( GL_COPY_WRITE_BUFFER, ( GLsizeiptr ) mesh->numIndices * geometry->indexSize,
+                  mesh->indices, GL_STATIC_DRAW );
+   glBindBuffer ( GL_COPY_WRITE_BUFFER, 0 );
+}
+
+///
+// Rehash()
+//
+//    Move every entry into a table of the given number of buckets, a power of two.
+//    On failure the old table is kept.
+//
+static GLboolean Rehash ( int count )
+{
+   GeometryEntry **table = esCalloc ( count, sizeof ( GeometryEntry * ) );
+   int b;
+
+   if ( table == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   for ( b = 0; b < numBuckets; b++ )
+   {
+      GeometryEntry *entry = buckets[b];
+
+      while ( entry != NULL )
+      {
+         GeometryEntry *next = entry->next;
+         GLuint slot = entry->hash & ( count - 1 );
+
+         entry->next = table[slot];
+         table[slot] = entry;
+         entry = next;
+      }
+   }
+
+   esFree ( buckets );
+   buckets = table;
+   numBuckets = count;
+   return GL_TRUE;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+const ESGeometry * ESUTIL_API
+esAcquireGeometry ( const ESGeometryDesc *desc )
+{
+   GeometryKey key;
+   GeometryEntry *entry;
+   ESMesh mesh;
+   GLuint hash;
+
+   if ( !MakeKey ( &key, desc ) )
+   {
+      return NULL;
+   }
+
+   hash = HashKey ( &key );
+
+   if ( numBuckets > 0 )
+   {
+      for ( entry = buckets[hash & ( numBuckets - 1 )]; entry != NULL; entry = entry->next )
+      {
+         if ( entry->hash == hash && memcmp ( &entry->key, &key, sizeof ( GeometryKey ) ) == 0 )
+         {
+            entry->refCount++;
+            return &entry->geometry;
+         }
+      }
+   }
+
+   // First request: make room, then generate and upload
+   if ( numEntries >= numBuckets && !Rehash ( numBuckets > 0 ? numBuckets * 2 : GEOMETRY_MIN_BUCKETS ) )
+   {
+      // A full table still works, only with longer chains
+      if ( numBuckets == 0 )
+      {
+         return NULL;
+      }
+   }
+
+   if ( ( entry = esMalloc ( sizeof ( GeometryEntry ) ) ) == NULL )
+   {
+      return NULL;
+   }
+
+   if ( !GenMesh ( &mesh, &key ) )
+   {
+      esFree ( entry );
+      return NULL;
+   }
+
+   Upload ( &entry->geometry, &mesh );
+   esMeshFree ( &mesh );
+
+   entry->key = key;
+   entry->hash = hash;
+   entry->refCount = 1;
+   entry->next = buckets[hash & ( numBuckets - 1 )];
+   buckets[hash & ( numBuckets - 1 )] = entry;
+   numEntries++;
+
+   return &entry->geometry;
+}
+
+void ESUTIL_API
+esReleaseGeometry ( const ESGeometry *geometry )
+{
+   GeometryEntry *entry = ( GeometryEntry * ) geometry;
+   GeometryEntry **link;
+
+   if ( entry == NULL || --entry->refCount > 0 )
+   {
+      return;
+   }
+
+   link = &buckets[entry->hash & ( numBuckets - 1 )];
+
+   while ( *link != entry )
+   {
+      link = &( *link )->next;
+   }
+
+   *link = entry->next;
+
+   glDeleteBuffers ( 1, &entry->geometry.vertexBuffer );
+   glDeleteBuffers ( 1, &entry->geometry.indexBuffer );
+   esFree ( entry );
+
+   // Give the table back once nothing is cached
+   if ( --numEntries == 0 )
+   {
+      esFree ( buckets );
+      buckets = NULL;
+      numBuckets = 0;
+   }
+}
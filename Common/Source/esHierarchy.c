@@ -0,0 +1,366 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESHierarchy.c
+//
+//    Parent/child transform hierarchy stored as parallel arrays in
+//    topological order.  World matrices are recomputed only for nodes
+//    whose local matrix changed and their descendants, one depth level
+//    at a time with esMatrixMultiplyBatchGather.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <string.h>
+
+///
+// Defines
+//
+
+/// Initial number of nodes allocated when no capacity is given
+#define HIERARCHY_MIN_CAPACITY   16
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Grow()
+//
+//    Make room for at least capacity nodes.  On failure the hierarchy is
+//    left as it was (some arrays may have grown).
+//
+static GLboolean Grow ( ESHierarchy *hierarchy, int capacity )
+{
+   int      *parent;
+   ESMatrix *local;
+   ESMatrix *world;
+   GLubyte  *dirty;
+   GLubyte  *changed;
+   int      *depth;
+   int      *levelOrder;
+   int      *levelStart;
+   int      *order;
+
+   if ( capacity <= hierarchy->capacity )
+   {
+      return GL_TRUE;
+   }
+
+   if ( ( parent = esRealloc ( hierarchy->parent, sizeof ( int ) * capacity ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->parent = parent;
+
+   if ( ( local = esRealloc ( hierarchy->local, sizeof ( ESMatrix ) * capacity ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->local = local;
+
+   if ( ( world = esRealloc ( hierarchy->world, sizeof ( ESMatrix ) * capacity ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->world = world;
+
+   if ( ( dirty = esRealloc ( hierarchy->dirty, capacity ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->dirty = dirty;
+
+   if ( ( changed = esRealloc ( hierarchy->changed, capacity ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->changed = changed;
+
+   if ( ( depth = esRealloc ( hierarchy->depth, sizeof ( int ) * capacity ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->depth = depth;
+
+   if ( ( levelOrder = esRealloc ( hierarchy->levelOrder, sizeof ( int ) * capacity ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->levelOrder = levelOrder;
+
+   // One entry per depth level plus an end marker; there are at most capacity levels
+   if ( ( levelStart = esRealloc ( hierarchy->levelStart, sizeof ( int ) * ( capacity + 1 ) ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->levelStart = levelStart;
+
+   if ( ( order = esRealloc ( hierarchy->order, sizeof ( int ) * capacity ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+   hierarchy->order = order;
+
+   hierarchy->capacity = capacity;
+   return GL_TRUE;
+}
+
+///
+// SortLevels()
+//
+//    Counting sort of the nodes by depth.  Within a level the nodes stay in
+//    index order.
+//
+static void SortLevels ( ESHierarchy *hierarchy )
+{
+   int *depth = hierarchy->depth;
+   int *levelStart = hierarchy->levelStart;
+   int  maxDepth = hierarchy->maxDepth;
+   int  i, d;
+
+   memset ( levelStart, 0, sizeof ( int ) * ( maxDepth + 2 ) );
+
+   for ( i = 0; i < hierarchy->count; i++ )
+   {
+      levelStart[depth[i] + 1]++;
+   }
+
+   for ( d = 0; d <= maxDepth; d++ )
+   {
+      levelStart[d + 1] += levelStart[d];
+   }
+
+   for ( i = 0; i < hierarchy->count; i++ )
+   {
+      hierarchy->levelOrder[levelStart[depth[i]]++] = i;
+   }
+
+   // Each entry now holds the end of its level, shift them back to the starts
+   for ( d = maxDepth; d > 0; d-- )
+   {
+      levelStart[d] = levelStart[d - 1];
+   }
+   levelStart[0] = 0;
+
+   hierarchy->levelCount = hierarchy->count;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+GLboolean ESUTIL_API
+esHierarchyInit ( ESHierarchy *hierarchy, int capacity )
+{
+   memset ( hierarchy, 0, sizeof ( ESHierarchy ) );
+   hierarchy->maxDepth = -1;
+
+   return Grow ( hierarchy, capacity > 0 ? capacity : HIERARCHY_MIN_CAPACITY );
+}
+
+void ESUTIL_API
+esHierarchyFree ( ESHierarchy *hierarchy )
+{
+   esFree ( hierarchy->parent );
+   esFree ( hierarchy->local );
+   esFree ( hierarchy->world );
+   esFree ( hierarchy->dirty );
+   esFree ( hierarchy->changed );
+   esFree ( hierarchy->depth );
+   esFree ( hierarchy->levelOrder );
+   esFree ( hierarchy->levelStart );
+   esFree ( hierarchy->order );
+
+   memset ( hierarchy, 0, sizeof ( ESHierarchy ) );
+}
+
+int ESUTIL_API
+esHierarchyAddNode ( ESHierarchy *hierarchy, int parent, const ESMatrix *local )
+{
+   int node = hierarchy->count;
+
+   if ( parent >= node )
+   {
+      return -1;
+   }
+
+   if ( node == hierarchy->capacity &&
+         !Grow ( hierarchy, hierarchy->capacity > 0 ? hierarchy->capacity * 2 : HIERARCHY_MIN_CAPACITY ) )
+   {
+      return -1;
+   }
+
+   hierarchy->parent[node] = parent < 0 ? -1 : parent;
+   hierarchy->depth[node] = parent < 0 ? 0 : hierarchy->depth[parent] + 1;
+
+   if ( hierarchy->depth[node] > hierarchy->maxDepth )
+   {
+      hierarchy->maxDepth = hierarchy->depth[node];
+   }
+
+   if ( local != NULL )
+   {
+      hierarchy->local[node] = *local;
+   }
+   else
+   {
+      esMatrixLoadIdentity ( &hierarchy->local[node] );
+   }
+
+   hierarchy->dirty[node] = 1;
+   hierarchy->changed[node] = 0;
+
+   if ( hierarchy->firstDirty >= node )
+   {
+      hierarchy->firstDirty = node;
+   }
+
+   hierarchy->count++;
+   return node;
+}
+
+void ESUTIL_API
+esHierarchySetLocal ( ESHierarchy *hierarchy, int node, const ESMatrix *local )
+{
+   hierarchy->local[node] = *local;
+   hierarchy->dirty[node] = 1;
+
+   if ( node < hierarchy->firstDirty )
+   {
+      hierarchy->firstDirty = node;
+   }
+}
+
+int ESUTIL_API
+esHierarchyUpdate ( ESHierarchy *hierarchy )
+{
+   int       count = hierarchy->count;
+   int      *parent = hierarchy->parent;
+   ESMatrix *local = hierarchy->local;
+   ESMatrix *world = hierarchy->world;
+   GLubyte  *dirty = hierarchy->dirty;
+   GLubyte  *changed = hierarchy->changed;
+   int      *levelOrder;
+   int      *levelStart;
+   int      *order = hierarchy->order;
+   int       first = hierarchy->firstDirty;
+   int       updated = 0;
+   int       d;
+
+   // Forget what the previous update changed.  Nothing before its first
+   // dirty node was touched, so static frames cost nothing here.
+   if ( hierarchy->firstChanged < count )
+   {
+      memset ( changed + hierarchy->firstChanged, 0, count - hierarchy->firstChanged );
+   }
+   hierarchy->firstChanged = count;
+
+   if ( first >= count )
+   {
+      return 0;
+   }
+
+   if ( hierarchy->levelCount != count )
+   {
+      SortLevels ( hierarchy );
+   }
+   levelOrder = hierarchy->levelOrder;
+   levelStart = hierarchy->levelStart;
+
+   // Every parent is one level above its children, so by the time a level is
+   // reached its parents' changed flags and world matrices are final.  The
+   // nodes of a level that need recomputing (dirty ones and those whose
+   // parent was recomputed) are gathered and multiplied as one batch:
+   // world = local * parent world, children are transformed first.
+   for ( d = 0; d <= hierarchy->maxDepth; d++ )
+   {
+      int end = levelStart[d + 1];
+      int lo = levelStart[d], hi = end;
+      int n = 0;
+      int k;
+
+      // Nodes before the first dirty one are unchanged.  A level is in index
+      // order, so binary search for the first node that may have changed.
+      while ( lo < hi )
+      {
+         int mid = lo + ( hi - lo ) / 2;
+
+         if ( levelOrder[mid] < first )
+         {
+            lo = mid + 1;
+         }
+         else
+         {
+            hi = mid;
+         }
+      }
+
+      for ( k = lo; k < end; k++ )
+      {
+         int i = levelOrder[k];
+         int p = parent[i];
+
+         // Branch-free so a mixed level does not mispredict
+         int need = dirty[i] | ( p >= 0 ? changed[p] : 0 );
+
+         dirty[i] = 0;
+         changed[i] = ( GLubyte ) need;
+         order[n] = i;
+         n += need;
+      }
+
+      if ( d == 0 )
+      {
+         for ( k = 0; k < n; k++ )
+         {
+            world[order[k]] = local[order[k]];
+         }
+      }
+      else
+      {
+         esMatrixMultiplyBatchGather ( world, local, world, order, parent, n );
+      }
+
+      updated += n;
+   }
+
+   hierarchy->firstChanged = first;
+   hierarchy->firstDirty = count;
+
+   return updated;
+}
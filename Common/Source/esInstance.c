@@ -0,0 +1,390 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESInstance.c
+//
+//    Per-instance model-view-projection matrices from structure-of-arrays
+//    positions, orientations and scales, computed four instances at a time.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_simd.h"
+#include "esUtil_thread.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+///
+// Defines
+//
+
+/// Smallest number of four-instance groups handed to a worker thread
+#define INSTANCE_MIN_GROUPS_PER_THREAD   512
+
+///
+//  Types
+//
+typedef struct
+{
+   ESMatrix             *result;
+   const ESInstanceData *data;
+   const ESQuat         *step;
+   const ESMatrix       *viewProjection;
+} InstanceJob;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// InstanceScalar()
+//
+//    One instance.  The SIMD path evaluates every term in the same order.
+//
+static void InstanceScalar ( const InstanceJob *job, int i )
+{
+   const ESInstanceData *data = job->data;
+   const ESMatrix       *vp = job->viewProjection;
+   ESMatrix             *mvp = &job->result[i];
+   GLfloat x = data->rotationX[i], y = data->rotationY[i];
+   GLfloat z = data->rotationZ[i], w = data->rotationW[i];
+   GLfloat tx = data->positionX[i], ty = data->positionY[i], tz = data->positionZ[i];
+   GLfloat x2, y2, z2, xx, yy, zz, xy, yz, zx, wx, wy, wz;
+   GLfloat rot[3][3];
+   int     r, c;
+
+   if ( job->step != NULL )
+   {
+      const ESQuat *b = job->step;
+      GLfloat nx = w * b->x + x * b->w + y * b->z - z * b->y;
+      GLfloat ny = w * b->y - x * b->z + y * b->w + z * b->x;
+      GLfloat nz = w * b->z + x * b->y - y * b->x + z * b->w;
+      GLfloat nw = w * b->w - x * b->x - y * b->y - z * b->z;
+      GLfloat lenSq = nx * nx + ny * ny + nz * nz + nw * nw;
+
+      if ( lenSq > 0.0f )
+      {
+         GLfloat invLen = 1.0f / sqrtf ( lenSq );
+
+         x = nx * invLen;
+         y = ny * invLen;
+         z = nz * invLen;
+         w = nw * invLen;
+      }
+      else
+      {
+         x = y = z = 0.0f;
+         w = 1.0f;
+      }
+
+      data->rotationX[i] = x;
+      data->rotationY[i] = y;
+      data->rotationZ[i] = z;
+      data->rotationW[i] = w;
+   }
+
+   x2 = x + x;
+   y2 = y + y;
+   z2 = z + z;
+   xx = x * x2, yy = y * y2, zz = z * z2;
+   xy = x * y2, yz = y * z2, zx = z * x2;
+   wx = w * x2, wy = w * y2, wz = w * z2;
+
+   rot[0][0] = 1.0f - ( yy + zz );
+   rot[0][1] = xy - wz;
+   rot[0][2] = zx + wy;
+   rot[1][0] = xy + wz;
+   rot[1][1] = 1.0f - ( xx + zz );
+   rot[1][2] = yz - wx;
+   rot[2][0] = zx - wy;
+   rot[2][1] = yz + wx;
+   rot[2][2] = 1.0f - ( xx + yy );
+
+   if ( data->scale != NULL )
+   {
+      GLfloat s = data->scale[i];
+
+      for ( r = 0; r < 3; r++ )
+      {
+         rot[r][0] *= s;
+         rot[r][1] *= s;
+         rot[r][2] *= s;
+      }
+   }
+
+   for ( c = 0; c < 4; c++ )
+   {
+      for ( r = 0; r < 3; r++ )
+      {
+         mvp->m[r][c] = rot[r][0] * vp->m[0][c] + rot[r][1] * vp->m[1][c] + rot[r][2] * vp->m[2][c];
+      }
+
+      mvp->m[3][c] = tx * vp->m[0][c] + ty * vp->m[1][c] + tz * vp->m[2][c] + vp->m[3][c];
+   }
+}
+
+#if defined ( ES_SIMD )
+///
+// InstanceGroupSIMD()
+//
+//    Instances [i, i + 4), one instance per lane.  The matrices are built
+//    element by element across the four lanes and transposed so that each
+//    result is written as four contiguous rows.
+//
+static void InstanceGroupSIMD ( const InstanceJob *job, int i )
+{
+   const ESInstanceData *data = job->data;
+   const ESMatrix       *vp = job->viewProjection;
+   esVec4 x = esVec4Load ( data->rotationX + i );
+   esVec4 y = esVec4Load ( data->rotationY + i );
+   esVec4 z = esVec4Load ( data->rotationZ + i );
+   esVec4 w = esVec4Load ( data->rotationW + i );
+   esVec4 one = esVec4Splat ( 1.0f );
+   esVec4 x2, y2, z2, xx, yy, zz, xy, yz, zx, wx, wy, wz;
+   esVec4 rot[3][3];
+   esVec4 mvp[4][4];
+   int    r, c, k;
+
+   if ( job->step != NULL )
+   {
+      const ESQuat *b = job->step;
+      esVec4  bx = esVec4Splat ( b->x ), by = esVec4Splat ( b->y );
+      esVec4  bz = esVec4Splat ( b->z ), bw = esVec4Splat ( b->w );
+      esVec4  nx, ny, nz, nw, lenSq, invLen;
+      int     degenerate;
+
+      nx = esVec4Sub ( esVec4MulAdd ( esVec4MulAdd ( esVec4Mul ( w, bx ), x, bw ), y, bz ), esVec4Mul ( z, by ) );
+      ny = esVec4MulAdd ( esVec4MulAdd ( esVec4Sub ( esVec4Mul ( w, by ), esVec4Mul ( x, bz ) ), y, bw ), z, bx );
+      nz = esVec4MulAdd ( esVec4Sub ( esVec4MulAdd ( esVec4Mul ( w, bz ), x, by ), esVec4Mul ( y, bx ) ), z, bw );
+      nw = esVec4Sub ( esVec4Sub ( esVec4Sub ( esVec4Mul ( w, bw ), esVec4Mul ( x, bx ) ), esVec4Mul ( y, by ) ), esVec4Mul ( z, bz ) );
+
+      lenSq = esVec4MulAdd ( esVec4MulAdd ( esVec4MulAdd ( esVec4Mul ( nx, nx ), ny, ny ), nz, nz ), nw, nw );
+      invLen = esVec4Div ( one, esVec4Sqrt ( lenSq ) );
+      x = esVec4Mul ( nx, invLen );
+      y = esVec4Mul ( ny, invLen );
+      z = esVec4Mul ( nz, invLen );
+      w = esVec4Mul ( nw, invLen );
+
+      esVec4Store ( data->rotationX + i, x );
+      esVec4Store ( data->rotationY + i, y );
+      esVec4Store ( data->rotationZ + i, z );
+      esVec4Store ( data->rotationW + i, w );
+
+      // Lanes with a zero-length product reset to the identity, as esQuatNormalize does
+      degenerate = esVec4MoveMask ( esVec4CmpGE ( esVec4Zero (), lenSq ) );
+
+      if ( degenerate != 0 )
+      {
+         for ( k = 0; k < 4; k++ )
+         {
+            if ( degenerate & ( 1 << k ) )
+            {
+               data->rotationX[i + k] = data->rotationY[i + k] = data->rotationZ[i + k] = 0.0f;
+               data->rotationW[i + k] = 1.0f;
+            }
+         }
+
+         x = esVec4Load ( data->rotationX + i );
+         y = esVec4Load ( data->rotationY + i );
+         z = esVec4Load ( data->rotationZ + i );
+         w = esVec4Load ( data->rotationW + i );
+      }
+   }
+
+   x2 = esVec4Add ( x, x );
+   y2 = esVec4Add ( y, y );
+   z2 = esVec4Add ( z, z );
+   xx = esVec4Mul ( x, x2 ), yy = esVec4Mul ( y, y2 ), zz = esVec4Mul ( z, z2 );
+   xy = esVec4Mul ( x, y2 ), yz = esVec4Mul ( y, z2 ), zx = esVec4Mul ( z, x2 );
+   wx = esVec4Mul ( w, x2 ), wy = esVec4Mul ( w, y2 ), wz = esVec4Mul ( w, z2 );
+
+   rot[0][0] = esVec4Sub ( one, esVec4Add ( yy, zz ) );
+   rot[0][1] = esVec4Sub ( xy, wz );
+   rot[0][2] = esVec4Add ( zx, wy );
+   rot[1][0] = esVec4Add ( xy, wz );
+   rot[1][1] = esVec4Sub ( one, esVec4Add ( xx, zz ) );
+   rot[1][2] = esVec4Sub ( yz, wx );
+   rot[2][0] = esVec4Sub ( zx, wy );
+   rot[2][1] = esVec4Add ( yz, wx );
+   rot[2][2] = esVec4Sub ( one, esVec4Add ( xx, yy ) );
+
+   if ( data->scale != NULL )
+   {
+      esVec4 s = esVec4Load ( data->scale + i );
+
+      for ( r = 0; r < 3; r++ )
+      {
+         rot[r][0] = esVec4Mul ( rot[r][0], s );
+         rot[r][1] = esVec4Mul ( rot[r][1], s );
+         rot[r][2] = esVec4Mul ( rot[r][2], s );
+      }
+   }
+
+   {
+      esVec4 tx = esVec4Load ( data->positionX + i );
+      esVec4 ty = esVec4Load ( data->positionY + i );
+      esVec4 tz = esVec4Load ( data->positionZ + i );
+
+      for ( c = 0; c < 4; c++ )
+      {
+         esVec4 vp0 = esVec4Splat ( vp->m[0][c] );
+         esVec4 vp1 = esVec4Splat ( vp->m[1][c] );
+         esVec4 vp2 = esVec4Splat ( vp->m[2][c] );
+
+         for ( r = 0; r < 3; r++ )
+         {
+            mvp[r][c] = esVec4MulAdd ( esVec4MulAdd ( esVec4Mul ( rot[r][0], vp0 ), rot[r][1], vp1 ), rot[r][2], vp2 );
+         }
+
+         mvp[3][c] = esVec4Add ( esVec4MulAdd ( esVec4MulAdd ( esVec4Mul ( tx, vp0 ), ty, vp1 ), tz, vp2 ),
+                                 esVec4Splat ( vp->m[3][c] ) );
+      }
+   }
+
+   // mvp[r][0..3] holds row r of all four matrices; transpose to one matrix row per vector
+   for ( r = 0; r < 4; r++ )
+   {
+      esVec4Transpose ( mvp[r][0], mvp[r][1], mvp[r][2], mvp[r][3] );
+   }
+
+   // Write each matrix front to back, the mapped buffer may be write-combined memory
+   for ( k = 0; k < 4; k++ )
+   {
+      ESMatrix *result = &job->result[i + k];
+
+      for ( r = 0; r < 4; r++ )
+      {
+         esVec4Store ( result->m[r], mvp[r][k] );
+      }
+   }
+}
+#endif
+
+///
+// InstanceRange()
+//
+//    esParallelFor callback over four-instance groups [begin, end)
+//
+static void InstanceRange ( void *context, int begin, int end )
+{
+   const InstanceJob *job = ( const InstanceJob * ) context;
+   int first = begin * 4;
+   int last = end * 4 < job->data->count ? end * 4 : job->data->count;
+   int i = first;
+
+#if defined ( ES_SIMD )
+   for ( ; i + 4 <= last; i += 4 )
+   {
+      InstanceGroupSIMD ( job, i );
+   }
+#endif
+
+   for ( ; i < last; i++ )
+   {
+      InstanceScalar ( job, i );
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+GLboolean ESUTIL_API
+esInstanceDataInit ( ESInstanceData *data, int count )
+{
+   // Round each array up to a multiple of four floats so every array starts 16-byte aligned
+   int      stride = ( count + 3 ) & ~3;
+   GLfloat *block;
+   int      i;
+
+   memset ( data, 0, sizeof ( ESInstanceData ) );
+
+   if ( count <= 0 )
+   {
+      return GL_FALSE;
+   }
+
+   block = esMalloc ( ( size_t ) stride * 8 * sizeof ( GLfloat ) );
+
+   if ( block == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   data->count = count;
+   data->positionX = block;
+   data->positionY = block + stride;
+   data->positionZ = block + stride * 2;
+   data->rotationX = block + stride * 3;
+   data->rotationY = block + stride * 4;
+   data->rotationZ = block + stride * 5;
+   data->rotationW = block + stride * 6;
+   data->scale = block + stride * 7;
+
+   memset ( block, 0, ( size_t ) stride * 7 * sizeof ( GLfloat ) );
+
+   for ( i = 0; i < count; i++ )
+   {
+      data->rotationW[i] = 1.0f;
+      data->scale[i] = 1.0f;
+   }
+
+   return GL_TRUE;
+}
+
+void ESUTIL_API
+esInstanceDataFree ( ESInstanceData *data )
+{
+   // positionX is the start of the single allocation made by esInstanceDataInit
+   esFree ( data->positionX );
+   memset ( data, 0, sizeof ( ESInstanceData ) );
+}
+
+void ESUTIL_API
+esInstanceComputeMVPs ( ESMatrix *result, ESInstanceData *data, const ESQuat *step,
+                        const ESMatrix *viewProjection )
+{
+   InstanceJob job;
+
+   job.result = result;
+   job.data = data;
+   job.step = step;
+   job.viewProjection = viewProjection;
+
+   esParallelFor ( ( data->count + 3 ) / 4, INSTANCE_MIN_GROUPS_PER_THREAD, InstanceRange, &job );
+}
@@ -0,0 +1,231 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESMemory.c
+//
+//    Allocator hooks used by all of Common, and a linear arena for memory
+//    that only lives for one frame.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+
+///
+// Defines
+//
+
+/// Alignment of esFrameAlloc blocks, enough for the SIMD types
+#define FRAME_ALIGN   16
+
+/// Smallest arena kept once a frame has asked for memory
+#define FRAME_MIN_CAPACITY   ( 64 * 1024 )
+
+#define ALIGN_UP( value, alignment )   ( ( ( value ) + ( alignment ) - 1 ) & ~( size_t ) ( ( alignment ) - 1 ) )
+
+///
+//  Types
+//
+
+/// Header of a block allocated when a frame outgrows the arena
+typedef struct FrameBlock
+{
+   struct FrameBlock *next;
+} FrameBlock;
+
+///
+//  Globals
+//
+/// Set by esSetAllocator, all NULL to use the C library
+static ESAllocator allocator;
+
+/// The arena: frameMemory as allocated, frameBase aligned, frameUsed bytes of it handed out
+static GLubyte *frameMemory = NULL;
+static GLubyte *frameBase = NULL;
+static size_t frameCapacity = 0;
+static size_t frameUsed = 0;
+
+/// Blocks allocated this frame because the arena was full, and their total size
+static FrameBlock *frameOverflow = NULL;
+static size_t frameOverflowSize = 0;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FreeOverflow()
+//
+static void FreeOverflow ( void )
+{
+   while ( frameOverflow != NULL )
+   {
+      FrameBlock *next = frameOverflow->next;
+
+      esFree ( frameOverflow );
+      frameOverflow = next;
+   }
+
+   frameOverflowSize = 0;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+void ESUTIL_API
+esSetAllocator ( const ESAllocator *newAllocator )
+{
+   // The arena goes back to the allocator it came from
+   FreeOverflow ();
+   esFree ( frameMemory );
+   frameMemory = NULL;
+   frameBase = NULL;
+   frameCapacity = 0;
+   frameUsed = 0;
+
+   if ( newAllocator != NULL )
+   {
+      allocator = *newAllocator;
+   }
+   else
+   {
+      memset ( &allocator, 0, sizeof ( ESAllocator ) );
+   }
+}
+
+void *ESUTIL_API
+esMalloc ( size_t size )
+{
+   return allocator.allocFunc != NULL ? allocator.allocFunc ( allocator.userData, size ) : malloc ( size );
+}
+
+void *ESUTIL_API
+esCalloc ( size_t count, size_t size )
+{
+   void *ptr;
+
+   if ( size != 0 && count > ( ( size_t ) -1 ) / size )
+   {
+      return NULL;
+   }
+
+   if ( ( ptr = esMalloc ( count * size ) ) != NULL )
+   {
+      memset ( ptr, 0, count * size );
+   }
+
+   return ptr;
+}
+
+void *ESUTIL_API
+esRealloc ( void *ptr, size_t size )
+{
+   return allocator.reallocFunc != NULL ? allocator.reallocFunc ( allocator.userData, ptr, size ) : realloc ( ptr, size );
+}
+
+void ESUTIL_API
+esFree ( void *ptr )
+{
+   if ( ptr == NULL )
+   {
+      return;
+   }
+
+   if ( allocator.freeFunc != NULL )
+   {
+      allocator.freeFunc ( allocator.userData, ptr );
+   }
+   else
+   {
+      free ( ptr );
+   }
+}
+
+void *ESUTIL_API
+esFrameAlloc ( size_t size )
+{
+   FrameBlock *block;
+   GLubyte *ptr;
+
+   size = ALIGN_UP ( size > 0 ? size : 1, FRAME_ALIGN );
+
+   if ( size <= frameCapacity - frameUsed )
+   {
+      ptr = frameBase + frameUsed;
+      frameUsed += size;
+      return ptr;
+   }
+
+   // Full: hand out a block of its own, and grow the arena at the next reset
+   if ( ( block = esMalloc ( sizeof ( FrameBlock ) + FRAME_ALIGN - 1 + size ) ) == NULL )
+   {
+      return NULL;
+   }
+
+   block->next = frameOverflow;
+   frameOverflow = block;
+   frameOverflowSize += size;
+
+   return ( GLubyte * ) ALIGN_UP ( ( size_t ) ( block + 1 ), FRAME_ALIGN );
+}
+
+void ESUTIL_API
+esFrameReset ( void )
+{
+   if ( frameOverflow != NULL )
+   {
+      // Make the arena big enough for everything this frame asked for, so the
+      // next frame like it needs no heap calls
+      size_t capacity = frameCapacity > FRAME_MIN_CAPACITY ? frameCapacity : FRAME_MIN_CAPACITY;
+
+      while ( capacity < frameUsed + frameOverflowSize )
+      {
+         capacity *= 2;
+      }
+
+      FreeOverflow ();
+      esFree ( frameMemory );
+
+      frameMemory = esMalloc ( capacity + FRAME_ALIGN - 1 );
+      frameBase = frameMemory != NULL ? ( GLubyte * ) ALIGN_UP ( ( size_t ) frameMemory, FRAME_ALIGN ) : NULL;
+      frameCapacity = frameMemory != NULL ? capacity : 0;
+   }
+
+   frameUsed = 0;
+}
@@ -0,0 +1,1535 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESOptimize.c
+//
+//    Index buffer reordering for the post-transform vertex cache and for
+//    overdraw, cache statistics to measure the result, conversion to
+//    16-bit indices, and splitting into meshlets for culling.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_thread.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+///
+// Defines
+//
+
+/// Largest index a 16-bit submesh may use; 0xFFFF is the strip restart index
+#define MAX_INDEX_16   0xFFFE
+
+/// New vertices a meshlet triangle may cost for facing fully away from the
+/// meshlet's normal; keeps the normal cones narrow
+#define MESHLET_CONE_WEIGHT   0.5f
+
+#define EMPTY_SLOT   0xFFFFFFFFu
+
+/// Smallest number of vertices handed to a worker thread when hashing them
+#define WELD_MIN_VERTICES_PER_THREAD   16384
+
+/// Largest cell coordinate, so far away vertices cannot overflow a GLint
+#define WELD_MAX_CELL   1073741824.0f
+
+///
+//  Types
+//
+
+/// Compressed adjacency: the triangles using vertex v are
+/// triangles[offsets[v]] .. triangles[offsets[v + 1] - 1]
+typedef struct
+{
+   int *offsets;
+   int *triangles;
+} VertexTriangles;
+
+typedef struct
+{
+   GLfloat key;
+   int     cluster;
+} ClusterSort;
+
+/// Per-vertex hashing for esWeldVertices.  With an epsilon, vertices are hashed by
+/// the grid cell of their first attribute.  Cells are four times epsilon wide, so
+/// only a vertex within epsilon of a cell side has to look in the cell beyond it.
+typedef struct
+{
+   const GLubyte *vertices;
+   GLsizei        stride;
+   /// Byte offsets of every compared float; the first numKeys pick the cell
+   int            offsets[8];
+   int            numComponents;
+   int            numKeys;
+   /// 1 / ( 4 * epsilon ), 0 to weld equal vertices only
+   GLfloat        cellScale;
+   GLfloat        epsilon;
+   GLuint        *hashes;
+   /// Three cell coordinates per vertex, with an epsilon only
+   GLint         *cells;
+} WeldJob;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// BuildVertexTriangles()
+//
+//    Also returns the number of triangles using each vertex in live
+//
+static GLboolean BuildVertexTriangles ( VertexTriangles *adj, int *live, const GLuint *indices,
+                                        int numIndices, int numVertices )
+{
+   int i;
+
+   adj->offsets = esMalloc ( sizeof ( int ) * ( numVertices + 1 ) );
+   adj->triangles = esMalloc ( sizeof ( int ) * ( numIndices > 0 ? numIndices : 1 ) );
+
+   if ( adj->offsets == NULL || adj->triangles == NULL )
+   {
+      esFree ( adj->offsets );
+      esFree ( adj->triangles );
+      return GL_FALSE;
+   }
+
+   memset ( live, 0, sizeof ( int ) * numVertices );
+
+   for ( i = 0; i < numIndices; i++ )
+   {
+      live[indices[i]]++;
+   }
+
+   adj->offsets[0] = 0;
+
+   for ( i = 0; i < numVertices; i++ )
+   {
+      adj->offsets[i + 1] = adj->offsets[i] + live[i];
+   }
+
+   // Fill each list from its end, offsets[v] ends up back at the start
+   for ( i = 0; i < numVertices; i++ )
+   {
+      adj->offsets[i] += live[i];
+   }
+
+   for ( i = numIndices - 1; i >= 0; i-- )
+   {
+      adj->triangles[--adj->offsets[indices[i]]] = i / 3;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// CacheMiss()
+//
+//    FIFO cache simulation for one vertex.  A vertex is resident while
+//    fewer than cacheSize misses have happened since it was loaded.
+//
+static int CacheMiss ( GLuint v, int *stamps, int *time, int cacheSize )
+{
+   if ( *time - stamps[v] >= cacheSize )
+   {
+      stamps[v] = *time;
+      ( *time )++;
+      return 1;
+   }
+
+   return 0;
+}
+
+///
+// CacheMisses()
+//
+//    CacheMiss() for the three vertices of a triangle
+//
+static int CacheMisses ( const GLuint *tri, int *stamps, int *time, int cacheSize )
+{
+   return CacheMiss ( tri[0], stamps, time, cacheSize ) +
+          CacheMiss ( tri[1], stamps, time, cacheSize ) +
+          CacheMiss ( tri[2], stamps, time, cacheSize );
+}
+
+///
+// SkipDeadEnd()
+//
+//    Tipsify fallback when the current fan has no live neighbours: the most
+//    recently emitted vertex with triangles left, else the next one in input order
+//
+static int SkipDeadEnd ( const int *live, const int *deadEnd, int *deadEndSize,
+                         const GLuint *indices, int numIndices, int *cursor )
+{
+   while ( *deadEndSize > 0 )
+   {
+      int v = deadEnd[--( *deadEndSize )];
+
+      if ( live[v] > 0 )
+      {
+         return v;
+      }
+   }
+
+   while ( *cursor < numIndices )
+   {
+      int v = indices[( *cursor )++];
+
+      if ( live[v] > 0 )
+      {
+         return v;
+      }
+   }
+
+   return -1;
+}
+
+///
+// NextPrimitive()
+//
+//    Length of the primitive starting at indices[start] (a triangle, or a strip
+//    up to the next restart index) and its range of vertices
+//
+static int NextPrimitive ( const GLuint *indices, int numIndices, int start, GLenum mode,
+                           GLuint *minIndex, GLuint *maxIndex )
+{
+   int end = start;
+
+   *minIndex = 0xFFFFFFFFu;
+   *maxIndex = 0;
+
+   while ( end < numIndices )
+   {
+      GLuint v = indices[end];
+
+      if ( mode == GL_TRIANGLE_STRIP ? v == ES_PRIMITIVE_RESTART_INDEX : end == start + 3 )
+      {
+         break;
+      }
+
+      *minIndex = v < *minIndex ? v : *minIndex;
+      *maxIndex = v > *maxIndex ? v : *maxIndex;
+      end++;
+   }
+
+   return end - start;
+}
+
+///
+// CompareClusters()
+//
+//    Larger keys first, ties in original order
+//
+static int CompareClusters ( const void *a, const void *b )
+{
+   const ClusterSort *ca = ( const ClusterSort * ) a;
+   const ClusterSort *cb = ( const ClusterSort * ) b;
+
+   if ( ca->key != cb->key )
+   {
+      return ca->key > cb->key ? -1 : 1;
+   }
+
+   return ca->cluster - cb->cluster;
+}
+
+///
+// MeshletBounds()
+//
+//    Bounding sphere around the box of meshlet m's vertices and the normal
+//    cone around its average triangle normal.  The cutoff is the sine of
+//    the cone's half angle, 1 when it reaches 90 degrees and the meshlet
+//    can always be seen from somewhere.
+//
+static void MeshletBounds ( ESMeshlets *meshlets, int m, const GLfloat *normals,
+                            const GLubyte *base, int positionStride )
+{
+   const GLuint *indices = meshlets->indices + meshlets->firstIndex[m];
+   int      count = meshlets->count[m];
+   GLfloat  minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+   GLfloat  maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+   GLfloat  center[3], axis[3] = { 0.0f, 0.0f, 0.0f };
+   GLfloat  radius = 0.0f, minDot = 1.0f, length;
+   GLuint   minVertex = 0xFFFFFFFFu, maxVertex = 0;
+   int      i, k;
+
+   for ( i = 0; i < count; i++ )
+   {
+      const GLfloat *p = ( const GLfloat * ) ( base + ( size_t ) indices[i] * positionStride );
+
+      for ( k = 0; k < 3; k++ )
+      {
+         minimum[k] = p[k] < minimum[k] ? p[k] : minimum[k];
+         maximum[k] = p[k] > maximum[k] ? p[k] : maximum[k];
+      }
+
+      minVertex = indices[i] < minVertex ? indices[i] : minVertex;
+      maxVertex = indices[i] > maxVertex ? indices[i] : maxVertex;
+   }
+
+   for ( k = 0; k < 3; k++ )
+   {
+      center[k] = ( minimum[k] + maximum[k] ) * 0.5f;
+   }
+
+   for ( i = 0; i < count; i++ )
+   {
+      const GLfloat *p = ( const GLfloat * ) ( base + ( size_t ) indices[i] * positionStride );
+      GLfloat dx = p[0] - center[0], dy = p[1] - center[1], dz = p[2] - center[2];
+      GLfloat d = dx * dx + dy * dy + dz * dz;
+
+      radius = d > radius ? d : radius;
+   }
+
+   for ( i = 0; i < count; i += 3 )
+   {
+      const GLfloat *n = normals + ( meshlets->firstIndex[m] + i );
+
+      axis[0] += n[0];
+      axis[1] += n[1];
+      axis[2] += n[2];
+   }
+
+   length = sqrtf ( axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] );
+
+   if ( length > 0.0f )
+   {
+      axis[0] /= length;
+      axis[1] /= length;
+      axis[2] /= length;
+
+      for ( i = 0; i < count; i += 3 )
+      {
+         const GLfloat *n = normals + ( meshlets->firstIndex[m] + i );
+         GLfloat d = n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2];
+
+         // Degenerate triangles have no normal and face nowhere
+         if ( n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f )
+         {
+            minDot = d < minDot ? d : minDot;
+         }
+      }
+   }
+   else
+   {
+      minDot = 0.0f;
+   }
+
+   meshlets->minVertex[m] = minVertex;
+   meshlets->maxVertex[m] = maxVertex;
+   meshlets->centerX[m] = center[0];
+   meshlets->centerY[m] = center[1];
+   meshlets->centerZ[m] = center[2];
+   meshlets->radius[m] = sqrtf ( radius );
+   meshlets->coneX[m] = axis[0];
+   meshlets->coneY[m] = axis[1];
+   meshlets->coneZ[m] = axis[2];
+   meshlets->coneCutoff[m] = minDot > 0.0f ? sqrtf ( 1.0f - minDot * minDot ) : 1.0f;
+}
+
+///
+// TableSize()
+//
+//    Power of two at least twice count, for open addressing
+//
+static GLuint TableSize ( int count )
+{
+   GLuint size = 16;
+
+   while ( size < ( GLuint ) count * 2 )
+   {
+      size *= 2;
+   }
+
+   return size;
+}
+
+///
+// HashCell()
+//
+static GLuint HashCell ( const GLint *cell )
+{
+   GLuint h = ( GLuint ) cell[0] * 73856093u ^ ( GLuint ) cell[1] * 19349663u ^ ( GLuint ) cell[2] * 83492791u;
+
+   return h ^ ( h >> 15 );
+}
+
+///
+// WeldComponent()
+//
+static GLfloat WeldComponent ( const WeldJob *job, GLuint v, int c )
+{
+   return *( const GLfloat * ) ( job->vertices + ( GLsizeiptr ) v * job->stride + job->offsets[c] );
+}
+
+///
+// WeldHashRange()
+//
+//    esParallelFor callback, the hash (and cell) of vertices [begin, end)
+//
+static void WeldHashRange ( void *context, int begin, int end )
+{
+   const WeldJob *job = ( const WeldJob * ) context;
+   int v, c;
+
+   for ( v = begin; v < end; v++ )
+   {
+      if ( job->cellScale == 0.0f )
+      {
+         GLuint h = 2166136261u;
+
+         for ( c = 0; c < job->numComponents; c++ )
+         {
+            // Adding zero turns -0 into +0 so both hash alike
+            GLfloat value = WeldComponent ( job, v, c ) + 0.0f;
+            GLuint  bits;
+
+            memcpy ( &bits, &value, sizeof ( bits ) );
+            h = ( h ^ bits ) * 16777619u;
+         }
+
+         job->hashes[v] = h ^ ( h >> 15 );
+      }
+      else
+      {
+         GLint *cell = job->cells + 3 * v;
+
+         for ( c = 0; c < 3; c++ )
+         {
+            GLfloat scaled = c < job->numKeys ? WeldComponent ( job, v, c ) * job->cellScale : 0.0f;
+
+            scaled = scaled < -WELD_MAX_CELL ? -WELD_MAX_CELL : scaled > WELD_MAX_CELL ? WELD_MAX_CELL : scaled;
+            cell[c] = ( GLint ) floorf ( scaled );
+         }
+
+         job->hashes[v] = HashCell ( cell );
+      }
+   }
+}
+
+///
+// WeldMatch()
+//
+//    Whether every compared float of vertices u and v is equal, or within epsilon
+//
+static GLboolean WeldMatch ( const WeldJob *job, GLuint u, GLuint v )
+{
+   int c;
+
+   for ( c = 0; c < job->numComponents; c++ )
+   {
+      GLfloat d = WeldComponent ( job, u, c ) - WeldComponent ( job, v, c );
+
+      if ( !( d <= job->epsilon && -d <= job->epsilon ) )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// WeldFindNear()
+//
+//    The lowest welded vertex within epsilon of v, searching the cell of v and
+//    the cells beyond the sides v is within epsilon of; EMPTY_SLOT if none.
+//    table holds a vertex and its hash per slot.
+//
+static GLuint WeldFindNear ( const WeldJob *job, const GLuint *table, GLuint mask, GLuint v )
+{
+   const GLint *home = job->cells + 3 * v;
+   GLuint best = EMPTY_SLOT;
+   GLint side[3] = { 0, 0, 0 };
+   int n, c;
+
+   for ( c = 0; c < job->numKeys; c++ )
+   {
+      GLfloat offset = WeldComponent ( job, v, c ) * job->cellScale - ( GLfloat ) home[c];
+
+      side[c] = offset < 0.25f ? -1 : offset >= 0.75f ? 1 : 0;
+   }
+
+   for ( n = 0; n < 8; n++ )
+   {
+      GLint  cell[3];
+      GLuint hash, slot;
+
+      if ( ( ( n & 1 ) && side[0] == 0 ) || ( ( n & 2 ) && side[1] == 0 ) || ( ( n & 4 ) && side[2] == 0 ) )
+      {
+         continue;
+      }
+
+      for ( c = 0; c < 3; c++ )
+      {
+         cell[c] = home[c] + ( ( n >> c ) & 1 ? side[c] : 0 );
+      }
+
+      hash = HashCell ( cell );
+
+      for ( slot = hash & mask; table[2 * slot] != EMPTY_SLOT; slot = ( slot + 1 ) & mask )
+      {
+         GLuint u = table[2 * slot];
+         const GLint *other = job->cells + 3 * u;
+
+         if ( table[2 * slot + 1] == hash && u < best && other[0] == cell[0] && other[1] == cell[1] &&
+               other[2] == cell[2] && WeldMatch ( job, u, v ) )
+         {
+            best = u;
+         }
+      }
+   }
+
+   return best;
+}
+
+///
+// SameTriangle()
+//
+//    Whether triangle t is a, b, c, starting from any corner
+//
+static GLboolean SameTriangle ( const GLuint *t, GLuint a, GLuint b, GLuint c )
+{
+   return ( t[0] == a && t[1] == b && t[2] == c ) ||
+          ( t[0] == b && t[1] == c && t[2] == a ) ||
+          ( t[0] == c && t[1] == a && t[2] == b );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+void ESUTIL_API
+esAnalyzeVertexCache ( ESVertexCacheStats *stats, GLenum mode, const GLuint *indices, int numIndices,
+                       int numVertices, int cacheSize )
+{
+   int *stamps;
+   int  time;
+   int  unique = 0;
+   int  numTriangles = 0;
+   int  i;
+
+   memset ( stats, 0, sizeof ( ESVertexCacheStats ) );
+
+   if ( numIndices < 3 || numVertices <= 0 )
+   {
+      return;
+   }
+
+   if ( cacheSize <= 0 )
+   {
+      cacheSize = ES_VERTEX_CACHE_SIZE;
+   }
+
+   stamps = esMalloc ( sizeof ( int ) * numVertices );
+
+   if ( stamps == NULL )
+   {
+      return;
+   }
+
+   // Start the clock past every initial stamp so the cache begins empty
+   time = cacheSize;
+   memset ( stamps, 0, sizeof ( int ) * numVertices );
+
+   if ( mode == GL_TRIANGLE_STRIP )
+   {
+      int run = 0;
+
+      for ( i = 0; i < numIndices; i++ )
+      {
+         if ( indices[i] == ES_PRIMITIVE_RESTART_INDEX )
+         {
+            run = 0;
+            continue;
+         }
+
+         stats->transformed += CacheMiss ( indices[i], stamps, &time, cacheSize );
+
+         // Degenerate triangles used to join or flip strips are not counted
+         if ( ++run >= 3 && indices[i] != indices[i - 1] && indices[i] != indices[i - 2] &&
+              indices[i - 1] != indices[i - 2] )
+         {
+            numTriangles++;
+         }
+      }
+   }
+   else
+   {
+      for ( i = 0; i + 3 <= numIndices; i += 3 )
+      {
+         stats->transformed += CacheMisses ( indices + i, stamps, &time, cacheSize );
+      }
+
+      numTriangles = numIndices / 3;
+   }
+
+   for ( i = 0; i < numVertices; i++ )
+   {
+      unique += stamps[i] != 0;
+   }
+
+   stats->acmr = numTriangles > 0 ? ( float ) stats->transformed / ( float ) numTriangles : 0.0f;
+   stats->atvr = unique > 0 ? ( float ) stats->transformed / ( float ) unique : 0.0f;
+
+   esFree ( stamps );
+}
+
+GLboolean ESUTIL_API
+esOptimizeVertexCache ( GLuint *indices, int numIndices, int numVertices, int cacheSize )
+{
+   VertexTriangles adj;
+   int     *live, *stamps, *deadEnd;
+   GLubyte *emitted;
+   GLuint  *result;
+   int      numTriangles = numIndices / 3;
+   int      deadEndSize = 0;
+   int      cursor = 0;
+   int      written = 0;
+   int      time, fan;
+
+   if ( numTriangles == 0 || numVertices <= 0 )
+   {
+      return GL_TRUE;
+   }
+
+   if ( cacheSize <= 0 )
+   {
+      cacheSize = ES_VERTEX_CACHE_SIZE;
+   }
+
+   live = esMalloc ( sizeof ( int ) * numVertices );
+   stamps = esCalloc ( numVertices, sizeof ( int ) );
+   deadEnd = esMalloc ( sizeof ( int ) * numTriangles * 3 );
+   emitted = esCalloc ( numTriangles, 1 );
+   result = esMalloc ( sizeof ( GLuint ) * numTriangles * 3 );
+
+   if ( live == NULL || stamps == NULL || deadEnd == NULL || emitted == NULL || result == NULL ||
+        !BuildVertexTriangles ( &adj, live, indices, numTriangles * 3, numVertices ) )
+   {
+      esFree ( live );
+      esFree ( stamps );
+      esFree ( deadEnd );
+      esFree ( emitted );
+      esFree ( result );
+      return GL_FALSE;
+   }
+
+   // Tipsify (Sander, Nehab and Barczak 2007): emit every remaining triangle
+   // around a fanning vertex, then move to the emitted vertex that will stay
+   // in the cache longest while still having triangles left
+   time = cacheSize + 1;
+   fan = indices[0];
+
+   while ( fan >= 0 )
+   {
+      int candidates = deadEndSize;
+      int best = -1;
+      int bestPriority = -1;
+      int t, k;
+
+      for ( t = adj.offsets[fan]; t < adj.offsets[fan + 1]; t++ )
+      {
+         int tri = adj.triangles[t];
+
+         if ( emitted[tri] )
+         {
+            continue;
+         }
+
+         for ( k = 0; k < 3; k++ )
+         {
+            GLuint v = indices[tri * 3 + k];
+
+            result[written++] = v;
+            deadEnd[deadEndSize++] = v;
+            live[v]--;
+
+            if ( time - stamps[v] > cacheSize )
+            {
+               stamps[v] = time;
+               time++;
+            }
+         }
+
+         emitted[tri] = 1;
+      }
+
+      // Vertices emitted by this fan that are still live, preferring the
+      // oldest one that will not be evicted before its triangles are done
+      for ( ; candidates < deadEndSize; candidates++ )
+      {
+         int v = deadEnd[candidates];
+
+         if ( live[v] > 0 )
+         {
+            int priority = 0;
+
+            if ( time - stamps[v] + 2 * live[v] <= cacheSize )
+            {
+               priority = time - stamps[v];
+            }
+
+            if ( priority > bestPriority )
+            {
+               bestPriority = priority;
+               best = v;
+            }
+         }
+      }
+
+      if ( best < 0 )
+      {
+         best = SkipDeadEnd ( live, deadEnd, &deadEndSize, indices, numTriangles * 3, &cursor );
+      }
+
+      fan = best;
+   }
+
+   memcpy ( indices, result, sizeof ( GLuint ) * written );
+
+   esFree ( adj.offsets );
+   esFree ( adj.triangles );
+   esFree ( live );
+   esFree ( stamps );
+   esFree ( deadEnd );
+   esFree ( emitted );
+   esFree ( result );
+   return GL_TRUE;
+}
+
+GLboolean ESUTIL_API
+esOptimizeOverdraw ( GLuint *indices, int numIndices, const GLfloat *positions, int positionStride,
+                     int numVertices, int cacheSize, float threshold )
+{
+   const GLubyte *base = ( const GLubyte * ) positions;
+   int           numTriangles = numIndices / 3;
+   int          *stamps, *clusters;
+   ClusterSort  *order;
+   GLfloat      *centroids;
+   GLuint       *result;
+   GLfloat       center[3] = { 0.0f, 0.0f, 0.0f };
+   GLfloat       totalArea = 0.0f;
+   int           numClusters = 0;
+   int           time, start, t, c, k, written;
+
+   if ( numTriangles < 2 || numVertices <= 0 )
+   {
+      return GL_TRUE;
+   }
+
+   if ( cacheSize <= 0 )
+   {
+      cacheSize = ES_VERTEX_CACHE_SIZE;
+   }
+
+   if ( positionStride == 0 )
+   {
+      positionStride = 3 * sizeof ( GLfloat );
+   }
+
+   stamps = esCalloc ( numVertices, sizeof ( int ) );
+   clusters = esMalloc ( sizeof ( int ) * ( numTriangles + 1 ) );
+   centroids = esMalloc ( sizeof ( GLfloat ) * 4 * numTriangles );
+   order = esMalloc ( sizeof ( ClusterSort ) * numTriangles );
+   result = esMalloc ( sizeof ( GLuint ) * numTriangles * 3 );
+
+   if ( stamps == NULL || clusters == NULL || centroids == NULL || order == NULL || result == NULL )
+   {
+      esFree ( stamps );
+      esFree ( clusters );
+      esFree ( centroids );
+      esFree ( order );
+      esFree ( result );
+      return GL_FALSE;
+   }
+
+   // Hard boundaries: triangles where the cache-ordered input restarts with three misses
+   time = cacheSize;
+   start = 0;
+
+   for ( t = 0; t <= numTriangles; t++ )
+   {
+      int misses = t < numTriangles ? CacheMisses ( indices + t * 3, stamps, &time, cacheSize ) : 3;
+      int end = t;
+
+      if ( misses < 3 || end == start )
+      {
+         continue;
+      }
+
+      // Soft boundaries (Sander et al., linear-speed overdraw): split the run
+      // [start, end) wherever the ACMR so far, starting from an empty cache,
+      // is within threshold of the run's own, so clusters can be drawn in any order
+      {
+         int     runMisses = 0;
+         int     soft = start;
+         GLfloat limit;
+         int     i;
+
+         time += cacheSize;
+
+         for ( i = start; i < end; i++ )
+         {
+            runMisses += CacheMisses ( indices + i * 3, stamps, &time, cacheSize );
+         }
+
+         limit = threshold * ( float ) runMisses / ( float ) ( end - start );
+         runMisses = 0;
+         time += cacheSize;
+
+         for ( i = start; i < end; i++ )
+         {
+            runMisses += CacheMisses ( indices + i * 3, stamps, &time, cacheSize );
+
+            if ( ( float ) runMisses <= limit * ( float ) ( i + 1 - soft ) || i + 1 == end )
+            {
+               clusters[numClusters++] = soft;
+               soft = i + 1;
+               runMisses = 0;
+               time += cacheSize;
+            }
+         }
+      }
+
+      start = end;
+
+      // The triangle that ended the run opens the next one on a fresh cache
+      if ( t < numTriangles )
+      {
+         time += cacheSize;
+         CacheMisses ( indices + t * 3, stamps, &time, cacheSize );
+      }
+   }
+
+   clusters[numClusters] = numTriangles;
+
+   // Area-weighted centroid of the whole mesh, and per triangle centroid and area
+   for ( t = 0; t < numTriangles; t++ )
+   {
+      const GLfloat *p0 = ( const GLfloat * ) ( base + ( size_t ) indices[t * 3 + 0] * positionStride );
+      const GLfloat *p1 = ( const GLfloat * ) ( base + ( size_t ) indices[t * 3 + 1] * positionStride );
+      const GLfloat *p2 = ( const GLfloat * ) ( base + ( size_t ) indices[t * 3 + 2] * positionStride );
+      GLfloat e1[3], e2[3], n[3], area;
+
+      for ( k = 0; k < 3; k++ )
+      {
+         e1[k] = p1[k] - p0[k];
+         e2[k] = p2[k] - p0[k];
+         centroids[t * 4 + k] = ( p0[k] + p1[k] + p2[k] ) / 3.0f;
+      }
+
+      n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+      n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+      n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+      area = sqrtf ( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+      centroids[t * 4 + 3] = area;
+      totalArea += area;
+
+      for ( k = 0; k < 3; k++ )
+      {
+         center[k] += centroids[t * 4 + k] * area;
+      }
+   }
+
+   if ( totalArea > 0.0f )
+   {
+      for ( k = 0; k < 3; k++ )
+      {
+         center[k] /= totalArea;
+      }
+   }
+
+   // Clusters that face away from the center are likely to occlude the rest, draw them first
+   for ( c = 0; c < numClusters; c++ )
+   {
+      GLfloat cc[3] = { 0.0f, 0.0f, 0.0f };
+      GLfloat cn[3] = { 0.0f, 0.0f, 0.0f };
+      GLfloat area = 0.0f, len;
+
+      for ( t = clusters[c]; t < clusters[c + 1]; t++ )
+      {
+         const GLfloat *p0 = ( const GLfloat * ) ( base + ( size_t ) indices[t * 3 + 0] * positionStride );
+         const GLfloat *p1 = ( const GLfloat * ) ( base + ( size_t ) indices[t * 3 + 1] * positionStride );
+         const GLfloat *p2 = ( const GLfloat * ) ( base + ( size_t ) indices[t * 3 + 2] * positionStride );
+         GLfloat e1[3], e2[3];
+
+         for ( k = 0; k < 3; k++ )
+         {
+            e1[k] = p1[k] - p0[k];
+            e2[k] = p2[k] - p0[k];
+            cc[k] += centroids[t * 4 + k] * centroids[t * 4 + 3];
+         }
+
+         cn[0] += e1[1] * e2[2] - e1[2] * e2[1];
+         cn[1] += e1[2] * e2[0] - e1[0] * e2[2];
+         cn[2] += e1[0] * e2[1] - e1[1] * e2[0];
+         area += centroids[t * 4 + 3];
+      }
+
+      len = sqrtf ( cn[0] * cn[0] + cn[1] * cn[1] + cn[2] * cn[2] );
+      order[c].cluster = c;
+      order[c].key = 0.0f;
+
+      if ( area > 0.0f && len > 0.0f )
+      {
+         for ( k = 0; k < 3; k++ )
+         {
+            order[c].key += ( cc[k] / area - center[k] ) * cn[k] / len;
+         }
+      }
+   }
+
+   qsort ( order, numClusters, sizeof ( ClusterSort ), CompareClusters );
+
+   written = 0;
+
+   for ( c = 0; c < numClusters; c++ )
+   {
+      int first = clusters[order[c].cluster];
+      int count = clusters[order[c].cluster + 1] - first;
+
+      memcpy ( result + written, indices + first * 3, sizeof ( GLuint ) * count * 3 );
+      written += count * 3;
+   }
+
+   memcpy ( indices, result, sizeof ( GLuint ) * written );
+
+   esFree ( stamps );
+   esFree ( clusters );
+   esFree ( centroids );
+   esFree ( order );
+   esFree ( result );
+   return GL_TRUE;
+}
+
+int ESUTIL_API
+esSplitIndices16 ( GLushort **indices16, ESSubmesh **submeshes, GLenum mode,
+                   const GLuint *indices, int numIndices )
+{
+   ESSubmesh *parts;
+   GLushort  *out;
+   int        numParts = 0;
+   int        capacity = 1;
+   int        written = 0;
+   int        start = 0;
+   int        p, i;
+
+   *indices16 = NULL;
+   *submeshes = NULL;
+
+   parts = esMalloc ( sizeof ( ESSubmesh ) * capacity );
+   out = esMalloc ( sizeof ( GLushort ) * ( numIndices > 0 ? numIndices : 1 ) );
+
+   if ( parts == NULL || out == NULL )
+   {
+      esFree ( parts );
+      esFree ( out );
+      return 0;
+   }
+
+   // Group whole primitives, in order, while their vertices span at most 16 bits.
+   // firstIndex and numIndices refer to the source indices until the second pass.
+   while ( start < numIndices )
+   {
+      GLuint     lo, hi;
+      int        length = NextPrimitive ( indices, numIndices, start, mode, &lo, &hi );
+      ESSubmesh *part = numParts > 0 ? &parts[numParts - 1] : NULL;
+
+      if ( length == 0 )
+      {
+         // Back-to-back restart indices
+         start++;
+         continue;
+      }
+
+      if ( hi - lo > MAX_INDEX_16 )
+      {
+         // A single primitive spans more vertices than 16 bits can address
+         esFree ( parts );
+         esFree ( out );
+         return 0;
+      }
+
+      if ( part != NULL )
+      {
+         GLuint partLo = ( GLuint ) part->baseVertex;
+         GLuint partHi = partLo + part->numVertices - 1;
+
+         partLo = lo < partLo ? lo : partLo;
+         partHi = hi > partHi ? hi : partHi;
+
+         if ( partHi - partLo <= MAX_INDEX_16 )
+         {
+            part->numIndices = start + length - part->firstIndex;
+            part->baseVertex = partLo;
+            part->numVertices = partHi - partLo + 1;
+            start += length;
+            continue;
+         }
+      }
+
+      if ( numParts == capacity )
+      {
+         ESSubmesh *grown = esRealloc ( parts, sizeof ( ESSubmesh ) * capacity * 2 );
+
+         if ( grown == NULL )
+         {
+            esFree ( parts );
+            esFree ( out );
+            return 0;
+         }
+
+         parts = grown;
+         capacity *= 2;
+      }
+
+      part = &parts[numParts++];
+      part->firstIndex = start;
+      part->numIndices = length;
+      part->baseVertex = lo;
+      part->numVertices = hi - lo + 1;
+      start += length;
+   }
+
+   // Rebase each group on its lowest vertex.  Only restarts between groups are
+   // dropped, so the output never overtakes the input.
+   for ( p = 0; p < numParts; p++ )
+   {
+      ESSubmesh *part = &parts[p];
+      GLuint     base = ( GLuint ) part->baseVertex;
+
+      for ( i = part->firstIndex; i < part->firstIndex + part->numIndices; i++ )
+      {
+         out[written + i - part->firstIndex] = indices[i] == ES_PRIMITIVE_RESTART_INDEX && mode == GL_TRIANGLE_STRIP ?
+                                               0xFFFF : ( GLushort ) ( indices[i] - base );
+      }
+
+      part->firstIndex = written;
+      written += part->numIndices;
+   }
+
+   *indices16 = out;
+   *submeshes = parts;
+   return numParts;
+}
+
+GLboolean ESUTIL_API
+esBuildMeshlets ( ESMeshlets *meshlets, const GLuint *indices, int numIndices, const GLfloat *positions,
+                  int positionStride, int numVertices, int maxVertices, int maxTriangles )
+{
+   const GLubyte *base = ( const GLubyte * ) positions;
+   VertexTriangles adj;
+   int     *live, *stamps, *starts, *verts;
+   GLfloat *normals, *sortedNormals;
+   GLubyte *emitted;
+   GLuint  *result;
+   GLubyte *block;
+   int      numTriangles = numIndices / 3;
+   int      numMeshlets = 0;
+   int      numVerts = 0, numTris = 0;
+   int      written = 0;
+   int      cursor = 0;
+   GLfloat  axis[3] = { 0.0f, 0.0f, 0.0f };
+   size_t   words, size;
+   int      i, k, m;
+
+   memset ( meshlets, 0, sizeof ( ESMeshlets ) );
+
+   if ( numTriangles == 0 || maxVertices < 3 || maxTriangles < 1 )
+   {
+      return GL_FALSE;
+   }
+
+   if ( positionStride == 0 )
+   {
+      positionStride = 3 * sizeof ( GLfloat );
+   }
+
+   live = esMalloc ( sizeof ( int ) * numVertices );
+   stamps = esMalloc ( sizeof ( int ) * numVertices );
+   starts = esMalloc ( sizeof ( int ) * ( numTriangles + 1 ) );
+   verts = esMalloc ( sizeof ( int ) * maxVertices );
+   normals = esMalloc ( sizeof ( GLfloat ) * 3 * numTriangles );
+   sortedNormals = esMalloc ( sizeof ( GLfloat ) * 3 * numTriangles );
+   emitted = esCalloc ( numTriangles, 1 );
+   result = esMalloc ( sizeof ( GLuint ) * numTriangles * 3 );
+
+   if ( live == NULL || stamps == NULL || starts == NULL || verts == NULL || normals == NULL ||
+        sortedNormals == NULL || emitted == NULL || result == NULL ||
+        !BuildVertexTriangles ( &adj, live, indices, numTriangles * 3, numVertices ) )
+   {
+      esFree ( live );
+      esFree ( stamps );
+      esFree ( starts );
+      esFree ( verts );
+      esFree ( normals );
+      esFree ( sortedNormals );
+      esFree ( emitted );
+      esFree ( result );
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < numTriangles; i++ )
+   {
+      const GLfloat *p0 = ( const GLfloat * ) ( base + ( size_t ) indices[i * 3 + 0] * positionStride );
+      const GLfloat *p1 = ( const GLfloat * ) ( base + ( size_t ) indices[i * 3 + 1] * positionStride );
+      const GLfloat *p2 = ( const GLfloat * ) ( base + ( size_t ) indices[i * 3 + 2] * positionStride );
+      GLfloat *n = normals + i * 3;
+      GLfloat  length;
+
+      n[0] = ( p1[1] - p0[1] ) * ( p2[2] - p0[2] ) - ( p1[2] - p0[2] ) * ( p2[1] - p0[1] );
+      n[1] = ( p1[2] - p0[2] ) * ( p2[0] - p0[0] ) - ( p1[0] - p0[0] ) * ( p2[2] - p0[2] );
+      n[2] = ( p1[0] - p0[0] ) * ( p2[1] - p0[1] ) - ( p1[1] - p0[1] ) * ( p2[0] - p0[0] );
+      length = sqrtf ( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+      if ( length > 0.0f )
+      {
+         n[0] /= length;
+         n[1] /= length;
+         n[2] /= length;
+      }
+   }
+
+   memset ( stamps, 0xFF, sizeof ( int ) * numVertices );
+
+   // Grow each meshlet greedily by the triangle next to it that adds the
+   // fewest vertices, and start a new one when none fits
+   while ( written < numTriangles )
+   {
+      int best = -1;
+
+      if ( numTris > 0 && numTris < maxTriangles )
+      {
+         GLfloat bestScore = FLT_MAX;
+         GLfloat length = sqrtf ( axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] );
+         GLfloat scale = length > 0.0f ? 1.0f / length : 0.0f;
+
+         for ( i = 0; i < numVerts; i++ )
+         {
+            int v = verts[i];
+
+            if ( live[v] == 0 )
+            {
+               continue;
+            }
+
+            for ( k = adj.offsets[v]; k < adj.offsets[v + 1]; k++ )
+            {
+               int t = adj.triangles[k];
+               const GLfloat *n = normals + t * 3;
+               int added;
+               GLfloat score;
+
+               if ( emitted[t] )
+               {
+                  continue;
+               }
+
+               added = ( stamps[indices[t * 3 + 0]] != numMeshlets ) +
+                       ( stamps[indices[t * 3 + 1]] != numMeshlets ) +
+                       ( stamps[indices[t * 3 + 2]] != numMeshlets );
+
+               if ( numVerts + added > maxVertices )
+               {
+                  continue;
+               }
+
+               score = ( GLfloat ) added + MESHLET_CONE_WEIGHT *
+                       ( 1.0f - ( n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2] ) * scale );
+
+               if ( score < bestScore || ( score == bestScore && t < best ) )
+               {
+                  bestScore = score;
+                  best = t;
+               }
+            }
+         }
+      }
+
+      if ( best < 0 )
+      {
+         if ( numTris > 0 )
+         {
+            starts[numMeshlets++] = written - numTris;
+            numVerts = numTris = 0;
+            axis[0] = axis[1] = axis[2] = 0.0f;
+         }
+
+         while ( emitted[cursor] )
+         {
+            cursor++;
+         }
+
+         best = cursor;
+      }
+
+      emitted[best] = 1;
+      memcpy ( result + written * 3, indices + best * 3, sizeof ( GLuint ) * 3 );
+      memcpy ( sortedNormals + written * 3, normals + best * 3, sizeof ( GLfloat ) * 3 );
+      written++;
+      numTris++;
+
+      for ( k = 0; k < 3; k++ )
+      {
+         GLuint v = indices[best * 3 + k];
+
+         live[v]--;
+         axis[k] += normals[best * 3 + k];
+
+         if ( stamps[v] != numMeshlets )
+         {
+            stamps[v] = numMeshlets;
+            verts[numVerts++] = v;
+         }
+      }
+   }
+
+   starts[numMeshlets++] = written - numTris;
+   starts[numMeshlets] = written;
+
+   // Indices, then the per-meshlet arrays and the visibility mask in one block
+   words = ( numMeshlets + 31 ) / 32;
+   size = sizeof ( GLuint ) * numTriangles * 3 + ( 4 * sizeof ( GLint ) + 8 * sizeof ( GLfloat ) ) * numMeshlets +
+          sizeof ( GLuint ) * words;
+   block = esMalloc ( size );
+
+   if ( block != NULL )
+   {
+      meshlets->numMeshlets = numMeshlets;
+      meshlets->numIndices = numTriangles * 3;
+      meshlets->indices = ( GLuint * ) block;
+      meshlets->firstIndex = ( GLint * ) ( meshlets->indices + numTriangles * 3 );
+      meshlets->count = ( GLsizei * ) ( meshlets->firstIndex + numMeshlets );
+      meshlets->minVertex = ( GLuint * ) ( meshlets->count + numMeshlets );
+      meshlets->maxVertex = meshlets->minVertex + numMeshlets;
+      meshlets->centerX = ( GLfloat * ) ( meshlets->maxVertex + numMeshlets );
+      meshlets->centerY = meshlets->centerX + numMeshlets;
+      meshlets->centerZ = meshlets->centerY + numMeshlets;
+      meshlets->radius = meshlets->centerZ + numMeshlets;
+      meshlets->coneX = meshlets->radius + numMeshlets;
+      meshlets->coneY = meshlets->coneX + numMeshlets;
+      meshlets->coneZ = meshlets->coneY + numMeshlets;
+      meshlets->coneCutoff = meshlets->coneZ + numMeshlets;
+      meshlets->visibleMask = ( GLuint * ) ( meshlets->coneCutoff + numMeshlets );
+      memcpy ( meshlets->indices, result, sizeof ( GLuint ) * numTriangles * 3 );
+
+      for ( m = 0; m < numMeshlets; m++ )
+      {
+         meshlets->firstIndex[m] = starts[m] * 3;
+         meshlets->count[m] = ( starts[m + 1] - starts[m] ) * 3;
+         MeshletBounds ( meshlets, m, sortedNormals, base, positionStride );
+      }
+   }
+
+   esFree ( adj.offsets );
+   esFree ( adj.triangles );
+   esFree ( live );
+   esFree ( stamps );
+   esFree ( starts );
+   esFree ( verts );
+   esFree ( normals );
+   esFree ( sortedNormals );
+   esFree ( emitted );
+   esFree ( result );
+   return block != NULL;
+}
+
+void ESUTIL_API
+esMeshletsFree ( ESMeshlets *meshlets )
+{
+   esFree ( meshlets->indices );
+   memset ( meshlets, 0, sizeof ( ESMeshlets ) );
+}
+
+int ESUTIL_API
+esWeldVertices ( GLuint *remap, const ESMeshLayout *layout, const GLvoid *vertices, int numVertices,
+                 GLfloat epsilon )
+{
+   static const int attribSize[ES_MESH_MAX_ATTRIBS] = { 3, 3, 2 };
+   WeldJob job;
+   GLuint *table;
+   GLuint  size;
+   int     numUnique = 0;
+   int     a, c, v;
+
+   if ( numVertices <= 0 || epsilon < 0.0f )
+   {
+      return 0;
+   }
+
+   job.vertices = ( const GLubyte * ) vertices;
+   job.stride = layout->stride;
+   job.numComponents = 0;
+   job.numKeys = 0;
+   job.epsilon = epsilon;
+   job.cellScale = epsilon > 0.0f ? 0.25f / epsilon : 0.0f;
+
+   // The position comes first, so it is the key when it is stored
+   for ( a = 0; a < ES_MESH_MAX_ATTRIBS; a++ )
+   {
+      if ( layout->offset[a] >= 0 )
+      {
+         if ( job.numKeys == 0 )
+         {
+            job.numKeys = attribSize[a];
+         }
+
+         for ( c = 0; c < attribSize[a]; c++ )
+         {
+            job.offsets[job.numComponents++] = layout->offset[a] + c * sizeof ( GLfloat );
+         }
+      }
+   }
+
+   // Each slot holds a vertex and its hash, so probing rarely touches the vertices
+   size = TableSize ( numVertices );
+   table = esMalloc ( sizeof ( GLuint ) * 2 * size );
+   job.hashes = esMalloc ( sizeof ( GLuint ) * numVertices );
+   job.cells = epsilon > 0.0f ? esMalloc ( sizeof ( GLint ) * 3 * numVertices ) : NULL;
+
+   if ( table == NULL || job.hashes == NULL || ( epsilon > 0.0f && job.cells == NULL ) )
+   {
+      esFree ( table );
+      esFree ( job.hashes );
+      esFree ( job.cells );
+      return 0;
+   }
+
+   memset ( table, 0xFF, sizeof ( GLuint ) * 2 * size );
+
+   // Hashing is the bulk of the work and independent per vertex; the table is
+   // then filled in vertex order so the result does not depend on the threads
+   esParallelFor ( numVertices, WELD_MIN_VERTICES_PER_THREAD, WeldHashRange, &job );
+
+   for ( v = 0; v < numVertices; v++ )
+   {
+      GLuint match = EMPTY_SLOT;
+      GLuint slot = job.hashes[v] & ( size - 1 );
+
+      if ( epsilon > 0.0f )
+      {
+         match = WeldFindNear ( &job, table, size - 1, v );
+      }
+
+      for ( ; table[2 * slot] != EMPTY_SLOT; slot = ( slot + 1 ) & ( size - 1 ) )
+      {
+         GLuint u = table[2 * slot];
+
+         if ( epsilon == 0.0f && table[2 * slot + 1] == job.hashes[v] && WeldMatch ( &job, u, v ) )
+         {
+            match = u;
+            break;
+         }
+      }
+
+      if ( match == EMPTY_SLOT )
+      {
+         table[2 * slot] = v;
+         table[2 * slot + 1] = job.hashes[v];
+         remap[v] = numUnique++;
+      }
+      else
+      {
+         remap[v] = remap[match];
+      }
+   }
+
+   esFree ( table );
+   esFree ( job.hashes );
+   esFree ( job.cells );
+   return numUnique;
+}
+
+int ESUTIL_API
+esRemoveDegenerateTriangles ( GLuint *indices, int numIndices )
+{
+   int     numTriangles = numIndices / 3;
+   GLuint  size = TableSize ( numTriangles );
+   GLuint *table = esMalloc ( sizeof ( GLuint ) * size );
+   int     written = 0;
+   int     t;
+
+   if ( table == NULL )
+   {
+      return -1;
+   }
+
+   memset ( table, 0xFF, sizeof ( GLuint ) * size );
+
+   for ( t = 0; t < numTriangles; t++ )
+   {
+      GLuint a = indices[3 * t], b = indices[3 * t + 1], c = indices[3 * t + 2];
+      GLuint lowest, h, slot;
+
+      if ( a == b || b == c || c == a )
+      {
+         continue;
+      }
+
+      // Hash from the lowest corner so rotations of a triangle collide; the
+      // opposite winding is a different face and is kept
+      lowest = a < b ? ( a < c ? 0 : 2 ) : ( b < c ? 1 : 2 );
+      h = lowest == 0 ? ( a * 73856093u ^ b * 19349663u ^ c * 83492791u ) :
+          lowest == 1 ? ( b * 73856093u ^ c * 19349663u ^ a * 83492791u ) :
+          ( c * 73856093u ^ a * 19349663u ^ b * 83492791u );
+
+      for ( slot = ( h ^ ( h >> 15 ) ) & ( size - 1 ); table[slot] != EMPTY_SLOT; slot = ( slot + 1 ) & ( size - 1 ) )
+      {
+         if ( SameTriangle ( indices + 3 * table[slot], a, b, c ) )
+         {
+            break;
+         }
+      }
+
+      if ( table[slot] != EMPTY_SLOT )
+      {
+         continue;
+      }
+
+      // Kept triangles move down in place, with their first corner unchanged
+      table[slot] = written;
+      indices[3 * written] = a;
+      indices[3 * written + 1] = b;
+      indices[3 * written + 2] = c;
+      written++;
+   }
+
+   esFree ( table );
+   return 3 * written;
+}
+
+GLboolean ESUTIL_API
+esCleanMesh ( ESMesh *mesh, GLfloat epsilon )
+{
+   ESMeshLod whole;
+   ESMeshLod *lods = mesh->numLods > 0 ? mesh->lods : &whole;
+   int numLods = mesh->numLods > 0 ? mesh->numLods : 1;
+   GLsizei stride = mesh->layout.stride;
+   GLubyte *base = ( GLubyte * ) mesh->vertices;
+   GLuint *remap;
+   GLuint *indices;
+   int numUnique, numIndices = 0;
+   int i, k;
+
+   if ( mesh->mode != GL_TRIANGLES || mesh->vertices == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   whole.firstIndex = 0;
+   whole.numIndices = mesh->numIndices;
+
+   if ( ( remap = esMalloc ( sizeof ( GLuint ) * ( mesh->numVertices > 0 ? mesh->numVertices : 1 ) ) ) == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   numUnique = esWeldVertices ( remap, &mesh->layout, mesh->vertices, mesh->numVertices, epsilon );
+
+   if ( numUnique == 0 && mesh->numVertices > 0 )
+   {
+      esFree ( remap );
+      return GL_FALSE;
+   }
+
+   // Each kept vertex is the first with its new index, and moves down
+   for ( i = 0, k = 0; i < mesh->numVertices; i++ )
+   {
+      if ( remap[i] == ( GLuint ) k )
+      {
+         memmove ( base + ( GLsizeiptr ) k * stride, base + ( GLsizeiptr ) i * stride, stride );
+         k++;
+      }
+   }
+
+   for ( i = 0; i < mesh->numIndices; i++ )
+   {
+      mesh->indices[i] = remap[mesh->indices[i]];
+   }
+
+   esFree ( remap );
+
+   // Clean each level on its own and pack the levels together, directly after the vertices
+   indices = ( GLuint * ) ( base + ( GLsizeiptr ) numUnique * stride );
+
+   for ( k = 0; k < numLods; k++ )
+   {
+      ESMeshLod *lod = &lods[k];
+      GLuint minVertex = EMPTY_SLOT, maxVertex = 0;
+      int count = esRemoveDegenerateTriangles ( mesh->indices + lod->firstIndex, lod->numIndices );
+
+      if ( count < 0 )
+      {
+         return GL_FALSE;
+      }
+
+      memmove ( indices + numIndices, mesh->indices + lod->firstIndex, sizeof ( GLuint ) * count );
+
+      for ( i = 0; i < count; i++ )
+      {
+         GLuint v = indices[numIndices + i];
+
+         minVertex = v < minVertex ? v : minVertex;
+         maxVertex = v > maxVertex ? v : maxVertex;
+      }
+
+      lod->firstIndex = numIndices;
+      lod->numIndices = count;
+      lod->firstVertex = count > 0 ? ( int ) minVertex : 0;
+      lod->numVertices = count > 0 ? ( int ) ( maxVertex - minVertex + 1 ) : 0;
+      numIndices += count;
+   }
+
+   mesh->numVertices = numUnique;
+   mesh->numIndices = numIndices;
+   mesh->indices = indices;
+   mesh->indexOffset = ( GLsizeiptr ) numUnique * stride;
+   mesh->size = mesh->indexOffset + ( GLsizeiptr ) numIndices * sizeof ( GLuint );
+
+   // Give back what an allocated mesh no longer uses
+   if ( mesh->allocated && ( base = esRealloc ( mesh->vertices, mesh->size > 0 ? mesh->size : 1 ) ) != NULL )
+   {
+      mesh->vertices = base;
+      mesh->indices = ( GLuint * ) ( base + mesh->indexOffset );
+   }
+
+   return GL_TRUE;
+}
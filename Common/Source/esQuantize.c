@@ -0,0 +1,466 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESQuantize.c
+//
+//    Vertex attribute quantization: re-encode float vertices as half floats,
+//    normalized 16-bit integers or GL_INT_2_10_10_10_REV to shrink the
+//    vertex stream.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+///
+// Defines
+//
+
+/// Components of each ES_MESH_* attribute
+#define ATTRIB_COMPONENTS( attrib )   ( ( attrib ) == ES_MESH_TEXCOORD ? 2 : 3 )
+
+///
+//  Types
+//
+typedef union
+{
+   GLfloat f;
+   GLuint  u;
+} FloatBits;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FloatToHalf()
+//
+//    Round to the nearest half float, ties to even.  Values too large for a
+//    half become infinity.
+//
+static GLhalf FloatToHalf ( GLfloat f )
+{
+   FloatBits bits;
+   GLuint sign, mantissa, half, rest, halfway;
+   int exponent;
+
+   bits.f = f;
+   sign = ( bits.u >> 16 ) & 0x8000;
+   exponent = ( int ) ( ( bits.u >> 23 ) & 0xFF );
+   mantissa = bits.u & 0x7FFFFF;
+
+   if ( exponent == 0xFF )
+   {
+      // Infinity stays infinity, NaN stays NaN
+      return ( GLhalf ) ( sign | 0x7C00 | ( mantissa ? 0x200 : 0 ) );
+   }
+
+   exponent = exponent - 127 + 15;
+
+   if ( exponent >= 31 )
+   {
+      return ( GLhalf ) ( sign | 0x7C00 );
+   }
+
+   if ( exponent <= 0 )
+   {
+      // Denormal half, or zero
+      int shift = 14 - exponent;
+
+      if ( shift > 24 )
+      {
+         return ( GLhalf ) sign;
+      }
+
+      mantissa |= 0x800000;
+      half = mantissa >> shift;
+      rest = mantissa & ( ( 1u << shift ) - 1 );
+      halfway = 1u << ( shift - 1 );
+   }
+   else
+   {
+      half = ( ( GLuint ) exponent << 10 ) | ( mantissa >> 13 );
+      rest = mantissa & 0x1FFF;
+      halfway = 0x1000;
+   }
+
+   // A carry out of the mantissa correctly bumps the exponent
+   if ( rest > halfway || ( rest == halfway && ( half & 1 ) ) )
+   {
+      half++;
+   }
+
+   return ( GLhalf ) ( sign | half );
+}
+
+///
+// HalfToFloat()
+//
+static GLfloat HalfToFloat ( GLhalf h )
+{
+   FloatBits bits;
+   GLuint sign = ( GLuint ) ( h & 0x8000 ) << 16;
+   GLuint exponent = ( h >> 10 ) & 0x1F;
+   GLuint mantissa = h & 0x3FF;
+
+   if ( exponent == 0 )
+   {
+      GLfloat f = ldexpf ( ( GLfloat ) mantissa, -24 );
+      return sign ? -f : f;
+   }
+
+   bits.u = sign | ( exponent == 31 ? 0xFF << 23 : ( exponent - 15 + 127 ) << 23 ) | ( mantissa << 13 );
+   return bits.f;
+}
+
+///
+// PackSnorm()
+//
+//    Round f, clamped to [-1, 1], to a signed normalized integer whose
+//    largest value is maxValue
+//
+static int PackSnorm ( GLfloat f, int maxValue )
+{
+   if ( f > 1.0f )
+   {
+      f = 1.0f;
+   }
+   else if ( f < -1.0f )
+   {
+      f = -1.0f;
+   }
+
+   return ( int ) ( f * ( GLfloat ) maxValue + ( f < 0.0f ? -0.5f : 0.5f ) );
+}
+
+///
+// UnpackSnorm()
+//
+//    Decode as GL does for a normalized signed attribute
+//
+static GLfloat UnpackSnorm ( int value, int maxValue )
+{
+   return value < -maxValue ? -1.0f : ( GLfloat ) value / ( GLfloat ) maxValue;
+}
+
+///
+// AttribSlotSize()
+//
+//    Bytes one encoded attribute takes, padded to 4 so every attribute
+//    stays aligned; 0 for an unsupported type
+//
+static int AttribSlotSize ( GLenum type, int components )
+{
+   switch ( type )
+   {
+      case GL_FLOAT:
+         return 4 * components;
+
+      case GL_HALF_FLOAT:
+      case GL_SHORT:
+      case GL_UNSIGNED_SHORT:
+         return ( 2 * components + 3 ) & ~3;
+
+      case GL_INT_2_10_10_10_REV:
+         return components == 3 ? 4 : 0;
+   }
+
+   return 0;
+}
+
+///
+// QuantizeAttrib()
+//
+//    Encode one attribute of every vertex and measure the error of the
+//    decoded values against the source
+//
+static void QuantizeAttrib ( ESQuantizedVertices *result, int attrib, const ESMeshLayout *layout,
+                             const GLubyte *src, GLenum type )
+{
+   int components = ATTRIB_COMPONENTS ( attrib );
+   GLint offset = result->attribs[attrib].offset;
+   GLfloat *scale = result->scale[attrib];
+   GLfloat *bias = result->bias[attrib];
+   GLfloat minValue[3], maxValue[3], invScale[3];
+   double sumSquares = 0.0;
+   GLfloat maxError = 0.0f;
+   GLfloat error;
+   int v, c;
+
+   src += layout->offset[attrib];
+
+   // The 16-bit integer formats cover the bounds of each component
+   for ( c = 0; c < components; c++ )
+   {
+      minValue[c] = maxValue[c] = result->numVertices > 0 ? ( ( const GLfloat * ) src ) [c] : 0.0f;
+   }
+
+   for ( v = 1; v < result->numVertices; v++ )
+   {
+      const GLfloat *in = ( const GLfloat * ) ( src + v * layout->stride );
+
+      for ( c = 0; c < components; c++ )
+      {
+         minValue[c] = in[c] < minValue[c] ? in[c] : minValue[c];
+         maxValue[c] = in[c] > maxValue[c] ? in[c] : maxValue[c];
+      }
+   }
+
+   for ( c = 0; c < 3; c++ )
+   {
+      scale[c] = 1.0f;
+      bias[c] = 0.0f;
+
+      if ( c >= components )
+      {
+         continue;
+      }
+
+      if ( type == GL_SHORT )
+      {
+         scale[c] = ( maxValue[c] - minValue[c] ) * 0.5f;
+         bias[c] = ( maxValue[c] + minValue[c] ) * 0.5f;
+      }
+      else if ( type == GL_UNSIGNED_SHORT )
+      {
+         scale[c] = maxValue[c] - minValue[c];
+         bias[c] = minValue[c];
+      }
+
+      invScale[c] = scale[c] > 0.0f ? 1.0f / scale[c] : 0.0f;
+   }
+
+   for ( v = 0; v < result->numVertices; v++ )
+   {
+      const GLfloat *in = ( const GLfloat * ) ( src + v * layout->stride );
+      GLubyte *dst = ( GLubyte * ) result->vertices + v * result->stride + offset;
+      GLfloat decoded[3];
+      GLfloat squares = 0.0f;
+      GLuint packed = 0;
+
+      for ( c = 0; c < components; c++ )
+      {
+         switch ( type )
+         {
+            case GL_FLOAT:
+               ( ( GLfloat * ) dst ) [c] = in[c];
+               decoded[c] = in[c];
+               break;
+
+            case GL_HALF_FLOAT:
+            {
+               GLhalf h = FloatToHalf ( in[c] );
+
+               ( ( GLhalf * ) dst ) [c] = h;
+               decoded[c] = HalfToFloat ( h );
+               break;
+            }
+
+            case GL_SHORT:
+            {
+               int q = PackSnorm ( ( in[c] - bias[c] ) * invScale[c], 32767 );
+
+               ( ( GLshort * ) dst ) [c] = ( GLshort ) q;
+               decoded[c] = UnpackSnorm ( q, 32767 ) * scale[c] + bias[c];
+               break;
+            }
+
+            case GL_UNSIGNED_SHORT:
+            {
+               GLfloat f = ( in[c] - bias[c] ) * invScale[c];
+               int q = ( int ) ( ( f < 0.0f ? 0.0f : f > 1.0f ? 1.0f : f ) * 65535.0f + 0.5f );
+
+               ( ( GLushort * ) dst ) [c] = ( GLushort ) q;
+               decoded[c] = ( GLfloat ) q / 65535.0f * scale[c] + bias[c];
+               break;
+            }
+
+            case GL_INT_2_10_10_10_REV:
+            {
+               int q = PackSnorm ( in[c], 511 );
+
+               packed |= ( ( GLuint ) q & 0x3FF ) << ( 10 * c );
+               decoded[c] = UnpackSnorm ( q, 511 );
+               break;
+            }
+         }
+
+         error = fabsf ( decoded[c] - in[c] );
+         squares += error * error;
+         maxError = error > maxError ? error : maxError;
+      }
+
+      sumSquares += squares;
+
+      // Fill the whole slot, the destination may be a mapped buffer
+      if ( type == GL_INT_2_10_10_10_REV )
+      {
+         memcpy ( dst, &packed, sizeof ( GLuint ) );
+      }
+      else if ( type != GL_FLOAT && components == 3 )
+      {
+         ( ( GLushort * ) dst ) [3] = 0;
+      }
+   }
+
+   result->maxError[attrib] = maxError;
+   result->rmsError[attrib] = result->numVertices > 0 ?
+                              ( GLfloat ) sqrt ( sumSquares / ( ( double ) result->numVertices * components ) ) : 0.0f;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+//
+/// \brief Re-encode float vertices with smaller attribute types.  GL_SHORT and GL_UNSIGNED_SHORT
+///        are normalized over the bounds of each component, GL_INT_2_10_10_10_REV (positions and
+///        normals only) stores values in [-1, 1] as they are and GL_HALF_FLOAT and GL_FLOAT need
+///        no dequantization.  Each attribute is padded to a multiple of 4 bytes.
+/// \param result Returns the encoded vertices, their glVertexAttribPointer parameters,
+///        dequantization constants and errors
+/// \param layout Layout of the float source, as in an ESMesh
+/// \param vertices Source vertices
+/// \param numVertices Number of vertices
+/// \param types Type of each ES_MESH_* attribute, NULL for GL_SHORT positions,
+///        GL_INT_2_10_10_10_REV normals and GL_UNSIGNED_SHORT texture coordinates
+/// \param memory Where to write the vertices, or NULL, as for esGenSphereMesh
+/// \param memorySize Size of memory in bytes, or NULL to allocate; returns the size needed
+/// \return FALSE if a type is not supported for its attribute, memory is too small
+///         or could not be allocated
+//
+GLboolean ESUTIL_API
+esQuantizeVertices ( ESQuantizedVertices *result, const ESMeshLayout *layout, const GLvoid *vertices,
+                     int numVertices, const GLenum *types, void *memory, GLsizeiptr *memorySize )
+{
+   static const GLenum defaultTypes[ES_MESH_MAX_ATTRIBS] =
+   {
+      GL_SHORT, GL_INT_2_10_10_10_REV, GL_UNSIGNED_SHORT
+   };
+   int attrib;
+
+   memset ( result, 0, sizeof ( ESQuantizedVertices ) );
+
+   if ( types == NULL )
+   {
+      types = defaultTypes;
+   }
+
+   // Attributes are packed in ES_MESH_* order
+   for ( attrib = 0; attrib < ES_MESH_MAX_ATTRIBS; attrib++ )
+   {
+      int slotSize = AttribSlotSize ( types[attrib], ATTRIB_COMPONENTS ( attrib ) );
+
+      result->attribs[attrib].offset = -1;
+
+      if ( layout->offset[attrib] < 0 )
+      {
+         continue;
+      }
+
+      if ( slotSize == 0 )
+      {
+         return FALSE;
+      }
+
+      result->attribs[attrib].size = types[attrib] == GL_INT_2_10_10_10_REV ? 4 : ATTRIB_COMPONENTS ( attrib );
+      result->attribs[attrib].type = types[attrib];
+      result->attribs[attrib].normalized = types[attrib] != GL_FLOAT && types[attrib] != GL_HALF_FLOAT;
+      result->attribs[attrib].offset = result->stride;
+      result->stride += slotSize;
+   }
+
+   result->numVertices = numVertices;
+   result->size = ( GLsizeiptr ) numVertices * result->stride;
+
+   if ( memorySize == NULL )
+   {
+      memory = esMalloc ( result->size );
+
+      if ( memory == NULL )
+      {
+         return FALSE;
+      }
+
+      result->allocated = TRUE;
+   }
+   else
+   {
+      GLsizeiptr available = *memorySize;
+
+      *memorySize = result->size;
+
+      if ( memory == NULL )
+      {
+         return TRUE;
+      }
+
+      if ( available < result->size )
+      {
+         return FALSE;
+      }
+   }
+
+   result->vertices = memory;
+
+   for ( attrib = 0; attrib < ES_MESH_MAX_ATTRIBS; attrib++ )
+   {
+      if ( result->attribs[attrib].offset >= 0 )
+      {
+         QuantizeAttrib ( result, attrib, layout, ( const GLubyte * ) vertices, types[attrib] );
+      }
+   }
+
+   return TRUE;
+}
+
+//
+/// \brief Release vertices allocated by esQuantizeVertices.  Vertices written to caller
+///        memory are only cleared.
+//
+void ESUTIL_API
+esQuantizedVerticesFree ( ESQuantizedVertices *vertices )
+{
+   if ( vertices->allocated )
+   {
+      esFree ( vertices->vertices );
+   }
+
+   memset ( vertices, 0, sizeof ( ESQuantizedVertices ) );
+}
@@ -0,0 +1,367 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESQuat.c
+//
+//    Quaternion and dual-quaternion rotations, with conversion to
+//    ESMatrix/ESAffine and a packed snorm16 form for vertex attributes.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <math.h>
+
+#define PI 3.1415926535897932384626433832795f
+
+/// Above this cosine esQuatSlerp falls back to a normalized lerp
+#define SLERP_NLERP_THRESHOLD   0.9995f
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// QuatMul()
+//
+//    Hamilton product a * b.  May be called with result aliasing a or b.
+//
+static void QuatMul ( ESQuat *result, const ESQuat *a, const ESQuat *b )
+{
+   ESQuat tmp;
+
+   tmp.x = a->w * b->x + a->x * b->w + a->y * b->z - a->z * b->y;
+   tmp.y = a->w * b->y - a->x * b->z + a->y * b->w + a->z * b->x;
+   tmp.z = a->w * b->z + a->x * b->y - a->y * b->x + a->z * b->w;
+   tmp.w = a->w * b->w - a->x * b->x - a->y * b->y - a->z * b->z;
+
+   *result = tmp;
+}
+
+///
+// QuatToRotation()
+//
+//    Rotation part of esQuatToMatrix, rot[i][j] == ESMatrix::m[i][j]
+//
+static void QuatToRotation ( GLfloat rot[3][3], const ESQuat *q )
+{
+   GLfloat x2 = q->x + q->x;
+   GLfloat y2 = q->y + q->y;
+   GLfloat z2 = q->z + q->z;
+   GLfloat xx = q->x * x2, yy = q->y * y2, zz = q->z * z2;
+   GLfloat xy = q->x * y2, yz = q->y * z2, zx = q->z * x2;
+   GLfloat wx = q->w * x2, wy = q->w * y2, wz = q->w * z2;
+
+   rot[0][0] = 1.0f - ( yy + zz );
+   rot[0][1] = xy - wz;
+   rot[0][2] = zx + wy;
+
+   rot[1][0] = xy + wz;
+   rot[1][1] = 1.0f - ( xx + zz );
+   rot[1][2] = yz - wx;
+
+   rot[2][0] = zx - wy;
+   rot[2][1] = yz + wx;
+   rot[2][2] = 1.0f - ( xx + yy );
+}
+
+///
+// PackSnorm16()
+//
+static GLshort PackSnorm16 ( GLfloat f )
+{
+   if ( f > 1.0f )
+   {
+      f = 1.0f;
+   }
+   else if ( f < -1.0f )
+   {
+      f = -1.0f;
+   }
+
+   return ( GLshort ) floorf ( f * 32767.0f + 0.5f );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+void ESUTIL_API
+esQuatLoadIdentity ( ESQuat *result )
+{
+   result->x = result->y = result->z = 0.0f;
+   result->w = 1.0f;
+}
+
+void ESUTIL_API
+esQuatFromAxisAngle ( ESQuat *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
+{
+   GLfloat mag = sqrtf ( x * x + y * y + z * z );
+   GLfloat halfAngle = angle * PI / 360.0f;
+   GLfloat s;
+
+   if ( mag <= 0.0f )
+   {
+      esQuatLoadIdentity ( result );
+      return;
+   }
+
+   s = sinf ( halfAngle ) / mag;
+
+   result->x = x * s;
+   result->y = y * s;
+   result->z = z * s;
+   result->w = cosf ( halfAngle );
+}
+
+void ESUTIL_API
+esQuatMultiply ( ESQuat *result, const ESQuat *srcA, const ESQuat *srcB )
+{
+   QuatMul ( result, srcA, srcB );
+}
+
+void ESUTIL_API
+esQuatConjugate ( ESQuat *result, const ESQuat *src )
+{
+   result->x = -src->x;
+   result->y = -src->y;
+   result->z = -src->z;
+   result->w = src->w;
+}
+
+void ESUTIL_API
+esQuatNormalize ( ESQuat *result, const ESQuat *src )
+{
+   GLfloat lenSq = src->x * src->x + src->y * src->y + src->z * src->z + src->w * src->w;
+
+   if ( lenSq > 0.0f )
+   {
+      GLfloat invLen = 1.0f / sqrtf ( lenSq );
+
+      result->x = src->x * invLen;
+      result->y = src->y * invLen;
+      result->z = src->z * invLen;
+      result->w = src->w * invLen;
+   }
+   else
+   {
+      esQuatLoadIdentity ( result );
+   }
+}
+
+void ESUTIL_API
+esQuatNlerp ( ESQuat *result, const ESQuat *srcA, const ESQuat *srcB, GLfloat t )
+{
+   GLfloat dot = srcA->x * srcB->x + srcA->y * srcB->y + srcA->z * srcB->z + srcA->w * srcB->w;
+   GLfloat tb = dot < 0.0f ? -t : t;
+   GLfloat ta = 1.0f - t;
+   ESQuat  tmp;
+
+   // q and -q are the same rotation, blend towards whichever is closer
+   tmp.x = srcA->x * ta + srcB->x * tb;
+   tmp.y = srcA->y * ta + srcB->y * tb;
+   tmp.z = srcA->z * ta + srcB->z * tb;
+   tmp.w = srcA->w * ta + srcB->w * tb;
+
+   esQuatNormalize ( result, &tmp );
+}
+
+void ESUTIL_API
+esQuatSlerp ( ESQuat *result, const ESQuat *srcA, const ESQuat *srcB, GLfloat t )
+{
+   GLfloat dot = srcA->x * srcB->x + srcA->y * srcB->y + srcA->z * srcB->z + srcA->w * srcB->w;
+   GLfloat sign = 1.0f;
+   GLfloat theta, sinTheta, ta, tb;
+
+   if ( dot < 0.0f )
+   {
+      dot = -dot;
+      sign = -1.0f;
+   }
+
+   if ( dot > SLERP_NLERP_THRESHOLD )
+   {
+      // Nearly parallel, sin ( theta ) is too small to divide by
+      esQuatNlerp ( result, srcA, srcB, t );
+      return;
+   }
+
+   theta = acosf ( dot );
+   sinTheta = sinf ( theta );
+   ta = sinf ( ( 1.0f - t ) * theta ) / sinTheta;
+   tb = sign * sinf ( t * theta ) / sinTheta;
+
+   result->x = srcA->x * ta + srcB->x * tb;
+   result->y = srcA->y * ta + srcB->y * tb;
+   result->z = srcA->z * ta + srcB->z * tb;
+   result->w = srcA->w * ta + srcB->w * tb;
+}
+
+void ESUTIL_API
+esQuatToMatrix ( ESMatrix *result, const ESQuat *src )
+{
+   GLfloat rot[3][3];
+   int     i;
+
+   QuatToRotation ( rot, src );
+
+   for ( i = 0; i < 3; i++ )
+   {
+      result->m[i][0] = rot[i][0];
+      result->m[i][1] = rot[i][1];
+      result->m[i][2] = rot[i][2];
+      result->m[i][3] = 0.0f;
+   }
+
+   result->m[3][0] = 0.0f;
+   result->m[3][1] = 0.0f;
+   result->m[3][2] = 0.0f;
+   result->m[3][3] = 1.0f;
+}
+
+void ESUTIL_API
+esQuatToAffine ( ESAffine *result, const ESQuat *src )
+{
+   GLfloat rot[3][3];
+   int     i;
+
+   QuatToRotation ( rot, src );
+
+   // ESAffine is stored transposed
+   for ( i = 0; i < 3; i++ )
+   {
+      result->m[i][0] = rot[0][i];
+      result->m[i][1] = rot[1][i];
+      result->m[i][2] = rot[2][i];
+      result->m[i][3] = 0.0f;
+   }
+}
+
+void ESUTIL_API
+esQuatTransformVector ( const ESQuat *src, const GLfloat in[3], GLfloat out[3] )
+{
+   // out = q^-1 * in * q, expanded as in + w * t + cross ( -v, t ) with t = 2 * cross ( -v, in )
+   GLfloat vx = -src->x, vy = -src->y, vz = -src->z;
+   GLfloat tx = 2.0f * ( vy * in[2] - vz * in[1] );
+   GLfloat ty = 2.0f * ( vz * in[0] - vx * in[2] );
+   GLfloat tz = 2.0f * ( vx * in[1] - vy * in[0] );
+   GLfloat x = in[0] + src->w * tx + ( vy * tz - vz * ty );
+   GLfloat y = in[1] + src->w * ty + ( vz * tx - vx * tz );
+   GLfloat z = in[2] + src->w * tz + ( vx * ty - vy * tx );
+
+   out[0] = x;
+   out[1] = y;
+   out[2] = z;
+}
+
+void ESUTIL_API
+esQuatPack ( ESQuatPacked *result, const ESQuat *src )
+{
+   result->x = PackSnorm16 ( src->x );
+   result->y = PackSnorm16 ( src->y );
+   result->z = PackSnorm16 ( src->z );
+   result->w = PackSnorm16 ( src->w );
+}
+
+void ESUTIL_API
+esQuatUnpack ( ESQuat *result, const ESQuatPacked *src )
+{
+   ESQuat tmp;
+
+   // Same decode as a normalized GL_SHORT attribute, then undo the quantization error
+   tmp.x = src->x < -32767 ? -1.0f : src->x / 32767.0f;
+   tmp.y = src->y < -32767 ? -1.0f : src->y / 32767.0f;
+   tmp.z = src->z < -32767 ? -1.0f : src->z / 32767.0f;
+   tmp.w = src->w < -32767 ? -1.0f : src->w / 32767.0f;
+
+   esQuatNormalize ( result, &tmp );
+}
+
+void ESUTIL_API
+esDualQuatFromRotationTranslation ( ESDualQuat *result, const ESQuat *rotation, GLfloat tx, GLfloat ty, GLfloat tz )
+{
+   ESQuat t;
+
+   t.x = 0.5f * tx;
+   t.y = 0.5f * ty;
+   t.z = 0.5f * tz;
+   t.w = 0.0f;
+
+   result->real = *rotation;
+   QuatMul ( &result->dual, rotation, &t );
+}
+
+void ESUTIL_API
+esDualQuatMultiply ( ESDualQuat *result, const ESDualQuat *srcA, const ESDualQuat *srcB )
+{
+   ESQuat real, ad, bc;
+
+   // ( A + eB ) ( C + eD ) = AC + e ( AD + BC )
+   QuatMul ( &real, &srcA->real, &srcB->real );
+   QuatMul ( &ad, &srcA->real, &srcB->dual );
+   QuatMul ( &bc, &srcA->dual, &srcB->real );
+
+   result->real = real;
+   result->dual.x = ad.x + bc.x;
+   result->dual.y = ad.y + bc.y;
+   result->dual.z = ad.z + bc.z;
+   result->dual.w = ad.w + bc.w;
+}
+
+void ESUTIL_API
+esDualQuatToAffine ( ESAffine *result, const ESDualQuat *src )
+{
+   ESQuat conj, t;
+
+   esQuatToAffine ( result, &src->real );
+
+   // translation = 2 * conj ( real ) * dual
+   esQuatConjugate ( &conj, &src->real );
+   QuatMul ( &t, &conj, &src->dual );
+
+   result->m[0][3] = 2.0f * t.x;
+   result->m[1][3] = 2.0f * t.y;
+   result->m[2][3] = 2.0f * t.z;
+}
+
+void ESUTIL_API
+esDualQuatToMatrix ( ESMatrix *result, const ESDualQuat *src )
+{
+   ESAffine affine;
+
+   esDualQuatToAffine ( &affine, src );
+   esAffineToMatrix ( result, &affine );
+}
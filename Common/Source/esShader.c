@@ -91,12 +91,12 @@ GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc )
 
       if ( infoLen > 1 )
       {
-         char *infoLog = malloc ( sizeof ( char ) * infoLen );
+         char *infoLog = esMalloc ( sizeof ( char ) * infoLen );
 
          glGetShaderInfoLog ( shader, infoLen, NULL, infoLog );
          esLogMessage ( "Error compiling shader:\n%s\n", infoLog );
 
-         free ( infoLog );
+         esFree ( infoLog );
       }
 
       glDeleteShader ( shader );
@@ -164,12 +164,12 @@ GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragSha
 
       if ( infoLen > 1 )
       {
-         char *infoLog = malloc ( sizeof ( char ) * infoLen );
+         char *infoLog = esMalloc ( sizeof ( char ) * infoLen );
 
          glGetProgramInfoLog ( programObject, infoLen, NULL, infoLog );
          esLogMessage ( "Error linking program:\n%s\n", infoLog );
 
-         free ( infoLog );
+         esFree ( infoLog );
       }
 
       glDeleteProgram ( programObject );
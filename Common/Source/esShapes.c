@@ -38,6 +38,8 @@
 //  Includes
 //
 #include "esUtil.h"
+#include "esUtil_simd.h"
+#include "esUtil_thread.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -47,12 +49,1090 @@
 //
 #define ES_PI  (3.14159265f)
 
+/// Quads per band when ES_SHAPE_OPTIMIZE_VERTEX_CACHE is set: the widest band
+/// whose upper row is still in a FIFO cache of ES_VERTEX_CACHE_SIZE entries when
+/// the next row reuses it (ACMR about 0.59 against 1.0 for whole rows)
+#define GRID_BAND_WIDTH  ( ES_VERTEX_CACHE_SIZE / 2 - 2 )
+
+/// Bands are walked over blocks of rows spanning at most this many vertices,
+/// so esSplitIndices16 can turn each block into a single submesh
+#define GRID_BLOCK_VERTICES  65535
+
+/// Smallest number of sphere vertices handed to a worker thread
+#define SPHERE_MIN_VERTICES_PER_THREAD   16384
+
+/// Pole rows of a QuadGridIndices() grid
+#define SHAPE_POLE_TOP      1
+#define SHAPE_POLE_BOTTOM   2
+
+/// Most subdivisions of an icosphere, 20 * 4^8 triangles
+#define ICOSPHERE_MAX_SUBDIVISIONS   8
+
+///
+//  Types
+//
+typedef struct
+{
+   int            numSlices;
+   float          radius;
+   float          angleStep;
+   /// Per column sin, cos and texture s
+   const GLfloat *sinPhi;
+   const GLfloat *cosPhi;
+   const GLfloat *texS;
+   GLfloat       *positions;
+   int            positionStride;
+   GLfloat       *normals;
+   int            normalStride;
+   GLfloat       *texCoords;
+   int            texCoordStride;
+} SphereJob;
+
+/// Tessellation of one level of detail of a parametric shape
+typedef struct
+{
+   /// Slices around the axis, or subdivisions for an icosphere
+   int   slices;
+   int   rings;
+   int   numVertices;
+   int   numIndices;
+} ShapeLevel;
+
+/// Parametric shape and its chain of levels of detail
+typedef struct
+{
+   float       radius;
+   float       radius2;
+   float       height;
+   int         numLevels;
+   ShapeLevel  levels[ES_MESH_MAX_LODS];
+} Shape;
+
+/// Writes one level of a shape, vertices from firstVertex on and indices from indices on
+typedef void ( *ShapeGen ) ( const Shape *shape, const ShapeLevel *level, ESMesh *mesh,
+                             int firstVertex, GLuint *indices );
+
+///
+//  Globals
+//
+
+/// esGenCube geometry, 4 vertices per face
+static const GLfloat cubeVerts[] =
+{
+   -0.5f, -0.5f, -0.5f,
+   -0.5f, -0.5f,  0.5f,
+   0.5f, -0.5f,  0.5f,
+   0.5f, -0.5f, -0.5f,
+   -0.5f,  0.5f, -0.5f,
+   -0.5f,  0.5f,  0.5f,
+   0.5f,  0.5f,  0.5f,
+   0.5f,  0.5f, -0.5f,
+   -0.5f, -0.5f, -0.5f,
+   -0.5f,  0.5f, -0.5f,
+   0.5f,  0.5f, -0.5f,
+   0.5f, -0.5f, -0.5f,
+   -0.5f, -0.5f, 0.5f,
+   -0.5f,  0.5f, 0.5f,
+   0.5f,  0.5f, 0.5f,
+   0.5f, -0.5f, 0.5f,
+   -0.5f, -0.5f, -0.5f,
+   -0.5f, -0.5f,  0.5f,
+   -0.5f,  0.5f,  0.5f,
+   -0.5f,  0.5f, -0.5f,
+   0.5f, -0.5f, -0.5f,
+   0.5f, -0.5f,  0.5f,
+   0.5f,  0.5f,  0.5f,
+   0.5f,  0.5f, -0.5f,
+};
+
+static const GLfloat cubeNormals[] =
+{
+   0.0f, -1.0f, 0.0f,
+   0.0f, -1.0f, 0.0f,
+   0.0f, -1.0f, 0.0f,
+   0.0f, -1.0f, 0.0f,
+   0.0f, 1.0f, 0.0f,
+   0.0f, 1.0f, 0.0f,
+   0.0f, 1.0f, 0.0f,
+   0.0f, 1.0f, 0.0f,
+   0.0f, 0.0f, -1.0f,
+   0.0f, 0.0f, -1.0f,
+   0.0f, 0.0f, -1.0f,
+   0.0f, 0.0f, -1.0f,
+   0.0f, 0.0f, 1.0f,
+   0.0f, 0.0f, 1.0f,
+   0.0f, 0.0f, 1.0f,
+   0.0f, 0.0f, 1.0f,
+   -1.0f, 0.0f, 0.0f,
+   -1.0f, 0.0f, 0.0f,
+   -1.0f, 0.0f, 0.0f,
+   -1.0f, 0.0f, 0.0f,
+   1.0f, 0.0f, 0.0f,
+   1.0f, 0.0f, 0.0f,
+   1.0f, 0.0f, 0.0f,
+   1.0f, 0.0f, 0.0f,
+};
+
+static const GLfloat cubeTex[] =
+{
+   0.0f, 0.0f,
+   0.0f, 1.0f,
+   1.0f, 1.0f,
+   1.0f, 0.0f,
+   1.0f, 0.0f,
+   1.0f, 1.0f,
+   0.0f, 1.0f,
+   0.0f, 0.0f,
+   0.0f, 0.0f,
+   0.0f, 1.0f,
+   1.0f, 1.0f,
+   1.0f, 0.0f,
+   0.0f, 0.0f,
+   0.0f, 1.0f,
+   1.0f, 1.0f,
+   1.0f, 0.0f,
+   0.0f, 0.0f,
+   0.0f, 1.0f,
+   1.0f, 1.0f,
+   1.0f, 0.0f,
+   0.0f, 0.0f,
+   0.0f, 1.0f,
+   1.0f, 1.0f,
+   1.0f, 0.0f,
+};
+
+static const GLuint cubeIndices[] =
+{
+   0, 2, 1,
+   0, 3, 2,
+   4, 5, 6,
+   4, 6, 7,
+   8, 9, 10,
+   8, 10, 11,
+   12, 15, 14,
+   12, 14, 13,
+   16, 17, 18,
+   16, 18, 19,
+   20, 23, 22,
+   20, 22, 21
+};
+
+/// Icosahedron with edges of length 2, corners ( 0, +-1, +-phi ) and their rotations
+static const GLfloat icosahedronVerts[12][3] =
+{
+   { -1.0f,  1.618034f,  0.0f }, {  1.0f,  1.618034f,  0.0f },
+   { -1.0f, -1.618034f,  0.0f }, {  1.0f, -1.618034f,  0.0f },
+   {  0.0f, -1.0f,  1.618034f }, {  0.0f,  1.0f,  1.618034f },
+   {  0.0f, -1.0f, -1.618034f }, {  0.0f,  1.0f, -1.618034f },
+   {  1.618034f,  0.0f, -1.0f }, {  1.618034f,  0.0f,  1.0f },
+   { -1.618034f,  0.0f, -1.0f }, { -1.618034f,  0.0f,  1.0f }
+};
+
+/// Icosahedron faces, counter-clockwise seen from outside
+static const GLubyte icosahedronFaces[20][3] =
+{
+   { 0, 11,  5 }, { 0,  5,  1 }, { 0,  1,  7 }, { 0,  7, 10 }, { 0, 10, 11 },
+   { 1,  5,  9 }, { 5, 11,  4 }, { 11, 10, 2 }, { 10, 7,  6 }, { 7,  1,  8 },
+   { 3,  9,  4 }, { 3,  4,  2 }, { 3,  2,  6 }, { 3,  6,  8 }, { 3,  8,  9 },
+   { 4,  9,  5 }, { 2,  4, 11 }, { 6,  2, 10 }, { 8,  6,  7 }, { 9,  8,  1 }
+};
+
 //////////////////////////////////////////////////////////////////
 //
-//  Private Functions
+//  Private Functions
+//
+//
+
+///
+// GridBandWidth()
+//
+//    Quads per band for a grid numColumns quads wide.  Indices are emitted
+//    band by band, each band row by row, so neighbouring rows share cached
+//    vertices; without ES_SHAPE_OPTIMIZE_VERTEX_CACHE the whole row is one band.
+//
+static int GridBandWidth ( int numColumns, GLuint flags )
+{
+   if ( ( flags & ES_SHAPE_OPTIMIZE_VERTEX_CACHE ) && numColumns > GRID_BAND_WIDTH )
+   {
+      return GRID_BAND_WIDTH;
+   }
+
+   return numColumns;
+}
+
+///
+// SpherePoles()
+//
+//    SHAPE_POLE_* rows whose folded triangles esGenSphere leaves out: none unless
+//    ES_SHAPE_NO_DEGENERATES is set for GL_TRIANGLES.  The last row only reaches
+//    the south pole when numSlices is even.
+//
+static int SpherePoles ( int numSlices, GLuint flags )
+{
+   if ( ( flags & ( ES_SHAPE_NO_DEGENERATES | ES_SHAPE_TRIANGLE_STRIP ) ) != ES_SHAPE_NO_DEGENERATES )
+   {
+      return 0;
+   }
+
+   return SHAPE_POLE_TOP | ( numSlices % 2 == 0 ? SHAPE_POLE_BOTTOM : 0 );
+}
+
+///
+// GridIndexCount()
+//
+//    Number of indices GenGridIndices() writes
+//
+static int GridIndexCount ( int rows, int columns, int mirror, int poles, GLuint flags )
+{
+   int bandWidth = GridBandWidth ( columns, flags );
+   int numStrips = rows * ( ( columns + bandWidth - 1 ) / bandWidth );
+
+   if ( ( flags & ES_SHAPE_TRIANGLE_STRIP ) == 0 )
+   {
+      // One triangle per quad less in each pole row
+      return rows * columns * 6 - ( ( poles & SHAPE_POLE_TOP ) ? 3 * columns : 0 ) -
+             ( ( poles & SHAPE_POLE_BOTTOM ) ? 3 * columns : 0 );
+   }
+
+   if ( numStrips == 0 )
+   {
+      return 0;
+   }
+
+   // Each strip has two indices per quad plus two to close it, one more when
+   // mirrored, and strips are separated by a restart index
+   return 2 * rows * columns + ( 2 + mirror + 1 ) * numStrips - 1;
+}
+
+///
+// GenGridIndices()
+//
+//    Indices for a grid of rows x columns quads whose vertex ( i, j ) is
+//    i * ( columns + 1 ) + j, each quad split along its ( i, j ) - ( i + 1, j + 1 )
+//    diagonal.  mirror reverses the winding.  With ES_SHAPE_TRIANGLE_STRIP each
+//    band row is one strip and strips are separated by ES_PRIMITIVE_RESTART_INDEX.
+//    Otherwise the triangles a SHAPE_POLE_* row folds to a point are left out.
+//
+static void GenGridIndices ( GLuint *indices, int rows, int columns, int mirror, int poles, GLuint flags )
+{
+   int bandWidth = GridBandWidth ( columns, flags );
+   int blockRows = GRID_BLOCK_VERTICES / ( columns + 1 ) - 1;
+   int strip = ( flags & ES_SHAPE_TRIANGLE_STRIP ) != 0;
+   GLuint *first = indices;
+   int block, band, i, j;
+
+   if ( blockRows < 1 || bandWidth == columns )
+   {
+      // Whole rows already cover consecutive vertices
+      blockRows = rows > 0 ? rows : 1;
+   }
+
+   for ( block = 0; block < rows; block += blockRows )
+   {
+      int blockEnd = block + blockRows < rows ? block + blockRows : rows;
+
+      for ( band = 0; band < columns; band += bandWidth )
+      {
+         int bandEnd = band + bandWidth < columns ? band + bandWidth : columns;
+
+         for ( i = block; i < blockEnd; i++ )
+         {
+            GLuint top = i * ( columns + 1 );
+            GLuint bottom = top + columns + 1;
+
+            if ( strip )
+            {
+               if ( indices != first )
+               {
+                  *indices++ = ES_PRIMITIVE_RESTART_INDEX;
+               }
+
+               // A leading degenerate triangle makes the real ones start on odd
+               // positions, which flips the winding of the whole strip
+               if ( mirror )
+               {
+                  *indices++ = bottom + band;
+               }
+
+               for ( j = band; j <= bandEnd; j++ )
+               {
+                  *indices++ = bottom + j;
+                  *indices++ = top + j;
+               }
+            }
+            else
+            {
+               for ( j = band; j < bandEnd; j++ )
+               {
+                  // two triangles per quad
+                  GLuint a = top + j, b = top + j + 1, c = bottom + j + 1, d = bottom + j;
+
+                  if ( !( ( poles & SHAPE_POLE_BOTTOM ) && i == rows - 1 ) )
+                  {
+                     *indices++ = a;
+                     *indices++ = mirror ? d : b;
+                     *indices++ = c;
+                  }
+
+                  if ( !( ( poles & SHAPE_POLE_TOP ) && i == 0 ) )
+                  {
+                     *indices++ = a;
+                     *indices++ = c;
+                     *indices++ = mirror ? b : d;
+                  }
+               }
+            }
+         }
+      }
+   }
+}
+
+///
+// GridMode()
+//
+//    Primitive mode of GenGridIndices() output
+//
+static GLenum GridMode ( GLuint flags )
+{
+   return ( flags & ES_SHAPE_TRIANGLE_STRIP ) ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+}
+
+///
+// SphereRows()
+//
+//    esParallelFor callback, the vertices of sphere rows [begin, end).  Each
+//    vertex multiplies the row's sin and cos by the column tables, in the
+//    same order as sinf and cosf were once evaluated per vertex.
+//
+static void SphereRows ( void *context, int begin, int end )
+{
+   const SphereJob *job = ( const SphereJob * ) context;
+   int numColumns = job->numSlices + 1;
+   int numParallels = job->numSlices / 2;
+   int i, j, k;
+
+   for ( i = begin; i < end; i++ )
+   {
+      // sinf ( ES_PI ) is not 0; make the south pole a single point
+      GLfloat ringRadius = 2 * i == job->numSlices ? 0.0f : job->radius * sinf ( job->angleStep * ( float ) i );
+      GLfloat y = job->radius * cosf ( job->angleStep * ( float ) i );
+      GLfloat normalY = y / job->radius;
+      GLfloat texT = ( 1.0f - ( float ) i ) / ( float ) ( numParallels - 1 );
+#if defined ( ES_SIMD )
+      esVec4 ring = esVec4Splat ( ringRadius );
+      esVec4 radius = esVec4Splat ( job->radius );
+#endif
+
+      for ( j = 0; j < numColumns; j += 4 )
+      {
+         int vertex = i * numColumns + j;
+         int count = numColumns - j < 4 ? numColumns - j : 4;
+         GLfloat x[4], z[4], normalX[4], normalZ[4];
+
+#if defined ( ES_SIMD )
+         esVec4 vx = esVec4Mul ( ring, esVec4Load ( job->sinPhi + j ) );
+         esVec4 vz = esVec4Mul ( ring, esVec4Load ( job->cosPhi + j ) );
+
+         esVec4Store ( x, vx );
+         esVec4Store ( z, vz );
+         esVec4Store ( normalX, esVec4Div ( vx, radius ) );
+         esVec4Store ( normalZ, esVec4Div ( vz, radius ) );
+#else
+         for ( k = 0; k < 4; k++ )
+         {
+            x[k] = ringRadius * job->sinPhi[j + k];
+            z[k] = ringRadius * job->cosPhi[j + k];
+            normalX[k] = x[k] / job->radius;
+            normalZ[k] = z[k] / job->radius;
+         }
+#endif
+
+         for ( k = 0; k < count; k++ )
+         {
+            if ( job->positions )
+            {
+               GLfloat *position = job->positions + ( vertex + k ) * job->positionStride;
+               position[0] = x[k];
+               position[1] = y;
+               position[2] = z[k];
+            }
+
+            if ( job->normals )
+            {
+               GLfloat *normal = job->normals + ( vertex + k ) * job->normalStride;
+               normal[0] = normalX[k];
+               normal[1] = normalY;
+               normal[2] = normalZ[k];
+            }
+
+            if ( job->texCoords )
+            {
+               GLfloat *texCoord = job->texCoords + ( vertex + k ) * job->texCoordStride;
+               texCoord[0] = job->texS[j + k];
+               texCoord[1] = texT;
+            }
+         }
+      }
+   }
+}
+
+///
+// GenSphereVertices()
+//
+//    Vertices for esGenSphere.  Any array may be NULL; strides are in floats.
+//    The column sin/cos tables are built once and the rows are split across
+//    threads.  Returns FALSE if the tables could not be allocated.
+//
+static GLboolean GenSphereVertices ( int numSlices, float radius, GLfloat *positions, int positionStride,
+                                     GLfloat *normals, int normalStride, GLfloat *texCoords, int texCoordStride )
+{
+   SphereJob job;
+   int numColumns = numSlices + 1;
+   int tableSize = ( numColumns + 3 ) & ~3;
+   int minRows = SPHERE_MIN_VERTICES_PER_THREAD / numColumns;
+   GLfloat *tables;
+   int j;
+
+   // Padded to whole groups of four so the SIMD loop can read past the last column
+   tables = esCalloc ( 3 * tableSize, sizeof ( GLfloat ) );
+
+   if ( tables == NULL )
+   {
+      return FALSE;
+   }
+
+   job.numSlices = numSlices;
+   job.radius = radius;
+   job.angleStep = ( 2.0f * ES_PI ) / ( ( float ) numSlices );
+   job.sinPhi = tables;
+   job.cosPhi = tables + tableSize;
+   job.texS = tables + 2 * tableSize;
+   job.positions = positions;
+   job.positionStride = positionStride;
+   job.normals = normals;
+   job.normalStride = normalStride;
+   job.texCoords = texCoords;
+   job.texCoordStride = texCoordStride;
+
+   for ( j = 0; j < numColumns; j++ )
+   {
+      tables[j] = sinf ( job.angleStep * ( float ) j );
+      tables[tableSize + j] = cosf ( job.angleStep * ( float ) j );
+      tables[2 * tableSize + j] = ( float ) j / ( float ) numSlices;
+   }
+
+   esParallelFor ( numSlices / 2 + 1, minRows > 0 ? minRows : 1, SphereRows, &job );
+
+   esFree ( tables );
+   return TRUE;
+}
+
+///
+// GenCubeVertices()
+//
+//    Vertices for esGenCube.  Any array may be NULL; strides are in floats.
+//
+static void GenCubeVertices ( float scale, GLfloat *positions, int positionStride,
+                              GLfloat *normals, int normalStride, GLfloat *texCoords, int texCoordStride )
+{
+   int i;
+
+   for ( i = 0; i < 24; i++ )
+   {
+      if ( positions )
+      {
+         GLfloat *position = positions + i * positionStride;
+         position[0] = cubeVerts[i * 3 + 0] * scale;
+         position[1] = cubeVerts[i * 3 + 1] * scale;
+         position[2] = cubeVerts[i * 3 + 2] * scale;
+      }
+
+      if ( normals )
+      {
+         memcpy ( normals + i * normalStride, &cubeNormals[i * 3], 3 * sizeof ( GLfloat ) );
+      }
+
+      if ( texCoords )
+      {
+         memcpy ( texCoords + i * texCoordStride, &cubeTex[i * 2], 2 * sizeof ( GLfloat ) );
+      }
+   }
+}
+
+///
+// GenGridVertices()
+//
+//    Vertices for esGenSquareGrid, with the normal of the side the triangles
+//    face and the position as texture coordinate.  Any array may be NULL;
+//    strides are in floats.
+//
+static void GenGridVertices ( int size, GLfloat *positions, int positionStride,
+                              GLfloat *normals, int normalStride, GLfloat *texCoords, int texCoordStride )
+{
+   int i, j;
+   float stepSize = ( float ) size - 1;
+
+   for ( i = 0; i < size; ++i ) // row
+   {
+      for ( j = 0; j < size; ++j ) // column
+      {
+         int vertex = j + i * size;
+
+         if ( positions )
+         {
+            GLfloat *position = positions + vertex * positionStride;
+            position[0] = i / stepSize;
+            position[1] = j / stepSize;
+            position[2] = 0.0f;
+         }
+
+         if ( normals )
+         {
+            GLfloat *normal = normals + vertex * normalStride;
+            normal[0] = 0.0f;
+            normal[1] = 0.0f;
+            normal[2] = -1.0f;
+         }
+
+         if ( texCoords )
+         {
+            GLfloat *texCoord = texCoords + vertex * texCoordStride;
+            texCoord[0] = i / stepSize;
+            texCoord[1] = j / stepSize;
+         }
+      }
+   }
+}
+
+///
+// MeshBegin()
+//
+//    Check the layout, size the mesh and find or allocate its block as
+//    described for esGenSphereMesh.  On success mesh->vertices is NULL if
+//    the mesh was only sized.
+//
+static GLboolean MeshBegin ( ESMesh *mesh, const ESMeshLayout *layout, GLenum mode, int numVertices,
+                             int numIndices, void *memory, GLsizeiptr *memorySize )
+{
+   static const int attribSize[ES_MESH_MAX_ATTRIBS] =
+   {
+      3 * sizeof ( GLfloat ), 3 * sizeof ( GLfloat ), 2 * sizeof ( GLfloat )
+   };
+   int i;
+
+   memset ( mesh, 0, sizeof ( ESMesh ) );
+
+   if ( layout->stride <= 0 || layout->stride % 4 != 0 )
+   {
+      return FALSE;
+   }
+
+   for ( i = 0; i < ES_MESH_MAX_ATTRIBS; i++ )
+   {
+      GLint offset = layout->offset[i];
+
+      if ( offset != -1 && ( offset < 0 || offset % 4 != 0 || offset + attribSize[i] > layout->stride ) )
+      {
+         return FALSE;
+      }
+   }
+
+   mesh->layout = *layout;
+   mesh->mode = mode;
+   mesh->numVertices = numVertices;
+   mesh->numIndices = numIndices;
+   mesh->indexOffset = ( GLsizeiptr ) numVertices * layout->stride;
+   mesh->size = mesh->indexOffset + ( GLsizeiptr ) numIndices * sizeof ( GLuint );
+   mesh->numLods = 1;
+   mesh->lods[0].numIndices = numIndices;
+   mesh->lods[0].numVertices = numVertices;
+
+   if ( memorySize == NULL )
+   {
+      memory = esMalloc ( mesh->size );
+
+      if ( memory == NULL )
+      {
+         return FALSE;
+      }
+
+      mesh->allocated = TRUE;
+   }
+   else
+   {
+      GLsizeiptr available = *memorySize;
+
+      *memorySize = mesh->size;
+
+      if ( memory == NULL )
+      {
+         return TRUE;
+      }
+
+      if ( available < mesh->size )
+      {
+         return FALSE;
+      }
+   }
+
+   mesh->vertices = memory;
+   mesh->indices = ( GLuint * ) ( ( GLubyte * ) memory + mesh->indexOffset );
+   return TRUE;
+}
+
+///
+// MeshAttrib()
+//
+//    First element of an attribute in the mesh block, NULL if the layout leaves it out
+//
+static GLfloat *MeshAttrib ( ESMesh *mesh, int attrib )
+{
+   if ( mesh->layout.offset[attrib] < 0 )
+   {
+      return NULL;
+   }
+
+   return ( GLfloat * ) ( ( GLubyte * ) mesh->vertices + mesh->layout.offset[attrib] );
+}
+
+///
+// MeshBound()
+//
+//    Set the bounding sphere of the whole mesh
+//
+static void MeshBound ( ESMesh *mesh, GLfloat x, GLfloat y, GLfloat z, GLfloat radius )
+{
+   mesh->lods[0].center[0] = x;
+   mesh->lods[0].center[1] = y;
+   mesh->lods[0].center[2] = z;
+   mesh->lods[0].radius = radius;
+}
+
+///
+// MeshVertex()
+//
+//    Write the attributes of a vertex the layout holds
+//
+static void MeshVertex ( ESMesh *mesh, int vertex, GLfloat x, GLfloat y, GLfloat z,
+                         GLfloat nx, GLfloat ny, GLfloat nz, GLfloat s, GLfloat t )
+{
+   GLubyte *base = ( GLubyte * ) mesh->vertices + ( GLsizeiptr ) vertex * mesh->layout.stride;
+   GLfloat *attrib;
+
+   if ( mesh->layout.offset[ES_MESH_POSITION] >= 0 )
+   {
+      attrib = ( GLfloat * ) ( base + mesh->layout.offset[ES_MESH_POSITION] );
+      attrib[0] = x;
+      attrib[1] = y;
+      attrib[2] = z;
+   }
+
+   if ( mesh->layout.offset[ES_MESH_NORMAL] >= 0 )
+   {
+      attrib = ( GLfloat * ) ( base + mesh->layout.offset[ES_MESH_NORMAL] );
+      attrib[0] = nx;
+      attrib[1] = ny;
+      attrib[2] = nz;
+   }
+
+   if ( mesh->layout.offset[ES_MESH_TEXCOORD] >= 0 )
+   {
+      attrib = ( GLfloat * ) ( base + mesh->layout.offset[ES_MESH_TEXCOORD] );
+      attrib[0] = s;
+      attrib[1] = t;
+   }
+}
+
+///
+// QuadGridIndices()
+//
+//    GL_TRIANGLES indices for rows x columns quads whose vertex ( i, j ) is
+//    first + i * ( columns + 1 ) + j, with rows running down the surface and
+//    columns around it.  The triangles a pole row would fold to a point are
+//    left out.  Returns the end of the indices written.
+//
+static GLuint *QuadGridIndices ( GLuint *indices, int first, int rows, int columns, int poles )
+{
+   int i, j;
+
+   for ( i = 0; i < rows; i++ )
+   {
+      GLuint top = first + i * ( columns + 1 );
+      GLuint bottom = top + columns + 1;
+
+      for ( j = 0; j < columns; j++ )
+      {
+         GLuint a = top + j, b = top + j + 1, c = bottom + j + 1, d = bottom + j;
+
+         if ( !( ( poles & SHAPE_POLE_BOTTOM ) && i == rows - 1 ) )
+         {
+            *indices++ = a;
+            *indices++ = d;
+            *indices++ = c;
+         }
+
+         if ( !( ( poles & SHAPE_POLE_TOP ) && i == 0 ) )
+         {
+            *indices++ = a;
+            *indices++ = c;
+            *indices++ = b;
+         }
+      }
+   }
+
+   return indices;
+}
+
+///
+// FanIndices()
+//
+//    GL_TRIANGLES indices for a disc of numSlices triangles around center,
+//    whose rim vertices follow from rim on.  reverse flips the facing.
+//    Returns the end of the indices written.
+//
+static GLuint *FanIndices ( GLuint *indices, int center, int rim, int numSlices, int reverse )
+{
+   int j;
+
+   for ( j = 0; j < numSlices; j++ )
+   {
+      *indices++ = center;
+      *indices++ = rim + ( reverse ? j + 1 : j );
+      *indices++ = rim + ( reverse ? j : j + 1 );
+   }
+
+   return indices;
+}
+
+///
+// ShapeLevels()
+//
+//    Fill in the tessellation of up to numLods levels, each halving slices
+//    and rings down to minimum.  The chain stops early once a level would
+//    repeat the one before.  Returns FALSE if the arguments are out of range.
+//
+static GLboolean ShapeLevels ( Shape *shape, int slices, int rings, int minimum, int numLods )
+{
+   int k;
+
+   if ( slices < minimum || rings < minimum || numLods < 1 )
+   {
+      return FALSE;
+   }
+
+   shape->numLevels = 0;
+
+   for ( k = 0; k < numLods && k < ES_MESH_MAX_LODS; k++ )
+   {
+      ShapeLevel *level = &shape->levels[k];
+
+      level->slices = ( slices >> k ) > minimum ? slices >> k : minimum;
+      level->rings = ( rings >> k ) > minimum ? rings >> k : minimum;
+
+      if ( k > 0 && level->slices == level[-1].slices && level->rings == level[-1].rings )
+      {
+         break;
+      }
+
+      shape->numLevels++;
+   }
+
+   return TRUE;
+}
+
+///
+// GenShapeMesh()
+//
+//    Pack every level of a shape into one mesh, level after level, each
+//    with the same bounding sphere around the origin
+//
+static GLboolean GenShapeMesh ( ESMesh *mesh, const ESMeshLayout *layout, const Shape *shape,
+                                ShapeGen gen, GLfloat boundRadius, void *memory, GLsizeiptr *memorySize )
+{
+   ESMeshLod lods[ES_MESH_MAX_LODS];
+   int numVertices = 0;
+   int numIndices = 0;
+   int k;
+
+   for ( k = 0; k < shape->numLevels; k++ )
+   {
+      lods[k].firstIndex = numIndices;
+      lods[k].numIndices = shape->levels[k].numIndices;
+      lods[k].firstVertex = numVertices;
+      lods[k].numVertices = shape->levels[k].numVertices;
+      lods[k].center[0] = lods[k].center[1] = lods[k].center[2] = 0.0f;
+      lods[k].radius = boundRadius;
+
+      numVertices += lods[k].numVertices;
+      numIndices += lods[k].numIndices;
+   }
+
+   if ( !MeshBegin ( mesh, layout, GL_TRIANGLES, numVertices, numIndices, memory, memorySize ) )
+   {
+      return FALSE;
+   }
+
+   mesh->numLods = shape->numLevels;
+   memcpy ( mesh->lods, lods, shape->numLevels * sizeof ( ESMeshLod ) );
+
+   if ( mesh->vertices != NULL )
+   {
+      for ( k = 0; k < shape->numLevels; k++ )
+      {
+         gen ( shape, &shape->levels[k], mesh, lods[k].firstVertex, mesh->indices + lods[k].firstIndex );
+      }
+   }
+
+   return TRUE;
+}
+
+///
+// CylinderLevel()
+//
+//    Side rings top and bottom, then the top and bottom caps, each a center
+//    vertex followed by its rim
+//
+static void CylinderLevel ( const Shape *shape, const ShapeLevel *level, ESMesh *mesh,
+                            int firstVertex, GLuint *indices )
+{
+   int numSlices = level->slices;
+   int topCap = firstVertex + 2 * ( numSlices + 1 );
+   int bottomCap = topCap + numSlices + 2;
+   float angleStep = ( 2.0f * ES_PI ) / ( float ) numSlices;
+   float halfHeight = shape->height * 0.5f;
+   float radius = shape->radius;
+   int j;
+
+   for ( j = 0; j <= numSlices; j++ )
+   {
+      GLfloat sinPhi = sinf ( angleStep * ( float ) j );
+      GLfloat cosPhi = cosf ( angleStep * ( float ) j );
+      GLfloat s = ( float ) j / ( float ) numSlices;
+      GLfloat x = radius * sinPhi;
+      GLfloat z = radius * cosPhi;
+
+      MeshVertex ( mesh, firstVertex + j, x, halfHeight, z, sinPhi, 0.0f, cosPhi, s, 1.0f );
+      MeshVertex ( mesh, firstVertex + numSlices + 1 + j, x, -halfHeight, z, sinPhi, 0.0f, cosPhi, s, 0.0f );
+      MeshVertex ( mesh, topCap + 1 + j, x, halfHeight, z, 0.0f, 1.0f, 0.0f,
+                   0.5f + 0.5f * sinPhi, 0.5f + 0.5f * cosPhi );
+      MeshVertex ( mesh, bottomCap + 1 + j, x, -halfHeight, z, 0.0f, -1.0f, 0.0f,
+                   0.5f + 0.5f * sinPhi, 0.5f + 0.5f * cosPhi );
+   }
+
+   MeshVertex ( mesh, topCap, 0.0f, halfHeight, 0.0f, 0.0f, 1.0f, 0.0f, 0.5f, 0.5f );
+   MeshVertex ( mesh, bottomCap, 0.0f, -halfHeight, 0.0f, 0.0f, -1.0f, 0.0f, 0.5f, 0.5f );
+
+   indices = QuadGridIndices ( indices, firstVertex, 1, numSlices, 0 );
+   indices = FanIndices ( indices, topCap, topCap + 1, numSlices, 0 );
+   FanIndices ( indices, bottomCap, bottomCap + 1, numSlices, 1 );
+}
+
+///
+// ConeLevel()
+//
+//    A row of apex vertices, one per slice with the normal of the middle of
+//    the slice plus an unused one closing the row, the base ring, then the base cap
+//
+static void ConeLevel ( const Shape *shape, const ShapeLevel *level, ESMesh *mesh,
+                        int firstVertex, GLuint *indices )
+{
+   int numSlices = level->slices;
+   int cap = firstVertex + 2 * ( numSlices + 1 );
+   float angleStep = ( 2.0f * ES_PI ) / ( float ) numSlices;
+   float halfHeight = shape->height * 0.5f;
+   float radius = shape->radius;
+   // The side normal is ( height * sin, radius, height * cos ) normalized
+   float slant = sqrtf ( shape->height * shape->height + radius * radius );
+   float normalXZ = slant > 0.0f ? shape->height / slant : 0.0f;
+   float normalY = slant > 0.0f ? radius / slant : 1.0f;
+   int j;
+
+   for ( j = 0; j <= numSlices; j++ )
+   {
+      GLfloat sinPhi = sinf ( angleStep * ( float ) j );
+      GLfloat cosPhi = cosf ( angleStep * ( float ) j );
+      GLfloat sinMid = sinf ( angleStep * ( ( float ) j + 0.5f ) );
+      GLfloat cosMid = cosf ( angleStep * ( ( float ) j + 0.5f ) );
+      GLfloat s = ( float ) j / ( float ) numSlices;
+      GLfloat x = radius * sinPhi;
+      GLfloat z = radius * cosPhi;
+
+      MeshVertex ( mesh, firstVertex + j, 0.0f, halfHeight, 0.0f,
+                   normalXZ * sinMid, normalY, normalXZ * cosMid, j < numSlices ? s + 0.5f / ( float ) numSlices : s, 1.0f );
+      MeshVertex ( mesh, firstVertex + numSlices + 1 + j, x, -halfHeight, z,
+                   normalXZ * sinPhi, normalY, normalXZ * cosPhi, s, 0.0f );
+      MeshVertex ( mesh, cap + 1 + j, x, -halfHeight, z, 0.0f, -1.0f, 0.0f,
+                   0.5f + 0.5f * sinPhi, 0.5f + 0.5f * cosPhi );
+   }
+
+   MeshVertex ( mesh, cap, 0.0f, -halfHeight, 0.0f, 0.0f, -1.0f, 0.0f, 0.5f, 0.5f );
+
+   indices = QuadGridIndices ( indices, firstVertex, 1, numSlices, SHAPE_POLE_TOP );
+   FanIndices ( indices, cap, cap + 1, numSlices, 1 );
+}
+
+///
+// TorusLevel()
+//
+//    Grid of rings around the tube by slices around the y axis
+//
+static void TorusLevel ( const Shape *shape, const ShapeLevel *level, ESMesh *mesh,
+                         int firstVertex, GLuint *indices )
+{
+   int numSlices = level->slices;
+   int numRings = level->rings;
+   float sliceStep = ( 2.0f * ES_PI ) / ( float ) numSlices;
+   float ringStep = ( 2.0f * ES_PI ) / ( float ) numRings;
+   int i, j;
+
+   for ( i = 0; i <= numRings; i++ )
+   {
+      // Rings run down the outside of the tube
+      GLfloat cosTheta = cosf ( ringStep * ( float ) i );
+      GLfloat sinTheta = -sinf ( ringStep * ( float ) i );
+      GLfloat ringRadius = shape->radius + shape->radius2 * cosTheta;
+      GLfloat t = ( float ) i / ( float ) numRings;
+
+      for ( j = 0; j <= numSlices; j++ )
+      {
+         GLfloat sinPhi = sinf ( sliceStep * ( float ) j );
+         GLfloat cosPhi = cosf ( sliceStep * ( float ) j );
+
+         MeshVertex ( mesh, firstVertex + i * ( numSlices + 1 ) + j,
+                      ringRadius * sinPhi, shape->radius2 * sinTheta, ringRadius * cosPhi,
+                      cosTheta * sinPhi, sinTheta, cosTheta * cosPhi, ( float ) j / ( float ) numSlices, t );
+      }
+   }
+
+   QuadGridIndices ( indices, firstVertex, numRings, numSlices, 0 );
+}
+
+///
+// CapsuleLevel()
+//
+//    Latitude rows from the top pole to the bottom one, the equator row
+//    repeated at the top and bottom of the cylinder
+//
+static void CapsuleLevel ( const Shape *shape, const ShapeLevel *level, ESMesh *mesh,
+                           int firstVertex, GLuint *indices )
+{
+   int numSlices = level->slices;
+   int numRings = level->rings;
+   float sliceStep = ( 2.0f * ES_PI ) / ( float ) numSlices;
+   float ringStep = ( 0.5f * ES_PI ) / ( float ) numRings;
+   float halfHeight = shape->height * 0.5f;
+   float radius = shape->radius;
+   float totalHeight = shape->height + 2.0f * radius;
+   int i, j;
+
+   for ( i = 0; i <= 2 * numRings + 1; i++ )
+   {
+      int ring = i <= numRings ? i : i - 1;
+      GLfloat sinTheta = sinf ( ringStep * ( float ) ring );
+      GLfloat cosTheta = cosf ( ringStep * ( float ) ring );
+      GLfloat y = ( i <= numRings ? halfHeight : -halfHeight ) + radius * cosTheta;
+      GLfloat t = totalHeight > 0.0f ? ( y + halfHeight + radius ) / totalHeight : 0.0f;
+
+      for ( j = 0; j <= numSlices; j++ )
+      {
+         GLfloat sinPhi = sinf ( sliceStep * ( float ) j );
+         GLfloat cosPhi = cosf ( sliceStep * ( float ) j );
+
+         MeshVertex ( mesh, firstVertex + i * ( numSlices + 1 ) + j,
+                      radius * sinTheta * sinPhi, y, radius * sinTheta * cosPhi,
+                      sinTheta * sinPhi, cosTheta, sinTheta * cosPhi, ( float ) j / ( float ) numSlices, t );
+      }
+   }
+
+   QuadGridIndices ( indices, firstVertex, 2 * numRings + 1, numSlices, SHAPE_POLE_TOP | SHAPE_POLE_BOTTOM );
+}
+
+///
+// IcosphereLevel()
 //
+//    Each icosahedron face split into a triangular grid of its own vertices,
+//    so texture coordinates can be kept from wrapping across a face; faces
+//    on the seam run s a little past 0 or 1 instead
 //
+static void IcosphereLevel ( const Shape *shape, const ShapeLevel *level, ESMesh *mesh,
+                             int firstVertex, GLuint *indices )
+{
+   int frequency = 1 << level->slices;
+   int faceVertices = ( frequency + 1 ) * ( frequency + 2 ) / 2;
+   int face, i, j, k;
+
+   for ( face = 0; face < 20; face++ )
+   {
+      const GLfloat *a = icosahedronVerts[icosahedronFaces[face][0]];
+      const GLfloat *b = icosahedronVerts[icosahedronFaces[face][1]];
+      const GLfloat *c = icosahedronVerts[icosahedronFaces[face][2]];
+      int first = firstVertex + face * faceVertices;
+      GLfloat centerS = atan2f ( a[0] + b[0] + c[0], a[2] + b[2] + c[2] ) / ( 2.0f * ES_PI );
+
+      // Row i holds i + 1 vertices, from a towards b then across to c
+      for ( i = 0; i <= frequency; i++ )
+      {
+         for ( j = 0; j <= i; j++ )
+         {
+            GLfloat wa = ( float ) ( frequency - i ) / ( float ) frequency;
+            GLfloat wb = ( float ) ( i - j ) / ( float ) frequency;
+            GLfloat wc = ( float ) j / ( float ) frequency;
+            GLfloat n[3], length, s;
+
+            for ( k = 0; k < 3; k++ )
+            {
+               n[k] = wa * a[k] + wb * b[k] + wc * c[k];
+            }
+
+            length = sqrtf ( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+            n[0] /= length;
+            n[1] /= length;
+            n[2] /= length;
+
+            // On the axis the longitude is undefined, take the face's
+            s = n[0] * n[0] + n[2] * n[2] > 1e-12f ? atan2f ( n[0], n[2] ) / ( 2.0f * ES_PI ) : centerS;
+
+            if ( s - centerS > 0.5f )
+            {
+               s -= 1.0f;
+            }
+            else if ( s - centerS < -0.5f )
+            {
+               s += 1.0f;
+            }
+
+            if ( centerS < 0.0f )
+            {
+               s += 1.0f;
+            }
 
+            MeshVertex ( mesh, first + i * ( i + 1 ) / 2 + j,
+                         shape->radius * n[0], shape->radius * n[1], shape->radius * n[2],
+                         n[0], n[1], n[2], s, 1.0f - acosf ( n[1] < 1.0f ? n[1] : 1.0f ) / ES_PI );
+         }
+      }
+
+      for ( i = 0; i < frequency; i++ )
+      {
+         GLuint row = first + i * ( i + 1 ) / 2;
+         GLuint next = first + ( i + 1 ) * ( i + 2 ) / 2;
+
+         for ( j = 0; j <= i; j++ )
+         {
+            *indices++ = row + j;
+            *indices++ = next + j;
+            *indices++ = next + j + 1;
+
+            if ( j < i )
+            {
+               *indices++ = row + j;
+               *indices++ = next + j + 1;
+               *indices++ = row + j + 1;
+            }
+         }
+      }
+   }
+}
 
 
 //////////////////////////////////////////////////////////////////
@@ -63,95 +1143,86 @@
 
 //
 /// \brief Generates geometry for a sphere.  Allocates memory for the vertex data and stores
-///        the results in the arrays.  Generate index list for a TRIANGLE_STRIP
+///        the results in the arrays.  Generate index list as TRIANGLES, or as a TRIANGLE_STRIP
+///        with primitive restart if flags has ES_SHAPE_TRIANGLE_STRIP.
 /// \param numSlices The number of slices in the sphere
+/// \param flags Bitfield of ES_SHAPE_* values, 0 for the original layout
 /// \param vertices If not NULL, will contain array of float3 positions
 /// \param normals If not NULL, will contain array of float3 normals
 /// \param texCoords If not NULL, will contain array of float2 texCoords
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \param indices If not NULL, will contain the array of indices
 /// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLE_STRIP
+///         if it is not NULL ) as GL_TRIANGLES or GL_TRIANGLE_STRIP, 0 if memory ran out
 // 
-int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GLfloat **normals,
+int ESUTIL_API esGenSphere ( int numSlices, float radius, GLuint flags, GLfloat **vertices, GLfloat **normals,
                              GLfloat **texCoords, GLuint **indices )
 {
-   int i;
-   int j;
    int numParallels = numSlices / 2;
    int numVertices = ( numParallels + 1 ) * ( numSlices + 1 );
-   int numIndices = numParallels * numSlices * 6;
-   float angleStep = ( 2.0f * ES_PI ) / ( ( float ) numSlices );
+   int numIndices = GridIndexCount ( numParallels, numSlices, 1, SpherePoles ( numSlices, flags ), flags );
+   GLboolean allocated = GL_TRUE;
 
    // Allocate memory for buffers
    if ( vertices != NULL )
    {
-      *vertices = malloc ( sizeof ( GLfloat ) * 3 * numVertices );
+      *vertices = esMalloc ( sizeof ( GLfloat ) * 3 * numVertices );
+      allocated = allocated && *vertices != NULL;
    }
 
    if ( normals != NULL )
    {
-      *normals = malloc ( sizeof ( GLfloat ) * 3 * numVertices );
+      *normals = esMalloc ( sizeof ( GLfloat ) * 3 * numVertices );
+      allocated = allocated && *normals != NULL;
    }
 
    if ( texCoords != NULL )
    {
-      *texCoords = malloc ( sizeof ( GLfloat ) * 2 * numVertices );
+      *texCoords = esMalloc ( sizeof ( GLfloat ) * 2 * numVertices );
+      allocated = allocated && *texCoords != NULL;
    }
 
    if ( indices != NULL )
    {
-      *indices = malloc ( sizeof ( GLuint ) * numIndices );
+      *indices = esMalloc ( sizeof ( GLuint ) * numIndices );
+      allocated = allocated && *indices != NULL;
    }
 
-   for ( i = 0; i < numParallels + 1; i++ )
+   // Free whatever was allocated if any buffer or the vertex tables could not be
+   if ( !allocated ||
+        !GenSphereVertices ( numSlices, radius, vertices ? *vertices : NULL, 3,
+                             normals ? *normals : NULL, 3, texCoords ? *texCoords : NULL, 2 ) )
    {
-      for ( j = 0; j < numSlices + 1; j++ )
+      if ( vertices != NULL )
       {
-         int vertex = ( i * ( numSlices + 1 ) + j ) * 3;
+         esFree ( *vertices );
+         *vertices = NULL;
+      }
 
-         if ( vertices )
-         {
-            ( *vertices ) [vertex + 0] = radius * sinf ( angleStep * ( float ) i ) *
-                                         sinf ( angleStep * ( float ) j );
-            ( *vertices ) [vertex + 1] = radius * cosf ( angleStep * ( float ) i );
-            ( *vertices ) [vertex + 2] = radius * sinf ( angleStep * ( float ) i ) *
-                                         cosf ( angleStep * ( float ) j );
-         }
+      if ( normals != NULL )
+      {
+         esFree ( *normals );
+         *normals = NULL;
+      }
 
-         if ( normals )
-         {
-            ( *normals ) [vertex + 0] = ( *vertices ) [vertex + 0] / radius;
-            ( *normals ) [vertex + 1] = ( *vertices ) [vertex + 1] / radius;
-            ( *normals ) [vertex + 2] = ( *vertices ) [vertex + 2] / radius;
-         }
+      if ( texCoords != NULL )
+      {
+         esFree ( *texCoords );
+         *texCoords = NULL;
+      }
 
-         if ( texCoords )
-         {
-            int texIndex = ( i * ( numSlices + 1 ) + j ) * 2;
-            ( *texCoords ) [texIndex + 0] = ( float ) j / ( float ) numSlices;
-            ( *texCoords ) [texIndex + 1] = ( 1.0f - ( float ) i ) / ( float ) ( numParallels - 1 );
-         }
+      if ( indices != NULL )
+      {
+         esFree ( *indices );
+         *indices = NULL;
       }
+
+      return 0;
    }
 
    // Generate the indices
    if ( indices != NULL )
    {
-      GLuint *indexBuf = ( *indices );
-
-      for ( i = 0; i < numParallels ; i++ )
-      {
-         for ( j = 0; j < numSlices; j++ )
-         {
-            *indexBuf++  = i * ( numSlices + 1 ) + j;
-            *indexBuf++ = ( i + 1 ) * ( numSlices + 1 ) + j;
-            *indexBuf++ = ( i + 1 ) * ( numSlices + 1 ) + ( j + 1 );
-
-            *indexBuf++ = i * ( numSlices + 1 ) + j;
-            *indexBuf++ = ( i + 1 ) * ( numSlices + 1 ) + ( j + 1 );
-            *indexBuf++ = i * ( numSlices + 1 ) + ( j + 1 );
-         }
-      }
+      GenGridIndices ( *indices, numParallels, numSlices, 1, SpherePoles ( numSlices, flags ), flags );
    }
 
    return numIndices;
@@ -164,146 +1235,39 @@ int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GL
 /// \param vertices If not NULL, will contain array of float3 positions
 /// \param normals If not NULL, will contain array of float3 normals
 /// \param texCoords If not NULL, will contain array of float2 texCoords
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \param indices If not NULL, will contain the array of indices for the triangle list
 /// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLE_STRIP
+///         if it is not NULL ) as GL_TRIANGLES
 // ɶλvertices  indices  texCoords   indices
 int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
                            GLfloat **texCoords, GLuint **indices )
 {
-   int i;
    int numVertices = 24;//
    int numIndices = 36;//
 
-   GLfloat cubeVerts[] =
-   {
-      -0.5f, -0.5f, -0.5f,
-      -0.5f, -0.5f,  0.5f,
-      0.5f, -0.5f,  0.5f,
-      0.5f, -0.5f, -0.5f,
-      -0.5f,  0.5f, -0.5f,
-      -0.5f,  0.5f,  0.5f,
-      0.5f,  0.5f,  0.5f,
-      0.5f,  0.5f, -0.5f,
-      -0.5f, -0.5f, -0.5f,
-      -0.5f,  0.5f, -0.5f,
-      0.5f,  0.5f, -0.5f,
-      0.5f, -0.5f, -0.5f,
-      -0.5f, -0.5f, 0.5f,
-      -0.5f,  0.5f, 0.5f,
-      0.5f,  0.5f, 0.5f,
-      0.5f, -0.5f, 0.5f,
-      -0.5f, -0.5f, -0.5f,
-      -0.5f, -0.5f,  0.5f,
-      -0.5f,  0.5f,  0.5f,
-      -0.5f,  0.5f, -0.5f,
-      0.5f, -0.5f, -0.5f,
-      0.5f, -0.5f,  0.5f,
-      0.5f,  0.5f,  0.5f,
-      0.5f,  0.5f, -0.5f,
-   };
-
-   GLfloat cubeNormals[] =
-   {
-      0.0f, -1.0f, 0.0f,
-      0.0f, -1.0f, 0.0f,
-      0.0f, -1.0f, 0.0f,
-      0.0f, -1.0f, 0.0f,
-      0.0f, 1.0f, 0.0f,
-      0.0f, 1.0f, 0.0f,
-      0.0f, 1.0f, 0.0f,
-      0.0f, 1.0f, 0.0f,
-      0.0f, 0.0f, -1.0f,
-      0.0f, 0.0f, -1.0f,
-      0.0f, 0.0f, -1.0f,
-      0.0f, 0.0f, -1.0f,
-      0.0f, 0.0f, 1.0f,
-      0.0f, 0.0f, 1.0f,
-      0.0f, 0.0f, 1.0f,
-      0.0f, 0.0f, 1.0f,
-      -1.0f, 0.0f, 0.0f,
-      -1.0f, 0.0f, 0.0f,
-      -1.0f, 0.0f, 0.0f,
-      -1.0f, 0.0f, 0.0f,
-      1.0f, 0.0f, 0.0f,
-      1.0f, 0.0f, 0.0f,
-      1.0f, 0.0f, 0.0f,
-      1.0f, 0.0f, 0.0f,
-   };
-
-   GLfloat cubeTex[] =
-   {
-      0.0f, 0.0f,
-      0.0f, 1.0f,
-      1.0f, 1.0f,
-      1.0f, 0.0f,
-      1.0f, 0.0f,
-      1.0f, 1.0f,
-      0.0f, 1.0f,
-      0.0f, 0.0f,
-      0.0f, 0.0f,
-      0.0f, 1.0f,
-      1.0f, 1.0f,
-      1.0f, 0.0f,
-      0.0f, 0.0f,
-      0.0f, 1.0f,
-      1.0f, 1.0f,
-      1.0f, 0.0f,
-      0.0f, 0.0f,
-      0.0f, 1.0f,
-      1.0f, 1.0f,
-      1.0f, 0.0f,
-      0.0f, 0.0f,
-      0.0f, 1.0f,
-      1.0f, 1.0f,
-      1.0f, 0.0f,
-   };
-
    // Allocate memory for buffers
    if ( vertices != NULL )
    {
-      *vertices = malloc ( sizeof ( GLfloat ) * 3 * numVertices );
-      memcpy ( *vertices, cubeVerts, sizeof ( cubeVerts ) );
-
-      for ( i = 0; i < numVertices * 3; i++ )
-      {
-         ( *vertices ) [i] *= scale;//СΪԭ0.1
-      }
+      *vertices = esMalloc ( sizeof ( GLfloat ) * 3 * numVertices );
    }
 
    if ( normals != NULL )
    {
-      *normals = malloc ( sizeof ( GLfloat ) * 3 * numVertices );
-      memcpy ( *normals, cubeNormals, sizeof ( cubeNormals ) );
+      *normals = esMalloc ( sizeof ( GLfloat ) * 3 * numVertices );
    }
 
    if ( texCoords != NULL )
    {
-      *texCoords = malloc ( sizeof ( GLfloat ) * 2 * numVertices );
-      memcpy ( *texCoords, cubeTex, sizeof ( cubeTex ) ) ;
+      *texCoords = esMalloc ( sizeof ( GLfloat ) * 2 * numVertices );
    }
 
+   GenCubeVertices ( scale, vertices ? *vertices : NULL, 3,
+                     normals ? *normals : NULL, 3, texCoords ? *texCoords : NULL, 2 );
 
    // Generate the indices
    if ( indices != NULL )
    {
-      GLuint cubeIndices[] =
-      {
-         0, 2, 1,
-         0, 3, 2,
-         4, 5, 6,
-         4, 6, 7,
-         8, 9, 10,
-         8, 10, 11,
-         12, 15, 14,
-         12, 14, 13,
-         16, 17, 18,
-         16, 18, 19,
-         20, 23, 22,
-         20, 22, 21
-      };
-
-      *indices = malloc ( sizeof ( GLuint ) * numIndices );
+      *indices = esMalloc ( sizeof ( GLuint ) * numIndices );
       memcpy ( *indices, cubeIndices, sizeof ( cubeIndices ) );
    }
 
@@ -312,56 +1276,399 @@ int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
 
 //
 /// \brief Generates a square grid consisting of triangles.  Allocates memory for the vertex data and stores
-///        the results in the arrays.  Generate index list as TRIANGLES.
+///        the results in the arrays.  Generate index list as TRIANGLES, or as a TRIANGLE_STRIP
+///        with primitive restart if flags has ES_SHAPE_TRIANGLE_STRIP.
 /// \param size create a grid of size by size (number of triangles = (size-1)*(size-1)*2)
+/// \param flags Bitfield of ES_SHAPE_OPTIMIZE_VERTEX_CACHE and ES_SHAPE_TRIANGLE_STRIP, or 0
 /// \param vertices If not NULL, will contain array of float3 positions
-/// \param indices If not NULL, will contain the array of indices for the triangle strip
+/// \param indices If not NULL, will contain the array of indices
 /// \return The number of indices required for rendering the buffers (the number of indices stored in the indices array
-///         if it is not NULL ) as a GL_TRIANGLES
+///         if it is not NULL ) as GL_TRIANGLES or GL_TRIANGLE_STRIP
 //
-int ESUTIL_API esGenSquareGrid ( int size, GLfloat **vertices, GLuint **indices )
+int ESUTIL_API esGenSquareGrid ( int size, GLuint flags, GLfloat **vertices, GLuint **indices )
 {
-   int i, j;
-   int numIndices = ( size - 1 ) * ( size - 1 ) * 2 * 3;
+   int numIndices = GridIndexCount ( size - 1, size - 1, 0, 0, flags );
 
    // Allocate memory for buffers
    if ( vertices != NULL )
    {
-      int numVertices = size * size;
-      float stepSize = ( float ) size - 1;
-      *vertices = malloc ( sizeof ( GLfloat ) * 3 * numVertices );
+      *vertices = esMalloc ( sizeof ( GLfloat ) * 3 * size * size );
+      GenGridVertices ( size, *vertices, 3, NULL, 0, NULL, 0 );
+   }
+
+   // Generate the indices
+   if ( indices != NULL )
+   {
+      *indices = esMalloc ( sizeof ( GLuint ) * numIndices );
+      GenGridIndices ( *indices, size - 1, size - 1, 0, 0, flags );
+   }
+
+   return numIndices;
+}
+
+//
+/// \brief Fill in a tightly packed layout holding the given attributes in ES_MESH_* order
+/// \param layout Returns the layout
+/// \param attribs Bitfield of ES_MESH_*_BIT values
+//
+void ESUTIL_API esMeshLayoutInit ( ESMeshLayout *layout, GLbitfield attribs )
+{
+   static const int attribSize[ES_MESH_MAX_ATTRIBS] =
+   {
+      3 * sizeof ( GLfloat ), 3 * sizeof ( GLfloat ), 2 * sizeof ( GLfloat )
+   };
+   int i;
+
+   layout->stride = 0;
+
+   for ( i = 0; i < ES_MESH_MAX_ATTRIBS; i++ )
+   {
+      layout->offset[i] = -1;
 
-      for ( i = 0; i < size; ++i ) // row
+      if ( attribs & ( 1 << i ) )
       {
-         for ( j = 0; j < size; ++j ) // column
-         {
-            ( *vertices ) [ 3 * ( j + i * size )     ] = i / stepSize;
-            ( *vertices ) [ 3 * ( j + i * size ) + 1 ] = j / stepSize;
-            ( *vertices ) [ 3 * ( j + i * size ) + 2 ] = 0.0f;
-         }
+         layout->offset[i] = layout->stride;
+         layout->stride += attribSize[i];
       }
    }
+}
 
-   // Generate the indices
-   if ( indices != NULL )
+//
+/// \brief Generate esGenSphere geometry as an ESMesh.  The memory and memorySize arguments
+///        are shared by all the esGen*Mesh functions:
+///        - memorySize NULL: the mesh is allocated and must be released with esMeshFree
+///        - memory NULL: the mesh is only sized, *memorySize returns the bytes it needs
+///        - otherwise the mesh is written to memory, such as a buffer mapped with
+///          glMapBufferRange, if *memorySize is large enough
+/// \param mesh Returns the mesh, its counts and size are set even if nothing is written
+/// \param layout Vertex layout, texture coordinates as for esGenSphere
+/// \param flags Bitfield of ES_SHAPE_* values, as for esGenSphere
+/// \param memory Where to write the mesh, or NULL
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenSphereMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, float radius,
+                                       GLuint flags, void *memory, GLsizeiptr *memorySize )
+{
+   int numParallels = numSlices / 2;
+   int stride = layout->stride / sizeof ( GLfloat );
+
+   if ( !MeshBegin ( mesh, layout, GridMode ( flags ), ( numParallels + 1 ) * ( numSlices + 1 ),
+                     GridIndexCount ( numParallels, numSlices, 1, SpherePoles ( numSlices, flags ), flags ),
+                     memory, memorySize ) )
    {
-      *indices = malloc ( sizeof ( GLuint ) * numIndices );
+      return FALSE;
+   }
 
-      for ( i = 0; i < size - 1; ++i )
+   MeshBound ( mesh, 0.0f, 0.0f, 0.0f, radius );
+
+   if ( mesh->vertices != NULL )
+   {
+      if ( !GenSphereVertices ( numSlices, radius, MeshAttrib ( mesh, ES_MESH_POSITION ), stride,
+                                MeshAttrib ( mesh, ES_MESH_NORMAL ), stride, MeshAttrib ( mesh, ES_MESH_TEXCOORD ), stride ) )
       {
-         for ( j = 0; j < size - 1; ++j )
-         {
-            // two triangles per quad
-            ( *indices ) [ 6 * ( j + i * ( size - 1 ) )     ] = j + ( i )   * ( size )    ;
-            ( *indices ) [ 6 * ( j + i * ( size - 1 ) ) + 1 ] = j + ( i )   * ( size ) + 1;
-            ( *indices ) [ 6 * ( j + i * ( size - 1 ) ) + 2 ] = j + ( i + 1 ) * ( size ) + 1;
-
-            ( *indices ) [ 6 * ( j + i * ( size - 1 ) ) + 3 ] = j + ( i )   * ( size )    ;
-            ( *indices ) [ 6 * ( j + i * ( size - 1 ) ) + 4 ] = j + ( i + 1 ) * ( size ) + 1;
-            ( *indices ) [ 6 * ( j + i * ( size - 1 ) ) + 5 ] = j + ( i + 1 ) * ( size )    ;
-         }
+         esMeshFree ( mesh );
+         return FALSE;
       }
+
+      GenGridIndices ( mesh->indices, numParallels, numSlices, 1, SpherePoles ( numSlices, flags ), flags );
    }
 
-   return numIndices;
+   return TRUE;
+}
+
+//
+/// \brief Generate esGenCube geometry as an ESMesh, always as GL_TRIANGLES
+/// \param mesh Returns the mesh
+/// \param layout Vertex layout
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenCubeMesh ( ESMesh *mesh, const ESMeshLayout *layout, float scale,
+                                     void *memory, GLsizeiptr *memorySize )
+{
+   int stride = layout->stride / sizeof ( GLfloat );
+
+   if ( !MeshBegin ( mesh, layout, GL_TRIANGLES, 24, 36, memory, memorySize ) )
+   {
+      return FALSE;
+   }
+
+   // Half the diagonal of the cube
+   MeshBound ( mesh, 0.0f, 0.0f, 0.0f, scale * 0.8660254f );
+
+   if ( mesh->vertices != NULL )
+   {
+      GenCubeVertices ( scale, MeshAttrib ( mesh, ES_MESH_POSITION ), stride,
+                        MeshAttrib ( mesh, ES_MESH_NORMAL ), stride, MeshAttrib ( mesh, ES_MESH_TEXCOORD ), stride );
+      memcpy ( mesh->indices, cubeIndices, sizeof ( cubeIndices ) );
+   }
+
+   return TRUE;
+}
+
+//
+/// \brief Generate esGenSquareGrid geometry as an ESMesh.  Normals are ( 0, 0, -1 ), the side
+///        the triangles face, and texture coordinates repeat the position x and y.
+/// \param mesh Returns the mesh
+/// \param layout Vertex layout
+/// \param flags Bitfield of ES_SHAPE_* values, as for esGenSquareGrid
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenSquareGridMesh ( ESMesh *mesh, const ESMeshLayout *layout, int size, GLuint flags,
+                                           void *memory, GLsizeiptr *memorySize )
+{
+   int stride = layout->stride / sizeof ( GLfloat );
+
+   if ( !MeshBegin ( mesh, layout, GridMode ( flags ), size * size, GridIndexCount ( size - 1, size - 1, 0, 0, flags ),
+                     memory, memorySize ) )
+   {
+      return FALSE;
+   }
+
+   MeshBound ( mesh, 0.5f, 0.5f, 0.0f, 0.7071068f );
+
+   if ( mesh->vertices != NULL )
+   {
+      GenGridVertices ( size, MeshAttrib ( mesh, ES_MESH_POSITION ), stride,
+                        MeshAttrib ( mesh, ES_MESH_NORMAL ), stride, MeshAttrib ( mesh, ES_MESH_TEXCOORD ), stride );
+      GenGridIndices ( mesh->indices, size - 1, size - 1, 0, 0, flags );
+   }
+
+   return TRUE;
+}
+
+//
+/// \brief Generate a capped cylinder along the y axis, centered on the origin, as GL_TRIANGLES.
+///        Each further level of detail halves numSlices, down to 3.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSlices Slices around the axis of the finest level, at least 3
+/// \param radius Radius of the cylinder
+/// \param height Height of the cylinder
+/// \param numLods Levels of detail wanted, at most ES_MESH_MAX_LODS; fewer are generated
+///        when the tessellation runs out
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenCylinderMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, float radius,
+                                         float height, int numLods, void *memory, GLsizeiptr *memorySize )
+{
+   Shape shape;
+   int k;
+
+   if ( !ShapeLevels ( &shape, numSlices, 3, 3, numLods ) )
+   {
+      return FALSE;
+   }
+
+   shape.radius = radius;
+   shape.height = height;
+
+   for ( k = 0; k < shape.numLevels; k++ )
+   {
+      shape.levels[k].numVertices = 4 * shape.levels[k].slices + 6;
+      shape.levels[k].numIndices = 12 * shape.levels[k].slices;
+   }
+
+   return GenShapeMesh ( mesh, layout, &shape, CylinderLevel,
+                         sqrtf ( radius * radius + 0.25f * height * height ), memory, memorySize );
+}
+
+//
+/// \brief Generate a cone along the y axis, apex up and centered on the origin, with a capped
+///        base, as GL_TRIANGLES.  Each further level of detail halves numSlices, down to 3.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSlices Slices around the axis of the finest level, at least 3
+/// \param radius Radius of the base
+/// \param height Height from the base to the apex
+/// \param numLods Levels of detail wanted, see esGenCylinderMesh
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenConeMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, float radius,
+                                     float height, int numLods, void *memory, GLsizeiptr *memorySize )
+{
+   Shape shape;
+   int k;
+
+   if ( !ShapeLevels ( &shape, numSlices, 3, 3, numLods ) )
+   {
+      return FALSE;
+   }
+
+   shape.radius = radius;
+   shape.height = height;
+
+   for ( k = 0; k < shape.numLevels; k++ )
+   {
+      shape.levels[k].numVertices = 3 * shape.levels[k].slices + 4;
+      shape.levels[k].numIndices = 6 * shape.levels[k].slices;
+   }
+
+   return GenShapeMesh ( mesh, layout, &shape, ConeLevel,
+                         sqrtf ( radius * radius + 0.25f * height * height ), memory, memorySize );
+}
+
+//
+/// \brief Generate a torus around the y axis as GL_TRIANGLES.  Each further level of detail
+///        halves numSlices and numRings, down to 3.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSlices Slices around the y axis of the finest level, at least 3
+/// \param numRings Segments around the tube of the finest level, at least 3
+/// \param radius Distance from the center to the middle of the tube
+/// \param tubeRadius Radius of the tube
+/// \param numLods Levels of detail wanted, see esGenCylinderMesh
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenTorusMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, int numRings,
+                                      float radius, float tubeRadius, int numLods,
+                                      void *memory, GLsizeiptr *memorySize )
+{
+   Shape shape;
+   int k;
+
+   if ( !ShapeLevels ( &shape, numSlices, numRings, 3, numLods ) )
+   {
+      return FALSE;
+   }
+
+   shape.radius = radius;
+   shape.radius2 = tubeRadius;
+
+   for ( k = 0; k < shape.numLevels; k++ )
+   {
+      shape.levels[k].numVertices = ( shape.levels[k].slices + 1 ) * ( shape.levels[k].rings + 1 );
+      shape.levels[k].numIndices = 6 * shape.levels[k].slices * shape.levels[k].rings;
+   }
+
+   return GenShapeMesh ( mesh, layout, &shape, TorusLevel, radius + tubeRadius, memory, memorySize );
+}
+
+//
+/// \brief Generate a capsule, a cylinder with hemispherical ends, along the y axis and centered
+///        on the origin, as GL_TRIANGLES.  Each hemisphere has numSlices / 4 rings.  Each further
+///        level of detail halves numSlices, down to 4.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSlices Slices around the axis of the finest level, at least 4
+/// \param radius Radius of the cylinder and the hemispheres
+/// \param height Height of the cylinder between the hemisphere centers
+/// \param numLods Levels of detail wanted, see esGenCylinderMesh
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenCapsuleMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSlices, float radius,
+                                        float height, int numLods, void *memory, GLsizeiptr *memorySize )
+{
+   Shape shape;
+   int k;
+
+   if ( !ShapeLevels ( &shape, numSlices, 4, 4, numLods ) )
+   {
+      return FALSE;
+   }
+
+   shape.radius = radius;
+   shape.height = height;
+
+   for ( k = 0; k < shape.numLevels; k++ )
+   {
+      ShapeLevel *level = &shape.levels[k];
+
+      // Rings per hemisphere
+      level->rings = level->slices / 4;
+      level->numVertices = ( 2 * level->rings + 2 ) * ( level->slices + 1 );
+      level->numIndices = 12 * level->rings * level->slices;
+   }
+
+   return GenShapeMesh ( mesh, layout, &shape, CapsuleLevel, 0.5f * height + radius, memory, memorySize );
+}
+
+//
+/// \brief Generate an icosphere, an icosahedron whose faces are split into 4^numSubdivisions
+///        triangles projected onto the sphere, as GL_TRIANGLES.  Each further level of detail
+///        has one subdivision less, down to the icosahedron.
+/// \param mesh Returns the mesh and its levels of detail
+/// \param layout Vertex layout
+/// \param numSubdivisions Subdivisions of the finest level, 0 to 10
+/// \param radius Radius of the sphere
+/// \param numLods Levels of detail wanted, see esGenCylinderMesh
+/// \param memory Where to write the mesh, or NULL, see esGenSphereMesh
+/// \param memorySize Size of memory in bytes, returns the size of the mesh
+/// \return FALSE if a parameter or the layout is invalid, memory is too small or could not be allocated
+//
+GLboolean ESUTIL_API esGenIcosphereMesh ( ESMesh *mesh, const ESMeshLayout *layout, int numSubdivisions,
+                                          float radius, int numLods, void *memory, GLsizeiptr *memorySize )
+{
+   Shape shape;
+   int k;
+
+   if ( numSubdivisions < 0 || numSubdivisions > ICOSPHERE_MAX_SUBDIVISIONS || numLods < 1 )
+   {
+      return FALSE;
+   }
+
+   shape.radius = radius;
+   shape.numLevels = 0;
+
+   for ( k = 0; k < numLods && k < ES_MESH_MAX_LODS && k <= numSubdivisions; k++ )
+   {
+      ShapeLevel *level = &shape.levels[k];
+      int frequency = 1 << ( numSubdivisions - k );
+
+      level->slices = numSubdivisions - k;
+      level->rings = 0;
+      level->numVertices = 10 * ( frequency + 1 ) * ( frequency + 2 );
+      level->numIndices = 60 * frequency * frequency;
+      shape.numLevels++;
+   }
+
+   return GenShapeMesh ( mesh, layout, &shape, IcosphereLevel, radius, memory, memorySize );
+}
+
+//
+/// \brief Pick the level of detail to draw at a distance.  Every level has edges about twice
+///        as long as the one before, so doubling the distance keeps them the same size on screen:
+///        level 0 is used closer than lodDistance and level k from lodDistance * 2^(k-1).
+/// \param mesh Mesh with one or more levels of detail
+/// \param distance Distance from the eye to the center of the mesh
+/// \param lodDistance Distance up to which the finest level is drawn
+/// \return Index into mesh->lods
+//
+int ESUTIL_API esMeshSelectLod ( const ESMesh *mesh, GLfloat distance, GLfloat lodDistance )
+{
+   int level = 0;
+
+   while ( level < mesh->numLods - 1 && distance >= lodDistance )
+   {
+      level++;
+      lodDistance *= 2.0f;
+   }
+
+   return level;
+}
+
+//
+/// \brief Release a mesh allocated by an esGen*Mesh function.  Meshes written to caller
+///        memory are only cleared.
+//
+void ESUTIL_API esMeshFree ( ESMesh *mesh )
+{
+   if ( mesh->allocated )
+   {
+      esFree ( mesh->vertices );
+   }
+
+   memset ( mesh, 0, sizeof ( ESMesh ) );
 }
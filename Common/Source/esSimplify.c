@@ -0,0 +1,1158 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESSimplify.c
+//
+//    Mesh simplification by edge collapse with quadric error metrics, and
+//    level of detail chains built from it.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_thread.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+///
+// Defines
+//
+
+/// Vertex kinds; only free and border vertices are ever collapsed
+#define KIND_FREE     0
+#define KIND_BORDER   1
+#define KIND_LOCKED   2
+
+/// Weight of the planes keeping open borders in place, against the surface planes
+#define BORDER_WEIGHT   10.0f
+
+/// A collapse may turn a triangle normal by at most about 75 degrees
+#define MIN_NORMAL_COS   0.25f
+
+/// Smallest number of triangles or collapses handed to a worker thread
+#define MIN_ITEMS_PER_THREAD   4096
+
+#define EMPTY_SLOT   0xFFFFFFFFu
+
+/// Collapses are ordered by the top bits of their cost, sign excluded: the
+/// exponent and 6 bits of mantissa, within 1.6%
+#define COST_BUCKET_SHIFT   17
+#define COST_BUCKETS        ( 1 << ( 31 - COST_BUCKET_SHIFT ) )
+
+///
+//  Types
+//
+
+/// Symmetric quadric of area-weighted squared plane distances:
+/// error ( p ) = p.A.p + 2 b.p + c, over weight w of area
+typedef struct
+{
+   GLfloat a00, a01, a02, a11, a12, a22;
+   GLfloat b0, b1, b2;
+   GLfloat c;
+   GLfloat w;
+} Quadric;
+
+/// Collapse of vertex v onto vertex u
+typedef struct
+{
+   GLuint  v;
+   GLuint  u;
+   GLfloat cost;
+} Collapse;
+
+/// Working state of esSimplifyMesh
+typedef struct
+{
+   int            numVertices;
+   /// Positions scaled into the unit cube
+   GLfloat       *positions;
+   /// Attributes compared by collapses, pre-multiplied by their weights
+   GLfloat       *attribs;
+   int            numAttribs;
+   /// First vertex at the same position, and the next one round the ring
+   /// of vertices sharing it
+   GLuint        *weld;
+   GLuint        *wedge;
+   GLubyte       *kind;
+   Quadric       *quadrics;
+   Quadric       *triangleQuadrics;
+   GLuint        *indices;
+   int            numTriangles;
+   /// Triangles using each vertex, see BuildAdjacency()
+   int           *offsets;
+   int           *triangles;
+   Collapse      *collapses;
+   Collapse      *sorted;
+   int            numCollapses;
+   int           *buckets;
+} Simplifier;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// HashVertex()
+//
+static GLuint HashVertex ( GLuint a, GLuint b, GLuint c )
+{
+   GLuint h = a * 73856093u ^ b * 19349663u ^ c * 83492791u;
+
+   return h ^ ( h >> 15 );
+}
+
+///
+// TableSize()
+//
+//    Power of two open addressing table size for count keys
+//
+static GLuint TableSize ( int count )
+{
+   GLuint size = 16;
+
+   while ( size < ( GLuint ) count * 2 )
+   {
+      size *= 2;
+   }
+
+   return size;
+}
+
+///
+// QuadricFromPlane()
+//
+static void QuadricFromPlane ( Quadric *q, const GLfloat n[3], GLfloat d, GLfloat w )
+{
+   q->a00 = w * n[0] * n[0];
+   q->a01 = w * n[0] * n[1];
+   q->a02 = w * n[0] * n[2];
+   q->a11 = w * n[1] * n[1];
+   q->a12 = w * n[1] * n[2];
+   q->a22 = w * n[2] * n[2];
+   q->b0 = w * n[0] * d;
+   q->b1 = w * n[1] * d;
+   q->b2 = w * n[2] * d;
+   q->c = w * d * d;
+   q->w = w;
+}
+
+///
+// QuadricAdd()
+//
+static void QuadricAdd ( Quadric *q, const Quadric *r )
+{
+   q->a00 += r->a00;
+   q->a01 += r->a01;
+   q->a02 += r->a02;
+   q->a11 += r->a11;
+   q->a12 += r->a12;
+   q->a22 += r->a22;
+   q->b0 += r->b0;
+   q->b1 += r->b1;
+   q->b2 += r->b2;
+   q->c += r->c;
+   q->w += r->w;
+}
+
+///
+// QuadricError()
+//
+//    Mean squared distance of p to the planes of q
+//
+static GLfloat QuadricError ( const Quadric *q, const GLfloat p[3] )
+{
+   GLfloat rx = q->a00 * p[0] + q->a01 * p[1] + q->a02 * p[2];
+   GLfloat ry = q->a01 * p[0] + q->a11 * p[1] + q->a12 * p[2];
+   GLfloat rz = q->a02 * p[0] + q->a12 * p[1] + q->a22 * p[2];
+   GLfloat error = rx * p[0] + ry * p[1] + rz * p[2] +
+                   2.0f * ( q->b0 * p[0] + q->b1 * p[1] + q->b2 * p[2] ) + q->c;
+
+   if ( q->w <= 0.0f )
+   {
+      return 0.0f;
+   }
+
+   // Rounding can take an exact fit slightly below zero
+   return error > 0.0f ? error / q->w : 0.0f;
+}
+
+///
+// TriangleNormal()
+//
+//    Unnormalized normal, twice the area long
+//
+static void TriangleNormal ( GLfloat n[3], const GLfloat *p0, const GLfloat *p1, const GLfloat *p2 )
+{
+   GLfloat e1[3], e2[3];
+
+   e1[0] = p1[0] - p0[0];
+   e1[1] = p1[1] - p0[1];
+   e1[2] = p1[2] - p0[2];
+   e2[0] = p2[0] - p0[0];
+   e2[1] = p2[1] - p0[1];
+   e2[2] = p2[2] - p0[2];
+
+   n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+   n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+   n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+///
+// WeldVertices()
+//
+//    Map every vertex to the first one at the same position.  Vertices
+//    sharing a position carry different attributes, a texture seam or a
+//    hard edge, and are locked.
+//
+static GLboolean WeldVertices ( Simplifier *s, const GLubyte *positions, GLsizei stride )
+{
+   GLuint  size = TableSize ( s->numVertices );
+   GLuint *table = esMalloc ( sizeof ( GLuint ) * size );
+   int     i;
+
+   if ( table == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   memset ( table, 0xFF, sizeof ( GLuint ) * size );
+
+   for ( i = 0; i < s->numVertices; i++ )
+   {
+      const GLfloat *p = ( const GLfloat * ) ( positions + ( GLsizeiptr ) i * stride );
+      GLfloat key[3];
+      GLuint  bits[3];
+      GLuint  slot;
+
+      // Adding zero turns -0 into +0 so both hash alike
+      key[0] = p[0] + 0.0f;
+      key[1] = p[1] + 0.0f;
+      key[2] = p[2] + 0.0f;
+      memcpy ( bits, key, sizeof ( bits ) );
+
+      slot = HashVertex ( bits[0], bits[1], bits[2] ) & ( size - 1 );
+
+      while ( table[slot] != EMPTY_SLOT )
+      {
+         const GLfloat *q = ( const GLfloat * ) ( positions + ( GLsizeiptr ) table[slot] * stride );
+
+         if ( q[0] == p[0] && q[1] == p[1] && q[2] == p[2] )
+         {
+            break;
+         }
+
+         slot = ( slot + 1 ) & ( size - 1 );
+      }
+
+      s->wedge[i] = i;
+
+      if ( table[slot] == EMPTY_SLOT )
+      {
+         table[slot] = i;
+         s->weld[i] = i;
+      }
+      else
+      {
+         GLuint first = table[slot];
+
+         s->weld[i] = first;
+         s->wedge[i] = s->wedge[first];
+         s->wedge[first] = i;
+         s->kind[i] = KIND_LOCKED;
+         s->kind[first] = KIND_LOCKED;
+      }
+   }
+
+   esFree ( table );
+   return GL_TRUE;
+}
+
+///
+// FindEdges()
+//
+//    Mark vertices on open borders, between welded vertices, and lock those
+//    on edges shared by more than two triangles.  Border planes are added to
+//    the quadrics so the border keeps its shape.
+//
+static GLboolean FindEdges ( Simplifier *s, GLboolean lockBorder )
+{
+   int     numEdges = s->numTriangles * 3;
+   GLuint  size = TableSize ( numEdges );
+   GLuint *keys = esMalloc ( sizeof ( GLuint ) * 2 * size );
+   int    *counts = esMalloc ( sizeof ( int ) * size );
+   int     i, k;
+
+   if ( keys == NULL || counts == NULL )
+   {
+      esFree ( keys );
+      esFree ( counts );
+      return GL_FALSE;
+   }
+
+   memset ( keys, 0xFF, sizeof ( GLuint ) * 2 * size );
+
+   for ( i = 0; i < numEdges; i++ )
+   {
+      GLuint a = s->weld[s->indices[i]];
+      GLuint b = s->weld[s->indices[i / 3 * 3 + ( i + 1 ) % 3]];
+      GLuint slot = HashVertex ( a, b, 0 ) & ( size - 1 );
+
+      while ( keys[2 * slot] != EMPTY_SLOT && ( keys[2 * slot] != a || keys[2 * slot + 1] != b ) )
+      {
+         slot = ( slot + 1 ) & ( size - 1 );
+      }
+
+      if ( keys[2 * slot] == EMPTY_SLOT )
+      {
+         keys[2 * slot] = a;
+         keys[2 * slot + 1] = b;
+         counts[slot] = 0;
+      }
+
+      counts[slot]++;
+   }
+
+   for ( i = 0; i < numEdges; i++ )
+   {
+      int     tri = i / 3;
+      GLuint  a = s->weld[s->indices[i]];
+      GLuint  b = s->weld[s->indices[i / 3 * 3 + ( i + 1 ) % 3]];
+      GLuint  slot = HashVertex ( b, a, 0 ) & ( size - 1 );
+      GLuint  forward = HashVertex ( a, b, 0 ) & ( size - 1 );
+      int     reverse = 0;
+
+      while ( keys[2 * slot] != EMPTY_SLOT )
+      {
+         if ( keys[2 * slot] == b && keys[2 * slot + 1] == a )
+         {
+            reverse = counts[slot];
+            break;
+         }
+
+         slot = ( slot + 1 ) & ( size - 1 );
+      }
+
+      while ( keys[2 * forward] != a || keys[2 * forward + 1] != b )
+      {
+         forward = ( forward + 1 ) & ( size - 1 );
+      }
+
+      if ( counts[forward] > 1 || reverse > 1 )
+      {
+         s->kind[a] = KIND_LOCKED;
+         s->kind[b] = KIND_LOCKED;
+      }
+      else if ( reverse == 0 )
+      {
+         const GLfloat *pa = s->positions + 3 * a;
+         const GLfloat *pb = s->positions + 3 * b;
+         const GLuint  *t = s->indices + tri * 3;
+         GLfloat n[3], edge[3], plane[3], length;
+         Quadric q;
+
+         for ( k = 0; k < 2; k++ )
+         {
+            GLuint v = k == 0 ? a : b;
+
+            if ( s->kind[v] == KIND_FREE )
+            {
+               s->kind[v] = lockBorder ? KIND_LOCKED : KIND_BORDER;
+            }
+         }
+
+         // Plane through the edge, perpendicular to the triangle
+         TriangleNormal ( n, s->positions + 3 * t[0], s->positions + 3 * t[1], s->positions + 3 * t[2] );
+         edge[0] = pb[0] - pa[0];
+         edge[1] = pb[1] - pa[1];
+         edge[2] = pb[2] - pa[2];
+         plane[0] = edge[1] * n[2] - edge[2] * n[1];
+         plane[1] = edge[2] * n[0] - edge[0] * n[2];
+         plane[2] = edge[0] * n[1] - edge[1] * n[0];
+         length = sqrtf ( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+
+         if ( length > 0.0f )
+         {
+            GLfloat edgeLength = sqrtf ( edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2] );
+
+            plane[0] /= length;
+            plane[1] /= length;
+            plane[2] /= length;
+            QuadricFromPlane ( &q, plane, -( plane[0] * pa[0] + plane[1] * pa[1] + plane[2] * pa[2] ),
+                               BORDER_WEIGHT * edgeLength * edgeLength );
+            // Only the distance counts, the border adds no area
+            q.w = 0.0f;
+            QuadricAdd ( &s->quadrics[a], &q );
+            QuadricAdd ( &s->quadrics[b], &q );
+         }
+      }
+   }
+
+   esFree ( keys );
+   esFree ( counts );
+   return GL_TRUE;
+}
+
+///
+// BuildAdjacency()
+//
+//    Compressed lists of the triangles using each vertex: triangles[offsets[v]]
+//    .. triangles[offsets[v + 1] - 1]
+//
+static void BuildAdjacency ( Simplifier *s )
+{
+   int numIndices = s->numTriangles * 3;
+   int i;
+
+   memset ( s->offsets, 0, sizeof ( int ) * ( s->numVertices + 1 ) );
+
+   for ( i = 0; i < numIndices; i++ )
+   {
+      s->offsets[s->indices[i] + 1]++;
+   }
+
+   for ( i = 0; i < s->numVertices; i++ )
+   {
+      s->offsets[i + 1] += s->offsets[i];
+   }
+
+   for ( i = 0; i < numIndices; i++ )
+   {
+      s->triangles[s->offsets[s->indices[i]]++] = i / 3;
+   }
+
+   // Filling moved each offset to the start of the next list
+   for ( i = s->numVertices; i > 0; i-- )
+   {
+      s->offsets[i] = s->offsets[i - 1];
+   }
+
+   s->offsets[0] = 0;
+}
+
+///
+// TriangleQuadrics()
+//
+//    esParallelFor callback, the plane quadric of triangles [begin, end)
+//
+static void TriangleQuadrics ( void *context, int begin, int end )
+{
+   Simplifier *s = ( Simplifier * ) context;
+   int i;
+
+   for ( i = begin; i < end; i++ )
+   {
+      const GLuint *t = s->indices + i * 3;
+      const GLfloat *p0 = s->positions + 3 * t[0];
+      GLfloat n[3], area;
+
+      TriangleNormal ( n, p0, s->positions + 3 * t[1], s->positions + 3 * t[2] );
+      area = sqrtf ( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+      if ( area > 0.0f )
+      {
+         n[0] /= area;
+         n[1] /= area;
+         n[2] /= area;
+      }
+
+      QuadricFromPlane ( &s->triangleQuadrics[i], n, -( n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2] ),
+                         area * 0.5f );
+   }
+}
+
+///
+// VertexQuadrics()
+//
+//    esParallelFor callback, sums the triangle quadrics around vertices
+//    [begin, end) into their welded vertex.  The first vertex of a position
+//    walks the ring of the others, so no two threads write the same quadric.
+//
+static void VertexQuadrics ( void *context, int begin, int end )
+{
+   Simplifier *s = ( Simplifier * ) context;
+   int i, j;
+
+   for ( i = begin; i < end; i++ )
+   {
+      Quadric *q = &s->quadrics[i];
+      GLuint   k = i;
+
+      memset ( q, 0, sizeof ( Quadric ) );
+
+      if ( s->weld[i] != ( GLuint ) i )
+      {
+         continue;
+      }
+
+      do
+      {
+         for ( j = s->offsets[k]; j < s->offsets[k + 1]; j++ )
+         {
+            QuadricAdd ( q, &s->triangleQuadrics[s->triangles[j]] );
+         }
+
+         k = s->wedge[k];
+      }
+      while ( k != ( GLuint ) i );
+   }
+}
+
+///
+// CollapseCost()
+//
+//    Error of moving v onto u, FLT_MAX if the collapse is not allowed
+//
+static GLfloat CollapseCost ( const Simplifier *s, GLuint v, GLuint u )
+{
+   Quadric q;
+   GLfloat cost;
+   int     i;
+
+   if ( s->kind[v] == KIND_LOCKED )
+   {
+      return FLT_MAX;
+   }
+
+   // A border vertex may only slide along the border, an edge with one triangle
+   if ( s->kind[v] == KIND_BORDER )
+   {
+      int shared = 0;
+
+      if ( s->kind[s->weld[u]] == KIND_FREE )
+      {
+         return FLT_MAX;
+      }
+
+      for ( i = s->offsets[v]; i < s->offsets[v + 1]; i++ )
+      {
+         const GLuint *t = s->indices + s->triangles[i] * 3;
+
+         shared += s->weld[t[0]] == s->weld[u] || s->weld[t[1]] == s->weld[u] || s->weld[t[2]] == s->weld[u];
+      }
+
+      if ( shared != 1 )
+      {
+         return FLT_MAX;
+      }
+   }
+
+   q = s->quadrics[v];
+   QuadricAdd ( &q, &s->quadrics[s->weld[u]] );
+   cost = QuadricError ( &q, s->positions + 3 * u );
+
+   for ( i = 0; i < s->numAttribs; i++ )
+   {
+      GLfloat d = s->attribs[v * s->numAttribs + i] - s->attribs[u * s->numAttribs + i];
+      cost += d * d;
+   }
+
+   return cost;
+}
+
+///
+// CollapseCosts()
+//
+//    esParallelFor callback, picks the cheaper direction of collapses
+//    [begin, end) and its cost
+//
+static void CollapseCosts ( void *context, int begin, int end )
+{
+   Simplifier *s = ( Simplifier * ) context;
+   int i;
+
+   for ( i = begin; i < end; i++ )
+   {
+      Collapse *c = &s->collapses[i];
+      GLfloat forward = CollapseCost ( s, c->v, c->u );
+      GLfloat backward = CollapseCost ( s, c->u, c->v );
+
+      if ( backward < forward )
+      {
+         GLuint v = c->v;
+
+         c->v = c->u;
+         c->u = v;
+         forward = backward;
+      }
+
+      c->cost = forward;
+   }
+}
+
+///
+// SortCollapses()
+//
+//    Counting sort of the collapses into sorted, cheapest first.  Costs in
+//    one bucket keep their edge order, so the result is deterministic.
+//
+static void SortCollapses ( Simplifier *s )
+{
+   int i, sum = 0;
+
+   memset ( s->buckets, 0, sizeof ( int ) * COST_BUCKETS );
+
+   for ( i = 0; i < s->numCollapses; i++ )
+   {
+      GLuint bits;
+
+      memcpy ( &bits, &s->collapses[i].cost, sizeof ( bits ) );
+      s->buckets[bits >> COST_BUCKET_SHIFT]++;
+   }
+
+   for ( i = 0; i < COST_BUCKETS; i++ )
+   {
+      int count = s->buckets[i];
+
+      s->buckets[i] = sum;
+      sum += count;
+   }
+
+   for ( i = 0; i < s->numCollapses; i++ )
+   {
+      GLuint bits;
+
+      memcpy ( &bits, &s->collapses[i].cost, sizeof ( bits ) );
+      s->sorted[s->buckets[bits >> COST_BUCKET_SHIFT]++] = s->collapses[i];
+   }
+}
+
+///
+// HasHalfEdge()
+//
+//    TRUE if a triangle of the adjacency has the half-edge a -> b
+//
+static GLboolean HasHalfEdge ( const Simplifier *s, GLuint a, GLuint b )
+{
+   int i, k;
+
+   for ( i = s->offsets[b]; i < s->offsets[b + 1]; i++ )
+   {
+      const GLuint *t = s->indices + s->triangles[i] * 3;
+
+      for ( k = 0; k < 3; k++ )
+      {
+         if ( t[k] == a && t[( k + 1 ) % 3] == b )
+         {
+            return GL_TRUE;
+         }
+      }
+   }
+
+   return GL_FALSE;
+}
+
+///
+// GatherCollapses()
+//
+//    One candidate per edge: half-edges a -> b with a < b, and those with
+//    a > b that have no opposite half-edge
+//
+static void GatherCollapses ( Simplifier *s )
+{
+   int numEdges = s->numTriangles * 3;
+   int i;
+
+   s->numCollapses = 0;
+
+   for ( i = 0; i < numEdges; i++ )
+   {
+      GLuint a = s->indices[i];
+      GLuint b = s->indices[i / 3 * 3 + ( i + 1 ) % 3];
+
+      if ( a < b || !HasHalfEdge ( s, b, a ) )
+      {
+         s->collapses[s->numCollapses].v = a;
+         s->collapses[s->numCollapses].u = b;
+         s->numCollapses++;
+      }
+   }
+}
+
+///
+// CollapseRemoves()
+//
+//    Number of triangles collapsing v onto u removes, -1 if it would flip
+//    or fold a triangle.  Triangles are read through remap, so collapses
+//    made earlier in the pass are seen.
+//
+static int CollapseRemoves ( const Simplifier *s, const GLuint *remap, GLuint v, GLuint u )
+{
+   const GLfloat *pu = s->positions + 3 * u;
+   int removed = 0;
+   int i, k;
+
+   for ( i = s->offsets[v]; i < s->offsets[v + 1]; i++ )
+   {
+      const GLuint *t = s->indices + s->triangles[i] * 3;
+      const GLfloat *p[3], *moved[3];
+      GLuint  c[3];
+      GLfloat before[3], after[3], lengths;
+
+      for ( k = 0; k < 3; k++ )
+      {
+         c[k] = remap[t[k]];
+         p[k] = moved[k] = s->positions + 3 * c[k];
+
+         if ( c[k] == v )
+         {
+            moved[k] = pu;
+         }
+      }
+
+      if ( c[0] == u || c[1] == u || c[2] == u )
+      {
+         removed++;
+         continue;
+      }
+
+      if ( c[0] == c[1] || c[1] == c[2] || c[2] == c[0] )
+      {
+         // Already folded by an earlier collapse, dropped at the end of the pass
+         continue;
+      }
+
+      TriangleNormal ( before, p[0], p[1], p[2] );
+      TriangleNormal ( after, moved[0], moved[1], moved[2] );
+      lengths = sqrtf ( ( before[0] * before[0] + before[1] * before[1] + before[2] * before[2] ) *
+                        ( after[0] * after[0] + after[1] * after[1] + after[2] * after[2] ) );
+
+      if ( before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= MIN_NORMAL_COS * lengths )
+      {
+         return -1;
+      }
+   }
+
+   return removed;
+}
+
+///
+// CompactTriangles()
+//
+//    Apply a pass's collapses and drop the triangles they folded
+//
+static void CompactTriangles ( Simplifier *s, const GLuint *remap )
+{
+   int numTriangles = 0;
+   int i;
+
+   for ( i = 0; i < s->numTriangles; i++ )
+   {
+      GLuint a = remap[s->indices[i * 3 + 0]];
+      GLuint b = remap[s->indices[i * 3 + 1]];
+      GLuint c = remap[s->indices[i * 3 + 2]];
+
+      if ( a != b && b != c && c != a )
+      {
+         s->indices[numTriangles * 3 + 0] = a;
+         s->indices[numTriangles * 3 + 1] = b;
+         s->indices[numTriangles * 3 + 2] = c;
+         numTriangles++;
+      }
+   }
+
+   s->numTriangles = numTriangles;
+}
+
+///
+// SimplifierInit()
+//
+//    Copy and normalize the vertices and the triangles that do not already
+//    fold onto a welded position.  Returns the scale from mesh units to
+//    the unit cube, 0 if memory ran out.
+//
+static GLfloat SimplifierInit ( Simplifier *s, const GLuint *indices, int numIndices,
+                                const ESMeshLayout *layout, const GLvoid *vertices, int numVertices,
+                                const GLfloat *weights )
+{
+   const GLubyte *base = ( const GLubyte * ) vertices;
+   const GLubyte *positions = base + layout->offset[ES_MESH_POSITION];
+   GLfloat minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+   GLfloat maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+   GLfloat extent = 0.0f;
+   int     numTriangles = numIndices / 3;
+   int     i, k, a;
+
+   memset ( s, 0, sizeof ( Simplifier ) );
+   s->numVertices = numVertices;
+
+   for ( a = ES_MESH_NORMAL; a < ES_MESH_MAX_ATTRIBS; a++ )
+   {
+      if ( weights != NULL && weights[a] > 0.0f && layout->offset[a] >= 0 )
+      {
+         s->numAttribs += a == ES_MESH_TEXCOORD ? 2 : 3;
+      }
+   }
+
+   s->positions = esMalloc ( sizeof ( GLfloat ) * 3 * numVertices );
+   s->attribs = esMalloc ( sizeof ( GLfloat ) * ( s->numAttribs * numVertices + 1 ) );
+   s->weld = esMalloc ( sizeof ( GLuint ) * numVertices );
+   s->wedge = esMalloc ( sizeof ( GLuint ) * numVertices );
+   s->kind = esCalloc ( numVertices, 1 );
+   s->quadrics = esMalloc ( sizeof ( Quadric ) * numVertices );
+   s->triangleQuadrics = esMalloc ( sizeof ( Quadric ) * ( numTriangles + 1 ) );
+   s->indices = esMalloc ( sizeof ( GLuint ) * ( numIndices + 1 ) );
+   s->offsets = esMalloc ( sizeof ( int ) * ( numVertices + 1 ) );
+   s->triangles = esMalloc ( sizeof ( int ) * ( numIndices + 1 ) );
+   s->collapses = esMalloc ( sizeof ( Collapse ) * ( numIndices + 1 ) );
+   s->sorted = esMalloc ( sizeof ( Collapse ) * ( numIndices + 1 ) );
+   s->buckets = esMalloc ( sizeof ( int ) * COST_BUCKETS );
+
+   if ( s->positions == NULL || s->attribs == NULL || s->weld == NULL || s->wedge == NULL || s->kind == NULL ||
+        s->quadrics == NULL || s->triangleQuadrics == NULL || s->indices == NULL ||
+        s->offsets == NULL || s->triangles == NULL || s->collapses == NULL ||
+        s->sorted == NULL || s->buckets == NULL ||
+        !WeldVertices ( s, positions, layout->stride ) )
+   {
+      return 0.0f;
+   }
+
+   for ( i = 0; i < numVertices; i++ )
+   {
+      const GLfloat *p = ( const GLfloat * ) ( positions + ( GLsizeiptr ) i * layout->stride );
+
+      for ( k = 0; k < 3; k++ )
+      {
+         minimum[k] = p[k] < minimum[k] ? p[k] : minimum[k];
+         maximum[k] = p[k] > maximum[k] ? p[k] : maximum[k];
+      }
+   }
+
+   for ( k = 0; k < 3; k++ )
+   {
+      extent = maximum[k] - minimum[k] > extent ? maximum[k] - minimum[k] : extent;
+   }
+
+   extent = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+   for ( i = 0; i < numVertices; i++ )
+   {
+      const GLfloat *p = ( const GLfloat * ) ( positions + ( GLsizeiptr ) i * layout->stride );
+      GLfloat *attrib = s->attribs + i * s->numAttribs;
+
+      for ( k = 0; k < 3; k++ )
+      {
+         s->positions[i * 3 + k] = ( p[k] - minimum[k] ) * extent;
+      }
+
+      for ( a = ES_MESH_NORMAL; a < ES_MESH_MAX_ATTRIBS; a++ )
+      {
+         if ( weights != NULL && weights[a] > 0.0f && layout->offset[a] >= 0 )
+         {
+            const GLfloat *value = ( const GLfloat * ) ( base + ( GLsizeiptr ) i * layout->stride + layout->offset[a] );
+
+            for ( k = 0; k < ( a == ES_MESH_TEXCOORD ? 2 : 3 ); k++ )
+            {
+               *attrib++ = value[k] * weights[a];
+            }
+         }
+      }
+   }
+
+   for ( i = 0; i < numTriangles; i++ )
+   {
+      const GLuint *t = indices + i * 3;
+
+      if ( s->weld[t[0]] != s->weld[t[1]] && s->weld[t[1]] != s->weld[t[2]] &&
+           s->weld[t[2]] != s->weld[t[0]] )
+      {
+         memcpy ( s->indices + s->numTriangles * 3, t, sizeof ( GLuint ) * 3 );
+         s->numTriangles++;
+      }
+   }
+
+   return extent;
+}
+
+///
+// SimplifierFree()
+//
+static void SimplifierFree ( Simplifier *s )
+{
+   esFree ( s->positions );
+   esFree ( s->attribs );
+   esFree ( s->weld );
+   esFree ( s->wedge );
+   esFree ( s->kind );
+   esFree ( s->quadrics );
+   esFree ( s->triangleQuadrics );
+   esFree ( s->indices );
+   esFree ( s->offsets );
+   esFree ( s->triangles );
+   esFree ( s->collapses );
+   esFree ( s->sorted );
+   esFree ( s->buckets );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+int ESUTIL_API
+esSimplifyMesh ( GLuint *result, const GLuint *indices, int numIndices, const ESMeshLayout *layout,
+                 const GLvoid *vertices, int numVertices, const ESSimplifyParams *params, GLfloat *error )
+{
+   Simplifier s;
+   GLuint    *remap;
+   GLubyte   *touched;
+   GLfloat    scale, errorLimit, maxCost = 0.0f;
+   int        target = params->targetTriangles;
+   int        i;
+
+   if ( error != NULL )
+   {
+      *error = 0.0f;
+   }
+
+   if ( layout->offset[ES_MESH_POSITION] < 0 || numIndices < 3 || numVertices <= 0 )
+   {
+      return 0;
+   }
+
+   scale = SimplifierInit ( &s, indices, numIndices, layout, vertices, numVertices, params->attribWeights );
+   remap = esMalloc ( sizeof ( GLuint ) * numVertices );
+   touched = esMalloc ( numVertices );
+
+   if ( scale != 0.0f && remap != NULL && touched != NULL )
+   {
+      // Surface planes, then the border planes on top
+      BuildAdjacency ( &s );
+      esParallelFor ( s.numTriangles, MIN_ITEMS_PER_THREAD, TriangleQuadrics, &s );
+      esParallelFor ( numVertices, MIN_ITEMS_PER_THREAD, VertexQuadrics, &s );
+   }
+
+   if ( scale == 0.0f || remap == NULL || touched == NULL ||
+        !FindEdges ( &s, ( params->flags & ES_SIMPLIFY_LOCK_BORDER ) != 0 ) )
+   {
+      SimplifierFree ( &s );
+      esFree ( remap );
+      esFree ( touched );
+      return 0;
+   }
+
+   errorLimit = params->targetError > 0.0f ? params->targetError * scale : FLT_MAX;
+   errorLimit = errorLimit < sqrtf ( FLT_MAX ) ? errorLimit * errorLimit : FLT_MAX;
+   target = target > 1 ? target : 1;
+
+   // Each pass collapses the cheapest edges whose ends no other collapse of
+   // the pass has touched, then costs are brought up to date
+   while ( s.numTriangles > target )
+   {
+      int     goal = ( s.numTriangles - target + 1 ) / 2;
+      int     numTriangles = s.numTriangles;
+      int     collapsed = 0;
+      GLfloat passLimit = errorLimit;
+
+      GatherCollapses ( &s );
+      esParallelFor ( s.numCollapses, MIN_ITEMS_PER_THREAD, CollapseCosts, &s );
+      SortCollapses ( &s );
+
+      // Collapses blocked by cheaper ones in the pass wait for the next pass
+      // rather than giving way to much dearer ones
+      if ( goal < s.numCollapses && 1.5f * s.sorted[goal].cost < passLimit )
+      {
+         passLimit = 1.5f * s.sorted[goal].cost;
+      }
+
+      for ( i = 0; i < numVertices; i++ )
+      {
+         remap[i] = i;
+      }
+
+      memset ( touched, 0, numVertices );
+
+      for ( i = 0; i < s.numCollapses && collapsed < goal && numTriangles > target; i++ )
+      {
+         const Collapse *c = &s.sorted[i];
+         int removed;
+
+         if ( c->cost > passLimit )
+         {
+            break;
+         }
+
+         if ( touched[c->v] || touched[c->u] )
+         {
+            continue;
+         }
+
+         removed = CollapseRemoves ( &s, remap, c->v, c->u );
+
+         if ( removed < 0 || numTriangles - removed < 1 )
+         {
+            continue;
+         }
+
+         remap[c->v] = c->u;
+         touched[c->v] = touched[c->u] = 1;
+         QuadricAdd ( &s.quadrics[s.weld[c->u]], &s.quadrics[c->v] );
+         numTriangles -= removed;
+         maxCost = c->cost > maxCost ? c->cost : maxCost;
+         collapsed++;
+      }
+
+      if ( collapsed == 0 )
+      {
+         break;
+      }
+
+      CompactTriangles ( &s, remap );
+      BuildAdjacency ( &s );
+   }
+
+   memcpy ( result, s.indices, sizeof ( GLuint ) * s.numTriangles * 3 );
+
+   if ( error != NULL )
+   {
+      *error = sqrtf ( maxCost ) / scale;
+   }
+
+   i = s.numTriangles * 3;
+   SimplifierFree ( &s );
+   esFree ( remap );
+   esFree ( touched );
+   return i;
+}
+
+GLboolean ESUTIL_API
+esGenMeshLods ( ESMesh *result, const ESMesh *mesh, int numLods, GLfloat ratio, const ESSimplifyParams *params )
+{
+   ESSimplifyParams levelParams = *params;
+   GLuint    *indices[ES_MESH_MAX_LODS];
+   int        counts[ES_MESH_MAX_LODS];
+   ESMeshLod  bound;
+   GLsizeiptr vertexSize = ( GLsizeiptr ) mesh->numVertices * mesh->layout.stride;
+   int        numIndices = 0;
+   int        k, levels;
+   GLboolean  ok = GL_TRUE;
+
+   memset ( result, 0, sizeof ( ESMesh ) );
+
+   if ( mesh->mode != GL_TRIANGLES || mesh->vertices == NULL || numLods < 1 )
+   {
+      return GL_FALSE;
+   }
+
+   numLods = numLods < ES_MESH_MAX_LODS ? numLods : ES_MESH_MAX_LODS;
+   bound = mesh->lods[0];
+
+   if ( mesh->numLods == 0 )
+   {
+      bound.firstIndex = 0;
+      bound.numIndices = mesh->numIndices;
+   }
+
+   indices[0] = mesh->indices + bound.firstIndex;
+   counts[0] = bound.numIndices;
+   levels = 1;
+
+   // Each level is simplified from the one before, which is both faster and
+   // keeps the chain nested
+   for ( k = 1; k < numLods; k++ )
+   {
+      levelParams.targetTriangles = ( int ) ( ( GLfloat ) ( counts[k - 1] / 3 ) * ratio );
+      indices[k] = esMalloc ( sizeof ( GLuint ) * counts[k - 1] );
+
+      if ( indices[k] == NULL )
+      {
+         ok = GL_FALSE;
+         break;
+      }
+
+      counts[k] = esSimplifyMesh ( indices[k], indices[k - 1], counts[k - 1], &mesh->layout,
+                                   mesh->vertices, mesh->numVertices, &levelParams, NULL );
+
+      // Stop once simplification stalls on the error limit or locked vertices
+      if ( counts[k] == 0 || counts[k] == counts[k - 1] )
+      {
+         ok = counts[k] != 0;
+         esFree ( indices[k] );
+         break;
+      }
+
+      levels++;
+   }
+
+   for ( k = 0; k < levels; k++ )
+   {
+      numIndices += counts[k];
+   }
+
+   if ( ok )
+   {
+      result->vertices = esMalloc ( vertexSize + sizeof ( GLuint ) * numIndices );
+      ok = result->vertices != NULL;
+   }
+
+   if ( ok )
+   {
+      result->layout = mesh->layout;
+      result->mode = GL_TRIANGLES;
+      result->numVertices = mesh->numVertices;
+      result->numIndices = numIndices;
+      result->indexOffset = vertexSize;
+      result->size = vertexSize + sizeof ( GLuint ) * numIndices;
+      result->indices = ( GLuint * ) ( ( GLubyte * ) result->vertices + vertexSize );
+      result->allocated = GL_TRUE;
+      result->numLods = levels;
+      memcpy ( result->vertices, mesh->vertices, vertexSize );
+
+      numIndices = 0;
+
+      for ( k = 0; k < levels; k++ )
+      {
+         ESMeshLod *lod = &result->lods[k];
+
+         // Collapses only move vertices onto others, so the bound still holds
+         *lod = bound;
+         lod->firstIndex = numIndices;
+         lod->numIndices = counts[k];
+         lod->firstVertex = 0;
+         lod->numVertices = mesh->numVertices;
+         memcpy ( result->indices + numIndices, indices[k], sizeof ( GLuint ) * counts[k] );
+         numIndices += counts[k];
+      }
+   }
+
+   for ( k = 1; k < levels; k++ )
+   {
+      esFree ( indices[k] );
+   }
+
+   return ok;
+}
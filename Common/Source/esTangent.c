@@ -0,0 +1,446 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESTangent.c
+//
+//    Tangent frames for normal mapping, packed with the normal as one
+//    snorm16 quaternion (QTangent) per vertex.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_thread.h"
+#include <string.h>
+#include <math.h>
+
+///
+// Defines
+//
+
+/// Smallest number of triangles or vertices handed to a worker thread
+#define TANGENT_MIN_PER_THREAD   8192
+
+/// Floats accumulated per vertex: tangent, bitangent and the number of triangles
+#define FRAME_FLOATS   7
+
+/// Smallest |w| kept so snorm16 can still hold the sign that carries the handedness
+#define QTANGENT_MIN_W   ( 1.0f / 32767.0f )
+
+///
+//  Types
+//
+
+/// Shared state of the esParallelFor passes of esGenTangents
+typedef struct
+{
+   const GLubyte *vertices;
+   GLsizei        stride;
+   GLint          position;
+   GLint          normal;
+   GLint          texCoord;
+   const GLuint  *indices;
+   /// Area weighted tangent and bitangent of each triangle
+   GLfloat       *faces;
+   /// FRAME_FLOATS per vertex, summed from the faces
+   GLfloat       *frames;
+   GLubyte       *result;
+   GLsizei        resultStride;
+} TangentJob;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Attrib()
+//
+static const GLfloat *Attrib ( const TangentJob *job, GLuint v, GLint offset )
+{
+   return ( const GLfloat * ) ( job->vertices + ( GLsizeiptr ) v * job->stride + offset );
+}
+
+///
+// Cross()
+//
+static void Cross ( GLfloat result[3], const GLfloat a[3], const GLfloat b[3] )
+{
+   result[0] = a[1] * b[2] - a[2] * b[1];
+   result[1] = a[2] * b[0] - a[0] * b[2];
+   result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+///
+// Dot()
+//
+static GLfloat Dot ( const GLfloat a[3], const GLfloat b[3] )
+{
+   return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+///
+// FaceRange()
+//
+//    esParallelFor callback, the tangent and bitangent of triangles [begin, end).
+//    Both are scaled to the triangle's area, so large triangles weigh more at
+//    the vertices they share; triangles with no texture area give zero.
+//
+static void FaceRange ( void *context, int begin, int end )
+{
+   const TangentJob *job = ( const TangentJob * ) context;
+   int t, c;
+
+   for ( t = begin; t < end; t++ )
+   {
+      const GLuint  *tri = job->indices + 3 * t;
+      const GLfloat *p0 = Attrib ( job, tri[0], job->position );
+      const GLfloat *p1 = Attrib ( job, tri[1], job->position );
+      const GLfloat *p2 = Attrib ( job, tri[2], job->position );
+      const GLfloat *uv0 = Attrib ( job, tri[0], job->texCoord );
+      const GLfloat *uv1 = Attrib ( job, tri[1], job->texCoord );
+      const GLfloat *uv2 = Attrib ( job, tri[2], job->texCoord );
+      GLfloat *face = job->faces + 6 * t;
+      GLfloat  e1[3], e2[3], n[3];
+      GLfloat  du1 = uv1[0] - uv0[0], dv1 = uv1[1] - uv0[1];
+      GLfloat  du2 = uv2[0] - uv0[0], dv2 = uv2[1] - uv0[1];
+      GLfloat  det = du1 * dv2 - du2 * dv1;
+      GLfloat  area, lenT, lenB;
+
+      for ( c = 0; c < 3; c++ )
+      {
+         e1[c] = p1[c] - p0[c];
+         e2[c] = p2[c] - p0[c];
+      }
+
+      // Directions of increasing s and t, times det
+      for ( c = 0; c < 3; c++ )
+      {
+         face[c] = e1[c] * dv2 - e2[c] * dv1;
+         face[3 + c] = e2[c] * du1 - e1[c] * du2;
+      }
+
+      Cross ( n, e1, e2 );
+      area = sqrtf ( Dot ( n, n ) );
+      lenT = sqrtf ( Dot ( face, face ) );
+      lenB = sqrtf ( Dot ( face + 3, face + 3 ) );
+
+      if ( det == 0.0f || lenT == 0.0f || lenB == 0.0f )
+      {
+         memset ( face, 0, sizeof ( GLfloat ) * 6 );
+         continue;
+      }
+
+      // A mirrored mapping has a negative det; dividing by its sign keeps the
+      // vectors pointing along +s and +t
+      lenT = det < 0.0f ? -lenT : lenT;
+      lenB = det < 0.0f ? -lenB : lenB;
+
+      for ( c = 0; c < 3; c++ )
+      {
+         face[c] *= area / lenT;
+         face[3 + c] *= area / lenB;
+      }
+   }
+}
+
+///
+// FrameToQTangent()
+//
+//    The rotation taking x, y and z to the orthonormal tangent, n x t and normal,
+//    in the esQuatTransformVector convention, with w made positive and then
+//    negated for a left-handed frame
+//
+static void FrameToQTangent ( ESQuat *q, const GLfloat t[3], const GLfloat n[3], GLfloat handedness )
+{
+   GLfloat b[3];
+   GLfloat trace, s;
+
+   Cross ( b, n, t );
+
+   // Rotation matrix with columns t, b, n, so m[row][col] is ( t, b, n )[col][row].
+   // esQuatTransformVector rotates by the conjugate, hence the negated x, y, z.
+   trace = t[0] + b[1] + n[2];
+
+   if ( trace > 0.0f )
+   {
+      s = 0.5f / sqrtf ( trace + 1.0f );
+      q->w = 0.25f / s;
+      q->x = ( n[1] - b[2] ) * s;
+      q->y = ( t[2] - n[0] ) * s;
+      q->z = ( b[0] - t[1] ) * s;
+   }
+   else if ( t[0] > b[1] && t[0] > n[2] )
+   {
+      s = 2.0f * sqrtf ( 1.0f + t[0] - b[1] - n[2] );
+      q->w = ( b[2] - n[1] ) / s;
+      q->x = -0.25f * s;
+      q->y = -( b[0] + t[1] ) / s;
+      q->z = -( n[0] + t[2] ) / s;
+   }
+   else if ( b[1] > n[2] )
+   {
+      s = 2.0f * sqrtf ( 1.0f + b[1] - t[0] - n[2] );
+      q->w = ( n[0] - t[2] ) / s;
+      q->x = -( b[0] + t[1] ) / s;
+      q->y = -0.25f * s;
+      q->z = -( n[1] + b[2] ) / s;
+   }
+   else
+   {
+      s = 2.0f * sqrtf ( 1.0f + n[2] - t[0] - b[1] );
+      q->w = ( t[1] - b[0] ) / s;
+      q->x = -( n[0] + t[2] ) / s;
+      q->y = -( n[1] + b[2] ) / s;
+      q->z = -0.25f * s;
+   }
+
+   esQuatNormalize ( q, q );
+
+   if ( q->w < 0.0f )
+   {
+      q->x = -q->x;
+      q->y = -q->y;
+      q->z = -q->z;
+      q->w = -q->w;
+   }
+
+   // q and -q are the same rotation, so the sign of w is free to carry the handedness
+   if ( q->w < QTANGENT_MIN_W )
+   {
+      GLfloat scale = sqrtf ( 1.0f - QTANGENT_MIN_W * QTANGENT_MIN_W );
+
+      q->x *= scale;
+      q->y *= scale;
+      q->z *= scale;
+      q->w = QTANGENT_MIN_W;
+   }
+
+   if ( handedness < 0.0f )
+   {
+      q->x = -q->x;
+      q->y = -q->y;
+      q->z = -q->z;
+      q->w = -q->w;
+   }
+}
+
+///
+// VertexRange()
+//
+//    esParallelFor callback, orthonormalizes and packs the frames of the used
+//    vertices in [begin, end)
+//
+static void VertexRange ( void *context, int begin, int end )
+{
+   const TangentJob *job = ( const TangentJob * ) context;
+   int v, c;
+
+   for ( v = begin; v < end; v++ )
+   {
+      const GLfloat *frame = job->frames + FRAME_FLOATS * v;
+      const GLfloat *normal = Attrib ( job, v, job->normal );
+      GLfloat n[3], t[3], b[3];
+      GLfloat len, d;
+      ESQuat  q;
+
+      if ( frame[6] == 0.0f )
+      {
+         continue;
+      }
+
+      len = sqrtf ( Dot ( normal, normal ) );
+
+      if ( len > 0.0f )
+      {
+         for ( c = 0; c < 3; c++ )
+         {
+            n[c] = normal[c] / len;
+         }
+      }
+      else
+      {
+         n[0] = 0.0f;
+         n[1] = 0.0f;
+         n[2] = 1.0f;
+      }
+
+      // Gram-Schmidt the tangent against the normal
+      d = Dot ( n, frame );
+
+      for ( c = 0; c < 3; c++ )
+      {
+         t[c] = frame[c] - n[c] * d;
+      }
+
+      len = Dot ( t, t );
+
+      if ( len < 1e-12f )
+      {
+         // No usable tangent: take one from the bitangent, or any direction
+         // across the normal
+         Cross ( t, frame + 3, n );
+         len = Dot ( t, t );
+
+         if ( len < 1e-12f )
+         {
+            GLfloat axis[3] = { 0.0f, 0.0f, 0.0f };
+
+            axis[fabsf ( n[0] ) < 0.57735f ? 0 : fabsf ( n[1] ) < 0.57735f ? 1 : 2] = 1.0f;
+            Cross ( t, axis, n );
+            Cross ( t, n, t );
+            len = Dot ( t, t );
+         }
+      }
+
+      len = 1.0f / sqrtf ( len );
+
+      for ( c = 0; c < 3; c++ )
+      {
+         t[c] *= len;
+      }
+
+      Cross ( b, n, t );
+      FrameToQTangent ( &q, t, n, Dot ( b, frame + 3 ) < 0.0f ? -1.0f : 1.0f );
+      esQuatPack ( ( ESQuatPacked * ) ( job->result + ( GLsizeiptr ) v * job->resultStride ), &q );
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+GLboolean ESUTIL_API
+esGenTangents ( ESQuatPacked *result, GLsizei stride, const ESMeshLayout *layout, const GLvoid *vertices,
+                int numVertices, const GLuint *indices, int numIndices )
+{
+   TangentJob job;
+   int numTriangles = numIndices / 3;
+   int t, k, c;
+
+   if ( layout->offset[ES_MESH_POSITION] < 0 || layout->offset[ES_MESH_NORMAL] < 0 ||
+         layout->offset[ES_MESH_TEXCOORD] < 0 || numIndices % 3 != 0 || numVertices < 0 )
+   {
+      return GL_FALSE;
+   }
+
+   job.vertices = ( const GLubyte * ) vertices;
+   job.stride = layout->stride;
+   job.position = layout->offset[ES_MESH_POSITION];
+   job.normal = layout->offset[ES_MESH_NORMAL];
+   job.texCoord = layout->offset[ES_MESH_TEXCOORD];
+   job.indices = indices;
+   job.result = ( GLubyte * ) result;
+   job.resultStride = stride != 0 ? stride : ( GLsizei ) sizeof ( ESQuatPacked );
+   job.faces = esMalloc ( sizeof ( GLfloat ) * 6 * ( numTriangles > 0 ? numTriangles : 1 ) );
+   job.frames = esCalloc ( numVertices > 0 ? numVertices : 1, sizeof ( GLfloat ) * FRAME_FLOATS );
+
+   if ( job.faces == NULL || job.frames == NULL )
+   {
+      esFree ( job.faces );
+      esFree ( job.frames );
+      return GL_FALSE;
+   }
+
+   esParallelFor ( numTriangles, TANGENT_MIN_PER_THREAD, FaceRange, &job );
+
+   // Scattering to the corners is left to one thread; it is a few adds per index
+   for ( t = 0; t < numTriangles; t++ )
+   {
+      const GLfloat *face = job.faces + 6 * t;
+
+      for ( k = 0; k < 3; k++ )
+      {
+         GLfloat *frame = job.frames + FRAME_FLOATS * indices[3 * t + k];
+
+         for ( c = 0; c < 6; c++ )
+         {
+            frame[c] += face[c];
+         }
+
+         frame[6] += 1.0f;
+      }
+   }
+
+   esParallelFor ( numVertices, TANGENT_MIN_PER_THREAD, VertexRange, &job );
+
+   esFree ( job.faces );
+   esFree ( job.frames );
+   return GL_TRUE;
+}
+
+GLboolean ESUTIL_API
+esGenMeshTangents ( ESQuatPacked *result, GLsizei stride, const ESMesh *mesh )
+{
+   int k;
+
+   if ( mesh->mode != GL_TRIANGLES || mesh->vertices == NULL )
+   {
+      return GL_FALSE;
+   }
+
+   // Coarsest level first, so vertices shared between levels end up with the
+   // frame of the finest level that uses them
+   for ( k = mesh->numLods - 1; k >= 0; k-- )
+   {
+      if ( !esGenTangents ( result, stride, &mesh->layout, mesh->vertices, mesh->numVertices,
+                            mesh->indices + mesh->lods[k].firstIndex, mesh->lods[k].numIndices ) )
+      {
+         return GL_FALSE;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+void ESUTIL_API
+esQTangentUnpack ( const ESQuatPacked *src, GLfloat normal[3], GLfloat tangent[3], GLfloat bitangent[3] )
+{
+   static const GLfloat xAxis[3] = { 1.0f, 0.0f, 0.0f };
+   static const GLfloat zAxis[3] = { 0.0f, 0.0f, 1.0f };
+   ESQuat  q;
+   GLfloat sign = src->w < 0 ? -1.0f : 1.0f;
+   int     c;
+
+   esQuatUnpack ( &q, src );
+   esQuatTransformVector ( &q, zAxis, normal );
+   esQuatTransformVector ( &q, xAxis, tangent );
+   Cross ( bitangent, normal, tangent );
+
+   for ( c = 0; c < 3; c++ )
+   {
+      bitangent[c] *= sign;
+   }
+}
@@ -0,0 +1,339 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2013 Dan Ginsburg, Budirijanto Purnomo
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// Book:      OpenGL(R) ES 3.0 Programming Guide, 2nd Edition
+// Authors:   Dan Ginsburg, Budirijanto Purnomo, Dave Shreiner, Aaftab Munshi
+// ISBN-10:   0-321-93388-5
+// ISBN-13:   978-0-321-93388-1
+// Publisher: Addison-Wesley Professional
+// URLs:      http://www.opengles-book.com
+//            http://my.safaribooksonline.com/book/animation-and-3d/9780133440133
+//
+// ESThread.c
+//
+//    Minimal worker-thread support for the batch routines in Common.  Workers
+//    are started the first time a loop needs them and then wait for the next
+//    loop, so a steady frame loop makes no thread or heap calls.  Splitting a
+//    loop still costs a wake-up per worker, so esParallelFor is only worth
+//    using when each range carries at least tens of microseconds of work.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_thread.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+///
+//  Types
+//
+typedef struct
+{
+   ESParallelFunc func;
+   void          *context;
+   int            begin;
+   int            end;
+} ESParallelRange;
+
+/// A pool thread; worker i processes ranges[i] of each loop it takes part in
+typedef struct
+{
+   int            index;
+   /// Last loop the worker has seen
+   unsigned int   generation;
+} ESWorker;
+
+///
+//  Local variables
+//
+static int s_threadCount = 1;
+
+#ifdef _WIN32
+static SRWLOCK            s_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE s_wake = CONDITION_VARIABLE_INIT;
+static CONDITION_VARIABLE s_done = CONDITION_VARIABLE_INIT;
+#define LOCK()            AcquireSRWLockExclusive ( &s_lock )
+#define UNLOCK()          ReleaseSRWLockExclusive ( &s_lock )
+#define WAIT( cond )      SleepConditionVariableSRW ( &( cond ), &s_lock, INFINITE, 0 )
+#define BROADCAST( cond ) WakeAllConditionVariable ( &( cond ) )
+#define SIGNAL( cond )    WakeConditionVariable ( &( cond ) )
+#else
+static pthread_mutex_t    s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     s_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t     s_done = PTHREAD_COND_INITIALIZER;
+#define LOCK()            pthread_mutex_lock ( &s_lock )
+#define UNLOCK()          pthread_mutex_unlock ( &s_lock )
+#define WAIT( cond )      pthread_cond_wait ( &( cond ), &s_lock )
+#define BROADCAST( cond ) pthread_cond_broadcast ( &( cond ) )
+#define SIGNAL( cond )    pthread_cond_signal ( &( cond ) )
+#endif
+
+// Pool state, guarded by s_lock.  Range 0 of a loop is run by the caller.
+static ESWorker        s_workers[ES_MAX_THREADS];
+static int             s_numWorkers = 0;
+static ESParallelRange s_ranges[ES_MAX_THREADS];
+static int             s_numRanges = 0;
+static unsigned int    s_generation = 0;
+static int             s_pending = 0;
+static int             s_busy = 0;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// ProcessorCount()
+//
+//    Number of online processors, at least 1
+//
+static int ProcessorCount ( void )
+{
+   int count;
+
+#ifdef _WIN32
+   SYSTEM_INFO info;
+   GetSystemInfo ( &info );
+   count = ( int ) info.dwNumberOfProcessors;
+#else
+   count = ( int ) sysconf ( _SC_NPROCESSORS_ONLN );
+#endif
+
+   return count > 0 ? count : 1;
+}
+
+///
+// WorkerLoop()
+//
+//    Body of a pool thread: wait for a new loop, run this worker's range if the
+//    loop has one, report it done.  Workers live as long as the process.
+//
+static void WorkerLoop ( ESWorker *worker )
+{
+   LOCK ();
+
+   for ( ;; )
+   {
+      ESParallelRange range;
+
+      while ( worker->generation == s_generation )
+      {
+         WAIT ( s_wake );
+      }
+
+      worker->generation = s_generation;
+
+      if ( worker->index >= s_numRanges )
+      {
+         continue;
+      }
+
+      range = s_ranges[worker->index];
+      UNLOCK ();
+
+      range.func ( range.context, range.begin, range.end );
+
+      LOCK ();
+
+      if ( --s_pending == 0 )
+      {
+         SIGNAL ( s_done );
+      }
+   }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI WorkerThread ( LPVOID param )
+{
+   WorkerLoop ( ( ESWorker * ) param );
+   return 0;
+}
+#else
+static void *WorkerThread ( void *param )
+{
+   WorkerLoop ( ( ESWorker * ) param );
+   return NULL;
+}
+#endif
+
+///
+// StartWorkers()
+//
+//    Grow the pool to numWorkers threads (called with s_lock held).  Returns
+//    how many are running, fewer if a thread could not be created.
+//
+static int StartWorkers ( int numWorkers )
+{
+   while ( s_numWorkers < numWorkers )
+   {
+      ESWorker *worker = &s_workers[s_numWorkers + 1];
+#ifdef _WIN32
+      HANDLE    thread;
+#else
+      pthread_t thread;
+#endif
+
+      worker->index = s_numWorkers + 1;
+      worker->generation = s_generation;
+
+#ifdef _WIN32
+      thread = CreateThread ( NULL, 0, WorkerThread, worker, 0, NULL );
+
+      if ( thread == NULL )
+      {
+         break;
+      }
+
+      CloseHandle ( thread );
+#else
+      if ( pthread_create ( &thread, NULL, WorkerThread, worker ) != 0 )
+      {
+         break;
+      }
+
+      pthread_detach ( thread );
+#endif
+      s_numWorkers++;
+   }
+
+   return s_numWorkers;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esSetThreadCount()
+//
+void ESUTIL_API esSetThreadCount ( int numThreads )
+{
+   if ( numThreads <= 0 )
+   {
+      numThreads = ProcessorCount ();
+   }
+
+   s_threadCount = numThreads > ES_MAX_THREADS ? ES_MAX_THREADS : numThreads;
+}
+
+///
+//  esGetThreadCount()
+//
+int ESUTIL_API esGetThreadCount ( void )
+{
+   return s_threadCount;
+}
+
+///
+//  esParallelFor()
+//
+void esParallelFor ( int count, int minPerThread, ESParallelFunc func, void *context )
+{
+   int numRanges = s_threadCount;
+   int i;
+
+   if ( count <= 0 )
+   {
+      return;
+   }
+
+   if ( minPerThread < 1 )
+   {
+      minPerThread = 1;
+   }
+
+   if ( numRanges > count / minPerThread )
+   {
+      numRanges = count / minPerThread;
+   }
+
+   if ( numRanges <= 1 )
+   {
+      func ( context, 0, count );
+      return;
+   }
+
+   LOCK ();
+
+   // A loop started from inside another (or from a second thread while the
+   // pool is in use) runs on the calling thread
+   if ( s_busy )
+   {
+      UNLOCK ();
+      func ( context, 0, count );
+      return;
+   }
+
+   // Only the first loop that needs more workers creates them.  If some could
+   // not be created the loop is split over the ones there are.
+   i = StartWorkers ( numRanges - 1 ) + 1;
+
+   if ( numRanges > i )
+   {
+      numRanges = i;
+   }
+
+   if ( numRanges <= 1 )
+   {
+      UNLOCK ();
+      func ( context, 0, count );
+      return;
+   }
+
+   for ( i = 0; i < numRanges; i++ )
+   {
+      s_ranges[i].func = func;
+      s_ranges[i].context = context;
+      s_ranges[i].begin = ( int ) ( ( long long ) count * i / numRanges );
+      s_ranges[i].end = ( int ) ( ( long long ) count * ( i + 1 ) / numRanges );
+   }
+
+   s_busy = 1;
+   s_numRanges = numRanges;
+   s_pending = numRanges - 1;
+   s_generation++;
+   BROADCAST ( s_wake );
+   UNLOCK ();
+
+   func ( context, s_ranges[0].begin, s_ranges[0].end );
+
+   LOCK ();
+
+   while ( s_pending > 0 )
+   {
+      WAIT ( s_done );
+   }
+
+   s_busy = 0;
+   UNLOCK ();
+}
@@ -40,14 +40,806 @@
 //  Includes
 //
 #include "esUtil.h"
+#include "esUtil_simd.h"
+#include "esUtil_thread.h"
 #include <math.h>
 #include <string.h>
 
 #define PI 3.1415926535897932384626433832795f
 
+/// Smallest number of matrices handed to a worker thread by the batch routines
+#define BATCH_MIN_PER_THREAD   4096
+
+/// Smallest number of points handed to a worker thread by esTransformPoints and friends
+#define TRANSFORM_MIN_PER_THREAD   16384
+
+///
+//  Types
+//
+typedef enum
+{
+   BATCH_SHARED_RIGHT,     // out[i] = a[i] * b
+   BATCH_SHARED_LEFT,      // out[i] = a * b[i]
+   BATCH_PAIRWISE,         // out[i] = a[i] * b[i]
+   BATCH_GATHER            // out[i] = a[i] * b[bIndex[i]] for i in index
+} BatchMode;
+
+typedef struct
+{
+   BatchMode       mode;
+   ESMatrix       *out;
+   const ESMatrix *a;
+   const ESMatrix *b;
+
+   // BATCH_GATHER only
+   const int      *index;
+   const int      *bIndex;
+} BatchMultiply;
+
+typedef enum
+{
+   TRANSFORM_POINTS,       // ( x, y, z, 1 ) * m
+   TRANSFORM_VECTORS,      // ( x, y, z, 0 ) * m
+   TRANSFORM_PROJECT,      // ( x, y, z, 1 ) * m divided by w
+   TRANSFORM_POINTS_SOA    // TRANSFORM_POINTS on separate x, y, z arrays
+} TransformMode;
+
+typedef struct
+{
+   TransformMode   mode;
+   const ESMatrix *matrix;
+
+   // Interleaved arrays, strides in bytes
+   const GLubyte  *in;
+   GLubyte        *out;
+   int             inStride;
+   int             outStride;
+
+   // Separate x, y, z arrays
+   const GLfloat  *inSoA[3];
+   GLfloat        *outSoA[3];
+} PointTransform;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+#if defined ( ES_SIMD_AVX )
+///
+// MatrixMultiplyAVX()
+//
+//    result = srcA * srcB computing two result rows per 256-bit register.
+//    Both rows of srcA are loaded before anything is stored, so result may
+//    alias either source.
+//
+static void MatrixMultiplyAVX ( GLfloat *result, const GLfloat *srcA, const GLfloat *srcB )
+{
+   __m256 b0 = _mm256_broadcast_ps ( ( const __m128 * ) ( srcB + 0 ) );
+   __m256 b1 = _mm256_broadcast_ps ( ( const __m128 * ) ( srcB + 4 ) );
+   __m256 b2 = _mm256_broadcast_ps ( ( const __m128 * ) ( srcB + 8 ) );
+   __m256 b3 = _mm256_broadcast_ps ( ( const __m128 * ) ( srcB + 12 ) );
+   __m256 a01 = _mm256_loadu_ps ( srcA + 0 );
+   __m256 a23 = _mm256_loadu_ps ( srcA + 8 );
+   __m256 r01, r23;
+
+   r01 = _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0x00 ), b0 );
+   r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0x55 ), b1 ) );
+   r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0xAA ), b2 ) );
+   r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0xFF ), b3 ) );
+
+   r23 = _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0x00 ), b0 );
+   r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0x55 ), b1 ) );
+   r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0xAA ), b2 ) );
+   r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0xFF ), b3 ) );
+
+   _mm256_storeu_ps ( result + 0, r01 );
+   _mm256_storeu_ps ( result + 8, r23 );
+}
+#endif
+
+#if defined ( ES_SIMD ) && !defined ( ES_SIMD_AVX )
+///
+// MatrixMultiplySIMD()
+//
+//    result = srcA * srcB one row at a time.  srcB is held in registers and
+//    each row of srcA is read before the matching result row is written, so
+//    result may alias either source.  The terms are accumulated in the same
+//    order as the scalar code.
+//
+static void MatrixMultiplySIMD ( GLfloat *result, const GLfloat *srcA, const GLfloat *srcB, int aligned )
+{
+   esVec4 b0, b1, b2, b3;
+   int    i;
+
+   if ( aligned )
+   {
+      b0 = esVec4LoadAligned ( srcB + 0 );
+      b1 = esVec4LoadAligned ( srcB + 4 );
+      b2 = esVec4LoadAligned ( srcB + 8 );
+      b3 = esVec4LoadAligned ( srcB + 12 );
+   }
+   else
+   {
+      b0 = esVec4Load ( srcB + 0 );
+      b1 = esVec4Load ( srcB + 4 );
+      b2 = esVec4Load ( srcB + 8 );
+      b3 = esVec4Load ( srcB + 12 );
+   }
+
+   for ( i = 0; i < 4; i++ )
+   {
+      const GLfloat *a = srcA + i * 4;
+      esVec4 row;
+
+      row = esVec4Mul ( esVec4Splat ( a[0] ), b0 );
+      row = esVec4MulAdd ( row, esVec4Splat ( a[1] ), b1 );
+      row = esVec4MulAdd ( row, esVec4Splat ( a[2] ), b2 );
+      row = esVec4MulAdd ( row, esVec4Splat ( a[3] ), b3 );
+
+      if ( aligned )
+      {
+         esVec4StoreAligned ( result + i * 4, row );
+      }
+      else
+      {
+         esVec4Store ( result + i * 4, row );
+      }
+   }
+}
+#endif
+
+///
+// MultiplySharedRight()
+//
+//    out[i] = a[i] * b for i in [begin, end).  b is held in registers for the
+//    whole range.
+//
+static void MultiplySharedRight ( ESMatrix *out, const ESMatrix *a, const ESMatrix *b, int begin, int end )
+{
+   int i;
+#if defined ( ES_SIMD_AVX )
+   __m256 b0 = _mm256_broadcast_ps ( ( const __m128 * ) b->m[0] );
+   __m256 b1 = _mm256_broadcast_ps ( ( const __m128 * ) b->m[1] );
+   __m256 b2 = _mm256_broadcast_ps ( ( const __m128 * ) b->m[2] );
+   __m256 b3 = _mm256_broadcast_ps ( ( const __m128 * ) b->m[3] );
+
+   for ( i = begin; i < end; i++ )
+   {
+      __m256 a01 = _mm256_loadu_ps ( a[i].m[0] );
+      __m256 a23 = _mm256_loadu_ps ( a[i].m[2] );
+      __m256 r01, r23;
+
+      r01 = _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0x00 ), b0 );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0x55 ), b1 ) );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0xAA ), b2 ) );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0xFF ), b3 ) );
+
+      r23 = _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0x00 ), b0 );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0x55 ), b1 ) );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0xAA ), b2 ) );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0xFF ), b3 ) );
+
+      _mm256_storeu_ps ( out[i].m[0], r01 );
+      _mm256_storeu_ps ( out[i].m[2], r23 );
+   }
+#elif defined ( ES_SIMD )
+   esVec4 b0 = esVec4Load ( b->m[0] );
+   esVec4 b1 = esVec4Load ( b->m[1] );
+   esVec4 b2 = esVec4Load ( b->m[2] );
+   esVec4 b3 = esVec4Load ( b->m[3] );
+
+   for ( i = begin; i < end; i++ )
+   {
+      int row;
+
+      for ( row = 0; row < 4; row++ )
+      {
+         const GLfloat *ar = a[i].m[row];
+         esVec4 r;
+
+         r = esVec4Mul ( esVec4Splat ( ar[0] ), b0 );
+         r = esVec4MulAdd ( r, esVec4Splat ( ar[1] ), b1 );
+         r = esVec4MulAdd ( r, esVec4Splat ( ar[2] ), b2 );
+         r = esVec4MulAdd ( r, esVec4Splat ( ar[3] ), b3 );
+         esVec4Store ( out[i].m[row], r );
+      }
+   }
+#else
+   for ( i = begin; i < end; i++ )
+   {
+      esMatrixMultiply ( &out[i], ( ESMatrix * ) &a[i], ( ESMatrix * ) b );
+   }
+#endif
+}
+
+///
+// MultiplySharedLeft()
+//
+//    out[i] = a * b[i] for i in [begin, end).  The splatted elements of a are
+//    computed once for the whole range.
+//
+static void MultiplySharedLeft ( ESMatrix *out, const ESMatrix *a, const ESMatrix *b, int begin, int end )
+{
+   int i;
+#if defined ( ES_SIMD )
+   esVec4 as[4][4];
+   int    row, col;
+
+   for ( row = 0; row < 4; row++ )
+   {
+      for ( col = 0; col < 4; col++ )
+      {
+         as[row][col] = esVec4Splat ( a->m[row][col] );
+      }
+   }
+
+   for ( i = begin; i < end; i++ )
+   {
+      esVec4 b0 = esVec4Load ( b[i].m[0] );
+      esVec4 b1 = esVec4Load ( b[i].m[1] );
+      esVec4 b2 = esVec4Load ( b[i].m[2] );
+      esVec4 b3 = esVec4Load ( b[i].m[3] );
+
+      for ( row = 0; row < 4; row++ )
+      {
+         esVec4 r;
+
+         r = esVec4Mul ( as[row][0], b0 );
+         r = esVec4MulAdd ( r, as[row][1], b1 );
+         r = esVec4MulAdd ( r, as[row][2], b2 );
+         r = esVec4MulAdd ( r, as[row][3], b3 );
+         esVec4Store ( out[i].m[row], r );
+      }
+   }
+#else
+   for ( i = begin; i < end; i++ )
+   {
+      esMatrixMultiply ( &out[i], ( ESMatrix * ) a, ( ESMatrix * ) &b[i] );
+   }
+#endif
+}
+
+///
+// MultiplyGather()
+//
+//    out[i] = a[i] * b[bIndex[i]] for i = index[begin] .. index[end - 1].  The
+//    rows of b stay in registers while consecutive elements share them, as
+//    siblings in a hierarchy level do.
+//
+static void MultiplyGather ( ESMatrix *out, const ESMatrix *a, const ESMatrix *b,
+                             const int *index, const int *bIndex, int begin, int end )
+{
+   int k;
+#if defined ( ES_SIMD_AVX )
+   __m256 b0 = _mm256_setzero_ps (), b1 = b0, b2 = b0, b3 = b0;
+   int    last = -1;
+
+   for ( k = begin; k < end; k++ )
+   {
+      int    i = index[k];
+      __m256 a01 = _mm256_loadu_ps ( a[i].m[0] );
+      __m256 a23 = _mm256_loadu_ps ( a[i].m[2] );
+      __m256 r01, r23;
+
+      if ( bIndex[i] != last )
+      {
+         last = bIndex[i];
+         b0 = _mm256_broadcast_ps ( ( const __m128 * ) b[last].m[0] );
+         b1 = _mm256_broadcast_ps ( ( const __m128 * ) b[last].m[1] );
+         b2 = _mm256_broadcast_ps ( ( const __m128 * ) b[last].m[2] );
+         b3 = _mm256_broadcast_ps ( ( const __m128 * ) b[last].m[3] );
+      }
+
+      r01 = _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0x00 ), b0 );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0x55 ), b1 ) );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0xAA ), b2 ) );
+      r01 = _mm256_add_ps ( r01, _mm256_mul_ps ( _mm256_shuffle_ps ( a01, a01, 0xFF ), b3 ) );
+
+      r23 = _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0x00 ), b0 );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0x55 ), b1 ) );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0xAA ), b2 ) );
+      r23 = _mm256_add_ps ( r23, _mm256_mul_ps ( _mm256_shuffle_ps ( a23, a23, 0xFF ), b3 ) );
+
+      _mm256_storeu_ps ( out[i].m[0], r01 );
+      _mm256_storeu_ps ( out[i].m[2], r23 );
+   }
+#elif defined ( ES_SIMD )
+   esVec4 b0 = esVec4Splat ( 0.0f ), b1 = b0, b2 = b0, b3 = b0;
+   int    last = -1;
+
+   for ( k = begin; k < end; k++ )
+   {
+      int i = index[k];
+      int row;
+
+      if ( bIndex[i] != last )
+      {
+         last = bIndex[i];
+         b0 = esVec4Load ( b[last].m[0] );
+         b1 = esVec4Load ( b[last].m[1] );
+         b2 = esVec4Load ( b[last].m[2] );
+         b3 = esVec4Load ( b[last].m[3] );
+      }
+
+      for ( row = 0; row < 4; row++ )
+      {
+         const GLfloat *ar = a[i].m[row];
+         esVec4 r;
+
+         r = esVec4Mul ( esVec4Splat ( ar[0] ), b0 );
+         r = esVec4MulAdd ( r, esVec4Splat ( ar[1] ), b1 );
+         r = esVec4MulAdd ( r, esVec4Splat ( ar[2] ), b2 );
+         r = esVec4MulAdd ( r, esVec4Splat ( ar[3] ), b3 );
+         esVec4Store ( out[i].m[row], r );
+      }
+   }
+#else
+   for ( k = begin; k < end; k++ )
+   {
+      int i = index[k];
+
+      esMatrixMultiply ( &out[i], ( ESMatrix * ) &a[i], ( ESMatrix * ) &b[bIndex[i]] );
+   }
+#endif
+}
+
+///
+// BatchMultiplyRange()
+//
+//    esParallelFor callback for the esMatrixMultiplyBatch* functions
+//
+static void BatchMultiplyRange ( void *context, int begin, int end )
+{
+   BatchMultiply *batch = ( BatchMultiply * ) context;
+   int            i;
+
+   switch ( batch->mode )
+   {
+      case BATCH_SHARED_RIGHT:
+         MultiplySharedRight ( batch->out, batch->a, batch->b, begin, end );
+         break;
+
+      case BATCH_SHARED_LEFT:
+         MultiplySharedLeft ( batch->out, batch->a, batch->b, begin, end );
+         break;
+
+      case BATCH_PAIRWISE:
+         for ( i = begin; i < end; i++ )
+         {
+            esMatrixMultiply ( &batch->out[i], ( ESMatrix * ) &batch->a[i], ( ESMatrix * ) &batch->b[i] );
+         }
+         break;
+
+      case BATCH_GATHER:
+         MultiplyGather ( batch->out, batch->a, batch->b, batch->index, batch->bIndex, begin, end );
+         break;
+   }
+}
+
+///
+// RunBatchMultiply()
+//
+//    Splits a batch multiply across the worker threads
+//
+static void RunBatchMultiply ( BatchMode mode, ESMatrix *out, const ESMatrix *a, const ESMatrix *b,
+                               const int *index, const int *bIndex, int n )
+{
+   BatchMultiply batch;
+
+   batch.mode = mode;
+   batch.out = out;
+   batch.a = a;
+   batch.b = b;
+   batch.index = index;
+   batch.bIndex = bIndex;
+
+   esParallelFor ( n, BATCH_MIN_PER_THREAD, BatchMultiplyRange, &batch );
+}
+
+///
+// TransformStrided()
+//
+//    Points, vectors or projected points [begin, end) of an interleaved array.
+//    The terms are accumulated in the same order as the scalar code, and each
+//    point is read before it is written so in and out may be the same array.
+//
+static void TransformStrided ( const PointTransform *job, int begin, int end )
+{
+   const ESMatrix *m = job->matrix;
+   int             translate = job->mode != TRANSFORM_VECTORS;
+   int             project = job->mode == TRANSFORM_PROJECT;
+   int             i;
+#if defined ( ES_SIMD )
+   esVec4 r0 = esVec4Load ( m->m[0] );
+   esVec4 r1 = esVec4Load ( m->m[1] );
+   esVec4 r2 = esVec4Load ( m->m[2] );
+   esVec4 r3 = esVec4Load ( m->m[3] );
+#endif
+
+   for ( i = begin; i < end; i++ )
+   {
+      const GLfloat *p = ( const GLfloat * ) ( job->in + ( size_t ) i * job->inStride );
+      GLfloat       *q = ( GLfloat * ) ( job->out + ( size_t ) i * job->outStride );
+      GLfloat        r[4];
+#if defined ( ES_SIMD )
+      esVec4         v;
+
+      v = esVec4Mul ( esVec4Splat ( p[0] ), r0 );
+      v = esVec4MulAdd ( v, esVec4Splat ( p[1] ), r1 );
+      v = esVec4MulAdd ( v, esVec4Splat ( p[2] ), r2 );
+
+      if ( translate )
+      {
+         v = esVec4Add ( v, r3 );
+      }
+
+      esVec4Store ( r, v );
+#else
+      GLfloat x = p[0], y = p[1], z = p[2];
+      int     j;
+
+      for ( j = 0; j < 4; j++ )
+      {
+         r[j] = x * m->m[0][j] + y * m->m[1][j] + z * m->m[2][j];
+
+         if ( translate )
+         {
+            r[j] += m->m[3][j];
+         }
+      }
+#endif
+
+      if ( project )
+      {
+         q[0] = r[0] / r[3];
+         q[1] = r[1] / r[3];
+         q[2] = r[2] / r[3];
+      }
+      else
+      {
+         q[0] = r[0];
+         q[1] = r[1];
+         q[2] = r[2];
+      }
+   }
+}
+
+///
+// TransformSoA()
+//
+//    Points [begin, end) of separate x, y, z arrays, four at a time with SIMD
+//
+static void TransformSoA ( const PointTransform *job, int begin, int end )
+{
+   const ESMatrix *m = job->matrix;
+   const GLfloat  *inX = job->inSoA[0], *inY = job->inSoA[1], *inZ = job->inSoA[2];
+   GLfloat        *outX = job->outSoA[0], *outY = job->outSoA[1], *outZ = job->outSoA[2];
+   int             i = begin;
+
+#if defined ( ES_SIMD )
+   for ( ; i + 4 <= end; i += 4 )
+   {
+      esVec4 x = esVec4Load ( inX + i );
+      esVec4 y = esVec4Load ( inY + i );
+      esVec4 z = esVec4Load ( inZ + i );
+      esVec4 tx, ty, tz;
+
+      tx = esVec4Mul ( x, esVec4Splat ( m->m[0][0] ) );
+      tx = esVec4MulAdd ( tx, y, esVec4Splat ( m->m[1][0] ) );
+      tx = esVec4MulAdd ( tx, z, esVec4Splat ( m->m[2][0] ) );
+      tx = esVec4Add ( tx, esVec4Splat ( m->m[3][0] ) );
+
+      ty = esVec4Mul ( x, esVec4Splat ( m->m[0][1] ) );
+      ty = esVec4MulAdd ( ty, y, esVec4Splat ( m->m[1][1] ) );
+      ty = esVec4MulAdd ( ty, z, esVec4Splat ( m->m[2][1] ) );
+      ty = esVec4Add ( ty, esVec4Splat ( m->m[3][1] ) );
+
+      tz = esVec4Mul ( x, esVec4Splat ( m->m[0][2] ) );
+      tz = esVec4MulAdd ( tz, y, esVec4Splat ( m->m[1][2] ) );
+      tz = esVec4MulAdd ( tz, z, esVec4Splat ( m->m[2][2] ) );
+      tz = esVec4Add ( tz, esVec4Splat ( m->m[3][2] ) );
+
+      esVec4Store ( outX + i, tx );
+      esVec4Store ( outY + i, ty );
+      esVec4Store ( outZ + i, tz );
+   }
+#endif
+
+   for ( ; i < end; i++ )
+   {
+      GLfloat x = inX[i], y = inY[i], z = inZ[i];
+
+      outX[i] = x * m->m[0][0] + y * m->m[1][0] + z * m->m[2][0] + m->m[3][0];
+      outY[i] = x * m->m[0][1] + y * m->m[1][1] + z * m->m[2][1] + m->m[3][1];
+      outZ[i] = x * m->m[0][2] + y * m->m[1][2] + z * m->m[2][2] + m->m[3][2];
+   }
+}
+
+///
+// TransformRange()
+//
+//    esParallelFor callback for esTransformPoints and friends
+//
+static void TransformRange ( void *context, int begin, int end )
+{
+   const PointTransform *job = ( const PointTransform * ) context;
+
+   if ( job->mode == TRANSFORM_POINTS_SOA )
+   {
+      TransformSoA ( job, begin, end );
+   }
+   else
+   {
+      TransformStrided ( job, begin, end );
+   }
+}
+
+///
+// RunTransform()
+//
+static void RunTransform ( TransformMode mode, const ESMatrix *matrix,
+                           const GLfloat *in, int inStride, GLfloat *out, int outStride, int count )
+{
+   PointTransform job;
+
+   memset ( &job, 0, sizeof ( job ) );
+   job.mode = mode;
+   job.matrix = matrix;
+   job.in = ( const GLubyte * ) in;
+   job.out = ( GLubyte * ) out;
+   job.inStride = inStride != 0 ? inStride : ( int ) ( 3 * sizeof ( GLfloat ) );
+   job.outStride = outStride != 0 ? outStride : ( int ) ( 3 * sizeof ( GLfloat ) );
+
+   esParallelFor ( count, TRANSFORM_MIN_PER_THREAD, TransformRange, &job );
+}
+
+#if defined ( ES_SIMD_SSE )
+#define SHUFFLE_MASK( x, y, z, w )    ( ( x ) | ( ( y ) << 2 ) | ( ( z ) << 4 ) | ( ( w ) << 6 ) )
+#define SWIZZLE( v, x, y, z, w )      _mm_shuffle_ps ( v, v, SHUFFLE_MASK ( x, y, z, w ) )
+#define SHUFFLE( a, b, x, y, z, w )   _mm_shuffle_ps ( a, b, SHUFFLE_MASK ( x, y, z, w ) )
+
+///
+// Mat2Mul(), Mat2AdjMul(), Mat2MulAdj()
+//
+//    2x2 row-major products packed in one register: A * B, adj(A) * B and A * adj(B)
+//
+static __m128 Mat2Mul ( __m128 a, __m128 b )
+{
+   return _mm_add_ps ( _mm_mul_ps ( a, SWIZZLE ( b, 0, 3, 0, 3 ) ),
+                       _mm_mul_ps ( SWIZZLE ( a, 1, 0, 3, 2 ), SWIZZLE ( b, 2, 1, 2, 1 ) ) );
+}
+
+static __m128 Mat2AdjMul ( __m128 a, __m128 b )
+{
+   return _mm_sub_ps ( _mm_mul_ps ( SWIZZLE ( a, 3, 3, 0, 0 ), b ),
+                       _mm_mul_ps ( SWIZZLE ( a, 1, 1, 2, 2 ), SWIZZLE ( b, 2, 3, 0, 1 ) ) );
+}
+
+static __m128 Mat2MulAdj ( __m128 a, __m128 b )
+{
+   return _mm_sub_ps ( _mm_mul_ps ( a, SWIZZLE ( b, 3, 0, 3, 0 ) ),
+                       _mm_mul_ps ( SWIZZLE ( a, 1, 0, 3, 2 ), SWIZZLE ( b, 2, 1, 2, 1 ) ) );
+}
+
+///
+// MatrixInverseSSE()
+//
+//    General 4x4 inverse by 2x2 block decomposition.  The matrix is split
+//    into blocks | A B ; C D | and the inverse assembled from their adjugates.
+//
+static GLboolean MatrixInverseSSE ( GLfloat *result, const GLfloat *src )
+{
+   __m128 r0 = _mm_loadu_ps ( src + 0 );
+   __m128 r1 = _mm_loadu_ps ( src + 4 );
+   __m128 r2 = _mm_loadu_ps ( src + 8 );
+   __m128 r3 = _mm_loadu_ps ( src + 12 );
+   __m128 a = _mm_movelh_ps ( r0, r1 );
+   __m128 b = _mm_movehl_ps ( r1, r0 );
+   __m128 c = _mm_movelh_ps ( r2, r3 );
+   __m128 d = _mm_movehl_ps ( r3, r2 );
+   __m128 detSub, detA, detB, detC, detD, detM;
+   __m128 dc, ab, x, y, z, w, tr, rDetM;
+
+   // ( |A|, |B|, |C|, |D| )
+   detSub = _mm_sub_ps ( _mm_mul_ps ( SHUFFLE ( r0, r2, 0, 2, 0, 2 ), SHUFFLE ( r1, r3, 1, 3, 1, 3 ) ),
+                         _mm_mul_ps ( SHUFFLE ( r0, r2, 1, 3, 1, 3 ), SHUFFLE ( r1, r3, 0, 2, 0, 2 ) ) );
+   detA = SWIZZLE ( detSub, 0, 0, 0, 0 );
+   detB = SWIZZLE ( detSub, 1, 1, 1, 1 );
+   detC = SWIZZLE ( detSub, 2, 2, 2, 2 );
+   detD = SWIZZLE ( detSub, 3, 3, 3, 3 );
+
+   dc = Mat2AdjMul ( d, c );
+   ab = Mat2AdjMul ( a, b );
+   x = _mm_sub_ps ( _mm_mul_ps ( detD, a ), Mat2Mul ( b, dc ) );
+   w = _mm_sub_ps ( _mm_mul_ps ( detA, d ), Mat2Mul ( c, ab ) );
+   y = _mm_sub_ps ( _mm_mul_ps ( detB, c ), Mat2MulAdj ( d, ab ) );
+   z = _mm_sub_ps ( _mm_mul_ps ( detC, b ), Mat2MulAdj ( a, dc ) );
+
+   // |M| = |A||D| + |B||C| - tr ( adj(A) B adj(D) C )
+   tr = _mm_mul_ps ( ab, SWIZZLE ( dc, 0, 2, 1, 3 ) );
+   tr = _mm_add_ps ( tr, _mm_movehl_ps ( tr, tr ) );
+   tr = _mm_add_ps ( tr, SWIZZLE ( tr, 1, 1, 1, 1 ) );
+   detM = _mm_add_ps ( _mm_mul_ps ( detA, detD ), _mm_mul_ps ( detB, detC ) );
+   detM = _mm_sub_ps ( detM, SWIZZLE ( tr, 0, 0, 0, 0 ) );
+
+   if ( _mm_cvtss_f32 ( detM ) == 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   rDetM = _mm_div_ps ( _mm_setr_ps ( 1.0f, -1.0f, -1.0f, 1.0f ), detM );
+   x = _mm_mul_ps ( x, rDetM );
+   y = _mm_mul_ps ( y, rDetM );
+   z = _mm_mul_ps ( z, rDetM );
+   w = _mm_mul_ps ( w, rDetM );
+
+   // Undo the adjugate and block packing while storing
+   _mm_storeu_ps ( result + 0,  SHUFFLE ( x, y, 3, 1, 3, 1 ) );
+   _mm_storeu_ps ( result + 4,  SHUFFLE ( x, y, 2, 0, 2, 0 ) );
+   _mm_storeu_ps ( result + 8,  SHUFFLE ( z, w, 3, 1, 3, 1 ) );
+   _mm_storeu_ps ( result + 12, SHUFFLE ( z, w, 2, 0, 2, 0 ) );
+
+   return GL_TRUE;
+}
+
+///
+// MatrixDeterminantSSE()
+//
+//    |M| from the same 2x2 blocks as MatrixInverseSSE
+//
+static GLfloat MatrixDeterminantSSE ( const GLfloat *src )
+{
+   __m128 r0 = _mm_loadu_ps ( src + 0 );
+   __m128 r1 = _mm_loadu_ps ( src + 4 );
+   __m128 r2 = _mm_loadu_ps ( src + 8 );
+   __m128 r3 = _mm_loadu_ps ( src + 12 );
+   __m128 a = _mm_movelh_ps ( r0, r1 );
+   __m128 b = _mm_movehl_ps ( r1, r0 );
+   __m128 c = _mm_movelh_ps ( r2, r3 );
+   __m128 d = _mm_movehl_ps ( r3, r2 );
+   __m128 detSub, ab, dc, tr, detM;
+
+   detSub = _mm_sub_ps ( _mm_mul_ps ( SHUFFLE ( r0, r2, 0, 2, 0, 2 ), SHUFFLE ( r1, r3, 1, 3, 1, 3 ) ),
+                         _mm_mul_ps ( SHUFFLE ( r0, r2, 1, 3, 1, 3 ), SHUFFLE ( r1, r3, 0, 2, 0, 2 ) ) );
+   dc = Mat2AdjMul ( d, c );
+   ab = Mat2AdjMul ( a, b );
+
+   tr = _mm_mul_ps ( ab, SWIZZLE ( dc, 0, 2, 1, 3 ) );
+   tr = _mm_add_ps ( tr, _mm_movehl_ps ( tr, tr ) );
+   tr = _mm_add_ps ( tr, SWIZZLE ( tr, 1, 1, 1, 1 ) );
+   detM = _mm_add_ps ( _mm_mul_ps ( SWIZZLE ( detSub, 0, 0, 0, 0 ), SWIZZLE ( detSub, 3, 3, 3, 3 ) ),
+                       _mm_mul_ps ( SWIZZLE ( detSub, 1, 1, 1, 1 ), SWIZZLE ( detSub, 2, 2, 2, 2 ) ) );
+
+   return _mm_cvtss_f32 ( _mm_sub_ps ( detM, tr ) );
+}
+
+///
+// Cross3SSE()
+//
+//    Cross product of the xyz lanes; w comes out as 0
+//
+static __m128 Cross3SSE ( __m128 a, __m128 b )
+{
+   return _mm_sub_ps ( _mm_mul_ps ( SWIZZLE ( a, 1, 2, 0, 3 ), SWIZZLE ( b, 2, 0, 1, 3 ) ),
+                       _mm_mul_ps ( SWIZZLE ( a, 2, 0, 1, 3 ), SWIZZLE ( b, 1, 2, 0, 3 ) ) );
+}
+
+///
+// MatrixInverseTranspose3x3SSE()
+//
+//    The cofactor rows of the upper 3x3 are cross products of the other two rows
+//
+static GLboolean MatrixInverseTranspose3x3SSE ( GLfloat result[3][3], const ESMatrix *src )
+{
+   __m128  m0 = _mm_loadu_ps ( src->m[0] );
+   __m128  m1 = _mm_loadu_ps ( src->m[1] );
+   __m128  m2 = _mm_loadu_ps ( src->m[2] );
+   __m128  c0 = Cross3SSE ( m1, m2 );
+   __m128  c1 = Cross3SSE ( m2, m0 );
+   __m128  c2 = Cross3SSE ( m0, m1 );
+   __m128  det = _mm_mul_ps ( m0, c0 );
+   __m128  invDet;
+   GLfloat last[4];
+
+   det = _mm_add_ss ( _mm_add_ss ( det, SWIZZLE ( det, 1, 1, 1, 1 ) ), SWIZZLE ( det, 2, 2, 2, 2 ) );
+
+   if ( _mm_cvtss_f32 ( det ) == 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   invDet = _mm_div_ps ( _mm_set1_ps ( 1.0f ), SWIZZLE ( det, 0, 0, 0, 0 ) );
+
+   // Each four-float store spills into the next row, which is written after it
+   _mm_storeu_ps ( result[0], _mm_mul_ps ( c0, invDet ) );
+   _mm_storeu_ps ( result[1], _mm_mul_ps ( c1, invDet ) );
+   _mm_storeu_ps ( last, _mm_mul_ps ( c2, invDet ) );
+   result[2][0] = last[0];
+   result[2][1] = last[1];
+   result[2][2] = last[2];
+
+   return GL_TRUE;
+}
+#endif
+
+#if !defined ( ES_SIMD_SSE )
+///
+// MatrixInverseScalar()
+//
+//    General 4x4 inverse from the twelve 2x2 sub-determinants of the upper
+//    and lower row pairs (Laplace expansion)
+//
+static GLboolean MatrixInverseScalar ( ESMatrix *result, const ESMatrix *src )
+{
+   const GLfloat ( *a ) [4] = src->m;
+   GLfloat  s0, s1, s2, s3, s4, s5, c0, c1, c2, c3, c4, c5;
+   GLfloat  det, invDet;
+   ESMatrix inv;
+
+   s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+   s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+   s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+   s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+   s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+   s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+   c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+   c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+   c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+   c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+   c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+   c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+   det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+   if ( det == 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   invDet = 1.0f / det;
+
+   inv.m[0][0] = (  a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3 ) * invDet;
+   inv.m[0][1] = ( -a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3 ) * invDet;
+   inv.m[0][2] = (  a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3 ) * invDet;
+   inv.m[0][3] = ( -a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3 ) * invDet;
+
+   inv.m[1][0] = ( -a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1 ) * invDet;
+   inv.m[1][1] = (  a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1 ) * invDet;
+   inv.m[1][2] = ( -a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1 ) * invDet;
+   inv.m[1][3] = (  a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1 ) * invDet;
+
+   inv.m[2][0] = (  a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0 ) * invDet;
+   inv.m[2][1] = ( -a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0 ) * invDet;
+   inv.m[2][2] = (  a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0 ) * invDet;
+   inv.m[2][3] = ( -a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0 ) * invDet;
+
+   inv.m[3][0] = ( -a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0 ) * invDet;
+   inv.m[3][1] = (  a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0 ) * invDet;
+   inv.m[3][2] = ( -a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0 ) * invDet;
+   inv.m[3][3] = (  a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0 ) * invDet;
+
+   memcpy ( result, &inv, sizeof ( ESMatrix ) );
+   return GL_TRUE;
+}
+#endif
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
 void ESUTIL_API
 esScale ( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz )
 {
+#if defined ( ES_SIMD )
+   esVec4Store ( result->m[0], esVec4Mul ( esVec4Load ( result->m[0] ), esVec4Splat ( sx ) ) );
+   esVec4Store ( result->m[1], esVec4Mul ( esVec4Load ( result->m[1] ), esVec4Splat ( sy ) ) );
+   esVec4Store ( result->m[2], esVec4Mul ( esVec4Load ( result->m[2] ), esVec4Splat ( sz ) ) );
+#else
    result->m[0][0] *= sx;
    result->m[0][1] *= sx;
    result->m[0][2] *= sx;
@@ -62,15 +854,23 @@ esScale ( ESMatrix *result, GLfloat sx, GLfloat sy, GLfloat sz )
    result->m[2][1] *= sz;
    result->m[2][2] *= sz;
    result->m[2][3] *= sz;
+#endif
 }
 
 void ESUTIL_API
 esTranslate ( ESMatrix *result, GLfloat tx, GLfloat ty, GLfloat tz )
 {
+#if defined ( ES_SIMD )
+   esVec4 t = esVec4Mul ( esVec4Load ( result->m[0] ), esVec4Splat ( tx ) );
+   t = esVec4MulAdd ( t, esVec4Load ( result->m[1] ), esVec4Splat ( ty ) );
+   t = esVec4MulAdd ( t, esVec4Load ( result->m[2] ), esVec4Splat ( tz ) );
+   esVec4Store ( result->m[3], esVec4Add ( esVec4Load ( result->m[3] ), t ) );
+#else
    result->m[3][0] += ( result->m[0][0] * tx + result->m[1][0] * ty + result->m[2][0] * tz );
    result->m[3][1] += ( result->m[0][1] * tx + result->m[1][1] * ty + result->m[2][1] * tz );
    result->m[3][2] += ( result->m[0][2] * tx + result->m[1][2] * ty + result->m[2][2] * tz );
    result->m[3][3] += ( result->m[0][3] * tx + result->m[1][3] * ty + result->m[2][3] * tz );
+#endif
 }
 
 void ESUTIL_API
@@ -198,6 +998,11 @@ esOrtho ( ESMatrix *result, float left, float right, float bottom, float top, fl
 void ESUTIL_API
 esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB )
 {
+#if defined ( ES_SIMD_AVX )
+   MatrixMultiplyAVX ( &result->m[0][0], &srcA->m[0][0], &srcB->m[0][0] );
+#elif defined ( ES_SIMD )
+   MatrixMultiplySIMD ( &result->m[0][0], &srcA->m[0][0], &srcB->m[0][0], GL_FALSE );
+#else
    ESMatrix    tmp;
    int         i;
 
@@ -225,6 +1030,83 @@ esMatrixMultiply ( ESMatrix *result, ESMatrix *srcA, ESMatrix *srcB )
    }
 
    memcpy ( result, &tmp, sizeof ( ESMatrix ) );
+#endif
+}
+
+void ESUTIL_API
+esMatrixMultiplyAligned ( ESMatrixA *result, const ESMatrixA *srcA, const ESMatrixA *srcB )
+{
+#if defined ( ES_SIMD_AVX )
+   MatrixMultiplyAVX ( &result->m[0][0], &srcA->m[0][0], &srcB->m[0][0] );
+#elif defined ( ES_SIMD )
+   MatrixMultiplySIMD ( &result->m[0][0], &srcA->m[0][0], &srcB->m[0][0], GL_TRUE );
+#else
+   esMatrixMultiply ( ( ESMatrix * ) result, ( ESMatrix * ) srcA, ( ESMatrix * ) srcB );
+#endif
+}
+
+
+void ESUTIL_API
+esMatrixMultiplyBatch ( ESMatrix *out, const ESMatrix *a, const ESMatrix *sharedB, int n )
+{
+   RunBatchMultiply ( BATCH_SHARED_RIGHT, out, a, sharedB, NULL, NULL, n );
+}
+
+void ESUTIL_API
+esMatrixMultiplyBatchLeft ( ESMatrix *out, const ESMatrix *sharedA, const ESMatrix *b, int n )
+{
+   RunBatchMultiply ( BATCH_SHARED_LEFT, out, sharedA, b, NULL, NULL, n );
+}
+
+void ESUTIL_API
+esMatrixMultiplyBatchPairwise ( ESMatrix *out, const ESMatrix *a, const ESMatrix *b, int n )
+{
+   RunBatchMultiply ( BATCH_PAIRWISE, out, a, b, NULL, NULL, n );
+}
+
+void ESUTIL_API
+esMatrixMultiplyBatchGather ( ESMatrix *out, const ESMatrix *a, const ESMatrix *b,
+                              const int *index, const int *bIndex, int n )
+{
+   RunBatchMultiply ( BATCH_GATHER, out, a, b, index, bIndex, n );
+}
+
+void ESUTIL_API
+esTransformPoints ( const ESMatrix *matrix, const GLfloat *in, int inStride, GLfloat *out, int outStride, int count )
+{
+   RunTransform ( TRANSFORM_POINTS, matrix, in, inStride, out, outStride, count );
+}
+
+void ESUTIL_API
+esTransformVectors ( const ESMatrix *matrix, const GLfloat *in, int inStride, GLfloat *out, int outStride, int count )
+{
+   RunTransform ( TRANSFORM_VECTORS, matrix, in, inStride, out, outStride, count );
+}
+
+void ESUTIL_API
+esProjectPoints ( const ESMatrix *matrix, const GLfloat *in, int inStride, GLfloat *out, int outStride, int count )
+{
+   RunTransform ( TRANSFORM_PROJECT, matrix, in, inStride, out, outStride, count );
+}
+
+void ESUTIL_API
+esTransformPointsSoA ( const ESMatrix *matrix,
+                       const GLfloat *inX, const GLfloat *inY, const GLfloat *inZ,
+                       GLfloat *outX, GLfloat *outY, GLfloat *outZ, int count )
+{
+   PointTransform job;
+
+   memset ( &job, 0, sizeof ( job ) );
+   job.mode = TRANSFORM_POINTS_SOA;
+   job.matrix = matrix;
+   job.inSoA[0] = inX;
+   job.inSoA[1] = inY;
+   job.inSoA[2] = inZ;
+   job.outSoA[0] = outX;
+   job.outSoA[1] = outY;
+   job.outSoA[2] = outZ;
+
+   esParallelFor ( count, TRANSFORM_MIN_PER_THREAD, TransformRange, &job );
 }
 
 
@@ -312,3 +1194,374 @@ esMatrixLookAt ( ESMatrix *result,
    result->m[3][2] =  axisZ[0] * posX + axisZ[1] * posY + axisZ[2] * posZ;
    result->m[3][3] = 1.0f;
 }
+
+void ESUTIL_API
+esAffineLoadIdentity ( ESAffine *result )
+{
+   memset ( result, 0x0, sizeof ( ESAffine ) );
+   result->m[0][0] = 1.0f;
+   result->m[1][1] = 1.0f;
+   result->m[2][2] = 1.0f;
+}
+
+void ESUTIL_API
+esAffineFromMatrix ( ESAffine *result, const ESMatrix *src )
+{
+   int row;
+
+   for ( row = 0; row < 3; row++ )
+   {
+      result->m[row][0] = src->m[0][row];
+      result->m[row][1] = src->m[1][row];
+      result->m[row][2] = src->m[2][row];
+      result->m[row][3] = src->m[3][row];
+   }
+}
+
+void ESUTIL_API
+esAffineToMatrix ( ESMatrix *result, const ESAffine *src )
+{
+   int col;
+
+   for ( col = 0; col < 4; col++ )
+   {
+      result->m[col][0] = src->m[0][col];
+      result->m[col][1] = src->m[1][col];
+      result->m[col][2] = src->m[2][col];
+      result->m[col][3] = 0.0f;
+   }
+
+   result->m[3][3] = 1.0f;
+}
+
+void ESUTIL_API
+esAffineMultiply ( ESAffine *result, const ESAffine *srcA, const ESAffine *srcB )
+{
+   // In ESAffine storage result = srcA * srcB is the row-major product B * A,
+   // and the constant [0 0 0 1] row of A only contributes B's translation.
+#if defined ( ES_SIMD )
+   esVec4 a0 = esVec4Load ( srcA->m[0] );
+   esVec4 a1 = esVec4Load ( srcA->m[1] );
+   esVec4 a2 = esVec4Load ( srcA->m[2] );
+   int    row;
+
+   for ( row = 0; row < 3; row++ )
+   {
+      const GLfloat *b = srcB->m[row];
+      GLfloat        t[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      esVec4         r;
+
+      t[3] = b[3];
+      r = esVec4Mul ( esVec4Splat ( b[0] ), a0 );
+      r = esVec4MulAdd ( r, esVec4Splat ( b[1] ), a1 );
+      r = esVec4MulAdd ( r, esVec4Splat ( b[2] ), a2 );
+      esVec4Store ( result->m[row], esVec4Add ( r, esVec4Load ( t ) ) );
+   }
+#else
+   ESAffine tmp;
+   int      row;
+
+   for ( row = 0; row < 3; row++ )
+   {
+      const GLfloat *b = srcB->m[row];
+
+      tmp.m[row][0] = b[0] * srcA->m[0][0] + b[1] * srcA->m[1][0] + b[2] * srcA->m[2][0];
+      tmp.m[row][1] = b[0] * srcA->m[0][1] + b[1] * srcA->m[1][1] + b[2] * srcA->m[2][1];
+      tmp.m[row][2] = b[0] * srcA->m[0][2] + b[1] * srcA->m[1][2] + b[2] * srcA->m[2][2];
+      tmp.m[row][3] = b[0] * srcA->m[0][3] + b[1] * srcA->m[1][3] + b[2] * srcA->m[2][3] + b[3];
+   }
+
+   memcpy ( result, &tmp, sizeof ( ESAffine ) );
+#endif
+}
+
+void ESUTIL_API
+esAffineMultiplyMatrix ( ESMatrix *result, const ESAffine *srcA, const ESMatrix *srcB )
+{
+   ESMatrix tmp;
+   int      row;
+
+   // Rows 0-2 of the equivalent ESMatrix end in 0, row 3 ends in 1, so each
+   // result row needs three products instead of four.
+   for ( row = 0; row < 4; row++ )
+   {
+      GLfloat a0 = srcA->m[0][row];
+      GLfloat a1 = srcA->m[1][row];
+      GLfloat a2 = srcA->m[2][row];
+#if defined ( ES_SIMD )
+      esVec4  r;
+
+      r = esVec4Mul ( esVec4Splat ( a0 ), esVec4Load ( srcB->m[0] ) );
+      r = esVec4MulAdd ( r, esVec4Splat ( a1 ), esVec4Load ( srcB->m[1] ) );
+      r = esVec4MulAdd ( r, esVec4Splat ( a2 ), esVec4Load ( srcB->m[2] ) );
+
+      if ( row == 3 )
+      {
+         r = esVec4Add ( r, esVec4Load ( srcB->m[3] ) );
+      }
+
+      esVec4Store ( tmp.m[row], r );
+#else
+      int     col;
+
+      for ( col = 0; col < 4; col++ )
+      {
+         tmp.m[row][col] = a0 * srcB->m[0][col] + a1 * srcB->m[1][col] + a2 * srcB->m[2][col];
+
+         if ( row == 3 )
+         {
+            tmp.m[row][col] += srcB->m[3][col];
+         }
+      }
+#endif
+   }
+
+   memcpy ( result, &tmp, sizeof ( ESMatrix ) );
+}
+
+void ESUTIL_API
+esAffineTranslate ( ESAffine *result, GLfloat tx, GLfloat ty, GLfloat tz )
+{
+   int row;
+
+   for ( row = 0; row < 3; row++ )
+   {
+      result->m[row][3] += result->m[row][0] * tx + result->m[row][1] * ty + result->m[row][2] * tz;
+   }
+}
+
+void ESUTIL_API
+esAffineScale ( ESAffine *result, GLfloat sx, GLfloat sy, GLfloat sz )
+{
+#if defined ( ES_SIMD )
+   GLfloat s[4];
+   esVec4  scale;
+
+   s[0] = sx;
+   s[1] = sy;
+   s[2] = sz;
+   s[3] = 1.0f;
+   scale = esVec4Load ( s );
+
+   esVec4Store ( result->m[0], esVec4Mul ( esVec4Load ( result->m[0] ), scale ) );
+   esVec4Store ( result->m[1], esVec4Mul ( esVec4Load ( result->m[1] ), scale ) );
+   esVec4Store ( result->m[2], esVec4Mul ( esVec4Load ( result->m[2] ), scale ) );
+#else
+   int row;
+
+   for ( row = 0; row < 3; row++ )
+   {
+      result->m[row][0] *= sx;
+      result->m[row][1] *= sy;
+      result->m[row][2] *= sz;
+   }
+#endif
+}
+
+void ESUTIL_API
+esAffineRotate ( ESAffine *result, GLfloat angle, GLfloat x, GLfloat y, GLfloat z )
+{
+   GLfloat sinAngle, cosAngle;
+   GLfloat mag = sqrtf ( x * x + y * y + z * z );
+
+   sinAngle = sinf ( angle * PI / 180.0f );
+   cosAngle = cosf ( angle * PI / 180.0f );
+
+   if ( mag > 0.0f )
+   {
+      GLfloat  xx, yy, zz, xy, yz, zx, xs, ys, zs;
+      GLfloat  oneMinusCos;
+      ESAffine rot;
+
+      x /= mag;
+      y /= mag;
+      z /= mag;
+
+      xx = x * x;
+      yy = y * y;
+      zz = z * z;
+      xy = x * y;
+      yz = y * z;
+      zx = z * x;
+      xs = x * sinAngle;
+      ys = y * sinAngle;
+      zs = z * sinAngle;
+      oneMinusCos = 1.0f - cosAngle;
+
+      // Same rotation as esRotate, stored transposed
+      rot.m[0][0] = ( oneMinusCos * xx ) + cosAngle;
+      rot.m[1][0] = ( oneMinusCos * xy ) - zs;
+      rot.m[2][0] = ( oneMinusCos * zx ) + ys;
+
+      rot.m[0][1] = ( oneMinusCos * xy ) + zs;
+      rot.m[1][1] = ( oneMinusCos * yy ) + cosAngle;
+      rot.m[2][1] = ( oneMinusCos * yz ) - xs;
+
+      rot.m[0][2] = ( oneMinusCos * zx ) - ys;
+      rot.m[1][2] = ( oneMinusCos * yz ) + xs;
+      rot.m[2][2] = ( oneMinusCos * zz ) + cosAngle;
+
+      rot.m[0][3] = rot.m[1][3] = rot.m[2][3] = 0.0f;
+
+      esAffineMultiply ( result, &rot, result );
+   }
+}
+
+GLboolean ESUTIL_API
+esAffineInvert ( ESAffine *result, const ESAffine *src )
+{
+   const GLfloat ( *m ) [4] = src->m;
+   GLfloat  c00, c01, c02, det, invDet;
+   ESAffine inv;
+   int      row;
+
+   // Cofactors of the first column of the 3x3 part
+   c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+   c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+   c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+
+   det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+
+   if ( det == 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   invDet = 1.0f / det;
+
+   // inverse(3x3) = transpose(cofactors) / det
+   inv.m[0][0] = c00 * invDet;
+   inv.m[1][0] = c01 * invDet;
+   inv.m[2][0] = c02 * invDet;
+   inv.m[0][1] = ( m[0][2] * m[2][1] - m[0][1] * m[2][2] ) * invDet;
+   inv.m[1][1] = ( m[0][0] * m[2][2] - m[0][2] * m[2][0] ) * invDet;
+   inv.m[2][1] = ( m[0][1] * m[2][0] - m[0][0] * m[2][1] ) * invDet;
+   inv.m[0][2] = ( m[0][1] * m[1][2] - m[0][2] * m[1][1] ) * invDet;
+   inv.m[1][2] = ( m[0][2] * m[1][0] - m[0][0] * m[1][2] ) * invDet;
+   inv.m[2][2] = ( m[0][0] * m[1][1] - m[0][1] * m[1][0] ) * invDet;
+
+   // translation = -inverse(3x3) * t
+   for ( row = 0; row < 3; row++ )
+   {
+      inv.m[row][3] = - ( inv.m[row][0] * m[0][3] + inv.m[row][1] * m[1][3] + inv.m[row][2] * m[2][3] );
+   }
+
+   memcpy ( result, &inv, sizeof ( ESAffine ) );
+   return GL_TRUE;
+}
+
+void ESUTIL_API
+esAffineTransformPoint ( const ESAffine *src, const GLfloat in[3], GLfloat out[3] )
+{
+   GLfloat x = in[0], y = in[1], z = in[2];
+
+   out[0] = src->m[0][0] * x + src->m[0][1] * y + src->m[0][2] * z + src->m[0][3];
+   out[1] = src->m[1][0] * x + src->m[1][1] * y + src->m[1][2] * z + src->m[1][3];
+   out[2] = src->m[2][0] * x + src->m[2][1] * y + src->m[2][2] * z + src->m[2][3];
+}
+
+void ESUTIL_API
+esAffineTransformVector ( const ESAffine *src, const GLfloat in[3], GLfloat out[3] )
+{
+   GLfloat x = in[0], y = in[1], z = in[2];
+
+   out[0] = src->m[0][0] * x + src->m[0][1] * y + src->m[0][2] * z;
+   out[1] = src->m[1][0] * x + src->m[1][1] * y + src->m[1][2] * z;
+   out[2] = src->m[2][0] * x + src->m[2][1] * y + src->m[2][2] * z;
+}
+
+GLboolean ESUTIL_API
+esMatrixInverse ( ESMatrix *result, const ESMatrix *src )
+{
+#if defined ( ES_SIMD_SSE )
+   return MatrixInverseSSE ( &result->m[0][0], &src->m[0][0] );
+#else
+   return MatrixInverseScalar ( result, src );
+#endif
+}
+
+GLboolean ESUTIL_API
+esMatrixInverseAffine ( ESMatrix *result, const ESMatrix *src )
+{
+   ESAffine affine;
+
+   esAffineFromMatrix ( &affine, src );
+
+   if ( !esAffineInvert ( &affine, &affine ) )
+   {
+      return GL_FALSE;
+   }
+
+   esAffineToMatrix ( result, &affine );
+   return GL_TRUE;
+}
+
+GLfloat ESUTIL_API
+esMatrixDeterminant ( const ESMatrix *src )
+{
+#if defined ( ES_SIMD_SSE )
+   return MatrixDeterminantSSE ( &src->m[0][0] );
+#else
+   const GLfloat ( *a ) [4] = src->m;
+   GLfloat s0, s1, s2, s3, s4, s5, c0, c1, c2, c3, c4, c5;
+
+   s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+   s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+   s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+   s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+   s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+   s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+   c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+   c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+   c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+   c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+   c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+   c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+   return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+#endif
+}
+
+GLboolean ESUTIL_API
+esMatrixInverseTranspose3x3 ( GLfloat result[3][3], const ESMatrix *src )
+{
+#if defined ( ES_SIMD_SSE )
+   return MatrixInverseTranspose3x3SSE ( result, src );
+#else
+   const GLfloat ( *m ) [4] = src->m;
+   GLfloat c[3][3];
+   GLfloat det, invDet;
+   int     i, j;
+
+   // Cofactor matrix of the upper 3x3; inverse-transpose = cofactors / det
+   c[0][0] = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+   c[0][1] = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+   c[0][2] = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+   c[1][0] = m[0][2] * m[2][1] - m[0][1] * m[2][2];
+   c[1][1] = m[0][0] * m[2][2] - m[0][2] * m[2][0];
+   c[1][2] = m[0][1] * m[2][0] - m[0][0] * m[2][1];
+   c[2][0] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+   c[2][1] = m[0][2] * m[1][0] - m[0][0] * m[1][2];
+   c[2][2] = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+
+   det = m[0][0] * c[0][0] + m[0][1] * c[0][1] + m[0][2] * c[0][2];
+
+   if ( det == 0.0f )
+   {
+      return GL_FALSE;
+   }
+
+   invDet = 1.0f / det;
+
+   for ( i = 0; i < 3; i++ )
+   {
+      for ( j = 0; j < 3; j++ )
+      {
+         result[i][j] = c[i][j] * invDet;
+      }
+   }
+
+   return GL_TRUE;
+#endif
+}
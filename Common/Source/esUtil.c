@@ -422,7 +422,7 @@ char *ESUTIL_API esLoadTGA ( void *ioContext, const char *fileName, int *width,
       int bytesToRead = sizeof ( char ) * ( *width ) * ( *height ) * Header.ColorDepth / 8;
 
       // Allocate the image data buffer
-      buffer = ( char * ) malloc ( bytesToRead );
+      buffer = ( char * ) esMalloc ( bytesToRead );
 
       if ( buffer )
       {
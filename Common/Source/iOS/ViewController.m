@@ -138,6 +138,9 @@ extern void esMain( ESContext *esContext );
     {
         _esContext.drawFunc( &_esContext );
     }
+
+    // GLKit presents the frame on return
+    esFrameReset();
 }
 
 